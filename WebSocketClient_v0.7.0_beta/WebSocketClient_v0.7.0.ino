@@ -14,6 +14,9 @@
 
 #include "wsBasicHttpClient.h"
 #include "webSocket.h"
+#include "webSocketJson.h"
+#include "webSocketReconnect.h"
+#include "webSocketQueue.h"
 
 #define USE_SERIAL Serial
 
@@ -21,6 +24,7 @@
 const char* ssid = "your_ssid";
 const char* password = "your_password";
 ESP8266WiFiMulti WiFiMulti;
+wsHTTPClient g_http;
 
 void setup() {
 
@@ -40,73 +44,37 @@ void setup() {
   WiFiMulti.addAP(ssid, password);
 
   webSocket_init();
-}
 
-wsHTTPClient g_http;
+  // configure traged server and url once, the request is reused
+  g_http.begin("ws://YOUR_PHP_SERVER:8080/WebSocketPHP/server.php"); //HTTP
+  // g_http.begin("wss://YOUR_TLS_SERVER/WebSocketPHP/server.php"); // WEBSOCKET_TLS
+  // g_http.setFingerprint(serverFingerprint);
+  g_http.setReuse(true);//keep-alive
+  g_http.setUpgrade(true);//keep-Upgrade
+  g_http.addHeader("Upgrade", "websocket");
+  g_http.addHeader("Sec-WebSocket-Version", "13");
+  g_http.addHeader("Sec-WebSocket-Key", "435M9dxxxAaUNpvBi0PRPA==");
+
+  webSocket_reconnectBegin(&g_http, wsSetHandles);
+}
 
 void loop() {
-  // wait for WiFi connection
-  if (!webSocket_isStart())
-  {
-    if ((WiFiMulti.run() == WL_CONNECTED))
-    {
-      USE_SERIAL.print("[HTTP] begin...\n");
-      // configure traged server and url
-      g_http.begin("http://YOUR_PHP_SERVER:8080/WebSocketPHP/server.php"); //HTTP
-      g_http.setReuse(true);//keep-alive
-      g_http.setUpgrade(true);//keep-Upgrade
-      g_http.addHeader("Upgrade", "websocket");
-      g_http.addHeader("Sec-WebSocket-Version", "13");
-      g_http.addHeader("Sec-WebSocket-Key", "435M9dxxxAaUNpvBi0PRPA==");
-
-      USE_SERIAL.print("[HTTP] GET...\n");
-      // start connection and send HTTP header
-      int httpCode = g_http.GET();
-
-      // httpCode will be negative on error
-      if (httpCode > 0)
-      {
-        // HTTP header has been send and Server response header has been handled
-        USE_SERIAL.printf("[HTTP] GET... code: %d\n", httpCode);
-
-        // file found at server
-        if (httpCode == HTTP_CODE_OK)
-        {
-          String payload = g_http.getString();
-          USE_SERIAL.println(payload);
-        }
-        else if (httpCode == HTTP_CODE_SWITCHING_PROTOCOLS)
-        {
-          USE_SERIAL.println("HTTP_CODE_SWITCHING_PROTOCOLS");
-          wsSetHandles();
-          webSocket_start();
-        }
-      }
-      else
-      {
-        USE_SERIAL.printf("[HTTP] GET... failed, error: %s\n", g_http.errorToString(httpCode).c_str());
-      }
-
-      if (!webSocket_isStart())
-      {
-        g_http.end();
-      }
-    }
+#ifdef WEBSOCKET_QUEUE
+  // flash work of the offline queue, also while webSocket_handle() is not run
+  webSocket_queuePoll();
+#endif // WEBSOCKET_QUEUE
 
-    delay(10000);
-  }
-  else
+  // wait for WiFi connection
+  if ((WiFiMulti.run() == WL_CONNECTED) && webSocket_reconnectHandle())
   {
-    WiFiClient g_client;
-    g_client = g_http.getStream();
-    webSocket_handle(g_client);
+    // by reference, the stream is a TLS client for wss://
+    webSocket_handle(g_http.getStream());
 
     if (USE_SERIAL.available())
     {
-      String str = "";
-      str = "{\"message\":\"" + USE_SERIAL.readString() + "\",\"name\":\"ESPr\",\"color\":\"F00\"}";
-      webSocket_setData(str);
-      USE_SERIAL.println(str);
+      String message = USE_SERIAL.readString();
+      sendChatMessage(message.c_str(), message.length());
+      USE_SERIAL.println(message);
     }
   }
 
@@ -126,16 +94,44 @@ void wsSetHandles(void)
   //      handleWebSocketRecivePong);
   webSocket_setHandler(WEBSOCKET_HANDLER_RECIVE, handleWebSocketRecive);
   webSocket_setHandler(WEBSOCKET_HANDLER_CLOSE, handleWebSocketClose);
+  webSocket_setHandler(WEBSOCKET_HANDLER_RESUME, handleWebSocketResume);
   webSocket_setHandler(WEBSOCKET_HANDLER_TIMEOUT_CLOSE,
                        handleWebSocketTimeOut);
 }
 
+// {"message":"...","name":"ESPr","color":"F00"} built in the send frame
+void sendChatMessage(const char *message, uint16_t length)
+{
+  WEB_SOCKET_JSON_WRITER json;
+
+  if (webSocket_jsonBegin(&json))
+  {
+    webSocket_jsonObjectBegin(&json);
+    webSocket_jsonKey(&json, "message");
+    webSocket_jsonStringN(&json, message, length);
+    webSocket_jsonKey(&json, "name");
+    webSocket_jsonString(&json, "ESPr");
+    webSocket_jsonKey(&json, "color");
+    webSocket_jsonString(&json, "F00");
+    webSocket_jsonObjectEnd(&json);
+    webSocket_jsonCommit(&json);
+  }
+}
+
 void handleWebSocketOpen(void)
 {
   Serial.println("handleWebSocketOpen>>>>>>>>>>>>>>>>>>>>");
-  String str = "{\"message\":\"Hello WebSocket\",\"name\":\"ESPr\",\"color\":\"F00\"}";
-  webSocket_setData(str);
-  USE_SERIAL.println(str);
+  Serial.print("connect: ");
+  Serial.print(g_http.getConnectTime()); // a resumed TLS session is much shorter
+  Serial.println(" msec");
+  sendChatMessage("Hello WebSocket", 15);
+}
+
+void handleWebSocketResume(void)
+{
+  Serial.print("handleWebSocketResume: after ");
+  Serial.print(webSocket_reconnectGetAttempt());
+  Serial.println(" attempts");
 }
 
 void handleWebSocketClose(void)
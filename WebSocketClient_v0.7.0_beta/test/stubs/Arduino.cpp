@@ -0,0 +1,156 @@
+// Definitions behind the host stand-ins of the Arduino core.
+
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include "Hash.h"
+
+uint32_t g_testMillis = 0;
+
+HardwareSerial Serial;
+EspClass ESP;
+ESP8266WiFiClass WiFi;
+WiFiClientServer g_testServer;
+
+unsigned long millis(void)
+{
+    return g_testMillis;
+}
+
+unsigned long micros(void)
+{
+    return g_testMillis * 1000ul;
+}
+
+void delay(unsigned long ms)
+{
+    g_testMillis += ms;
+}
+
+void yield(void)
+{
+}
+
+long random(long max)
+{
+    return (max > 0) ? (rand() % max) : 0;
+}
+
+long random(long min, long max)
+{
+    return min + random(max - min);
+}
+
+uint32_t EspClass::getCycleCount(void)
+{
+    return g_testMillis * 80000u;
+}
+
+static uint8_t g_flash[ESP_STUB_FLASH_SIZE];
+
+bool EspClass::flashEraseSector(uint32_t sector)
+{
+    if((sector + 1) * 4096u > sizeof(g_flash)) {
+        return false;
+    }
+
+    memset(&g_flash[sector * 4096u], 0xFF, 4096u);
+    flashErases++;
+
+    return true;
+}
+
+bool EspClass::flashWrite(uint32_t address, uint32_t *data, size_t size)
+{
+    const uint8_t *src = (const uint8_t *) data;
+
+    if((address & 3u) || (size & 3u) || (((uintptr_t) data) & 3u)
+       || (address + size > sizeof(g_flash))) {
+        return false;
+    }
+
+    for(size_t i = 0; i < size; i++) {
+        g_flash[address + i] &= src[i];
+    }
+
+    flashWrites++;
+
+    return true;
+}
+
+bool EspClass::flashRead(uint32_t address, uint32_t *data, size_t size)
+{
+    if((address & 3u) || (size & 3u) || (address + size > sizeof(g_flash))) {
+        return false;
+    }
+
+    memcpy(data, &g_flash[address], size);
+
+    return true;
+}
+
+static uint32_t sha1Rotate(uint32_t value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// FIPS 180-1, enough for the handshake keys
+void sha1(const uint8_t *data, uint32_t size, uint8_t hash[20])
+{
+    uint32_t h[5] = { 0x67452301u, 0xEFCDAB89u, 0x98BADCFEu, 0x10325476u, 0xC3D2E1F0u };
+    std::string message((const char *) data, size);
+    uint64_t bits = (uint64_t) size * 8u;
+
+    message += (char) 0x80;
+
+    while((message.size() % 64) != 56) {
+        message += (char) 0;
+    }
+
+    for(int i = 7; i >= 0; i--) {
+        message += (char)(bits >> (i * 8));
+    }
+
+    for(size_t block = 0; block < message.size(); block += 64) {
+        uint32_t w[80];
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+        for(int i = 0; i < 16; i++) {
+            const uint8_t *word = (const uint8_t *) &message[block + i * 4];
+            w[i] = ((uint32_t) word[0] << 24) | ((uint32_t) word[1] << 16)
+                   | ((uint32_t) word[2] << 8) | word[3];
+        }
+
+        for(int i = 16; i < 80; i++) {
+            w[i] = sha1Rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        for(int i = 0; i < 80; i++) {
+            uint32_t f = (i < 20) ? ((b & c) | (~b & d)) + 0x5A827999u
+                         : (i < 40) ? (b ^ c ^ d) + 0x6ED9EBA1u
+                         : (i < 60) ? ((b & c) | (b & d) | (c & d)) + 0x8F1BBCDCu
+                         : (b ^ c ^ d) + 0xCA62C1D6u;
+            uint32_t t = sha1Rotate(a, 5) + f + e + w[i];
+
+            e = d;
+            d = c;
+            c = sha1Rotate(b, 30);
+            b = a;
+            a = t;
+        }
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for(int i = 0; i < 20; i++) {
+        hash[i] = (uint8_t)(h[i / 4] >> (24 - (i % 4) * 8));
+    }
+}
+
+void sha1(const String &data, uint8_t hash[20])
+{
+    sha1((const uint8_t *) data.c_str(), data.length(), hash);
+}
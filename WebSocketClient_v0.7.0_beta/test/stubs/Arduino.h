@@ -0,0 +1,79 @@
+// Host stand-in for the parts of the ESP8266 Arduino core the sketch
+// sources use. Only enough to build and drive them from the host tests.
+
+#ifndef ARDUINO_STUB_H_
+#define ARDUINO_STUB_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define ICACHE_RAM_ATTR
+#define PSTR(s)		(s)
+#define F(s)		(s)
+#define snprintf_P	snprintf
+
+#define HEX			16
+#define DEC			10
+
+#define bitRead(value, bit)		(((value) >> (bit)) & 0x01)
+#define bitSet(value, bit)		((value) |= (1ul << (bit)))
+#define bitClear(value, bit)	((value) &= ~(1ul << (bit)))
+#define bitWrite(value, bit, bitvalue)	((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+extern uint32_t g_testMillis;  // the clock, tests move it
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void yield(void);
+long random(long max);
+long random(long min, long max);
+
+class String
+{
+public:
+    String() {}
+    String(const char *text) : _text(text ? text : "") {}
+    String(const std::string &text) : _text(text) {}
+    explicit String(int value) : _text(std::to_string(value)) {}
+    explicit String(unsigned int value) : _text(std::to_string(value)) {}
+    explicit String(unsigned long value) : _text(std::to_string(value)) {}
+
+    const char *c_str(void) const { return _text.c_str(); }
+    unsigned int length(void) const { return _text.size(); }
+    char operator[](unsigned int index) const { return _text[index]; }
+    int indexOf(char c) const { return (int) _text.find(c); }
+    int indexOf(const char *text) const { return (int) _text.find(text); }
+    String substring(unsigned int begin) const
+    {
+        return String(begin < _text.size() ? _text.substr(begin) : std::string());
+    }
+    String substring(unsigned int begin, unsigned int end) const
+    {
+        return String(begin < end ? _text.substr(begin, end - begin) : std::string());
+    }
+
+    String operator+(const String &other) const { return String(_text + other._text); }
+    friend String operator+(const char *left, const String &right) { return String(left) + right; }
+    String &operator+=(const String &other) { _text += other._text; return *this; }
+    String &operator+=(const char *other) { _text += other; return *this; }
+    String &operator+=(char other) { _text += other; return *this; }
+    bool operator==(const String &other) const { return _text == other._text; }
+    bool operator==(const char *other) const { return _text == other; }
+
+private:
+    std::string _text;
+};
+
+#include "Print.h"
+#include "HardwareSerial.h"
+#include "Esp.h"
+
+#endif /* ARDUINO_STUB_H_ */
@@ -0,0 +1,20 @@
+#ifndef CLIENT_STUB_H_
+#define CLIENT_STUB_H_
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+class Client : public Stream
+{
+public:
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char *host, uint16_t port) = 0;
+    virtual int read(uint8_t *buffer, size_t size) = 0;
+    virtual void stop(void) = 0;
+    virtual uint8_t connected(void) = 0;
+    virtual operator bool() = 0;
+    using Print::write;
+    using Stream::read;
+};
+
+#endif /* CLIENT_STUB_H_ */
@@ -0,0 +1,116 @@
+#ifndef ESP8266_HTTP_CLIENT_STUB_H_
+#define ESP8266_HTTP_CLIENT_STUB_H_
+
+#include <memory>
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED	(-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED	(-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED	(-3)
+#define HTTPC_ERROR_NOT_CONNECTED		(-4)
+#define HTTPC_ERROR_READ_TIMEOUT		(-11)
+
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT	5000
+
+enum t_http_codes
+{
+    HTTP_CODE_SWITCHING_PROTOCOLS = 101,
+    HTTP_CODE_OK = 200
+};
+
+class TransportTraits
+{
+public:
+    virtual ~TransportTraits() {}
+    virtual std::unique_ptr<WiFiClient> create(void)
+    {
+        return std::unique_ptr<WiFiClient>(new WiFiClient());
+    }
+    virtual bool verify(WiFiClient &, const char *) { return true; }
+};
+
+// The members of the core's HTTPClient (2.5) that wsHTTPClient builds on.
+// begin() takes http://host[:port][/uri] only, handleHeaderResponse() reads
+// the status line and headers the server already sent.
+class HTTPClient
+{
+public:
+    virtual ~HTTPClient() {}
+
+    bool begin(String url)
+    {
+        String authority;
+        int index = url.indexOf("://");
+
+        if(index < 0) {
+            return false;
+        }
+
+        url = url.substring(index + 3);
+        index = url.indexOf('/');
+        authority = (index < 0) ? url : url.substring(0, index);
+        _uri = (index < 0) ? String("/") : url.substring(index);
+        index = authority.indexOf(':');
+        _host = (index < 0) ? authority : authority.substring(0, index);
+        _port = (index < 0) ? 80 : (uint16_t) atoi(authority.substring(index + 1).c_str());
+        _protocol = "http";
+        _transportTraits.reset(new TransportTraits());
+
+        return true;
+    }
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void addHeader(const String &name, const String &value)
+    {
+        _headers += name + ": " + value + "\r\n";
+    }
+    bool connected(void) { return _tcp && _tcp->connected(); }
+    WiFiClient &getStream(void) { return *_tcp; }
+    WiFiClient *getStreamPtr(void) { return _tcp.get(); }
+
+protected:
+    struct RequestArgument
+    {
+        String key;
+        String value;
+    };
+
+    int returnError(int error) { return error; }
+    int handleHeaderResponse(void)
+    {
+        std::string header;
+        int c = 0;
+
+        if(!connected()) {
+            return HTTPC_ERROR_NOT_CONNECTED;
+        }
+
+        while((header.find("\r\n\r\n") == std::string::npos)
+              && ((c = _tcp->read()) >= 0)) {
+            header += (char) c;
+        }
+
+        if((header.compare(0, 9, "HTTP/1.1 ") != 0)
+           || (header.find("\r\n\r\n") == std::string::npos)) {
+            return HTTPC_ERROR_READ_TIMEOUT;
+        }
+
+        return atoi(header.c_str() + 9);
+    }
+
+    std::unique_ptr<WiFiClient> _tcp;
+    std::unique_ptr<TransportTraits> _transportTraits;
+    String _host;
+    uint16_t _port = 0;
+    bool _reuse = false;
+    uint16_t _tcpTimeout = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+    bool _useHTTP10 = false;
+    String _uri;
+    String _protocol;
+    String _headers;
+    String _userAgent = "ESP8266HTTPClient";
+    String _base64Authorization;
+    RequestArgument *_currentHeaders = nullptr;
+};
+
+#endif /* ESP8266_HTTP_CLIENT_STUB_H_ */
@@ -0,0 +1,25 @@
+#ifndef ESP8266_WIFI_STUB_H_
+#define ESP8266_WIFI_STUB_H_
+
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+
+#define WL_CONNECTED	3
+
+class ESP8266WiFiClass
+{
+public:
+    int status(void) { return WL_CONNECTED; }
+    int hostByName(const char *, IPAddress &address)
+    {
+        lookups++;
+        address = IPAddress(0x0100007Fu);
+        return 1;
+    }
+
+    uint32_t lookups = 0;
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif /* ESP8266_WIFI_STUB_H_ */
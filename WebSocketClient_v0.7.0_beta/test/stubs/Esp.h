@@ -0,0 +1,28 @@
+#ifndef ESP_STUB_H_
+#define ESP_STUB_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ESP_STUB_FLASH_SIZE	(64u * 4096u)
+
+// Flash is a RAM array with NOR rules: aligned words, a write can only
+// clear bits, an erase sets a 4 KiB sector to 0xFF. The counters let tests
+// see how much flash work a call did.
+class EspClass
+{
+public:
+    uint32_t getCycleCount(void);
+    uint32_t getCpuFreqMHz(void) { return 80; }
+    uint32_t getFreeHeap(void) { return 40000; }
+    bool flashEraseSector(uint32_t sector);
+    bool flashWrite(uint32_t address, uint32_t *data, size_t size);
+    bool flashRead(uint32_t address, uint32_t *data, size_t size);
+
+    uint32_t flashWrites = 0;
+    uint32_t flashErases = 0;
+};
+
+extern EspClass ESP;
+
+#endif /* ESP_STUB_H_ */
@@ -0,0 +1,18 @@
+#ifndef HARDWARE_SERIAL_STUB_H_
+#define HARDWARE_SERIAL_STUB_H_
+
+#include "Stream.h"
+
+class HardwareSerial : public Stream
+{
+public:
+    size_t write(uint8_t) { return 1; }
+    int available(void) { return 0; }
+    int read(void) { return -1; }
+    int peek(void) { return -1; }
+    void begin(unsigned long) {}
+};
+
+extern HardwareSerial Serial;
+
+#endif /* HARDWARE_SERIAL_STUB_H_ */
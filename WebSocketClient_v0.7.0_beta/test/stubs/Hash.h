@@ -0,0 +1,9 @@
+#ifndef HASH_STUB_H_
+#define HASH_STUB_H_
+
+#include "Arduino.h"
+
+void sha1(const uint8_t *data, uint32_t size, uint8_t hash[20]);
+void sha1(const String &data, uint8_t hash[20]);
+
+#endif /* HASH_STUB_H_ */
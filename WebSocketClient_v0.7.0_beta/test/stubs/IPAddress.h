@@ -0,0 +1,18 @@
+#ifndef IP_ADDRESS_STUB_H_
+#define IP_ADDRESS_STUB_H_
+
+#include <stdint.h>
+
+class IPAddress
+{
+public:
+    IPAddress() {}
+    IPAddress(uint32_t address) : _address(address) {}
+    operator uint32_t() const { return _address; }
+    bool isSet(void) const { return _address != 0; }
+
+private:
+    uint32_t _address = 0;
+};
+
+#endif /* IP_ADDRESS_STUB_H_ */
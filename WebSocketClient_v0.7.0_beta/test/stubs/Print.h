@@ -0,0 +1,42 @@
+#ifndef PRINT_STUB_H_
+#define PRINT_STUB_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+class String;
+
+// print() and println() are dropped, write() goes to the subclass
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t data) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t count = 0;
+
+        while(size--) {
+            count += write(*buffer++);
+        }
+
+        return count;
+    }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *) buffer, size); }
+
+    size_t print(const char *) { return 0; }
+    size_t print(const String &) { return 0; }
+    size_t print(char) { return 0; }
+    size_t print(int, int = 10) { return 0; }
+    size_t print(unsigned int, int = 10) { return 0; }
+    size_t print(long, int = 10) { return 0; }
+    size_t print(unsigned long, int = 10) { return 0; }
+    size_t print(double, int = 2) { return 0; }
+    size_t println(void) { return 0; }
+    template <typename T> size_t println(T) { return 0; }
+    template <typename T> size_t println(T, int) { return 0; }
+    size_t printf(const char *, ...) { return 0; }
+    virtual void flush(void) {}
+};
+
+#endif /* PRINT_STUB_H_ */
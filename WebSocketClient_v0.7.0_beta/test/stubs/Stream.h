@@ -0,0 +1,15 @@
+#ifndef STREAM_STUB_H_
+#define STREAM_STUB_H_
+
+#include "Print.h"
+
+class Stream : public Print
+{
+public:
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) = 0;
+    void setTimeout(unsigned long) {}
+};
+
+#endif /* STREAM_STUB_H_ */
@@ -0,0 +1,95 @@
+#ifndef WIFI_CLIENT_STUB_H_
+#define WIFI_CLIENT_STUB_H_
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include "Client.h"
+
+#define WIFICLIENT_MAX_PACKET_SIZE	1460
+
+// A connection in memory: the test appends what the peer sends to input
+// and finds what the sketch wrote in output. writeLimit caps the bytes the
+// next writes accept, to provoke short writes. reply goes to input with the
+// next write, a server answering a request. Copies share the connection,
+// like the ClientContext of the core.
+struct WiFiClientConnection
+{
+    std::string input;
+    size_t inputOffset = 0;
+    std::string output;
+    std::string reply;
+    size_t writeLimit = (size_t) -1;
+    bool isOpen = true;
+};
+
+// The server behind connect(): refuses, or hands reply to the connection.
+// connects counts the calls.
+struct WiFiClientServer
+{
+    bool refuse = false;
+    std::string reply;
+    uint32_t connects = 0;
+};
+
+extern WiFiClientServer g_testServer;
+
+class WiFiClient : public Client
+{
+public:
+    std::shared_ptr<WiFiClientConnection> connection =
+        std::make_shared<WiFiClientConnection>();
+
+    int connect(IPAddress, uint16_t) { return accept(); }
+    int connect(const char *, uint16_t) { return accept(); }
+    size_t write(uint8_t data) { return write(&data, 1); }
+    size_t write(const uint8_t *buffer, size_t size)
+    {
+        WiFiClientConnection &c = *connection;
+
+        size = std::min(size, c.writeLimit);
+        c.writeLimit -= (c.writeLimit == (size_t) -1) ? 0 : size;
+        c.output.append((const char *) buffer, size);
+        c.input += c.reply;
+        c.reply.clear();
+        return size;
+    }
+    using Print::write;
+    int available(void)
+    {
+        return connection->isOpen
+               ? (int)(connection->input.size() - connection->inputOffset) : 0;
+    }
+    int read(void)
+    {
+        return available() ? (uint8_t) connection->input[connection->inputOffset++] : -1;
+    }
+    int read(uint8_t *buffer, size_t size)
+    {
+        size = std::min(size, (size_t) available());
+        memcpy(buffer, connection->input.data() + connection->inputOffset, size);
+        connection->inputOffset += size;
+        return size;
+    }
+    int peek(void)
+    {
+        return available() ? (uint8_t) connection->input[connection->inputOffset] : -1;
+    }
+    void flush(void) {}
+    void stop(void) { connection->isOpen = false; }
+    uint8_t connected(void) { return connection->isOpen; }
+    operator bool() { return connection->isOpen; }
+    void setNoDelay(bool) {}
+    IPAddress remoteIP(void) { return IPAddress(0x0100007Fu); }
+
+protected:
+    int accept(void)
+    {
+        g_testServer.connects++;
+        connection->isOpen = !g_testServer.refuse;
+        connection->reply = g_testServer.reply;
+        return connection->isOpen;
+    }
+};
+
+#endif /* WIFI_CLIENT_STUB_H_ */
@@ -0,0 +1,176 @@
+// The TLS stand-in behind stubs/WiFiClientSecureBearSSL.h, built on OpenSSL.
+
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include "WiFiClientSecureBearSSL.h"
+
+WiFiClientSecureServer g_testTls;
+
+static SSL_CTX *g_tlsServer = nullptr;
+static SSL_CTX *g_tlsClient = nullptr;
+
+void testTlsBegin(void)
+{
+    EVP_PKEY *key = nullptr;
+    X509 *certificate = nullptr;
+    X509_NAME *name = nullptr;
+    unsigned int length = sizeof(g_testTls.fingerprint);
+
+    if(g_tlsServer) {
+        return;
+    }
+
+    // RSA as on most servers the ESP8266 talks to, so the full handshake
+    // pays for a private key operation the resumed one skips
+    key = EVP_RSA_gen(2048);
+    certificate = X509_new();
+    X509_set_version(certificate, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), 86400);
+    X509_set_pubkey(certificate, key);
+    name = X509_get_subject_name(certificate);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               (const unsigned char *) "localhost", -1, -1, 0);
+    X509_set_issuer_name(certificate, name);
+    X509_sign(certificate, key, EVP_sha256());
+    X509_digest(certificate, EVP_sha1(), g_testTls.fingerprint, &length);
+
+    g_tlsServer = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_use_certificate(g_tlsServer, certificate);
+    SSL_CTX_use_PrivateKey(g_tlsServer, key);
+    SSL_CTX_set_session_id_context(g_tlsServer, (const unsigned char *) "ws", 2);
+    SSL_CTX_set_session_cache_mode(g_tlsServer, SSL_SESS_CACHE_SERVER);
+
+    g_tlsClient = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_session_cache_mode(g_tlsClient, SSL_SESS_CACHE_CLIENT);
+
+    SSL_CTX *contexts[] = { g_tlsServer, g_tlsClient };
+
+    for(SSL_CTX *context : contexts) {
+        SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+        SSL_CTX_set_max_proto_version(context, TLS1_2_VERSION);
+        SSL_CTX_set_options(context, SSL_OP_NO_TICKET);
+    }
+
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+}
+
+// moves what one side wrote to the other side
+static bool tlsPump(BIO *from, BIO *to)
+{
+    char buffer[4096];
+    int length = 0;
+    bool moved = false;
+
+    while((length = BIO_read(from, buffer, sizeof(buffer))) > 0) {
+        BIO_write(to, buffer, length);
+        moved = true;
+    }
+
+    return moved;
+}
+
+namespace BearSSL {
+
+Session::~Session()
+{
+    SSL_SESSION_free((SSL_SESSION *) _session);
+}
+
+int WiFiClientSecure::connect(const char *host, uint16_t port)
+{
+    SSL *client = nullptr;
+    SSL *server = nullptr;
+    BIO *clientIn = nullptr;
+    BIO *clientOut = nullptr;
+    BIO *serverIn = nullptr;
+    BIO *serverOut = nullptr;
+    X509 *certificate = nullptr;
+    uint8_t fingerprint[20];
+    unsigned int length = sizeof(fingerprint);
+    bool done = false;
+    bool ok = false;
+
+    testTlsBegin();
+
+    if(!WiFiClient::connect(host, port)) {
+        return 0;
+    }
+
+    clientIn = BIO_new(BIO_s_mem());
+    clientOut = BIO_new(BIO_s_mem());
+    serverIn = BIO_new(BIO_s_mem());
+    serverOut = BIO_new(BIO_s_mem());
+    client = SSL_new(g_tlsClient);
+    server = SSL_new(g_tlsServer);
+    SSL_set_bio(client, clientIn, clientOut);
+    SSL_set_bio(server, serverIn, serverOut);
+    SSL_set_connect_state(client);
+    SSL_set_accept_state(server);
+    SSL_set_tlsext_host_name(client, host);
+
+    if(_session && _session->_session) {
+        SSL_set_session(client, (SSL_SESSION *) _session->_session);
+    }
+
+    g_testTls.recv = _recv;
+    g_testTls.xmit = _xmit;
+
+    for(int round = 0; !done && (round < 16); round++) {
+        int clientDone = SSL_do_handshake(client);
+        bool moved = tlsPump(clientOut, serverIn);
+        int serverDone = SSL_do_handshake(server);
+
+        moved = tlsPump(serverOut, clientIn) || moved;
+        done = (clientDone == 1) && (serverDone == 1);
+
+        if(!done && !moved) {
+            break;
+        }
+    }
+
+    if(done) {
+        const char *name = SSL_get_servername(server, TLSEXT_NAMETYPE_host_name);
+
+        g_testTls.sni = name ? name : "";
+        g_testTls.handshakes++;
+        certificate = SSL_get1_peer_certificate(client);
+        X509_digest(certificate, EVP_sha1(), fingerprint, &length);
+        X509_free(certificate);
+
+        // the stand-in's certificate is in every anchor list
+        ok = _hasFingerprint ? (memcmp(fingerprint, _fingerprint, sizeof(fingerprint)) == 0)
+             : (_trustAnchors != nullptr);
+    }
+
+    if(ok && SSL_session_reused(client)) {
+        g_testTls.resumed++;
+    }
+
+    if(ok && _session) {
+        SSL_SESSION_free((SSL_SESSION *) _session->_session);
+        _session->_session = SSL_get1_session(client);
+    }
+
+    // a session freed without a shutdown is not resumable
+    SSL_set_shutdown(client, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+    SSL_set_shutdown(server, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+    SSL_free(client);
+    SSL_free(server);
+
+    if(!ok) {
+        stop();
+    }
+
+    return ok;
+}
+
+bool WiFiClientSecure::probeMFLN(const char *, uint16_t, uint16_t)
+{
+    return g_testTls.mfln;
+}
+
+}
@@ -0,0 +1,72 @@
+#ifndef WIFI_CLIENT_SECURE_BEARSSL_STUB_H_
+#define WIFI_CLIENT_SECURE_BEARSSL_STUB_H_
+
+#include <string>
+#include "WiFiClient.h"
+
+// The local TLS stand-in: connect() runs a real handshake (OpenSSL, TLS 1.2,
+// session ID resumption and no tickets, like the BearSSL client) against a
+// server in the same process over memory buffers. Only the handshake is
+// real, the records after it go to the connection in plain text.
+struct WiFiClientSecureServer
+{
+    bool mfln = true;  // answers probeMFLN()
+    uint8_t fingerprint[20];  // SHA1 of its certificate
+    std::string sni;  // server name of the last handshake
+    int recv = 0;  // buffer sizes of the last connect
+    int xmit = 0;
+    uint32_t handshakes = 0;
+    uint32_t resumed = 0;
+};
+
+extern WiFiClientSecureServer g_testTls;
+
+void testTlsBegin(void);  // creates the key and certificate, sets fingerprint
+
+namespace BearSSL {
+
+class X509List
+{
+};
+
+// the session of the last handshake, offered again by the next connect
+class Session
+{
+public:
+    Session() {}
+    ~Session();
+    Session(const Session &) = delete;
+    Session &operator=(const Session &) = delete;
+
+    void *_session = nullptr;
+};
+
+class WiFiClientSecure : public WiFiClient
+{
+public:
+    int connect(const char *host, uint16_t port);
+    int connect(IPAddress, uint16_t) { return 0; }  // needs the name for SNI
+    void setBufferSizes(int recv, int xmit) { _recv = recv; _xmit = xmit; }
+    void setSession(Session *session) { _session = session; }
+    bool setFingerprint(const uint8_t fingerprint[20])
+    {
+        memcpy(_fingerprint, fingerprint, sizeof(_fingerprint));
+        _hasFingerprint = true;
+        return true;
+    }
+    void setTrustAnchors(const X509List *trustAnchors) { _trustAnchors = trustAnchors; }
+
+    static bool probeMFLN(const char *host, uint16_t port, uint16_t len);
+
+private:
+    Session *_session = nullptr;
+    const X509List *_trustAnchors = nullptr;
+    uint8_t _fingerprint[20];
+    bool _hasFingerprint = false;
+    int _recv = 16384;
+    int _xmit = 512;
+};
+
+}
+
+#endif /* WIFI_CLIENT_SECURE_BEARSSL_STUB_H_ */
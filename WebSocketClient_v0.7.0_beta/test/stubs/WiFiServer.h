@@ -0,0 +1,30 @@
+#ifndef WIFI_SERVER_STUB_H_
+#define WIFI_SERVER_STUB_H_
+
+#include <vector>
+#include "WiFiClient.h"
+
+// available() hands out the clients the test queued in pending
+class WiFiServer
+{
+public:
+    std::vector<WiFiClient> pending;
+
+    WiFiServer(uint16_t) {}
+    void begin(void) {}
+    WiFiClient available(void)
+    {
+        WiFiClient client;
+
+        client.connection->isOpen = false;
+
+        if(!pending.empty()) {
+            client = pending.front();
+            pending.erase(pending.begin());
+        }
+
+        return client;
+    }
+};
+
+#endif /* WIFI_SERVER_STUB_H_ */
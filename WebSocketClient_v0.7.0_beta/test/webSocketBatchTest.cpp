@@ -0,0 +1,272 @@
+/*
+ * @file    webSocketBatchTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the sample batches of webSocketBatch.h: frames written by
+// webSocket_handle() decode back to the samples with a port of
+// WebSocketPHP/batch.php, followed by a benchmark against one JSON frame
+// per sample ({"ch":..,"t":..,"v":..} through webSocketJson.h).
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <chrono>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketBatch.h"
+#include "webSocketJson.h"
+
+typedef struct _TEST_SAMPLE
+{
+  uint32_t time;
+  uint8_t channel;
+  int32_t value;
+} TEST_SAMPLE;
+
+// batch_read_varint() of batch.php
+static bool testReadVarint(const std::string &data, size_t *offset,
+                           uint32_t *value)
+{
+  *value = 0;
+
+  for (uint8_t shift = 0; shift < 35; shift += 7)
+  {
+    if (*offset >= data.size())
+    {
+      return false;
+    }
+
+    uint8_t byte = (uint8_t) data[(*offset)++];
+
+    *value |= (uint32_t)(byte & 0x7F) << shift;
+
+    if ((byte & 0x80) == 0)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// batch_decode() of batch.php
+static bool testDecode(const std::string &data, std::vector<TEST_SAMPLE> *samples)
+{
+  int32_t last[256] = { 0 };
+  size_t offset = 3;
+  uint32_t time = 0;
+  uint32_t channel = 0;
+  uint32_t delta = 0;
+  uint32_t zigzag = 0;
+
+  if ((data.size() < 4) || ((uint8_t) data[0] != WEB_SOCKET_BINARY_TAG)
+      || ((uint8_t) data[1] != WEBSOCKET_BINARY_BATCH)
+      || ((uint8_t) data[2] != WEB_SOCKET_BATCH_VERSION)
+      || !testReadVarint(data, &offset, &time))
+  {
+    return false;
+  }
+
+  while (offset < data.size())
+  {
+    if (!testReadVarint(data, &offset, &channel) || (channel > 255)
+        || !testReadVarint(data, &offset, &delta)
+        || !testReadVarint(data, &offset, &zigzag))
+    {
+      return false;
+    }
+
+    time += delta;
+    last[channel] = (int32_t)((uint32_t) last[channel]
+                              + ((zigzag >> 1) ^ (0u - (zigzag & 1u))));
+
+    TEST_SAMPLE sample = { time, (uint8_t) channel, last[channel] };
+    samples->push_back(sample);
+  }
+
+  return true;
+}
+
+// a client session writing into a stub connection
+static void testOpen(void)
+{
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_start();
+}
+
+// adds a sample, sending the full batch when the send buffer is taken
+static void testAdd(WiFiClient &client, const TEST_SAMPLE &sample)
+{
+  while (!webSocket_batchAddAt(sample.channel, sample.value, sample.time))
+  {
+    webSocket_handle(client);
+  }
+}
+
+static void testFlush(WiFiClient &client)
+{
+  while (!webSocket_batchFlush())
+  {
+    webSocket_handle(client);
+  }
+
+  webSocket_handle(client);
+}
+
+// a slowly changing sensor: four channels every 100 ms, small steps
+static std::vector<TEST_SAMPLE> testSensor(size_t count)
+{
+  std::vector<TEST_SAMPLE> samples;
+  int32_t value[4] = { 2048, -400, 230, 99000 };
+
+  srand(1);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    uint8_t channel = i & 3;
+
+    value[channel] += (rand() % 7) - 3;
+
+    TEST_SAMPLE sample = { (uint32_t)(1000000u + (i / 4) * 100u), channel,
+                           value[channel] };
+    samples.push_back(sample);
+  }
+
+  return samples;
+}
+
+static std::vector<TEST_SAMPLE> testDecodeStream(const std::string &stream)
+{
+  std::vector<TEST_FRAME> frames = testParse(stream);
+  std::vector<TEST_SAMPLE> samples;
+
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    TEST_CHECK(frames[i].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_BINARY));
+    TEST_CHECK(frames[i].payload.size() <= WEB_SOCKET_BATCH_SIZE);
+    TEST_CHECK(testDecode(frames[i].payload, &samples));
+  }
+
+  return samples;
+}
+
+static bool testSame(const std::vector<TEST_SAMPLE> &a,
+                     const std::vector<TEST_SAMPLE> &b)
+{
+  if (a.size() != b.size())
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < a.size(); i++)
+  {
+    if ((a[i].time != b[i].time) || (a[i].channel != b[i].channel)
+        || (a[i].value != b[i].value))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void testRoundTrip(void)
+{
+  // edges: int32 swings both ways, time wrapping and long gaps, last channel
+  static const TEST_SAMPLE edges[] = {
+    { 0xFFFFFF00u, 0, 0 }, { 0xFFFFFFFFu, 0, INT32_MAX }, { 5u, 0, INT32_MIN },
+    { 5u, 7, -1 }, { 0x7FFFFFFFu, 7, 1 }, { 0x80000000u, 1, INT32_MIN },
+    { 0x80000000u, 1, INT32_MAX }, { 0x80000001u, 0, 0 }
+  };
+  std::vector<TEST_SAMPLE> sent(edges, edges + sizeof(edges) / sizeof(edges[0]));
+  std::vector<TEST_SAMPLE> sensor = testSensor(1000);
+  WiFiClient client;
+
+  testOpen();
+
+  TEST_CHECK(!webSocket_batchAddAt(WEB_SOCKET_BATCH_CHANNELS, 1, 0));
+
+  sent.insert(sent.end(), sensor.begin(), sensor.end());
+
+  for (size_t i = 0; i < sent.size(); i++)
+  {
+    testAdd(client, sent[i]);
+  }
+
+  testFlush(client);
+  TEST_CHECK(webSocket_batchGetCount() == 0);
+  TEST_CHECK(testSame(testDecodeStream(client.connection->output), sent));
+
+  webSocket_abort();
+}
+
+static void benchEncode(void)
+{
+  enum { SAMPLES = 200000 };
+  std::vector<TEST_SAMPLE> samples = testSensor(SAMPLES);
+  WiFiClient batch;
+  WiFiClient json;
+  WEB_SOCKET_JSON_WRITER writer;
+
+  testOpen();
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for (size_t i = 0; i < samples.size(); i++)
+  {
+    testAdd(batch, samples[i]);
+  }
+
+  testFlush(batch);
+
+  double batch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                       - start).count();
+
+  TEST_CHECK(testSame(testDecodeStream(batch.connection->output), samples));
+
+  start = std::chrono::steady_clock::now();
+
+  for (size_t i = 0; i < samples.size(); i++)
+  {
+    TEST_CHECK(webSocket_jsonBegin(&writer));
+    webSocket_jsonObjectBegin(&writer);
+    webSocket_jsonKey(&writer, "ch");
+    webSocket_jsonUInt(&writer, samples[i].channel);
+    webSocket_jsonKey(&writer, "t");
+    webSocket_jsonUInt(&writer, samples[i].time);
+    webSocket_jsonKey(&writer, "v");
+    webSocket_jsonInt(&writer, samples[i].value);
+    webSocket_jsonObjectEnd(&writer);
+    webSocket_jsonCommit(&writer);
+    webSocket_handle(json);
+  }
+
+  double json_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                      - start).count();
+
+  TEST_CHECK(testParse(json.connection->output).size() == SAMPLES);
+  TEST_CHECK(batch.connection->output.size() * 4 < json.connection->output.size());
+
+  // on the wire, frame headers and masks included
+  printf("batch: %.2f bytes/sample, %.1f M samples/s\n",
+         (double) batch.connection->output.size() / SAMPLES, SAMPLES / batch_seconds / 1e6);
+  printf("json:  %.2f bytes/sample, %.1f M samples/s\n",
+         (double) json.connection->output.size() / SAMPLES, SAMPLES / json_seconds / 1e6);
+
+  webSocket_abort();
+}
+
+int main(void)
+{
+  testRoundTrip();
+  benchEncode();
+
+  return TEST_RESULT();
+}
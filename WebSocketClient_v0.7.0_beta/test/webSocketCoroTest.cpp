@@ -0,0 +1,268 @@
+/*
+ * @file    webSocketCoroTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the coroutine client of webSocketCoro.h against a blocking
+// server on a thread: messages, fragments and ping, the closing handshake,
+// and the close reply written behind a send backlog the server has not
+// read yet, after a close and after a protocol error.
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "webSocketTest.h"
+#include "webSocketCoro.h"
+
+#define TEST_BACKLOG_SIZE	(32u * 1024u * 1024u)  // more than the socket buffers take
+
+// checks on the server thread, main() counts them after the join
+#define SERVER_CHECK(condition) \
+    do { \
+        if(!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            *ok = false; \
+        } \
+    } while(0)
+
+// the server side: a listening socket on a free port, one client a run
+class testServer
+{
+public:
+    testServer()
+    {
+        struct sockaddr_in address = {};
+        socklen_t length = sizeof(address);
+
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        _listen = socket(AF_INET, SOCK_STREAM, 0);
+        bind(_listen, (struct sockaddr *) &address, sizeof(address));
+        listen(_listen, 1);
+        getsockname(_listen, (struct sockaddr *) &address, &length);
+        port = ntohs(address.sin_port);
+    }
+
+    ~testServer()
+    {
+        ::close(_listen);
+    }
+
+    // accepts and answers the upgrade, Sec-WebSocket-Accept is not checked
+    bool accept(void)
+    {
+        std::string request;
+        char data = 0;
+
+        _fd = ::accept(_listen, NULL, NULL);
+
+        while(request.find("\r\n\r\n") == std::string::npos && ::recv(_fd, &data, 1, 0) == 1) {
+            request += data;
+        }
+
+        return write("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                     "Connection: Upgrade\r\nSec-WebSocket-Accept: x\r\n\r\n");
+    }
+
+    bool write(const std::string &data)
+    {
+        return ::send(_fd, data.data(), data.size(), MSG_NOSIGNAL) == (ssize_t) data.size();
+    }
+
+    bool writeFrame(bool fin, uint8_t rsv, uint8_t opcode, const std::string &payload)
+    {
+        uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+        uint8_t length = webSocket_frameEncodeHeader(header, fin, rsv, opcode, NULL,
+                                                     payload.size());
+
+        return write(std::string((const char *) header, length) + payload);
+    }
+
+    // next frame from the client, false at the end of the stream
+    bool readFrame(TEST_FRAME *frame)
+    {
+        WEB_SOCKET_FRAME_INFO info;
+        uint8_t length = 0;
+
+        while((length = webSocket_frameDecodeHeader((const uint8_t *) _in.data(), _in.size(),
+                                                    &info)) == 0
+              || _in.size() < length + info.payload_length) {
+            if(!fill()) {
+                return false;
+            }
+        }
+
+        std::vector<TEST_FRAME> frames = testParse(_in.substr(0, length + info.payload_length));
+
+        _in.erase(0, length + info.payload_length);
+        *frame = frames[0];
+
+        return true;
+    }
+
+    bool isClosed(void)
+    {
+        return _in.empty() && !fill();
+    }
+
+    void close(void)
+    {
+        ::close(_fd);
+        _in.clear();
+    }
+
+    uint16_t port = 0;
+
+protected:
+    bool fill(void)
+    {
+        char buffer[65536];
+        ssize_t length = ::recv(_fd, buffer, sizeof(buffer), 0);
+
+        if(length > 0) {
+            _in.append(buffer, length);
+        }
+
+        return length > 0;
+    }
+
+    int _listen = -1;
+    int _fd = -1;
+    std::string _in;
+};
+
+static std::string testCode(uint16_t code)
+{
+    return std::string { (char)(code >> 8), (char)(code & 0xFF) };
+}
+
+// fragments with a ping in between, an echo, then a close by the client
+static webSocketTask testMessages(webSocketLoop &loop, uint16_t port)
+{
+    webSocketSession session(loop);
+    webSocketMessage message;
+
+    TEST_CHECK(co_await session.connect("127.0.0.1", port, "/"));
+
+    message = co_await session.receive();
+    TEST_CHECK(message.opcode == WEB_SOCKET_CORO_TEXT && message.payload == "Hello, world");
+
+    co_await session.send("echo me");
+    message = co_await session.receive();
+    TEST_CHECK(message.opcode == WEB_SOCKET_CORO_TEXT && message.payload == "echo me");
+
+    co_await session.close();
+    message = co_await session.receive();
+    TEST_CHECK(message.opcode == WEB_SOCKET_CORO_CLOSE);
+    TEST_CHECK(message.payload == testCode(WEB_SOCKET_CORO_CLOSE_NORMAL));
+    TEST_CHECK(!session.isOpen());
+}
+
+static void testMessagesServer(testServer *server, bool *ok)
+{
+    TEST_FRAME frame;
+
+    SERVER_CHECK(server->accept());
+    server->writeFrame(false, 0, WEB_SOCKET_CORO_TEXT, "Hello");
+    server->writeFrame(true, 0, WEB_SOCKET_CORO_PING, "p1");
+    server->writeFrame(true, 0, WEB_SOCKET_CORO_CONTINUE, ", world");
+
+    SERVER_CHECK(server->readFrame(&frame));
+    SERVER_CHECK(frame.masked && frame.head == (0x80 | WEB_SOCKET_CORO_PONG)
+                 && frame.payload == "p1");
+
+    SERVER_CHECK(server->readFrame(&frame));
+    SERVER_CHECK(frame.masked && frame.payload == "echo me");
+    server->writeFrame(true, 0, WEB_SOCKET_CORO_TEXT, frame.payload);
+
+    SERVER_CHECK(server->readFrame(&frame));
+    SERVER_CHECK(frame.head == (0x80 | WEB_SOCKET_CORO_CLOSE)
+                 && frame.payload == testCode(WEB_SOCKET_CORO_CLOSE_NORMAL));
+    server->writeFrame(true, 0, WEB_SOCKET_CORO_CLOSE, frame.payload);
+
+    SERVER_CHECK(server->isClosed());
+    server->close();
+}
+
+// The server ends the session while it has not read a large send yet. The
+// client gets CLOSE right away, the backlog and then the close reply still
+// reach the server.
+static webSocketTask testBacklog(webSocketLoop &loop, uint16_t port)
+{
+    webSocketSession session(loop);
+    webSocketMessage message;
+
+    session.setSendHighWatermark(2 * TEST_BACKLOG_SIZE);
+    TEST_CHECK(co_await session.connect("127.0.0.1", port, "/"));
+    TEST_CHECK(co_await session.send(std::string(TEST_BACKLOG_SIZE, 'b'),
+                                     WEB_SOCKET_CORO_BINARY));
+
+    message = co_await session.receive();
+    TEST_CHECK(message.opcode == WEB_SOCKET_CORO_CLOSE && !session.isOpen());
+    TEST_CHECK(session.getSendPending() > 0);  // the reply is still queued
+
+    co_await session.close();
+    TEST_CHECK(session.getSendPending() == 0);
+}
+
+static void testBacklogServer(testServer *server, uint16_t code, bool *ok)
+{
+    TEST_FRAME frame;
+
+    SERVER_CHECK(server->accept());
+
+    if(code == WEB_SOCKET_CORO_CLOSE_NORMAL) {
+        server->writeFrame(true, 0, WEB_SOCKET_CORO_CLOSE, testCode(code) + "bye");
+    } else {
+        server->writeFrame(true, 1, WEB_SOCKET_CORO_TEXT, "rsv");  // 1002
+    }
+
+    usleep(100000);
+
+    SERVER_CHECK(server->readFrame(&frame));
+    SERVER_CHECK(frame.head == (0x80 | WEB_SOCKET_CORO_BINARY)
+                 && frame.payload == std::string(TEST_BACKLOG_SIZE, 'b'));
+
+    SERVER_CHECK(server->readFrame(&frame));
+    SERVER_CHECK(frame.head == (0x80 | WEB_SOCKET_CORO_CLOSE) && frame.payload == testCode(code));
+
+    SERVER_CHECK(server->isClosed());
+    server->close();
+}
+
+int main(void)
+{
+    testServer server;
+    std::thread thread;
+    bool ok = true;
+
+    {
+        webSocketLoop loop;
+
+        thread = std::thread(testMessagesServer, &server, &ok);
+        testMessages(loop, server.port);
+        loop.run();
+        thread.join();
+    }
+
+    for(uint16_t code : { WEB_SOCKET_CORO_CLOSE_NORMAL, WEB_SOCKET_CORO_CLOSE_PROTOCOL }) {
+        webSocketLoop loop;
+
+        thread = std::thread(testBacklogServer, &server, code, &ok);
+        testBacklog(loop, server.port);
+        loop.run();
+        thread.join();
+    }
+
+    TEST_CHECK(ok);
+
+    return TEST_RESULT();
+}
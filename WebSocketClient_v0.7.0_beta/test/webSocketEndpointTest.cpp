@@ -0,0 +1,165 @@
+/*
+ * @file    webSocketEndpointTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the endpoint selection of webSocketEndpoint.h: scoring,
+// exploration of unmeasured endpoints, exclusion of the standby, backoff
+// bounds and millis() wrap, then a failover run over simulated endpoints.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "webSocketTest.h"
+#include "webSocketEndpoint.h"
+
+static void testScore(void)
+{
+  WEB_SOCKET_ENDPOINT endpoint;
+
+  memset(&endpoint, 0, sizeof(endpoint));
+  TEST_CHECK(webSocket_endpointScore(&endpoint) == WEB_SOCKET_ENDPOINT_UNMEASURED);
+
+  endpoint.connect = 30;
+  TEST_CHECK(webSocket_endpointScore(&endpoint) == 30);
+
+  endpoint.handshake = 80;  // preferred over connect
+  TEST_CHECK(webSocket_endpointScore(&endpoint) == 41);
+
+  endpoint.rtt = 12;        // preferred over both
+  TEST_CHECK(webSocket_endpointScore(&endpoint) == 12);
+
+  // smoothing: first sample taken as is, then 3/4 old and 1/4 new
+  memset(&endpoint, 0, sizeof(endpoint));
+  webSocket_endpointSucceed(&endpoint, 100);
+  TEST_CHECK(endpoint.handshake == 100);
+  webSocket_endpointSucceed(&endpoint, 200);
+  TEST_CHECK(endpoint.handshake == 125);
+}
+
+static void testSelect(void)
+{
+  WEB_SOCKET_ENDPOINT list[3];
+
+  memset(list, 0, sizeof(list));
+  TEST_CHECK(webSocket_endpointSelect(list, 0, 0, WEB_SOCKET_ENDPOINT_NONE)
+             == WEB_SOCKET_ENDPOINT_NONE);
+
+  // ties go by list order, unmeasured ones are tried first
+  TEST_CHECK(webSocket_endpointSelect(list, 3, 0, WEB_SOCKET_ENDPOINT_NONE) == 0);
+  list[0].rtt = 50;
+  TEST_CHECK(webSocket_endpointSelect(list, 3, 0, WEB_SOCKET_ENDPOINT_NONE) == 1);
+  list[1].rtt = 20;
+  TEST_CHECK(webSocket_endpointSelect(list, 3, 0, WEB_SOCKET_ENDPOINT_NONE) == 2);
+  list[2].rtt = 35;
+  TEST_CHECK(webSocket_endpointSelect(list, 3, 0, WEB_SOCKET_ENDPOINT_NONE) == 1);
+
+  // the standby: the best one other than the active one
+  TEST_CHECK(webSocket_endpointSelect(list, 3, 0, 1) == 2);
+
+  // a failed endpoint is skipped until its retry time
+  webSocket_endpointFail(&list[1], 1000, 0);
+  TEST_CHECK(webSocket_endpointSelect(list, 3, 1000, WEB_SOCKET_ENDPOINT_NONE) == 2);
+  TEST_CHECK(webSocket_endpointSelect(list, 3, list[1].retry_at,
+                                      WEB_SOCKET_ENDPOINT_NONE) == 1);
+
+  webSocket_endpointFail(&list[0], 1000, 0);
+  webSocket_endpointFail(&list[2], 1000, 0);
+  TEST_CHECK(webSocket_endpointSelect(list, 3, 1000, 1) == WEB_SOCKET_ENDPOINT_NONE);
+}
+
+static void testBackoff(void)
+{
+  WEB_SOCKET_ENDPOINT endpoint;
+  uint32_t ceiling = WEB_SOCKET_RECONNECT_MIN;
+
+  memset(&endpoint, 0, sizeof(endpoint));
+
+  for (int i = 0; i < 300; i++)
+  {
+    uint32_t now = 0xFFFFF000u + i * 97u;  // across the millis() wrap
+
+    // the smallest and largest jitter give half and all of the ceiling
+    webSocket_endpointFail(&endpoint, now, 0);
+    TEST_CHECK(endpoint.retry_at - now == ceiling / 2);
+    endpoint.failures--;
+    webSocket_endpointFail(&endpoint, now, ceiling / 2);
+    TEST_CHECK(endpoint.retry_at - now == ceiling / 2 * 2);
+
+    TEST_CHECK(!webSocket_endpointIsHealthy(&endpoint, now));
+    TEST_CHECK(!webSocket_endpointIsHealthy(&endpoint, endpoint.retry_at - 1));
+    TEST_CHECK(webSocket_endpointIsHealthy(&endpoint, endpoint.retry_at));
+
+    ceiling = (ceiling * 2 < WEB_SOCKET_RECONNECT_MAX) ? ceiling * 2
+              : WEB_SOCKET_RECONNECT_MAX;
+  }
+
+  TEST_CHECK(endpoint.failures == 255);  // saturates
+
+  webSocket_endpointSucceed(&endpoint, 10);
+  TEST_CHECK((endpoint.failures == 0) && webSocket_endpointIsHealthy(&endpoint, 0));
+}
+
+// Three endpoints, the fastest one goes down for a while. Sessions follow
+// the best healthy endpoint and come back once the fast one recovers.
+static void testFailover(void)
+{
+  static const uint32_t rtt[3] = { 40, 15, 25 };
+  WEB_SOCKET_ENDPOINT list[3];
+  uint32_t sessions[3] = { 0, 0, 0 };
+  uint8_t active = WEB_SOCKET_ENDPOINT_NONE;
+  uint8_t last = WEB_SOCKET_ENDPOINT_NONE;
+
+  memset(list, 0, sizeof(list));
+  srand(1);
+
+  for (uint32_t now = 0; now < 120000; now += 100)
+  {
+    bool down = (now >= 30000) && (now < 60000);
+
+    active = webSocket_endpointSelect(list, 3, now, WEB_SOCKET_ENDPOINT_NONE);
+    TEST_CHECK(active != WEB_SOCKET_ENDPOINT_NONE);
+
+    if (active == WEB_SOCKET_ENDPOINT_NONE)
+    {
+      break;
+    }
+
+    if ((active == 1) && down)
+    {
+      webSocket_endpointFail(&list[active], now, rand());
+      continue;
+    }
+
+    // a session of one second, its RTT is known when it ends
+    webSocket_endpointSucceed(&list[active], 2 * rtt[active]);
+    list[active].rtt = rtt[active];
+    sessions[active]++;
+    last = active;
+    now += 1000;
+
+    if ((now > 35000) && (now < 60000))
+    {
+      TEST_CHECK(active == 2);  // next best while 1 is down
+    }
+  }
+
+  TEST_CHECK(last == 1);
+  TEST_CHECK((sessions[0] == 1) && (sessions[1] > sessions[2]));
+  printf("failover: sessions per endpoint %u %u %u\n", (unsigned) sessions[0],
+         (unsigned) sessions[1], (unsigned) sessions[2]);
+}
+
+int main(void)
+{
+  testScore();
+  testSelect();
+  testBackoff();
+  testFailover();
+
+  return TEST_RESULT();
+}
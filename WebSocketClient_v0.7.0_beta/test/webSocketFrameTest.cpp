@@ -0,0 +1,222 @@
+/*
+ * @file    webSocketFrameTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for webSocketFrame.h: every length form, RSV bits and mask on
+// and off survive an encode/decode round trip, the compile time headers
+// match the encoder, headers RFC 6455 forbids are rejected, followed by a
+// header decode throughput benchmark.
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "webSocketTest.h"
+#include "webSocketFrame.h"
+
+// the constexpr helpers fold at compile time
+static_assert(webSocket_frameByte0(true, 0, 0x09) == 0x89, "ping byte0");
+static_assert(webSocket_frameByte0(false, 5, 0x02) == 0x52, "rsv byte0");
+static_assert(webSocket_frameByte1(true, 125) == 0xFD, "7 bit length");
+static_assert(webSocket_frameByte1(false, 126) == 0x7E, "16 bit length");
+static_assert(webSocket_frameByte1(true, 65536) == 0xFF, "64 bit length");
+static_assert(webSocket_frameHeaderSize(0xFE) == 8, "16 bit masked header");
+static_assert(webSocket_frameEncodedSize(70000, false) == 10, "64 bit header");
+static_assert(webSocket_frameEncodedSize(4, true) == 6, "masked ping header");
+static_assert(webSocket_frameHeaderConst(true, 0x09, true, 4) == 0x89840000u,
+              "masked ping");
+static_assert(webSocket_frameHeaderConst(true, 0x08, false, 0) == 0x88000000u,
+              "close");
+static_assert(webSocket_frameHeaderConst(true, 0x02, false, 300) == 0x827E012Cu,
+              "16 bit binary");
+
+static const uint64_t g_lengths[] = {
+  0, 1, 125, 126, 127, 1000, 65535, 65536, 0xFFFFFFFFull, 0x100000000ull,
+  0x7FFFFFFFFFFFFFFFull
+};
+
+static void testRoundTrip(void)
+{
+  static const uint8_t mask[WEB_SOCKET_MASK_KEY_SIZE] = { 0x12, 0x34, 0x56, 0x78 };
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX + 1];
+  WEB_SOCKET_FRAME_INFO info;
+  uint8_t header_length = 0;
+
+  for (size_t i = 0; i < sizeof(g_lengths) / sizeof(g_lengths[0]); i++)
+  {
+    for (uint8_t rsv = 0; rsv < 8; rsv++)
+    {
+      for (uint8_t flags = 0; flags < 4; flags++)
+      {
+        bool fin = (flags & 1) != 0;
+        bool masked = (flags & 2) != 0;
+        uint8_t opcode = (uint8_t)((i + rsv) & WEB_SOCKET_FRAME_OPCODE);
+
+        memset(header, 0xA5, sizeof(header));
+        header_length = webSocket_frameEncodeHeader(header, fin, rsv, opcode,
+                                                    masked ? mask : NULL,
+                                                    g_lengths[i]);
+
+        TEST_CHECK(header_length == webSocket_frameEncodedSize(g_lengths[i], masked));
+        TEST_CHECK(header_length == webSocket_frameHeaderSize(header[1]));
+        TEST_CHECK(header[header_length] == 0xA5);  // nothing past the header
+
+        // one byte short is not a header yet
+        TEST_CHECK(webSocket_frameDecodeHeader(header, header_length - 1, &info) == 0);
+        TEST_CHECK(webSocket_frameDecodeHeader(header, header_length, &info)
+                   == (((opcode & WEB_SOCKET_FRAME_CONTROL)
+                        && (!fin || (g_lengths[i] > WEB_SOCKET_FRAME_LENGTH7_MAX)))
+                       ? WEB_SOCKET_FRAME_INVALID : header_length));
+
+        TEST_CHECK(info.fin == fin);
+        TEST_CHECK(info.rsv == rsv);
+        TEST_CHECK(info.opcode == opcode);
+        TEST_CHECK(info.masked == masked);
+        TEST_CHECK(info.header_length == header_length);
+        TEST_CHECK(info.payload_length == g_lengths[i]);
+        TEST_CHECK(info.length_field == webSocket_frameLengthField(g_lengths[i]));
+        TEST_CHECK(memcmp(info.mask, masked ? mask : (const uint8_t *) "\0\0\0\0",
+                          WEB_SOCKET_MASK_KEY_SIZE) == 0);
+      }
+    }
+  }
+}
+
+static void testWireFormat(void)
+{
+  // RFC 6455 5.7: a single-frame unmasked text message "Hello" and the
+  // 256 byte and 64 KiB unmasked binary messages
+  static const uint8_t hello[] = { 0x81, 0x05 };
+  static const uint8_t length16[] = { 0x82, 0x7E, 0x01, 0x00 };
+  static const uint8_t length64[] = { 0x82, 0x7F, 0, 0, 0, 0, 0, 0x01, 0x00, 0x00 };
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+
+  TEST_CHECK(webSocket_frameEncodeHeader(header, true, 0, 0x01, NULL, 5) == sizeof(hello));
+  TEST_CHECK(memcmp(header, hello, sizeof(hello)) == 0);
+  TEST_CHECK(webSocket_frameEncodeHeader(header, true, 0, 0x02, NULL, 256) == sizeof(length16));
+  TEST_CHECK(memcmp(header, length16, sizeof(length16)) == 0);
+  TEST_CHECK(webSocket_frameEncodeHeader(header, true, 0, 0x02, NULL, 65536) == sizeof(length64));
+  TEST_CHECK(memcmp(header, length64, sizeof(length64)) == 0);
+}
+
+// webSocket_frameStoreConst() writes what the encoder writes, for every
+// length the 32 bit form holds
+static void testConst(void)
+{
+  static const uint8_t mask[WEB_SOCKET_MASK_KEY_SIZE] = { 0x9A, 0xBC, 0xDE, 0xF0 };
+  static const uint8_t opcodes[] = { 0x00, 0x01, 0x02, 0x08, 0x09, 0x0A };
+  uint8_t expect[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t expect_length = 0;
+  uint8_t header_length = 0;
+
+  for (uint32_t length = 0; length <= WEB_SOCKET_FRAME_LENGTH16_MAX;
+       length += (length < 300) ? 1 : 997)
+  {
+    for (size_t i = 0; i < sizeof(opcodes); i++)
+    {
+      for (uint8_t flags = 0; flags < 4; flags++)
+      {
+        bool fin = (flags & 1) != 0;
+        bool masked = (flags & 2) != 0;
+
+        expect_length = webSocket_frameEncodeHeader(expect, fin, 0, opcodes[i],
+                                                    masked ? mask : NULL, length);
+        header_length = webSocket_frameStoreConst(header,
+                                                  webSocket_frameHeaderConst(fin, opcodes[i],
+                                                                             masked,
+                                                                             (uint16_t) length),
+                                                  masked ? mask : NULL);
+
+        TEST_CHECK((header_length == expect_length)
+                   && (memcmp(header, expect, header_length) == 0));
+      }
+    }
+  }
+}
+
+// RFC 6455 5.2 and 5.5: the most significant bit of a 64 bit length is 0,
+// control frames are not fragmented and carry at most 125 bytes
+static void testInvalid(void)
+{
+  static const uint8_t msb[] = { 0x82, 0x7F, 0x80, 0, 0, 0, 0, 0, 0, 0 };
+  static const uint8_t ping_fragment[] = { 0x09, 0x00 };
+  static const uint8_t ping126[] = { 0x89, 0x7E, 0x00, 0x7E };
+  static const uint8_t close16[] = { 0x88, 0x7E, 0x00, 0xC8 };
+  static const uint8_t pong125[] = { 0x8A, 0x7D };
+  static const uint8_t text_fragment[] = { 0x01, 0x7E, 0x01, 0x00 };
+  WEB_SOCKET_FRAME_INFO info;
+
+  TEST_CHECK(webSocket_frameDecodeHeader(msb, sizeof(msb), &info)
+             == WEB_SOCKET_FRAME_INVALID);
+  TEST_CHECK((info.header_length == sizeof(msb)) && (info.opcode == 0x02));
+  TEST_CHECK(webSocket_frameDecodeHeader(msb, sizeof(msb) - 1, &info) == 0);
+  TEST_CHECK(webSocket_frameDecodeHeader(ping_fragment, sizeof(ping_fragment), &info)
+             == WEB_SOCKET_FRAME_INVALID);
+  TEST_CHECK(webSocket_frameDecodeHeader(ping126, sizeof(ping126), &info)
+             == WEB_SOCKET_FRAME_INVALID);
+  TEST_CHECK(webSocket_frameDecodeHeader(close16, sizeof(close16), &info)
+             == WEB_SOCKET_FRAME_INVALID);
+  TEST_CHECK(webSocket_frameDecodeHeader(pong125, sizeof(pong125), &info)
+             == sizeof(pong125));
+  TEST_CHECK(webSocket_frameDecodeHeader(text_fragment, sizeof(text_fragment), &info)
+             == sizeof(text_fragment));
+}
+
+static void benchDecode(void)
+{
+  enum { HEADERS = 64, ROUNDS = 200000 };
+  static const uint8_t mask[WEB_SOCKET_MASK_KEY_SIZE] = { 1, 2, 3, 4 };
+  uint8_t stream[HEADERS * WEB_SOCKET_FRAME_HEADER_MAX];
+  size_t stream_length = 0;
+  WEB_SOCKET_FRAME_INFO info;
+  uint64_t sink = 0;
+
+  memset(&info, 0, sizeof(info));
+
+  // the mix the ESP8266 sees: short and 16-bit lengths, masked and not
+  for (int i = 0; i < HEADERS; i++)
+  {
+    stream_length += webSocket_frameEncodeHeader(&stream[stream_length], true, 0,
+                                                 (i & 1) ? 0x02 : 0x01,
+                                                 (i & 2) ? mask : NULL,
+                                                 (i & 4) ? 730 + i : i);
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for (int round = 0; round < ROUNDS; round++)
+  {
+    size_t offset = 0;
+
+    while (offset < stream_length)
+    {
+      offset += webSocket_frameDecodeHeader(&stream[offset], stream_length - offset, &info);
+      sink += info.payload_length + info.mask[0];
+    }
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                 - start).count();
+  double headers = (double) HEADERS * ROUNDS;
+
+  printf("decode: %.1f M headers/s, %.2f ns/header, %.0f MB/s of headers (sink %llx)\n",
+         headers / seconds / 1e6, seconds * 1e9 / headers,
+         (double) stream_length * ROUNDS / seconds / 1e6,
+         (unsigned long long) sink);
+}
+
+int main(void)
+{
+  testRoundTrip();
+  testWireFormat();
+  testConst();
+  testInvalid();
+  benchDecode();
+
+  return TEST_RESULT();
+}
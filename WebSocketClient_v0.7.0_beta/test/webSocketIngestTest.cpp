@@ -0,0 +1,241 @@
+/*
+ * @file    webSocketIngestTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the ingest ring of webSocketIngest.h (WEBSOCKET_INGEST,
+// built with WEBSOCKET_POOL): ring limits, a producer thread against the
+// consumer, records kept while the engine cannot take them, and a producer
+// thread feeding webSocket_handle() without a record lost or reordered.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketIngest.h"
+#include "webSocketPool.h"
+
+#define TEST_RECORDS	200000u
+
+// record i: its number and up to 27 more bytes derived from it
+static uint8_t testRecord(uint32_t i, char *data)
+{
+  uint8_t length = sizeof(i) + (i % (WEB_SOCKET_INGEST_RECORD_SIZE - sizeof(i)));
+
+  memcpy(data, &i, sizeof(i));
+
+  for (uint8_t n = sizeof(i); n < length; n++)
+  {
+    data[n] = (char)(i * 31 + n);
+  }
+
+  return length;
+}
+
+static bool testIsRecord(uint32_t i, const char *data, uint8_t length)
+{
+  char expect[WEB_SOCKET_INGEST_RECORD_SIZE];
+
+  return (length == testRecord(i, expect)) && (memcmp(data, expect, length) == 0);
+}
+
+// pushes count records, retrying while the ring is full
+static void testProduce(uint32_t count)
+{
+  char data[WEB_SOCKET_INGEST_RECORD_SIZE];
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    uint8_t length = testRecord(i, data);
+
+    while (!webSocket_ingestPush(data, length, OPCODE_FRAME_BINARY))
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+static void testRing(void)
+{
+  char data[WEB_SOCKET_INGEST_RECORD_SIZE + 1] = { 0 };
+  uint32_t overrun = webSocket_ingestGetOverrun();
+  const WEB_SOCKET_INGEST_RECORD *record = NULL;
+
+  TEST_CHECK(webSocket_ingestPeek() == NULL);
+
+  for (uint32_t i = 0; i < WEB_SOCKET_INGEST_SLOTS; i++)
+  {
+    TEST_CHECK(webSocket_ingestPush(&i, sizeof(i), OPCODE_FRAME_BINARY));
+  }
+
+  TEST_CHECK(!webSocket_ingestPush(data, 1, OPCODE_FRAME_BINARY));
+  TEST_CHECK(webSocket_ingestGetOverrun() == overrun + 1);
+
+  for (uint32_t i = 0; i < WEB_SOCKET_INGEST_SLOTS; i++)
+  {
+    uint32_t value = 0;
+
+    record = webSocket_ingestPeek();
+    TEST_CHECK((record != NULL) && (record->length == sizeof(value)));
+    memcpy(&value, record->data, sizeof(value));
+    TEST_CHECK(value == i);
+    webSocket_ingestPop();
+  }
+
+  TEST_CHECK(webSocket_ingestPeek() == NULL);
+  webSocket_ingestPop();  // nothing to pop, changes nothing
+  TEST_CHECK(webSocket_ingestPeek() == NULL);
+
+  TEST_CHECK(!webSocket_ingestPush(data, sizeof(data), OPCODE_FRAME_BINARY));
+  TEST_CHECK(webSocket_ingestGetOverrun() == overrun + 2);
+}
+
+// one producer thread, the consumer here: every record once, in order
+static void testThread(void)
+{
+  std::thread producer(testProduce, TEST_RECORDS);
+  uint32_t next = 0;
+  int failed = 0;
+
+  while (next < TEST_RECORDS)
+  {
+    const WEB_SOCKET_INGEST_RECORD *record = webSocket_ingestPeek();
+
+    if (record == NULL)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    failed += !testIsRecord(next, record->data, record->length);
+    webSocket_ingestPop();
+    next++;
+  }
+
+  producer.join();
+
+  TEST_CHECK(failed == 0);
+  TEST_CHECK(webSocket_ingestPeek() == NULL);
+}
+
+static void testBegin(void)
+{
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_start();
+}
+
+// the data frames of a stream, control frames left out
+static std::vector<TEST_FRAME> testData(const std::string &stream)
+{
+  std::vector<TEST_FRAME> frames = testParse(stream);
+  std::vector<TEST_FRAME> data;
+
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    if (!(frames[i].head & WEB_SOCKET_FRAME_CONTROL))
+    {
+      data.push_back(frames[i]);
+    }
+  }
+
+  return data;
+}
+
+// Without a pool block the engine cannot take a record; it stays in the
+// ring instead of being popped and lost.
+static void testKept(void)
+{
+  WiFiClient client;
+  std::vector<char *> blocks;
+  std::vector<TEST_FRAME> frames;
+  char data[WEB_SOCKET_INGEST_RECORD_SIZE];
+  char *block = NULL;
+
+  testBegin();
+
+  while ((block = webSocket_poolAlloc(1)) != NULL)
+  {
+    blocks.push_back(block);
+  }
+
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    webSocket_ingestPush(data, testRecord(i, data), OPCODE_FRAME_BINARY);
+  }
+
+  webSocket_handle(client);
+  webSocket_handle(client);
+  TEST_CHECK(testData(client.connection->output).empty());
+  TEST_CHECK(webSocket_ingestPeek() != NULL);
+
+  for (size_t i = 0; i < blocks.size(); i++)
+  {
+    webSocket_poolFree(blocks[i]);
+  }
+
+  webSocket_handle(client);
+  frames = testData(client.connection->output);
+  TEST_CHECK(frames.size() == 3);
+
+  for (uint32_t i = 0; i < frames.size(); i++)
+  {
+    TEST_CHECK(testIsRecord(i, frames[i].payload.data(), frames[i].payload.size()));
+  }
+
+  TEST_CHECK(webSocket_ingestPeek() == NULL);
+
+  webSocket_abort();
+}
+
+// a producer thread feeding the session: every record goes out as a frame
+static void testSession(void)
+{
+  WiFiClient client;
+  std::thread producer(testProduce, TEST_RECORDS / 10);
+  std::vector<TEST_FRAME> frames;
+  int failed = 0;
+
+  testBegin();
+
+  for (int idle = 0; idle < 1000; )
+  {
+    size_t written = client.connection->output.size();
+
+    webSocket_handle(client);
+    idle = (client.connection->output.size() == written) ? idle + 1 : 0;
+    std::this_thread::yield();
+  }
+
+  producer.join();
+  webSocket_handle(client);
+
+  frames = testData(client.connection->output);
+  TEST_CHECK(frames.size() == TEST_RECORDS / 10);
+
+  for (uint32_t i = 0; i < frames.size(); i++)
+  {
+    failed += !testIsRecord(i, frames[i].payload.data(), frames[i].payload.size());
+  }
+
+  TEST_CHECK(failed == 0);
+
+  webSocket_abort();
+}
+
+int main(void)
+{
+  testRing();
+  testThread();
+  testKept();
+  testSession();
+
+  return TEST_RESULT();
+}
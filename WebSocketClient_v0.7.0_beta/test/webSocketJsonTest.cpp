@@ -0,0 +1,214 @@
+/*
+ * @file    webSocketJsonTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the JSON writer of webSocketJson.h: values, escapes and
+// nesting, the documents it refuses (overflow, open containers, a key
+// without a value) and, built with WEBSOCKET_POOL, that a refused commit
+// gives the send block back.
+
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketJson.h"
+#include "webSocketMsgPack.h"
+#include "webSocketPool.h"
+
+static char g_testBuffer[512];
+
+static std::string testText(const WEB_SOCKET_JSON_WRITER *json)
+{
+  return std::string(json->buffer, json->length);
+}
+
+static void testValues(void)
+{
+  WEB_SOCKET_JSON_WRITER json;
+
+  webSocket_jsonInit(&json, g_testBuffer, sizeof(g_testBuffer));
+  webSocket_jsonObjectBegin(&json);
+  webSocket_jsonKey(&json, "s");
+  webSocket_jsonString(&json, "a\"b\\c\n\r\t\b\f\x01\x1f" "caf\xC3\xA9");
+  webSocket_jsonKey(&json, "i");
+  webSocket_jsonArrayBegin(&json);
+  webSocket_jsonInt(&json, 0);
+  webSocket_jsonInt(&json, -1);
+  webSocket_jsonInt(&json, INT32_MAX);
+  webSocket_jsonInt(&json, INT32_MIN);
+  webSocket_jsonArrayEnd(&json);
+  webSocket_jsonKey(&json, "u");
+  webSocket_jsonUInt(&json, UINT32_MAX);
+  webSocket_jsonKey(&json, "f");
+  webSocket_jsonArrayBegin(&json);
+  webSocket_jsonFloat(&json, 1.5f, 2);
+  webSocket_jsonFloat(&json, -0.001f, 3);
+  webSocket_jsonFloat(&json, NAN, 2);
+  webSocket_jsonFloat(&json, 2.6f, 0);
+  webSocket_jsonFloat(&json, 0.9999999f, 2);
+  webSocket_jsonArrayEnd(&json);
+  webSocket_jsonKey(&json, "b");
+  webSocket_jsonBool(&json, true);
+  webSocket_jsonKey(&json, "n");
+  webSocket_jsonNull(&json);
+  webSocket_jsonKey(&json, "e");
+  webSocket_jsonObjectBegin(&json);
+  webSocket_jsonObjectEnd(&json);
+  webSocket_jsonKey(&json, "a");
+  webSocket_jsonArrayBegin(&json);
+  webSocket_jsonArrayBegin(&json);
+  webSocket_jsonArrayEnd(&json);
+  webSocket_jsonObjectBegin(&json);
+  webSocket_jsonKey(&json, "k");
+  webSocket_jsonBool(&json, false);
+  webSocket_jsonObjectEnd(&json);
+  webSocket_jsonArrayEnd(&json);
+  webSocket_jsonObjectEnd(&json);
+
+  TEST_CHECK(!json.is_overflow && (json.depth == 0) && !json.is_key);
+  TEST_CHECK(testText(&json)
+             == "{\"s\":\"a\\\"b\\\\c\\n\\r\\t\\b\\f\\u0001\\u001fcaf\xC3\xA9\","
+                "\"i\":[0,-1,2147483647,-2147483648],\"u\":4294967295,"
+                "\"f\":[1.50,-0.001,null,3,1.00],\"b\":true,\"n\":null,"
+                "\"e\":{},\"a\":[[],{\"k\":false}]}");
+}
+
+// documents the commit refuses
+static void testRefused(void)
+{
+  WEB_SOCKET_JSON_WRITER json;
+
+  // does not fit
+  webSocket_jsonInit(&json, g_testBuffer, 8);
+  webSocket_jsonString(&json, "12345678");
+  TEST_CHECK(json.is_overflow && !webSocket_jsonCommit(&json));
+
+  // a container left open
+  webSocket_jsonInit(&json, g_testBuffer, sizeof(g_testBuffer));
+  webSocket_jsonObjectBegin(&json);
+  TEST_CHECK(!json.is_overflow && !webSocket_jsonCommit(&json));
+
+  // closed twice
+  webSocket_jsonInit(&json, g_testBuffer, sizeof(g_testBuffer));
+  webSocket_jsonArrayBegin(&json);
+  webSocket_jsonArrayEnd(&json);
+  webSocket_jsonArrayEnd(&json);
+  TEST_CHECK(json.is_overflow);
+
+  // a key without a value, at the end, before another key or a close
+  webSocket_jsonInit(&json, g_testBuffer, sizeof(g_testBuffer));
+  webSocket_jsonKey(&json, "k");
+  TEST_CHECK(!json.is_overflow && !webSocket_jsonCommit(&json));
+
+  webSocket_jsonInit(&json, g_testBuffer, sizeof(g_testBuffer));
+  webSocket_jsonObjectBegin(&json);
+  webSocket_jsonKey(&json, "a");
+  webSocket_jsonKey(&json, "b");
+  webSocket_jsonInt(&json, 1);
+  webSocket_jsonObjectEnd(&json);
+  TEST_CHECK(json.is_overflow);
+
+  webSocket_jsonInit(&json, g_testBuffer, sizeof(g_testBuffer));
+  webSocket_jsonObjectBegin(&json);
+  webSocket_jsonKey(&json, "a");
+  webSocket_jsonObjectEnd(&json);
+  TEST_CHECK(json.is_overflow);
+
+  // nested deeper than WEB_SOCKET_JSON_DEPTH_MAX
+  webSocket_jsonInit(&json, g_testBuffer, sizeof(g_testBuffer));
+
+  for (uint8_t i = 0; i < WEB_SOCKET_JSON_DEPTH_MAX - 1; i++)
+  {
+    webSocket_jsonArrayBegin(&json);
+  }
+
+  TEST_CHECK(!json.is_overflow);
+  webSocket_jsonArrayBegin(&json);
+  TEST_CHECK(json.is_overflow);
+}
+
+static uint8_t testPoolUsed(void)
+{
+  uint8_t used = 0;
+
+  for (uint8_t i = 0; i < WEBSOCKET_POOL_CLASSES; i++)
+  {
+    used += webSocket_poolGetUsed(i);
+  }
+
+  return used;
+}
+
+// A refused commit gives the block of webSocket_jsonBegin() back, one that
+// goes out is returned after the write.
+static void testCommit(void)
+{
+  WiFiClient client;
+  WEB_SOCKET_JSON_WRITER json;
+  WEB_SOCKET_MSGPACK_WRITER pack;
+  std::vector<TEST_FRAME> frames;
+  std::string large(WEB_SOCKET_SEND_PAYLOAD_SIZE, 'x');
+  uint16_t capacity = 0;
+  uint8_t used = 0;
+
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_SERVER);
+  webSocket_setUseMask(false);
+  webSocket_start();
+  used = testPoolUsed();
+
+  TEST_CHECK(webSocket_jsonBegin(&json) && (testPoolUsed() == used + 1));
+  webSocket_jsonObjectBegin(&json);
+  webSocket_jsonKey(&json, "dangling");
+  webSocket_jsonObjectEnd(&json);
+  TEST_CHECK(!webSocket_jsonCommit(&json));
+  TEST_CHECK((testPoolUsed() == used) && !webSocket_isSendBusy());
+
+  TEST_CHECK(webSocket_jsonBegin(&json));
+  webSocket_jsonString(&json, large.c_str());
+  TEST_CHECK(!webSocket_jsonCommit(&json) && (testPoolUsed() == used));
+
+  TEST_CHECK(webSocket_msgpackBegin(&pack));
+  webSocket_msgpackStr(&pack, large.data(), large.size());
+  TEST_CHECK(!webSocket_msgpackCommit(&pack) && (testPoolUsed() == used));
+
+  TEST_CHECK(webSocket_beginFrame(&capacity) != NULL);
+  TEST_CHECK(!webSocket_commitFrame(capacity + 1, OPCODE_FRAME_TEXT)
+             && (testPoolUsed() == used));
+
+  // the next begin still gets a block and the frame goes out
+  TEST_CHECK(webSocket_jsonBegin(&json));
+  webSocket_jsonObjectBegin(&json);
+  webSocket_jsonKey(&json, "v");
+  webSocket_jsonInt(&json, 42);
+  webSocket_jsonObjectEnd(&json);
+  TEST_CHECK(webSocket_jsonCommit(&json) && webSocket_isSendBusy());
+
+  // nothing to give back while the frame is pending
+  webSocket_cancelFrame();
+  TEST_CHECK(webSocket_isSendBusy() && (testPoolUsed() == used + 1));
+
+  webSocket_handle(client);
+  frames = testParse(client.connection->output);
+  TEST_CHECK((frames.size() == 1)
+             && (frames[0].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_TEXT))
+             && (frames[0].payload == "{\"v\":42}"));
+  TEST_CHECK(testPoolUsed() == used);
+
+  webSocket_abort();
+}
+
+int main(void)
+{
+  testValues();
+  testRefused();
+  testCommit();
+
+  return TEST_RESULT();
+}
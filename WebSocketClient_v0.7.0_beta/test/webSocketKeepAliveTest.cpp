@@ -0,0 +1,242 @@
+/*
+ * @file    webSocketKeepAliveTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the keepalive of webSocket_handle() on the stub clock: the
+// RTT estimator against a floating point reference, the ping interval it
+// drives, retries and the timeout close in the client role, and a ping
+// that finds the control slot taken.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+
+static int g_testTimeOutClose = 0;
+
+static void testTimeOutClose(void)
+{
+  g_testTimeOutClose++;
+}
+
+static void testStart(uint8_t mode)
+{
+  webSocket_init();
+  webSocket_setMode(mode);
+  webSocket_setUseMask(mode == WEBSOCKET_MODE_CLIENT);
+  webSocket_setHandler(WEBSOCKET_HANDLER_TIMEOUT_CLOSE, testTimeOutClose);
+  webSocket_start();
+  g_testTimeOutClose = 0;
+}
+
+// an unmasked frame from a server
+static std::string testFrame(uint8_t opcode, const std::string &payload)
+{
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t length = webSocket_frameEncodeHeader(header, true, 0, opcode, NULL,
+                                               payload.size());
+
+  return std::string((const char *) header, length) + payload;
+}
+
+// idles until the keepalive pings, returns the timestamp payload
+static std::string testPing(WiFiClient &client)
+{
+  std::vector<TEST_FRAME> frames;
+
+  g_testMillis += webSocket_getKeepAliveInterval();
+  client.connection->output.clear();
+  webSocket_handle(client);
+  frames = testParse(client.connection->output);
+
+  TEST_CHECK((frames.size() == 1)
+             && (frames[0].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_PING))
+             && frames[0].masked
+             && (frames[0].payload.size() == WEB_SOCKET_PING_PAYLOAD_SIZE));
+
+  return frames.empty() ? std::string() : frames[0].payload;
+}
+
+static void testPong(WiFiClient &client, const std::string &payload,
+                     uint32_t rtt)
+{
+  g_testMillis += rtt;
+  client.connection->input += testFrame(OPCODE_FRAME_PONG, payload);
+  webSocket_handle(client);
+}
+
+// srtt and rttvar follow RFC 6298 within the rounding of the scaled
+// integers, the RTO is srtt + 4 rttvar
+static void testEstimator(void)
+{
+  static const uint32_t samples[] = { 100, 100, 120, 80, 300, 90, 100, 100,
+                                      40, 1000, 110, 100, 95, 105, 100, 100 };
+  WiFiClient client;
+  double srtt = 0;
+  double rttvar = 0;
+
+  testStart(WEBSOCKET_MODE_CLIENT);
+  TEST_CHECK(webSocket_getRtt() == 0);
+  TEST_CHECK(webSocket_getRto() == WEB_SOCKET_TIMEOUT_DEFAULT);
+
+  for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++)
+  {
+    testPong(client, testPing(client), samples[i]);
+
+    if (i == 0)
+    {
+      srtt = samples[i];
+      rttvar = samples[i] / 2.0;
+    }
+    else
+    {
+      rttvar = 0.75 * rttvar + 0.25 * abs((int) samples[i] - (int) srtt);
+      srtt = 0.875 * srtt + 0.125 * samples[i];
+    }
+
+    TEST_CHECK(abs((int) webSocket_getRtt() - (int) srtt) <= 1);
+    TEST_CHECK(abs((int) webSocket_getRttVar() - (int) rttvar) <= 2);
+    TEST_CHECK(abs((int) webSocket_getRto() - (int)(srtt + 4 * rttvar)) <= 8);
+  }
+
+  // a pong for another payload is no sample
+  testPong(client, "sktc", 5000);
+  TEST_CHECK(abs((int) webSocket_getRtt() - (int) srtt) <= 1);
+
+  webSocket_abort();
+}
+
+// the interval grows by half per answered ping up to what still detects a
+// dead peer within WEB_SOCKET_KEEPALIVE_MAX, and starts at 4 RTOs on a
+// slow link
+static void testInterval(void)
+{
+  static const uint32_t rtts[] = { 5, 100, 400, 1500, 4000 };
+
+  for (size_t n = 0; n < sizeof(rtts) / sizeof(rtts[0]); n++)
+  {
+    WiFiClient client;
+    uint32_t interval = WEB_SOCKET_TIMEOUT_DEFAULT;
+    uint32_t expect = 0;
+    uint32_t lower = 0;
+    uint32_t upper = 0;
+
+    testStart(WEBSOCKET_MODE_CLIENT);
+    TEST_CHECK(webSocket_getKeepAliveInterval() == WEB_SOCKET_TIMEOUT_DEFAULT);
+
+    for (int i = 0; i < 12; i++)
+    {
+      testPong(client, testPing(client), rtts[n]);
+
+      lower = WEB_SOCKET_KEEPALIVE_RTO_FACTOR * webSocket_getRto();
+      upper = WEB_SOCKET_TIMEOUT_RETRY * webSocket_getRto();
+      upper = (upper + WEB_SOCKET_TIMEOUT_MIN < WEB_SOCKET_KEEPALIVE_MAX)
+              ? WEB_SOCKET_KEEPALIVE_MAX - upper : WEB_SOCKET_TIMEOUT_MIN;
+      expect = interval + interval / 2;
+      expect = (expect < lower) ? lower : expect;
+      expect = (expect > upper) ? upper : expect;
+
+      TEST_CHECK(webSocket_getKeepAliveInterval() == expect);
+      TEST_CHECK((webSocket_getKeepAliveInterval()
+                  + WEB_SOCKET_TIMEOUT_RETRY * webSocket_getRto()
+                  <= WEB_SOCKET_KEEPALIVE_MAX)
+                 || (webSocket_getKeepAliveInterval() == WEB_SOCKET_TIMEOUT_MIN));
+      interval = webSocket_getKeepAliveInterval();
+    }
+
+    TEST_CHECK(interval == upper);
+    TEST_CHECK(webSocket_isStart());
+
+    webSocket_abort();
+  }
+}
+
+// a client whose pings go unanswered retries after one RTO each and closes
+static void testClientTimeOut(void)
+{
+  WiFiClient client;
+  std::vector<TEST_FRAME> frames;
+  uint32_t rto = 0;
+
+  testStart(WEBSOCKET_MODE_CLIENT);
+  testPong(client, testPing(client), 50);
+  rto = webSocket_getRto();
+  TEST_CHECK(rto == WEB_SOCKET_RTO_MIN);
+
+  testPing(client);
+  TEST_CHECK(webSocket_getTimeOutRetryCount() == 1);
+
+  for (uint8_t retry = 2; retry <= WEB_SOCKET_TIMEOUT_RETRY; retry++)
+  {
+    g_testMillis += rto - 1;
+    client.connection->output.clear();
+    webSocket_handle(client);
+    TEST_CHECK(client.connection->output.empty());
+
+    g_testMillis += 1;
+    webSocket_handle(client);
+    frames = testParse(client.connection->output);
+    TEST_CHECK((frames.size() == 1)
+               && (frames[0].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_PING)));
+    TEST_CHECK(webSocket_getTimeOutRetryCount() == retry);
+  }
+
+  TEST_CHECK(g_testTimeOutClose == 0);
+  g_testMillis += webSocket_getRto();
+  webSocket_handle(client);
+
+  TEST_CHECK(g_testTimeOutClose == 1);
+  TEST_CHECK(!webSocket_isStart() && !client.connected());
+}
+
+// a keepalive ping that finds a pong not written yet is skipped, and a
+// pong echoing its timestamp is not taken for an RTT sample
+static void testPingBusy(void)
+{
+  WiFiClient client;
+  std::vector<TEST_FRAME> frames;
+  std::string timestamp(WEB_SOCKET_PING_PAYLOAD_SIZE, 0);
+  uint32_t now = 0;
+
+  testStart(WEBSOCKET_MODE_CLIENT);
+  webSocket_sendPong();
+
+  g_testMillis += webSocket_getKeepAliveInterval();
+  now = g_testMillis;
+  client.connection->output.clear();
+  webSocket_handle(client);
+  frames = testParse(client.connection->output);
+
+  TEST_CHECK((frames.size() == 1)
+             && (frames[0].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_PONG)));
+  TEST_CHECK(webSocket_getTimeOutRetryCount() == 1);
+
+  timestamp[0] = (char)(now >> 24);
+  timestamp[1] = (char)(now >> 16);
+  timestamp[2] = (char)(now >> 8);
+  timestamp[3] = (char)(now & 0x000000FF);
+  testPong(client, timestamp, 10);
+  TEST_CHECK(webSocket_getRtt() == 0);
+
+  // the next one goes out
+  testPong(client, testPing(client), 10);
+  TEST_CHECK(webSocket_getRtt() == 10);
+
+  webSocket_abort();
+}
+
+int main(void)
+{
+  testEstimator();
+  testInterval();
+  testClientTimeOut();
+  testPingBusy();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,99 @@
+/*
+ * @file    webSocketLogTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the deferred log of webSocketLog.h, built at WARN and at
+// NONE: order and format of the records, calls below the level compiled
+// out with their arguments, records lost on a full ring and lines cut to
+// the buffer.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocketLog.h"
+#include <Arduino.h>
+#include <HardwareSerial.h>
+
+static uint32_t g_testEvaluated = 0;
+
+static std::string testFormat(void)
+{
+  char line[WEB_SOCKET_LOG_LINE_SIZE];
+  uint16_t length = webSocket_logFormat(line, sizeof(line));
+
+  return std::string(line, length);
+}
+
+static void testRecords(void)
+{
+  g_testEvaluated = 0;
+  g_testMillis = 1200;
+  WEB_SOCKET_LOG_ERROR("closed %d", -1);
+  g_testMillis = 1250;
+  WEB_SOCKET_LOG_WARN("payload %u over %u, opcode %x '%c'", 70000, 1024, 0xA, 'p');
+  WEB_SOCKET_LOG_INFO("info %u", g_testEvaluated++);
+  WEB_SOCKET_LOG_DEBUG("debug %u", g_testEvaluated++);
+  WEB_SOCKET_LOG_WARN("no arguments");
+
+  TEST_CHECK(g_testEvaluated == 0);  // compiled out, arguments included
+
+#if WEB_SOCKET_LOG_LEVEL >= WEB_SOCKET_LOG_LEVEL_WARN
+  TEST_CHECK(testFormat() == "1200 E closed -1");
+  TEST_CHECK(testFormat() == "1250 W payload 70000 over 1024, opcode a 'p'");
+  TEST_CHECK(testFormat() == "1250 W no arguments");
+#endif
+
+  TEST_CHECK(testFormat().empty());
+}
+
+static void testLost(void)
+{
+  for (uint32_t i = 0; i < WEB_SOCKET_LOG_SLOTS + 5; i++)
+  {
+    WEB_SOCKET_LOG_ERROR("record %u", i);
+  }
+
+#if WEB_SOCKET_LOG_LEVEL >= WEB_SOCKET_LOG_LEVEL_ERROR
+  // the oldest are kept, the drain reports and clears the lost count
+  TEST_CHECK(webSocket_logGetLost() == 5);
+  TEST_CHECK(testFormat() == "1250 E record 0");
+  TEST_CHECK(webSocket_logDrain(Serial, 4) == 4);
+  TEST_CHECK(webSocket_logGetLost() == 0);
+  TEST_CHECK(testFormat() == "1250 E record 5");
+  TEST_CHECK(webSocket_logDrain(Serial, 100) == WEB_SOCKET_LOG_SLOTS - 6);
+#endif
+
+  TEST_CHECK(webSocket_logGetLost() == 0);
+  TEST_CHECK(webSocket_logDrain(Serial, 100) == 0);
+}
+
+static void testTruncate(void)
+{
+  char line[12];
+
+  memset(line, '#', sizeof(line));
+  g_testMillis = 7;
+  WEB_SOCKET_LOG_ERROR("a long message %u", 123456);
+
+#if WEB_SOCKET_LOG_LEVEL >= WEB_SOCKET_LOG_LEVEL_ERROR
+  TEST_CHECK(webSocket_logFormat(line, sizeof(line)) == sizeof(line) - 1);
+  TEST_CHECK(strcmp(line, "7 E a long ") == 0);
+#endif
+
+  TEST_CHECK(webSocket_logFormat(line, sizeof(line)) == 0);
+}
+
+int main(void)
+{
+  testRecords();
+  testLost();
+  testTruncate();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,202 @@
+/*
+ * @file    webSocketMsgPackTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for webSocketMsgPack.h: every encoding the writer picks read
+// back at its limits, array and map counts the buffer cannot hold (above
+// 65535 and wrapping ones among them) and every truncation of a message.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketMsgPack.h"
+
+static const int32_t g_testInts[] = { 0, 127, 128, 255, 256, 65535, 65536,
+                                      INT32_MAX, -1, -32, -33, -128, -129,
+                                      -32768, -32769, INT32_MIN };
+static const uint16_t g_testLengths[] = { 0, 31, 32, 255, 256, 300 };
+
+static char g_testBuffer[4096];
+
+// one array holding a value of every kind
+static uint16_t testWrite(void)
+{
+  WEB_SOCKET_MSGPACK_WRITER pack;
+  std::string text(300, 't');
+  uint16_t count = sizeof(g_testInts) / sizeof(g_testInts[0])
+                   + 2 * (sizeof(g_testLengths) / sizeof(g_testLengths[0])) + 6;
+
+  webSocket_msgpackInit(&pack, g_testBuffer, sizeof(g_testBuffer));
+  webSocket_msgpackArray(&pack, count);
+  webSocket_msgpackNil(&pack);
+  webSocket_msgpackBool(&pack, true);
+  webSocket_msgpackUInt(&pack, UINT32_MAX);
+  webSocket_msgpackFloat(&pack, -1.5f);
+
+  for (size_t i = 0; i < sizeof(g_testInts) / sizeof(g_testInts[0]); i++)
+  {
+    webSocket_msgpackInt(&pack, g_testInts[i]);
+  }
+
+  for (size_t i = 0; i < sizeof(g_testLengths) / sizeof(g_testLengths[0]); i++)
+  {
+    webSocket_msgpackStr(&pack, text.data(), g_testLengths[i]);
+    webSocket_msgpackBin(&pack, text.data(), g_testLengths[i]);
+  }
+
+  webSocket_msgpackArray(&pack, 16);
+
+  for (uint16_t i = 0; i < 16; i++)
+  {
+    webSocket_msgpackUInt(&pack, i);
+  }
+
+  webSocket_msgpackMap(&pack, 16);
+
+  for (uint16_t i = 0; i < 16; i++)
+  {
+    webSocket_msgpackStr(&pack, "k", 1);
+    webSocket_msgpackInt(&pack, -i);
+  }
+
+  TEST_CHECK(!pack.is_overflow);
+
+  return pack.length;
+}
+
+static void testRoundTrip(void)
+{
+  WEB_SOCKET_MSGPACK_READER unpack;
+  uint16_t length = testWrite();
+  uint16_t count = 0;
+  uint32_t unsigned_value = 0;
+  int32_t value = 0;
+  float real = 0;
+  bool flag = false;
+  const char *str = NULL;
+  const uint8_t *bin = NULL;
+  uint16_t str_length = 0;
+
+  webSocket_msgpackReaderInit(&unpack, g_testBuffer, length);
+  TEST_CHECK(webSocket_msgpackReadArray(&unpack, &count) && (count == 34));
+  TEST_CHECK(webSocket_msgpackReadNil(&unpack));
+  TEST_CHECK(webSocket_msgpackReadBool(&unpack, &flag) && flag);
+  TEST_CHECK(!webSocket_msgpackReadInt(&unpack, &value));  // does not fit
+  TEST_CHECK(webSocket_msgpackReadUInt(&unpack, &unsigned_value)
+             && (unsigned_value == UINT32_MAX));
+  TEST_CHECK(webSocket_msgpackReadFloat(&unpack, &real) && (real == -1.5f));
+
+  for (size_t i = 0; i < sizeof(g_testInts) / sizeof(g_testInts[0]); i++)
+  {
+    TEST_CHECK(webSocket_msgpackReadInt(&unpack, &value) && (value == g_testInts[i]));
+  }
+
+  for (size_t i = 0; i < sizeof(g_testLengths) / sizeof(g_testLengths[0]); i++)
+  {
+    TEST_CHECK(webSocket_msgpackReadStr(&unpack, &str, &str_length)
+               && (str_length == g_testLengths[i]));
+    TEST_CHECK(webSocket_msgpackReadBin(&unpack, &bin, &str_length)
+               && (str_length == g_testLengths[i]));
+  }
+
+  TEST_CHECK(webSocket_msgpackReadArray(&unpack, &count) && (count == 16));
+  TEST_CHECK(webSocket_msgpackSkip(&unpack));
+  TEST_CHECK(webSocket_msgpackPeekType(&unpack) == WEBSOCKET_MSGPACK_INT);
+
+  for (uint16_t i = 1; i < 16; i++)
+  {
+    TEST_CHECK(webSocket_msgpackSkip(&unpack));
+  }
+
+  TEST_CHECK(webSocket_msgpackReadMap(&unpack, &count) && (count == 16));
+
+  for (uint16_t i = 0; i < 32; i++)
+  {
+    TEST_CHECK(webSocket_msgpackSkip(&unpack));
+  }
+
+  TEST_CHECK((unpack.index == length) && !unpack.is_error);
+  TEST_CHECK(webSocket_msgpackPeekType(&unpack) == WEBSOCKET_MSGPACK_INVALID);
+
+  webSocket_msgpackReaderInit(&unpack, g_testBuffer, length);
+  TEST_CHECK(webSocket_msgpackSkip(&unpack) && (unpack.index == length));
+}
+
+// Counts are refused when the rest of the buffer cannot hold the elements,
+// before they could be truncated to 16 bits or wrap a skip.
+static void testCounts(void)
+{
+  static const struct
+  {
+    const char *data;
+    uint16_t length;
+    uint8_t type;
+    uint16_t count;  // 0 when refused
+  } cases[] = {
+    { "\xDD\x00\x01\x11\x70" "0123456789", 15, WEBSOCKET_MSGPACK_ARRAY, 0 },  // 70000
+    { "\xDD\x00\x01\x00\x01" "0123456789", 15, WEBSOCKET_MSGPACK_ARRAY, 0 },  // 65537
+    { "\xDD\xFF\xFF\xFF\xFF", 5, WEBSOCKET_MSGPACK_ARRAY, 0 },
+    { "\xDC\xFF\xFF" "0123456789", 13, WEBSOCKET_MSGPACK_ARRAY, 0 },
+    { "\x93\x01\x02", 3, WEBSOCKET_MSGPACK_ARRAY, 0 },
+    { "\x93\x01\x02\x03", 4, WEBSOCKET_MSGPACK_ARRAY, 3 },
+    { "\xDD\x00\x00\x00\x03\x01\x02\x03", 8, WEBSOCKET_MSGPACK_ARRAY, 3 },
+    { "\xDF\x80\x00\x00\x00" "0123456789", 15, WEBSOCKET_MSGPACK_MAP, 0 },  // 2 x 2^31 wraps
+    { "\xDF\x00\x01\x00\x00" "0123456789", 15, WEBSOCKET_MSGPACK_MAP, 0 },  // 65536
+    { "\x82\x01\x02\x03", 4, WEBSOCKET_MSGPACK_MAP, 0 },
+    { "\x82\x01\x02\x03\x04", 5, WEBSOCKET_MSGPACK_MAP, 2 },
+    { "\xDE\x00\x02\x01\x02\x03\x04", 7, WEBSOCKET_MSGPACK_MAP, 2 },
+  };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+  {
+    WEB_SOCKET_MSGPACK_READER unpack;
+    uint16_t count = 0;
+    bool ok = false;
+
+    webSocket_msgpackReaderInit(&unpack, cases[i].data, cases[i].length);
+    ok = (cases[i].type == WEBSOCKET_MSGPACK_ARRAY)
+         ? webSocket_msgpackReadArray(&unpack, &count)
+         : webSocket_msgpackReadMap(&unpack, &count);
+    TEST_CHECK(ok == (cases[i].count != 0));
+    TEST_CHECK(!ok || (count == cases[i].count));
+    TEST_CHECK(ok != unpack.is_error);
+
+    webSocket_msgpackReaderInit(&unpack, cases[i].data, cases[i].length);
+    TEST_CHECK(webSocket_msgpackSkip(&unpack) == (cases[i].count != 0));
+    TEST_CHECK(unpack.index <= cases[i].length);
+  }
+}
+
+// no cut of the message skips as a whole or reads past the cut
+static void testTruncated(void)
+{
+  uint16_t length = testWrite();
+  int failed = 0;
+
+  for (uint16_t cut = 0; cut < length; cut++)
+  {
+    WEB_SOCKET_MSGPACK_READER unpack;
+
+    webSocket_msgpackReaderInit(&unpack, g_testBuffer, cut);
+    failed += webSocket_msgpackSkip(&unpack);
+    failed += (unpack.index > cut);
+  }
+
+  TEST_CHECK(failed == 0);
+}
+
+int main(void)
+{
+  testRoundTrip();
+  testCounts();
+  testTruncated();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,264 @@
+/*
+ * @file    webSocketMuxTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the logical channels of webSocketMux.h (WEBSOCKET_MUX):
+// round robin sends within the window, credit from the peer, credit granted
+// back for handled, truncated and fragmented messages, and binary frames
+// that are not mux frames reaching the receive handler.
+
+#include <stdio.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketMux.h"
+
+typedef struct _TEST_MESSAGE
+{
+  uint8_t channel;
+  std::string payload;
+} TEST_MESSAGE;
+
+static WiFiClient g_testClient;
+static std::vector<TEST_MESSAGE> g_testMux;
+static std::vector<std::string> g_testReceived;
+
+static void testMuxHandler(uint8_t channel, const char *payload,
+                           uint16_t payload_length)
+{
+  TEST_MESSAGE message = { channel, std::string(payload, payload_length) };
+
+  g_testMux.push_back(message);
+}
+
+static void testReceive(void)
+{
+  if (webSocket_getOpcode() & WEB_SOCKET_FRAME_CONTROL)
+  {
+    return;
+  }
+
+  g_testReceived.push_back(std::string(webSocket_getPayload(), webSocket_available()));
+}
+
+static void testBegin(void)
+{
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_setHandler(WEBSOCKET_HANDLER_RECIVE, testReceive);
+  webSocket_start();
+
+  for (uint8_t i = 0; i < WEB_SOCKET_MUX_CHANNELS; i++)
+  {
+    webSocket_muxSetHandler(i, testMuxHandler);
+  }
+
+  g_testClient.connection->input.clear();
+  g_testClient.connection->inputOffset = 0;
+  g_testClient.connection->output.clear();
+  g_testMux.clear();
+  g_testReceived.clear();
+}
+
+// a frame from the server, unmasked
+static std::string testFrame(bool fin, uint8_t opcode, const std::string &payload)
+{
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t length = webSocket_frameEncodeHeader(header, fin, 0, opcode, NULL,
+                                               payload.size());
+
+  return std::string((const char *) header, length) + payload;
+}
+
+static std::string testMuxFrame(uint8_t channel, const std::string &message)
+{
+  return std::string("\xC1") + (char) WEBSOCKET_BINARY_MUX + (char) channel + message;
+}
+
+static std::string testCreditFrame(uint8_t channel, uint16_t credit)
+{
+  return std::string("\xC1") + (char) WEBSOCKET_BINARY_MUX_CREDIT + (char) channel
+         + (char)(credit >> 8) + (char)(credit & 0xFF);
+}
+
+// feeds the stream and returns the data frames written meanwhile
+static std::vector<TEST_FRAME> testHandle(const std::string &stream, int calls)
+{
+  std::vector<TEST_FRAME> frames;
+  std::vector<TEST_FRAME> data;
+
+  g_testClient.connection->input += stream;
+
+  for (int i = 0; i < calls; i++)
+  {
+    webSocket_handle(g_testClient);
+  }
+
+  frames = testParse(g_testClient.connection->output);
+  g_testClient.connection->output.clear();
+
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    if (!(frames[i].head & WEB_SOCKET_FRAME_CONTROL))
+    {
+      data.push_back(frames[i]);
+    }
+  }
+
+  return data;
+}
+
+// credit granted to a channel by the frames written
+static uint32_t testGranted(const std::vector<TEST_FRAME> &frames, uint8_t channel)
+{
+  uint32_t credit = 0;
+
+  for (size_t f = 0; f < frames.size(); f++)
+  {
+    const std::string &p = frames[f].payload;
+
+    if ((p.size() < 2) || ((uint8_t) p[0] != WEB_SOCKET_BINARY_TAG)
+        || (p[1] != WEBSOCKET_BINARY_MUX_CREDIT))
+    {
+      continue;
+    }
+
+    for (size_t i = 2; i + 3 <= p.size(); i += 3)
+    {
+      if ((uint8_t) p[i] == channel)
+      {
+        credit += ((uint8_t) p[i + 1] << 8) | (uint8_t) p[i + 2];
+      }
+    }
+  }
+
+  return credit;
+}
+
+// one message per handle, the channels in turn, none beyond the window
+static void testSend(void)
+{
+  std::string message(100, 'm');
+  std::vector<TEST_FRAME> frames;
+  int sent = 0;
+
+  testBegin();
+
+  TEST_CHECK(!webSocket_muxSend(WEB_SOCKET_MUX_CHANNELS, "x", 1));
+  TEST_CHECK(!webSocket_muxSend(0, message.c_str(), WEB_SOCKET_MUX_WINDOW + 1));
+  TEST_CHECK(webSocket_muxSend(0, "a1", 2) && webSocket_muxSend(0, "a2", 2));
+  TEST_CHECK(webSocket_muxSend(1, "b1", 2));
+  TEST_CHECK(webSocket_muxGetQueued(0) == 8);
+
+  frames = testHandle("", 3);
+  TEST_CHECK((frames.size() == 3)
+             && (frames[0].payload == testMuxFrame(0, "a1"))
+             && (frames[1].payload == testMuxFrame(1, "b1"))
+             && (frames[2].payload == testMuxFrame(0, "a2")));
+  TEST_CHECK(webSocket_muxGetCredit(0) == WEB_SOCKET_MUX_WINDOW - 4);
+
+  // channel 2 runs out of credit, channel 3 still goes
+  for (int i = 0; i < 8; i++)
+  {
+    webSocket_muxSend(2, message.c_str(), message.size());
+    sent += testHandle("", 1).size();
+  }
+
+  TEST_CHECK(sent == (int)(WEB_SOCKET_MUX_WINDOW / message.size()));
+  TEST_CHECK(webSocket_muxGetCredit(2) < message.size());
+  TEST_CHECK(webSocket_muxGetQueued(2) > 0);
+
+  TEST_CHECK(webSocket_muxSend(3, "d", 1));
+  frames = testHandle("", 4);
+  TEST_CHECK((frames.size() == 1) && (frames[0].payload == testMuxFrame(3, "d")));
+
+  // credit from the server releases the rest
+  frames = testHandle(testFrame(true, OPCODE_FRAME_BINARY,
+                                testCreditFrame(2, WEB_SOCKET_MUX_WINDOW)), 8);
+  TEST_CHECK(!frames.empty() && (webSocket_muxGetQueued(2) == 0));
+  TEST_CHECK(g_testReceived.empty());
+
+  webSocket_abort();
+}
+
+// bytes handled are granted back once half the window is used
+static void testGrant(void)
+{
+  std::string message(WEB_SOCKET_MUX_WINDOW / 4, 'r');
+  std::vector<TEST_FRAME> frames;
+
+  testBegin();
+
+  frames = testHandle(testFrame(true, OPCODE_FRAME_BINARY, testMuxFrame(1, message)), 2);
+  TEST_CHECK((g_testMux.size() == 1) && (g_testMux[0].channel == 1)
+             && (g_testMux[0].payload == message));
+  TEST_CHECK(frames.empty());
+
+  frames = testHandle(testFrame(true, OPCODE_FRAME_BINARY, testMuxFrame(1, message)), 2);
+  TEST_CHECK((g_testMux.size() == 2) && (frames.size() == 1));
+  TEST_CHECK(testGranted(frames, 1) == 2 * message.size());
+  TEST_CHECK(g_testReceived.empty());
+
+  webSocket_abort();
+}
+
+// A message larger than the receive buffer is handled truncated, credit
+// covers all of it.
+static void testTruncated(void)
+{
+  std::string message(WEB_SOCKET_RECIVE_PAYLOAD_SIZE + 100, 't');
+  std::vector<TEST_FRAME> frames;
+
+  testBegin();
+
+  frames = testHandle(testFrame(true, OPCODE_FRAME_BINARY, testMuxFrame(0, message)), 4);
+  TEST_CHECK((g_testMux.size() == 1)
+             && (g_testMux[0].payload.size()
+                 == WEB_SOCKET_RECIVE_PAYLOAD_SIZE - WEB_SOCKET_MUX_HEADER_SIZE));
+  TEST_CHECK(testGranted(frames, 0) == message.size());
+
+  webSocket_abort();
+}
+
+// A fragmented mux message is dropped, its fragments are granted back and
+// do not reach the receive handler. Control frames may come in between.
+static void testFragmented(void)
+{
+  std::string part(WEB_SOCKET_MUX_WINDOW / 2, 'f');
+  std::vector<TEST_FRAME> frames;
+
+  testBegin();
+
+  frames = testHandle(testFrame(false, OPCODE_FRAME_BINARY, testMuxFrame(3, part))
+                      + testFrame(false, OPCODE_FRAME_CONTINUE, part)
+                      + testFrame(true, OPCODE_FRAME_PING, "")
+                      + testFrame(true, OPCODE_FRAME_CONTINUE, part), 8);
+  TEST_CHECK(g_testMux.empty() && g_testReceived.empty());
+  TEST_CHECK(testGranted(frames, 3) == 3 * part.size());
+
+  // binary messages that are not mux frames, whole or in fragments
+  frames = testHandle(testFrame(true, OPCODE_FRAME_BINARY, "\x01\x02")
+                      + testFrame(false, OPCODE_FRAME_BINARY, "\x01")
+                      + testFrame(true, OPCODE_FRAME_CONTINUE, "\x02"), 4);
+  TEST_CHECK((g_testReceived.size() == 3) && (g_testReceived[0] == "\x01\x02")
+             && (g_testReceived[1] == "\x01") && (g_testReceived[2] == "\x02"));
+  TEST_CHECK(g_testMux.empty() && frames.empty());
+
+  webSocket_abort();
+}
+
+int main(void)
+{
+  testSend();
+  testGrant();
+  testTruncated();
+  testFragmented();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,171 @@
+/*
+ * @file    webSocketPoolTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the block pool of webSocketPool.h: size classes, counters
+// and foreign or double frees, then replies built in the receive handler
+// while the received payload still holds its block.
+
+#include <stdio.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketJson.h"
+#include "webSocketMsgPack.h"
+#include "webSocketPool.h"
+
+static void testClasses(void)
+{
+  char *small = webSocket_poolAlloc(1);
+  char *medium = webSocket_poolAlloc(WEB_SOCKET_POOL_SMALL_SIZE + 1);
+  char *large[WEB_SOCKET_POOL_LARGE_COUNT];
+  char foreign[16];
+  uint32_t failed = webSocket_poolGetFailed();
+
+  // the smallest class that fits
+  TEST_CHECK(webSocket_poolGetSize(small) == WEB_SOCKET_POOL_SMALL_SIZE);
+  TEST_CHECK(webSocket_poolGetSize(medium) == WEB_SOCKET_POOL_MEDIUM_SIZE);
+  TEST_CHECK(((uintptr_t) small & 3) == 0 && ((uintptr_t) medium & 3) == 0);
+  TEST_CHECK(webSocket_poolGetSize(foreign) == 0);
+
+  for (uint8_t i = 0; i < WEB_SOCKET_POOL_LARGE_COUNT; i++)
+  {
+    large[i] = webSocket_poolAlloc(WEB_SOCKET_POOL_FRAME_MAX);
+    TEST_CHECK(webSocket_poolGetSize(large[i]) >= WEB_SOCKET_POOL_FRAME_MAX);
+  }
+
+  TEST_CHECK(webSocket_poolAlloc(WEB_SOCKET_POOL_FRAME_MAX) == NULL);
+  TEST_CHECK(webSocket_poolAlloc(WEB_SOCKET_POOL_LARGE_SIZE + 1) == NULL);
+  TEST_CHECK(webSocket_poolGetFailed() == failed + 2);
+  TEST_CHECK(webSocket_poolGetUsed(WEBSOCKET_POOL_LARGE) == WEB_SOCKET_POOL_LARGE_COUNT);
+
+  // a foreign pointer or a second free changes nothing
+  webSocket_poolFree(foreign);
+  webSocket_poolFree(large[0]);
+  webSocket_poolFree(large[0]);
+  TEST_CHECK(webSocket_poolGetUsed(WEBSOCKET_POOL_LARGE) == WEB_SOCKET_POOL_LARGE_COUNT - 1);
+  TEST_CHECK(webSocket_poolAlloc(WEB_SOCKET_POOL_FRAME_MAX) == large[0]);
+
+  for (uint8_t i = 0; i < WEB_SOCKET_POOL_LARGE_COUNT; i++)
+  {
+    webSocket_poolFree(large[i]);
+  }
+
+  webSocket_poolFree(small);
+  webSocket_poolFree(medium);
+
+  for (uint8_t i = 0; i < WEBSOCKET_POOL_CLASSES; i++)
+  {
+    TEST_CHECK(webSocket_poolGetUsed(i) == 0);
+  }
+
+  TEST_CHECK(webSocket_poolGetHighWater(WEBSOCKET_POOL_LARGE) == WEB_SOCKET_POOL_LARGE_COUNT);
+}
+
+static std::string g_testEcho;
+static uint8_t g_testReply = 0;
+
+enum testReplyType {
+  TEST_REPLY_ECHO = 0,
+  TEST_REPLY_JSON,
+  TEST_REPLY_MSGPACK
+};
+
+// replies from inside the handler, the received payload is still borrowed
+static void testReceive(void)
+{
+  WEB_SOCKET_JSON_WRITER json;
+  WEB_SOCKET_MSGPACK_WRITER pack;
+
+  g_testEcho.assign(webSocket_getPayload(), webSocket_available());
+
+  switch (g_testReply)
+  {
+    case TEST_REPLY_ECHO:
+      webSocket_setData(g_testEcho.data(), g_testEcho.size(), OPCODE_FRAME_TEXT);
+      break;
+    case TEST_REPLY_JSON:
+      if (webSocket_jsonBegin(&json))
+      {
+        webSocket_jsonObjectBegin(&json);
+        webSocket_jsonKey(&json, "length");
+        webSocket_jsonUInt(&json, g_testEcho.size());
+        webSocket_jsonObjectEnd(&json);
+        webSocket_jsonCommit(&json);
+      }
+      break;
+    case TEST_REPLY_MSGPACK:
+      if (webSocket_msgpackBegin(&pack))
+      {
+        webSocket_msgpackUInt(&pack, g_testEcho.size());
+        webSocket_msgpackCommit(&pack);
+      }
+      break;
+  }
+}
+
+static std::string testReply(uint8_t reply, size_t length)
+{
+  WiFiClient client;
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  std::string payload(length, 'r');
+  std::vector<TEST_FRAME> frames;
+
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_setHandler(WEBSOCKET_HANDLER_RECIVE, testReceive);
+  webSocket_start();
+  g_testReply = reply;
+
+  client.connection->input.assign((const char *) header,
+                                  webSocket_frameEncodeHeader(header, true, 0,
+                                                              OPCODE_FRAME_TEXT,
+                                                              NULL, length));
+  client.connection->input += payload;
+  webSocket_handle(client);
+  webSocket_handle(client);
+  webSocket_abort();
+
+  for (uint8_t i = 0; i < WEBSOCKET_POOL_CLASSES; i++)
+  {
+    TEST_CHECK(webSocket_poolGetUsed(i) == 0);  // all returned
+  }
+
+  frames = testParse(client.connection->output);
+
+  return (frames.size() == 1) ? frames[0].payload : "";
+}
+
+static void testHandlerReply(void)
+{
+  static const size_t lengths[] = { 10, WEB_SOCKET_POOL_MEDIUM_SIZE + 44,
+                                    WEB_SOCKET_RECIVE_PAYLOAD_SIZE };
+
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+  {
+    std::string expected = "{\"length\":" + std::to_string(lengths[i]) + "}";
+
+    TEST_CHECK(testReply(TEST_REPLY_ECHO, lengths[i]) == std::string(lengths[i], 'r'));
+    TEST_CHECK(testReply(TEST_REPLY_JSON, lengths[i]) == expected);
+    std::string packed = testReply(TEST_REPLY_MSGPACK, lengths[i]);
+    WEB_SOCKET_MSGPACK_READER unpack;
+    uint32_t value = 0;
+
+    webSocket_msgpackReaderInit(&unpack, packed.data(), packed.size());
+    TEST_CHECK(webSocket_msgpackReadUInt(&unpack, &value) && (value == lengths[i]));
+  }
+}
+
+int main(void)
+{
+  testClasses();
+  testHandlerReply();
+
+  return TEST_RESULT();
+}
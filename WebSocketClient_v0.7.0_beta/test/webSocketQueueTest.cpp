@@ -0,0 +1,295 @@
+/*
+ * @file    webSocketQueueTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the offline queue (webSocketQueue.h), alone and behind
+// webSocket_setData()/webSocket_handle(). Built twice: on the mmap backend
+// and with ARDUINO on the flash emulation of stubs/Esp.h.
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketFrame.h"
+#include "webSocketQueue.h"
+
+// records keep FIN and RSV and are masked with the key given to read
+static void testRecords(void)
+{
+  static const uint8_t spool_mask[WEB_SOCKET_MASK_KEY_SIZE] = { 9, 8, 7, 6 };
+  static const uint8_t drain_mask[WEB_SOCKET_MASK_KEY_SIZE] = { 1, 2, 3, 4 };
+  std::string payload = "spooled with one key, drained with another";
+  std::string masked = payload;
+  char buffer[1024];
+  uint16_t count = 0;
+  uint16_t length = 0;
+
+  for (size_t i = 0; i < masked.size(); i++)
+  {
+    masked[i] ^= spool_mask[i & 3];
+  }
+
+  webSocket_queueClear();
+  TEST_CHECK(webSocket_queueAppend(0x01, payload.data(), payload.size(), NULL));  // no FIN
+  TEST_CHECK(webSocket_queueAppend(0xC0, masked.data(), masked.size(), spool_mask));
+  TEST_CHECK(webSocket_queueAppend(0x82, NULL, 0, NULL));
+  TEST_CHECK(webSocket_queueGetCount() == 3);
+
+  length = webSocket_queueRead(buffer, sizeof(buffer), drain_mask, &count);
+  TEST_CHECK(count == 3);
+
+  std::vector<TEST_FRAME> frames = testParse(std::string(buffer, length));
+
+  TEST_CHECK(frames.size() == 3);
+  TEST_CHECK((frames[0].head == 0x01) && (frames[0].payload == payload));
+  TEST_CHECK((frames[1].head == 0xC0) && (frames[1].payload == payload));
+  TEST_CHECK((frames[2].head == 0x82) && frames[2].payload.empty());
+  TEST_CHECK(frames[0].masked && frames[1].masked && frames[2].masked);
+
+  // unmasked for a server role, and nothing consumed by a read
+  length = webSocket_queueRead(buffer, sizeof(buffer), NULL, &count);
+  frames = testParse(std::string(buffer, length));
+  TEST_CHECK((count == 3) && (frames.size() == 3) && !frames[1].masked);
+  TEST_CHECK(frames[1].payload == payload);
+
+  // a frame that does not fit stays for the next read
+  length = webSocket_queueRead(buffer, 60, NULL, &count);
+  TEST_CHECK((count == 1) && (length == 2 + payload.size()));
+
+  webSocket_queueConsume(3);
+  TEST_CHECK(webSocket_queueIsEmpty());
+}
+
+// frames spooled before the session sets its mask policy go out masked
+static void testSession(void)
+{
+  WiFiClient client;
+  std::vector<TEST_FRAME> frames;
+
+  webSocket_queueClear();
+  webSocket_init();
+
+  for (int i = 0; i < 10; i++)
+  {
+    webSocket_setData(String("offline ") + String(i));
+  }
+
+  TEST_CHECK(webSocket_queueGetCount() == 10);
+
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_setRefreshMask(0x11, 0x22, 0x33, 0x44);
+  webSocket_start();
+  webSocket_handle(client);
+
+  frames = testParse(client.connection->output);
+  TEST_CHECK(frames.size() == 10);
+  TEST_CHECK(webSocket_queueIsEmpty());
+
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    TEST_CHECK(frames[i].masked);
+    TEST_CHECK(frames[i].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_TEXT));
+    TEST_CHECK(frames[i].payload == "offline " + std::to_string(i));
+  }
+
+  webSocket_abort();
+}
+
+// a drain cut short drops the session, the next one resumes on a frame
+// boundary without sending anything twice
+static void testShortWrite(void)
+{
+  WiFiClient client;
+  WiFiClient next;
+  std::vector<TEST_FRAME> frames;
+
+  webSocket_queueClear();
+  webSocket_init();
+
+  for (int i = 0; i < 10; i++)
+  {
+    webSocket_setData(String("short ") + String(i));
+  }
+
+  client.connection->writeLimit = 3 * (2 + 4 + 7) + 5;  // three and a bit masked frames
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_start();
+  webSocket_handle(client);
+
+  TEST_CHECK(!client.connected());
+  TEST_CHECK(!webSocket_isStart());
+  TEST_CHECK(webSocket_queueGetCount() == 7);
+
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_start();
+  webSocket_handle(next);
+
+  frames = testParse(next.connection->output);
+  TEST_CHECK(frames.size() == 7);
+
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    TEST_CHECK(frames[i].payload == "short " + std::to_string(i + 3));
+  }
+
+  webSocket_abort();
+}
+
+static std::string testPayload(int index)
+{
+  char payload[48];
+
+  snprintf(payload, sizeof(payload), "stage %05d ................................", index);
+
+  return payload;
+}
+
+// reads and consumes everything that is queued
+static std::vector<TEST_FRAME> testDrain(void)
+{
+  std::vector<TEST_FRAME> frames;
+  std::vector<TEST_FRAME> read;
+  char buffer[2048];
+  uint16_t count = 0;
+  uint16_t length = 0;
+
+  do
+  {
+    length = webSocket_queueRead(buffer, sizeof(buffer), NULL, &count);
+    read = testParse(std::string(buffer, length));
+    frames.insert(frames.end(), read.begin(), read.end());
+    webSocket_queueConsume(count);
+  }
+  while (count);
+
+  return frames;
+}
+
+// staged records cross sectors, survive a restart once polled, and a full
+// ring drops the oldest sector
+static void testStage(void)
+{
+  std::string large(1000, 'L');
+  std::vector<TEST_FRAME> frames;
+
+  webSocket_queueClear();
+  webSocket_queuePoll();
+
+  for (int i = 0; i < 200; i++)
+  {
+    std::string payload = testPayload(i);
+
+    TEST_CHECK(webSocket_queueAppend(0x81, payload.data(), payload.size(), NULL));
+
+    if ((i % 10) == 9)
+    {
+      webSocket_queuePoll();
+    }
+  }
+
+  // larger than the stage
+  TEST_CHECK(webSocket_queueAppend(0x82, large.data(), large.size(), NULL));
+  webSocket_queuePoll();
+
+  TEST_CHECK(webSocket_queueBegin());
+  TEST_CHECK(webSocket_queueGetCount() == 201);
+
+  frames = testDrain();
+  TEST_CHECK(frames.size() == 201);
+
+  for (size_t i = 0; (i < frames.size()) && (i < 200); i++)
+  {
+    TEST_CHECK(frames[i].payload == testPayload(i));
+  }
+
+  TEST_CHECK((frames.size() == 201) && (frames[200].payload == large));
+  TEST_CHECK(webSocket_queueIsEmpty());
+
+  // about 72 records a sector, 16 sectors
+  for (int i = 0; i < 2000; i++)
+  {
+    std::string payload = testPayload(i);
+
+    TEST_CHECK(webSocket_queueAppend(0x81, payload.data(), payload.size(), NULL));
+    webSocket_queuePoll();
+  }
+
+  uint32_t count = webSocket_queueGetCount();
+
+  TEST_CHECK((count > 1000) && (count < 2000));
+  TEST_CHECK(webSocket_queueBegin());
+  TEST_CHECK(webSocket_queueGetCount() == count);
+
+  frames = testDrain();
+  TEST_CHECK(frames.size() == count);
+
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    TEST_CHECK(frames[i].payload == testPayload(2000 - count + i));
+  }
+}
+
+#ifdef ARDUINO
+// appends cost no erase and about one write per stage, the erase happens in
+// webSocket_queuePoll()
+static void testFlashWork(void)
+{
+  std::string payload(20, 'f');  // 36 byte records
+
+  webSocket_queueClear();
+  webSocket_queuePoll();
+  ESP.flashWrites = 0;
+  ESP.flashErases = 0;
+
+  for (int i = 0; i < 20; i++)
+  {
+    TEST_CHECK(webSocket_queueAppend(0x81, payload.data(), payload.size(), NULL));
+  }
+
+  TEST_CHECK(ESP.flashWrites == 20 * 36 / WEB_SOCKET_QUEUE_STAGE_SIZE);
+  TEST_CHECK(ESP.flashErases == 0);
+
+  webSocket_queuePoll();
+  TEST_CHECK(ESP.flashErases == 0);  // erased ahead by the poll after webSocket_queueClear()
+
+  // past the end of the first sector into the erased one
+  ESP.flashWrites = 0;
+
+  for (int i = 0; i < 150; i++)
+  {
+    TEST_CHECK(webSocket_queueAppend(0x81, payload.data(), payload.size(), NULL));
+  }
+
+  TEST_CHECK(ESP.flashErases == 0);
+  TEST_CHECK(ESP.flashWrites <= 150 * 36 / WEB_SOCKET_QUEUE_STAGE_SIZE + 3);
+
+  webSocket_queuePoll();
+  TEST_CHECK(ESP.flashErases == 1);
+  TEST_CHECK(testDrain().size() == 170);
+}
+#endif // ARDUINO
+
+int main(void)
+{
+  remove(WEB_SOCKET_QUEUE_FILE);
+  TEST_CHECK(webSocket_queueBegin());
+
+  testRecords();
+  testSession();
+  testShortWrite();
+  testStage();
+#ifdef ARDUINO
+  testFlashWork();
+#endif // ARDUINO
+
+  return TEST_RESULT();
+}
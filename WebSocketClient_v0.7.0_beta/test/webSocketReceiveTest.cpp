@@ -0,0 +1,250 @@
+/*
+ * @file    webSocketReceiveTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the receive path of webSocket_handle(): frames split
+// across TCP segments at every offset, masked payloads unmasked across the
+// split, payloads over WEB_SOCKET_RECIVE_PAYLOAD_SIZE truncated and the
+// rest skipped in sync, a close acted on only once it is complete, and
+// headers RFC 6455 forbids closed with 1002.
+
+#include <stdio.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+
+typedef struct _TEST_MESSAGE
+{
+  uint8_t opcode;
+  std::string payload;
+} TEST_MESSAGE;
+
+static std::vector<TEST_MESSAGE> g_testMessages;
+
+static void testReceive(void)
+{
+  TEST_MESSAGE message = { webSocket_getOpcode(),
+                           std::string(webSocket_getPayload(), webSocket_available()) };
+
+  g_testMessages.push_back(message);
+}
+
+static void testStart(uint8_t mode)
+{
+  webSocket_init();
+  webSocket_setMode(mode);
+  webSocket_setUseMask(mode == WEBSOCKET_MODE_CLIENT);
+  webSocket_setHandler(WEBSOCKET_HANDLER_RECIVE, testReceive);
+  webSocket_start();
+  g_testMessages.clear();
+}
+
+// a frame from the peer, masked when a key is given
+static std::string testFrame(uint8_t opcode, const std::string &payload,
+                             const uint8_t *mask = NULL)
+{
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t length = webSocket_frameEncodeHeader(header, true, 0, opcode, mask,
+                                               payload.size());
+  std::string frame((const char *) header, length);
+
+  for (size_t i = 0; i < payload.size(); i++)
+  {
+    frame += (char)(payload[i] ^ ((mask != NULL) ? mask[i & 3] : 0));
+  }
+
+  return frame;
+}
+
+static std::string testPayload(size_t length, uint8_t seed)
+{
+  std::string payload(length, 0);
+
+  for (size_t i = 0; i < length; i++)
+  {
+    payload[i] = (char)('a' + (i * 7 + seed) % 26);
+  }
+
+  return payload;
+}
+
+// a 100 byte frame in two reads, the second with the next frame behind it
+static void testSplit(void)
+{
+  WiFiClient client;
+  std::string first = testFrame(OPCODE_FRAME_BINARY, testPayload(100, 1));
+  std::string second = testFrame(OPCODE_FRAME_BINARY, testPayload(10, 2));
+
+  testStart(WEBSOCKET_MODE_CLIENT);
+
+  client.connection->input = first.substr(0, 50);
+  webSocket_handle(client);
+  TEST_CHECK(g_testMessages.empty() && (webSocket_available() == 0));
+
+  client.connection->input += first.substr(50) + second;
+  webSocket_handle(client);
+  webSocket_handle(client);
+
+  TEST_CHECK(g_testMessages.size() == 2);
+  TEST_CHECK((g_testMessages.size() == 2)
+             && (g_testMessages[0].opcode == OPCODE_FRAME_BINARY)
+             && (g_testMessages[0].payload == testPayload(100, 1))
+             && (g_testMessages[1].opcode == OPCODE_FRAME_BINARY)
+             && (g_testMessages[1].payload == testPayload(10, 2)));
+  TEST_CHECK(webSocket_isStart());
+
+  webSocket_abort();
+}
+
+// every split point of a stream of frames, masked from a client and
+// unmasked from a server, up to the 16 bit length form
+static void testEverySplit(void)
+{
+  static const uint8_t mask[WEB_SOCKET_MASK_KEY_SIZE] = { 0x37, 0xFA, 0x21, 0x3D };
+  static const size_t lengths[] = { 0, 1, 125, 126, 300 };
+
+  for (int mode = WEBSOCKET_MODE_SERVER; mode <= WEBSOCKET_MODE_CLIENT; mode++)
+  {
+    std::string stream;
+
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+    {
+      stream += testFrame((i & 1) ? OPCODE_FRAME_BINARY : OPCODE_FRAME_TEXT,
+                          testPayload(lengths[i], (uint8_t) i),
+                          (mode == WEBSOCKET_MODE_SERVER) ? mask : NULL);
+    }
+
+    for (size_t split = 1; split < stream.size(); split++)
+    {
+      WiFiClient client;
+      bool is_match = true;
+
+      testStart((uint8_t) mode);
+      client.connection->input = stream.substr(0, split);
+
+      for (int i = 0; i < 8; i++)
+      {
+        webSocket_handle(client);
+      }
+
+      client.connection->input += stream.substr(split);
+
+      for (int i = 0; i < 8; i++)
+      {
+        webSocket_handle(client);
+      }
+
+      is_match = (g_testMessages.size() == 5);
+
+      for (size_t i = 0; is_match && (i < 5); i++)
+      {
+        is_match = (g_testMessages[i].payload == testPayload(lengths[i], (uint8_t) i))
+                   && (g_testMessages[i].opcode
+                       == ((i & 1) ? OPCODE_FRAME_BINARY : OPCODE_FRAME_TEXT));
+      }
+
+      TEST_CHECK(is_match);
+      webSocket_abort();
+    }
+  }
+}
+
+// the part over the receive buffer is skipped across reads
+static void testTruncated(void)
+{
+  WiFiClient client;
+  std::string payload = testPayload(WEB_SOCKET_RECIVE_PAYLOAD_SIZE + 500, 3);
+  std::string stream = testFrame(OPCODE_FRAME_BINARY, payload)
+                       + testFrame(OPCODE_FRAME_TEXT, "next");
+
+  testStart(WEBSOCKET_MODE_CLIENT);
+
+  for (size_t offset = 0; offset < stream.size(); offset += 97)
+  {
+    client.connection->input += stream.substr(offset, 97);
+    webSocket_handle(client);
+  }
+
+  webSocket_handle(client);
+
+  TEST_CHECK(g_testMessages.size() == 2);
+  TEST_CHECK((g_testMessages.size() == 2)
+             && (g_testMessages[0].payload
+                 == payload.substr(0, WEB_SOCKET_RECIVE_PAYLOAD_SIZE))
+             && (g_testMessages[1].payload == "next"));
+
+  webSocket_abort();
+}
+
+// a close is answered once its payload has arrived, not at its header
+static void testClose(void)
+{
+  WiFiClient client;
+  std::string close = testFrame(OPCODE_FRAME_CLOSE, "\x03\xe8" "bye");
+  std::vector<TEST_FRAME> frames;
+
+  testStart(WEBSOCKET_MODE_CLIENT);
+
+  client.connection->input = close.substr(0, 3);
+  webSocket_handle(client);
+  webSocket_handle(client);
+  TEST_CHECK(client.connection->output.empty() && webSocket_isStart());
+
+  client.connection->input += close.substr(3);
+
+  for (int i = 0; i < 4; i++)
+  {
+    webSocket_handle(client);
+  }
+
+  frames = testParse(client.connection->output);
+  TEST_CHECK(!frames.empty()
+             && (frames[0].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_CLOSE)));
+  TEST_CHECK(!webSocket_isStart());
+}
+
+// a fragmented ping, a 126 byte pong and a 64 bit length with the most
+// significant bit set are closed with 1002
+static void testInvalid(void)
+{
+  static const char *const headers[] = {
+    "\x09\x00", "\x8A\x7E\x00\x7E", "\x82\x7F\x80\x00\x00\x00\x00\x00\x00\x00"
+  };
+  static const size_t sizes[] = { 2, 4, 10 };
+
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+  {
+    WiFiClient client;
+    std::vector<TEST_FRAME> frames;
+
+    testStart(WEBSOCKET_MODE_CLIENT);
+    client.connection->input = std::string(headers[i], sizes[i]);
+
+    for (int n = 0; n < 4; n++)
+    {
+      webSocket_handle(client);
+    }
+
+    frames = testParse(client.connection->output);
+    TEST_CHECK(!frames.empty()
+               && (frames[0].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_CLOSE))
+               && (frames[0].payload == "\x03\xea"));
+    TEST_CHECK(g_testMessages.empty() && !webSocket_isStart());
+  }
+}
+
+int main(void)
+{
+  testSplit();
+  testEverySplit();
+  testTruncated();
+  testClose();
+  testInvalid();
+
+  return TEST_RESULT();
+}
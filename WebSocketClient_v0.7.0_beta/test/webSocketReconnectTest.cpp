@@ -0,0 +1,270 @@
+/*
+ * @file    webSocketReconnectTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for webSocketReconnect.h: the jittered backoff at its bounds,
+// then the manager over wsHTTPClient against the stub server: a lost link
+// retried after the backoff, failed attempts backed off further, the
+// address resolved once while connects succeed and the upgrade request
+// replayed byte for byte, other methods built each time.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketReconnect.h"
+#include "wsBasicHttpClient.h"
+
+#define TEST_JITTERS	10000
+
+static const char g_testUpgrade[] = "HTTP/1.1 101 Switching Protocols\r\n\r\n";
+
+static int g_testSetups = 0;
+
+static void testSetup(void)
+{
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  g_testSetups++;
+}
+
+static uint32_t testCeiling(uint32_t min, uint32_t max, uint8_t attempt)
+{
+  uint64_t ceiling = min;
+
+  for (uint8_t i = 0; (i < attempt) && (ceiling < max); i++)
+  {
+    ceiling <<= 1;
+  }
+
+  return (ceiling > max) ? max : (uint32_t) ceiling;
+}
+
+// every delay between half the ceiling and the ceiling, both reached
+static void testBackoff(void)
+{
+  static const uint32_t ranges[][2] = { { 50, 10000 }, { 1, 1 }, { 3, 1000 },
+                                        { 1, UINT32_MAX }, { 0x80000001u, UINT32_MAX } };
+  int failed = 0;
+
+  TEST_CHECK(webSocket_reconnectBackoff(50, 10000, 0, 0) == 25);
+  TEST_CHECK(webSocket_reconnectBackoff(50, 10000, 0, 25) == 50);
+  TEST_CHECK(webSocket_reconnectBackoff(50, 10000, 0, 26) == 25);
+  TEST_CHECK(webSocket_reconnectBackoff(50, 10000, 1, 50) == 100);
+  TEST_CHECK(webSocket_reconnectBackoff(50, 10000, 8, 0) == 5000);
+  TEST_CHECK(webSocket_reconnectBackoff(50, 10000, UINT8_MAX, 5000) == 10000);
+  TEST_CHECK(webSocket_reconnectBackoff(1, UINT32_MAX, UINT8_MAX, UINT32_MAX)
+             == UINT32_MAX / 2 + (UINT32_MAX % (UINT32_MAX / 2 + 1)));
+
+  for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++)
+  {
+    for (uint16_t attempt = 0; attempt <= UINT8_MAX; attempt++)
+    {
+      uint32_t ceiling = testCeiling(ranges[r][0], ranges[r][1], attempt);
+      uint32_t low = webSocket_reconnectBackoff(ranges[r][0], ranges[r][1], attempt, 0);
+      uint32_t high = webSocket_reconnectBackoff(ranges[r][0], ranges[r][1], attempt,
+                                                 ceiling / 2);
+
+      failed += (low != ceiling / 2) || (high != ceiling / 2 + ceiling / 2);
+
+      for (int i = 0; i < 100; i++)
+      {
+        uint32_t delay = webSocket_reconnectBackoff(ranges[r][0], ranges[r][1],
+                                                    attempt, (uint32_t) rand());
+
+        failed += (delay < low) || (delay > high);
+      }
+    }
+  }
+
+  TEST_CHECK(failed == 0);
+}
+
+// the jitter spreads the delays over the upper half of the ceiling
+static void testJitter(void)
+{
+  uint32_t ceiling = WEB_SOCKET_RECONNECT_MAX;
+  uint32_t bins[4] = { 0 };
+  uint64_t sum = 0;
+
+  for (int i = 0; i < TEST_JITTERS; i++)
+  {
+    uint32_t delay = webSocket_reconnectBackoff(WEB_SOCKET_RECONNECT_MIN,
+                                                WEB_SOCKET_RECONNECT_MAX, 10,
+                                                (uint32_t) rand());
+
+    sum += delay;
+    bins[(delay - ceiling / 2) * 4 / (ceiling / 2 + 1)]++;
+  }
+
+  TEST_CHECK((sum / TEST_JITTERS > ceiling * 70 / 100)
+             && (sum / TEST_JITTERS < ceiling * 80 / 100));
+
+  for (int i = 0; i < 4; i++)
+  {
+    TEST_CHECK((bins[i] > TEST_JITTERS / 5) && (bins[i] < TEST_JITTERS * 3 / 10));
+  }
+}
+
+static std::string testOutput(wsHTTPClient *http)
+{
+  return http->getStreamPtr()->connection->output;
+}
+
+// runs the manager until it opens a session or gives up, the clock moved to
+// each attempt; returns the attempts made
+static int testUntilOpen(int limit)
+{
+  int attempts = 0;
+
+  while (attempts < limit)
+  {
+    uint32_t connects = g_testServer.connects;
+
+    if (webSocket_reconnectHandle())
+    {
+      return attempts + 1;
+    }
+
+    attempts += (g_testServer.connects != connects);
+    g_testMillis += webSocket_reconnectGetDelay();
+  }
+
+  return attempts;
+}
+
+static void testReconnect(void)
+{
+  wsHTTPClient http;
+  std::string request;
+  uint32_t lookups = WiFi.lookups;
+  uint32_t connects = 0;
+  uint32_t delay = 0;
+  int failed = 0;
+
+  g_testServer.refuse = false;
+  g_testServer.reply = g_testUpgrade;
+  http.begin("ws://example.local/chat");
+  http.setReuse(true);
+  http.setUpgrade(true);
+  http.addHeader("Upgrade", "websocket");
+  http.addHeader("Sec-WebSocket-Key", "dGhlIHNhbXBsZSBub25jZQ==");
+
+  TEST_CHECK(!webSocket_reconnectHandle());  // not begun
+  webSocket_reconnectBegin(&http, testSetup);
+  webSocket_reconnectSetBackoff(WEB_SOCKET_RECONNECT_MIN, WEB_SOCKET_RECONNECT_MAX);
+
+  TEST_CHECK(webSocket_reconnectHandle() && webSocket_isStart());
+  TEST_CHECK((g_testSetups == 1) && (WiFi.lookups == lookups + 1));
+  request = testOutput(&http);
+  TEST_CHECK(request.compare(0, 20, "GET /chat HTTP/1.1\r\n") == 0);
+  TEST_CHECK(webSocket_reconnectHandle());
+
+  // the link drops: the first retry waits a jittered MIN
+  connects = g_testServer.connects;
+  http.getStreamPtr()->stop();
+  TEST_CHECK(!webSocket_reconnectHandle() && !webSocket_isStart());
+  delay = webSocket_reconnectGetDelay();
+  TEST_CHECK((delay >= WEB_SOCKET_RECONNECT_MIN / 2) && (delay <= WEB_SOCKET_RECONNECT_MIN));
+  TEST_CHECK(webSocket_reconnectGetAttempt() == 1);
+
+  g_testMillis += delay - 1;
+  TEST_CHECK(!webSocket_reconnectHandle() && (g_testServer.connects == connects));
+  g_testMillis += 1;
+  TEST_CHECK(webSocket_reconnectHandle() && webSocket_isStart());
+  TEST_CHECK((g_testSetups == 2) && (g_testServer.connects == connects + 1));
+  TEST_CHECK((webSocket_reconnectGetAttempt() == 0) && (webSocket_reconnectGetDelay() == 0));
+
+  // the address is kept, the request header replayed unchanged
+  TEST_CHECK(WiFi.lookups == lookups + 1);
+  TEST_CHECK(testOutput(&http) == request);
+
+  // refused connects back off further and resolve again each time
+  http.getStreamPtr()->stop();
+  g_testServer.refuse = true;
+  webSocket_reconnectHandle();
+  lookups = WiFi.lookups;
+
+  for (uint8_t attempt = 1; attempt < 12; attempt++)
+  {
+    uint32_t ceiling = testCeiling(WEB_SOCKET_RECONNECT_MIN, WEB_SOCKET_RECONNECT_MAX,
+                                   attempt);
+
+    g_testMillis += webSocket_reconnectGetDelay();
+    failed += webSocket_reconnectHandle();
+    delay = webSocket_reconnectGetDelay();
+    failed += (delay < ceiling / 2) || (delay > ceiling);
+    failed += (webSocket_reconnectGetAttempt() != attempt + 1);
+  }
+
+  TEST_CHECK(failed == 0);
+  TEST_CHECK(WiFi.lookups == lookups + 10);  // the first still had the address
+
+  g_testServer.refuse = false;
+  TEST_CHECK(testUntilOpen(2) == 1);
+  TEST_CHECK((webSocket_reconnectGetAttempt() == 0) && (testOutput(&http) == request));
+
+  webSocket_abort();
+  http.disconnect();
+  g_testServer.reply.clear();
+}
+
+// only the upgrade GET is cached; other methods and a reset build anew
+static void testReplay(void)
+{
+  wsHTTPClient http;
+  std::string get;
+
+  g_testServer.refuse = false;
+  g_testServer.reply = g_testUpgrade;
+  http.begin("ws://example.local/chat");
+  http.addHeader("X-Test", "1");
+
+  TEST_CHECK(http.sendRequest("POST") == HTTP_CODE_SWITCHING_PROTOCOLS);
+  TEST_CHECK(testOutput(&http).compare(0, 21, "POST /chat HTTP/1.1\r\n") == 0);
+  http.disconnect();
+
+  TEST_CHECK(http.GET() == HTTP_CODE_SWITCHING_PROTOCOLS);
+  get = testOutput(&http);
+  TEST_CHECK((get.compare(0, 20, "GET /chat HTTP/1.1\r\n") == 0)
+             && (get.find("X-Test: 1\r\n") != std::string::npos));
+  http.disconnect();
+
+  // a POST after the GET is not the cached GET
+  http.addHeader("X-Post", "2");
+  TEST_CHECK(http.sendRequest("POST") == HTTP_CODE_SWITCHING_PROTOCOLS);
+  TEST_CHECK((testOutput(&http).compare(0, 21, "POST /chat HTTP/1.1\r\n") == 0)
+             && (testOutput(&http).find("X-Post: 2\r\n") != std::string::npos));
+  http.disconnect();
+
+  // the GET is replayed without the header added since
+  TEST_CHECK(http.GET() == HTTP_CODE_SWITCHING_PROTOCOLS);
+  TEST_CHECK(testOutput(&http) == get);
+  http.disconnect();
+
+  http.resetCache();
+  TEST_CHECK(http.GET() == HTTP_CODE_SWITCHING_PROTOCOLS);
+  TEST_CHECK((testOutput(&http).compare(0, 20, "GET /chat HTTP/1.1\r\n") == 0)
+             && (testOutput(&http).find("X-Post: 2\r\n") != std::string::npos));
+  http.disconnect();
+
+  g_testServer.reply.clear();
+}
+
+int main(void)
+{
+  srand(1);
+  testBackoff();
+  testJitter();
+  testReconnect();
+  testReplay();
+
+  return TEST_RESULT();
+}
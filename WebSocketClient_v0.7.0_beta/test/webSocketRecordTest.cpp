@@ -0,0 +1,245 @@
+/*
+ * @file    webSocketRecordTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the recorder of webSocketRecord.h and the replay client of
+// webSocketReplay.h: a session recorded to a file and to the RAM ring
+// replays to the same messages, fast and at the recorded times, and the
+// ring drops whole records, oldest first.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketRecord.h"
+#include "webSocketReplay.h"
+
+#define TEST_MESSAGES	100u
+
+typedef struct _TEST_MESSAGE
+{
+  uint32_t time;//msec
+  std::string payload;
+} TEST_MESSAGE;
+
+static std::vector<TEST_MESSAGE> g_testMessages;
+
+static void testReceive(void)
+{
+  TEST_MESSAGE message = { (uint32_t) millis(),
+                           std::string(webSocket_getPayload(), webSocket_available()) };
+
+  g_testMessages.push_back(message);
+}
+
+static void testStart(void)
+{
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_setHandler(WEBSOCKET_HANDLER_RECIVE, testReceive);
+  webSocket_start();
+  g_testMessages.clear();
+}
+
+// an unmasked frame from the server
+static std::string testFrame(uint8_t opcode, const std::string &payload)
+{
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t length = webSocket_frameEncodeHeader(header, true, 0, opcode, NULL,
+                                               payload.size());
+
+  return std::string((const char *) header, length) + payload;
+}
+
+// frames of varied size, every tenth answered by the client, 3 or 4 msec
+// apart
+static std::vector<TEST_MESSAGE> testSession(uint32_t count)
+{
+  WiFiClient client;
+  std::vector<TEST_MESSAGE> sent;
+
+  testStart();
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    TEST_MESSAGE message = { (uint32_t) g_testMillis,
+                             std::string(1 + (i * 37) % 200, (char)('a' + i % 26)) };
+
+    client.connection->input += testFrame(OPCODE_FRAME_TEXT, message.payload);
+    webSocket_handle(client);
+
+    if ((i % 10) == 0)
+    {
+      webSocket_setData(message.payload.data(), message.payload.size(),
+                        OPCODE_FRAME_TEXT);
+      webSocket_handle(client);
+    }
+
+    sent.push_back(message);
+    g_testMillis += 3 + (i & 1);
+  }
+
+  webSocket_abort();
+  TEST_CHECK(g_testMessages.size() == count);
+
+  return sent;
+}
+
+static void testReplay(const std::string &trace, bool paced,
+                       const std::vector<TEST_MESSAGE> &sent)
+{
+  webSocketReplayClient replay;
+  uint32_t start = 0;
+
+  testStart();
+  replay.begin((const uint8_t *) trace.data(), trace.size(), paced);
+  start = g_testMillis;
+
+  while (!replay.isDone())
+  {
+    webSocket_handle(replay);
+    g_testMillis += paced;
+  }
+
+  webSocket_abort();
+
+  TEST_CHECK(g_testMessages.size() == sent.size());
+  TEST_CHECK(replay.getWritten() == 0);  // no sends before the end of the trace
+
+  for (size_t i = 0; (i < g_testMessages.size()) && (i < sent.size()); i++)
+  {
+    TEST_CHECK(g_testMessages[i].payload == sent[i].payload);
+
+    // paced: each frame is due at its recorded time, not a msec earlier
+    if (paced)
+    {
+      TEST_CHECK(g_testMessages[i].time - start == sent[i].time - sent[0].time);
+    }
+    else
+    {
+      TEST_CHECK(g_testMessages[i].time == start);
+    }
+  }
+}
+
+static void testFile(void)
+{
+  std::vector<TEST_MESSAGE> sent;
+  std::string trace;
+  char buffer[4096];
+  size_t length = 0;
+  FILE *file = NULL;
+
+  g_testMillis = 10000;
+  TEST_CHECK(webSocket_recordOpen(TEST_RECORD_FILE));
+  webSocket_recordStart();
+  sent = testSession(TEST_MESSAGES);
+  webSocket_recordStop();
+  webSocket_recordClose();
+
+  file = fopen(TEST_RECORD_FILE, "rb");
+  TEST_CHECK(file != NULL);
+
+  while ((file != NULL) && ((length = fread(buffer, 1, sizeof(buffer), file)) > 0))
+  {
+    trace.append(buffer, length);
+  }
+
+  if (file != NULL)
+  {
+    fclose(file);
+  }
+
+  TEST_CHECK(trace.compare(0, WEB_SOCKET_RECORD_MAGIC_SIZE, WEB_SOCKET_RECORD_MAGIC) == 0);
+
+  testReplay(trace, false, sent);
+  testReplay(trace, true, sent);
+  printf("file: %u messages, %u byte trace over %u msec\n", (unsigned) sent.size(),
+         (unsigned) trace.size(), (unsigned)(sent.back().time - sent.front().time));
+}
+
+// records of 16 to 115 bytes through a ring of WEB_SOCKET_RECORD_SIZE
+static void testRing(void)
+{
+  uint8_t trace[WEB_SOCKET_RECORD_SIZE];
+  uint8_t payload[100];
+  WEB_SOCKET_RECORD_INFO info;
+  uint32_t dropped = webSocket_recordGetDropped();
+  uint32_t first = 0;
+  uint32_t count = 0;
+  uint16_t length = 0;
+  size_t offset = 0;
+
+  g_testMillis = 50000;
+  webSocket_recordStart();
+
+  for (uint32_t i = 0; i < 200; i++)
+  {
+    memset(payload, (uint8_t) i, sizeof(payload));
+    webSocket_recordPut(WEBSOCKET_RECORD_TX, payload, 13 + i % 100);
+  }
+
+  memset(payload, 0, sizeof(payload));
+  webSocket_recordPut(WEBSOCKET_RECORD_TX, trace, sizeof(trace));  // never fits
+  webSocket_recordStop();
+  webSocket_recordPut(WEBSOCKET_RECORD_TX, payload, 1);  // not recording
+
+  // a record larger than the buffer stays in the ring
+  TEST_CHECK(webSocket_recordRead(trace, 10) == 0);
+  length = webSocket_recordRead(trace, sizeof(trace));
+  TEST_CHECK((length > WEB_SOCKET_RECORD_SIZE - 116) && (webSocket_recordRead(trace, 1) == 0));
+
+  // whole records, consecutive up to the last one put
+  while ((offset < length) && webSocket_recordParse(&trace[offset], length - offset, &info))
+  {
+    if (count == 0)
+    {
+      first = trace[offset + info.header_length];
+    }
+
+    TEST_CHECK(info.length == 13 + (first + count) % 100);
+    TEST_CHECK(trace[offset + info.header_length] == (uint8_t)(first + count));
+    offset += info.header_length + info.length;
+    count++;
+  }
+
+  TEST_CHECK((offset == length) && (first + count == 200));
+  TEST_CHECK(webSocket_recordGetDropped() == dropped + first + 1);
+}
+
+// a session that fits the ring replays like the file
+static void testRingReplay(void)
+{
+  uint8_t trace[WEB_SOCKET_RECORD_SIZE];
+  std::vector<TEST_MESSAGE> sent;
+  uint32_t dropped = webSocket_recordGetDropped();
+  uint16_t length = 0;
+
+  g_testMillis = 90000;
+  webSocket_recordStart();
+  sent = testSession(10);
+  webSocket_recordStop();
+
+  length = webSocket_recordRead(trace, sizeof(trace));
+  TEST_CHECK(webSocket_recordGetDropped() == dropped);
+
+  testReplay(std::string((const char *) trace, length), false, sent);
+  testReplay(std::string((const char *) trace, length), true, sent);
+  printf("ring: %u messages in %u bytes\n", (unsigned) sent.size(), (unsigned) length);
+}
+
+int main(void)
+{
+  testFile();
+  testRing();
+  testRingReplay();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,224 @@
+/*
+ * @file    webSocketSchedTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the outbound scheduler of webSocketSched.h on the stub
+// clock: send order, expiry, eviction when the slots are full, then a slow
+// link flooded with short lived telemetry and a few commands.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketSched.h"
+
+static WiFiClient g_testClient;
+static size_t g_testOffset = 0;
+
+static void testOpen(void)
+{
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_start();
+  g_testClient = WiFiClient();
+  g_testOffset = 0;
+}
+
+static bool testQueue(const std::string &payload, uint8_t priority, uint32_t ttl)
+{
+  return webSocket_schedSend(payload.data(), payload.size(), OPCODE_FRAME_TEXT,
+                             priority, ttl);
+}
+
+// data payloads written since the last call, a keepalive ping is answered
+// as a server would
+static std::vector<std::string> testSent(void)
+{
+  std::vector<std::string> sent;
+  const std::string &output = g_testClient.connection->output;
+  std::vector<TEST_FRAME> frames = testParse(output.substr(g_testOffset));
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t header_length = 0;
+
+  g_testOffset = output.size();
+
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    if ((frames[i].head & WEB_SOCKET_FRAME_OPCODE) == OPCODE_FRAME_PING)
+    {
+      header_length = webSocket_frameEncodeHeader(header, true, 0, OPCODE_FRAME_PONG,
+                                                  NULL, frames[i].payload.size());
+      g_testClient.connection->input += std::string((const char *) header,
+                                                    header_length)
+                                        + frames[i].payload;
+    }
+
+    if (!(frames[i].head & WEB_SOCKET_FRAME_CONTROL))
+    {
+      sent.push_back(frames[i].payload);
+    }
+  }
+
+  return sent;
+}
+
+static std::vector<std::string> testDrain(void)
+{
+  while (webSocket_schedGetCount())
+  {
+    webSocket_handle(g_testClient);
+  }
+
+  webSocket_handle(g_testClient);
+
+  return testSent();
+}
+
+static void testOrder(void)
+{
+  std::vector<std::string> sent;
+  static const char *const expected[] = { "p9", "p5a", "p5b", "p1a", "p1b" };
+
+  g_testMillis = 0xFFFFFF00u;  // order holds across the millis() wrap
+  testOpen();
+
+  TEST_CHECK(testQueue("p1a", 1, WEB_SOCKET_SCHED_NO_EXPIRY));
+  g_testMillis += 100;
+  TEST_CHECK(testQueue("p5a", 5, WEB_SOCKET_SCHED_NO_EXPIRY));
+  g_testMillis += 100;
+  TEST_CHECK(testQueue("p1b", 1, WEB_SOCKET_SCHED_NO_EXPIRY));
+  TEST_CHECK(testQueue("p9", 9, WEB_SOCKET_SCHED_NO_EXPIRY));
+  g_testMillis += 100;
+  TEST_CHECK(testQueue("p5b", 5, WEB_SOCKET_SCHED_NO_EXPIRY));
+  TEST_CHECK(!testQueue(std::string(WEB_SOCKET_SCHED_RECORD_SIZE + 1, 'x'), 9, 0));
+
+  sent = testDrain();
+  TEST_CHECK(sent.size() == 5);
+
+  for (size_t i = 0; (i < sent.size()) && (i < 5); i++)
+  {
+    TEST_CHECK(sent[i] == expected[i]);
+  }
+
+  webSocket_abort();
+}
+
+static void testExpiry(void)
+{
+  uint32_t dropped = webSocket_schedGetDropped();
+
+  g_testMillis = 1000;
+  testOpen();
+
+  TEST_CHECK(testQueue("short", 9, 100));
+  TEST_CHECK(testQueue("long", 1, 101));
+  g_testMillis += 100;
+
+  // "short" is gone at exactly its time to live
+  TEST_CHECK(testDrain() == std::vector<std::string> { "long" });
+  TEST_CHECK(webSocket_schedGetDropped() == dropped + 1);
+
+  webSocket_abort();
+}
+
+// all slots taken: the oldest of the lowest priority goes, unless it ranks
+// above the new message, which is then refused
+static void testFull(void)
+{
+  uint32_t dropped = webSocket_schedGetDropped();
+  std::vector<std::string> sent;
+
+  g_testMillis = 5000;
+  testOpen();
+
+  for (uint8_t i = 0; i < WEB_SOCKET_SCHED_SLOTS; i++, g_testMillis++)
+  {
+    TEST_CHECK(testQueue("s" + std::to_string(i), (i < 2) ? 1 : 3,
+                         WEB_SOCKET_SCHED_NO_EXPIRY));
+  }
+
+  TEST_CHECK(testQueue("new2", 2, WEB_SOCKET_SCHED_NO_EXPIRY));  // replaces s0
+  TEST_CHECK(testQueue("new1", 1, WEB_SOCKET_SCHED_NO_EXPIRY));  // replaces s1
+  TEST_CHECK(!testQueue("new0", 0, WEB_SOCKET_SCHED_NO_EXPIRY));  // below new1
+  TEST_CHECK(webSocket_schedGetCount() == WEB_SOCKET_SCHED_SLOTS);
+  TEST_CHECK(webSocket_schedGetDropped() == dropped + 3);
+
+  sent = testDrain();
+  TEST_CHECK(sent.size() == WEB_SOCKET_SCHED_SLOTS);
+  TEST_CHECK((sent.size() == WEB_SOCKET_SCHED_SLOTS) && (sent[0] == "s2")
+             && (sent[WEB_SOCKET_SCHED_SLOTS - 2] == "new2")
+             && (sent[WEB_SOCKET_SCHED_SLOTS - 1] == "new1"));
+
+  webSocket_abort();
+}
+
+// A link that takes one message per 50 ms, telemetry every 10 ms with a
+// 100 ms time to live and a command (priority 5, no expiry) every 200 ms.
+static void testFlood(void)
+{
+  uint32_t dropped = webSocket_schedGetDropped();
+  uint32_t commands = 0;
+  uint32_t telemetry = 0;
+  uint32_t age_max = 0;
+
+  g_testMillis = 100000;
+  testOpen();
+
+  for (uint32_t tick = 0; tick < 10000; tick += 10, g_testMillis += 10)
+  {
+    if ((tick % 200) == 0)
+    {
+      TEST_CHECK(testQueue("c" + std::to_string(g_testMillis), 5,
+                           WEB_SOCKET_SCHED_NO_EXPIRY));
+    }
+
+    testQueue("t" + std::to_string(g_testMillis), 1, 100);
+
+    if ((tick % 50) == 40)
+    {
+      webSocket_handle(g_testClient);
+
+      std::vector<std::string> sent = testSent();
+
+      for (size_t i = 0; i < sent.size(); i++)
+      {
+        uint32_t age = g_testMillis - (uint32_t) strtoul(sent[i].c_str() + 1, NULL, 10);
+
+        if (sent[i][0] == 'c')
+        {
+          commands++;
+        }
+        else
+        {
+          telemetry++;
+          age_max = (age > age_max) ? age : age_max;
+        }
+      }
+    }
+  }
+
+  TEST_CHECK(commands == 50);
+  TEST_CHECK(age_max < 100);
+  printf("flood: %u commands, %u telemetry sent, %u dropped, oldest %u ms\n",
+         (unsigned) commands, (unsigned) telemetry,
+         (unsigned)(webSocket_schedGetDropped() - dropped), (unsigned) age_max);
+
+  webSocket_abort();
+}
+
+int main(void)
+{
+  testOrder();
+  testExpiry();
+  testFull();
+  testFlood();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,392 @@
+/*
+ * @file    webSocketServerTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the device side server of webSocketServer.h: the upgrade
+// request parser and Sec-WebSocket-Accept against RFC 6455, then clients
+// of the stub WiFiServer through handshake, messages, ping, broadcast and
+// close, and fragmented messages put together.
+
+#include <stdio.h>
+#include <string.h>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketServer.h"
+#include <WiFiServer.h>
+
+typedef struct _TEST_EVENT
+{
+  uint8_t client;
+  uint8_t event;
+  std::string payload;
+} TEST_EVENT;
+
+static std::vector<TEST_EVENT> g_testEvents;
+
+static void testHandler(uint8_t client, uint8_t event, const char *payload,
+                        uint16_t length)
+{
+  TEST_EVENT record = { client, event,
+                        (payload != NULL) ? std::string(payload, length) : "" };
+
+  g_testEvents.push_back(record);
+}
+
+static int8_t testParseRequest(const char *const *lines)
+{
+  WEB_SOCKET_SERVER_REQUEST request;
+  int8_t result = 0;
+
+  memset(&request, 0, sizeof(request));
+
+  for (size_t i = 0; (result == 0) && (lines[i] != NULL); i++)
+  {
+    result = webSocket_serverParseLine(&request, lines[i], strlen(lines[i]));
+  }
+
+  return result;
+}
+
+static void testParseLine(void)
+{
+  static const char *const valid[] = {
+    "GET /chat HTTP/1.1", "Host: server.example.com", "upgrade:websocket",
+    "CONNECTION: Upgrade", "Sec-WebSocket-Key: \tdGhlIHNhbXBsZSBub25jZQ==  ",
+    "Origin: http://example.com", "Sec-WebSocket-Version: 13", "", NULL
+  };
+  static const char *const post[] = {
+    "POST /chat HTTP/1.1", NULL
+  };
+  static const char *const no_key[] = {
+    "GET / HTTP/1.1", "Upgrade: websocket", "Sec-WebSocket-Version: 13", "", NULL
+  };
+  static const char *const short_key[] = {
+    "GET / HTTP/1.1", "Upgrade: websocket", "Sec-WebSocket-Key: dGhlIHNhbXBsZQ==",
+    "Sec-WebSocket-Version: 13", "", NULL
+  };
+  static const char *const version[] = {
+    "GET / HTTP/1.1", "Upgrade: websocket", "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==",
+    "Sec-WebSocket-Version: 8", "", NULL
+  };
+  static const char *const no_upgrade[] = {
+    "GET / HTTP/1.1", "Upgrade: h2c", "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==",
+    "Sec-WebSocket-Version: 13", "", NULL
+  };
+  static const char *const unfinished[] = {
+    "GET / HTTP/1.1", "Upgrade: websocket", NULL
+  };
+
+  TEST_CHECK(testParseRequest(valid) == 1);
+  TEST_CHECK(testParseRequest(post) == -1);
+  TEST_CHECK(testParseRequest(no_key) == -1);
+  TEST_CHECK(testParseRequest(short_key) == -1);
+  TEST_CHECK(testParseRequest(version) == -1);
+  TEST_CHECK(testParseRequest(no_upgrade) == -1);
+  TEST_CHECK(testParseRequest(unfinished) == 0);
+}
+
+static void testAccept(void)
+{
+  static const char *const base64[][2] = {
+    { "", "" }, { "f", "Zg==" }, { "fo", "Zm8=" }, { "foo", "Zm9v" },
+    { "foob", "Zm9vYg==" }, { "fooba", "Zm9vYmE=" }, { "foobar", "Zm9vYmFy" }
+  };
+  char accept[WEB_SOCKET_SERVER_ACCEPT_SIZE + 1];
+  char dist[16];
+
+  // RFC 4648 10
+  for (size_t i = 0; i < sizeof(base64) / sizeof(base64[0]); i++)
+  {
+    memset(dist, 0, sizeof(dist));
+    webSocket_serverBase64((const uint8_t *) base64[i][0], strlen(base64[i][0]), dist);
+    TEST_CHECK(strcmp(dist, base64[i][1]) == 0);
+  }
+
+  // RFC 6455 1.3
+  webSocket_serverAccept("dGhlIHNhbXBsZSBub25jZQ==", accept);
+  TEST_CHECK(strcmp(accept, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") == 0);
+}
+
+static std::string testRequest(void)
+{
+  return "GET /chat HTTP/1.1\r\n"
+         "Host: server.example.com\r\n"
+         "Upgrade: websocket\r\n"
+         "Connection: Upgrade\r\n"
+         "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+         "Sec-WebSocket-Version: 13\r\n"
+         "\r\n";
+}
+
+// a masked frame from a client
+static std::string testFrame(uint8_t opcode, const std::string &payload,
+                             bool fin = true)
+{
+  static const uint8_t mask[WEB_SOCKET_MASK_KEY_SIZE] = { 0x37, 0xFA, 0x21, 0x3D };
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t length = webSocket_frameEncodeHeader(header, fin, 0, opcode, mask,
+                                               payload.size());
+  std::string frame((const char *) header, length);
+
+  for (size_t i = 0; i < payload.size(); i++)
+  {
+    frame += (char)(payload[i] ^ mask[i & 3]);
+  }
+
+  return frame;
+}
+
+static void testSession(void)
+{
+  static const char switching[] =
+    "HTTP/1.1 101 Switching Protocols\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n\r\n";
+  // RFC 6455 5.7: a single-frame masked text message "Hello"
+  static const char hello[] = "\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58";
+  WiFiServer server(81);
+  WiFiClient first;
+  WiFiClient second;
+  std::vector<TEST_FRAME> frames;
+
+  g_testEvents.clear();
+  webSocket_serverBegin(&server, testHandler);
+
+  // the request arrives in two parts, the first frame right behind it
+  first.connection->input = testRequest().substr(0, 40);
+  server.pending.push_back(first);
+  webSocket_serverHandle();
+  TEST_CHECK(first.connection->output.empty() && (webSocket_serverGetCount() == 0));
+
+  first.connection->input += testRequest().substr(40) + hello;
+  webSocket_serverHandle();
+  TEST_CHECK(first.connection->output == switching);
+  TEST_CHECK(webSocket_serverGetCount() == 1);
+
+  webSocket_serverHandle();
+  TEST_CHECK(g_testEvents.size() == 2);
+  TEST_CHECK((g_testEvents[0].client == 0)
+             && (g_testEvents[0].event == WEBSOCKET_SERVER_OPEN));
+  TEST_CHECK((g_testEvents[1].event == WEBSOCKET_SERVER_TEXT)
+             && (g_testEvents[1].payload == "Hello"));
+
+  // a frame split over reads, then a ping
+  second.connection->input = testRequest();
+  server.pending.push_back(second);
+  webSocket_serverHandle();
+  TEST_CHECK(webSocket_serverGetCount() == 2);
+
+  std::string binary = testFrame(OPCODE_FRAME_BINARY, std::string(200, 'b'));
+
+  second.connection->output.clear();
+  second.connection->input += binary.substr(0, 1);
+  webSocket_serverHandle();
+  second.connection->input += binary.substr(1, 100);
+  webSocket_serverHandle();
+  second.connection->input += binary.substr(101) + testFrame(OPCODE_FRAME_PING, "t0");
+  webSocket_serverHandle();
+  webSocket_serverHandle();
+
+  TEST_CHECK((g_testEvents.back().client == 1)
+             && (g_testEvents.back().event == WEBSOCKET_SERVER_BINARY)
+             && (g_testEvents.back().payload == std::string(200, 'b')));
+
+  frames = testParse(second.connection->output);
+  TEST_CHECK((frames.size() == 1) && !frames[0].masked
+             && (frames[0].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_PONG))
+             && (frames[0].payload == "t0"));
+
+  // a broadcast is the same bytes for every client
+  first.connection->output.clear();
+  second.connection->output.clear();
+  TEST_CHECK(webSocket_serverBroadcast("{\"t\":1}", 7, OPCODE_FRAME_TEXT) == 2);
+  TEST_CHECK(first.connection->output == "\x81\x07{\"t\":1}");
+  TEST_CHECK(second.connection->output == first.connection->output);
+
+  // an unmasked frame closes with 1002, a close is echoed
+  first.connection->output.clear();
+  first.connection->input += std::string("\x81\x01x", 3);
+  second.connection->output.clear();
+  second.connection->input += testFrame(OPCODE_FRAME_CLOSE, "\x03\xe8" "bye");
+  webSocket_serverHandle();
+
+  TEST_CHECK(first.connection->output == "\x88\x02\x03\xea");
+  TEST_CHECK(second.connection->output == "\x88\x02\x03\xe8");
+  TEST_CHECK(!first.connected() && !second.connected());
+  TEST_CHECK(webSocket_serverGetCount() == 0);
+  TEST_CHECK(g_testEvents.back().event == WEBSOCKET_SERVER_CLOSE);
+}
+
+// a new open client on a fresh server
+static void testOpen(WiFiServer *server, WiFiClient *client)
+{
+  webSocket_serverBegin(server, testHandler);
+  *client = WiFiClient();
+  client->connection->input = testRequest();
+  server->pending.push_back(*client);
+  webSocket_serverHandle();
+  client->connection->output.clear();
+  g_testEvents.clear();
+}
+
+// a read takes what fits the receive buffer, a frame may need several
+static void testHandle(int calls)
+{
+  for (int i = 0; i < calls; i++)
+  {
+    webSocket_serverHandle();
+  }
+}
+
+// Fragments are put together in the receive buffer, with control frames
+// between them; messages that do not fit or break the order are closed.
+static void testFragments(void)
+{
+  WiFiServer server(81);
+  WiFiClient client;
+  std::vector<TEST_FRAME> frames;
+  std::string stream = testFrame(OPCODE_FRAME_TEXT, "Hel", false)
+                       + testFrame(OPCODE_FRAME_PING, "p")
+                       + testFrame(OPCODE_FRAME_CONTINUE, "", false)
+                       + testFrame(OPCODE_FRAME_CONTINUE, "lo ", false)
+                       + testFrame(OPCODE_FRAME_PONG, "")
+                       + testFrame(OPCODE_FRAME_CONTINUE, "world")
+                       + testFrame(OPCODE_FRAME_BINARY, "one");
+
+  // all at once, then a byte per handle
+  for (int bytewise = 0; bytewise < 2; bytewise++)
+  {
+    testOpen(&server, &client);
+
+    if (bytewise)
+    {
+      for (size_t i = 0; i < stream.size(); i++)
+      {
+        client.connection->input += stream[i];
+        webSocket_serverHandle();
+      }
+    }
+    else
+    {
+      client.connection->input += stream;
+      webSocket_serverHandle();
+    }
+
+    frames = testParse(client.connection->output);
+    TEST_CHECK((frames.size() == 1) && (frames[0].payload == "p")
+               && (frames[0].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_PONG)));
+    TEST_CHECK((g_testEvents.size() == 2)
+               && (g_testEvents[0].event == WEBSOCKET_SERVER_TEXT)
+               && (g_testEvents[0].payload == "Hello world")
+               && (g_testEvents[1].event == WEBSOCKET_SERVER_BINARY)
+               && (g_testEvents[1].payload == "one"));
+    TEST_CHECK(webSocket_serverGetCount() == 1);
+  }
+
+  // empty fragments make an empty message
+  client.connection->input += testFrame(OPCODE_FRAME_BINARY, "", false)
+                              + testFrame(OPCODE_FRAME_CONTINUE, "");
+  webSocket_serverHandle();
+  TEST_CHECK((g_testEvents.size() == 3)
+             && (g_testEvents[2].event == WEBSOCKET_SERVER_BINARY)
+             && g_testEvents[2].payload.empty());
+
+  // The largest message that fits: a frame with a 7 bit length takes 6
+  // bytes, the last fragment ends at the end of the buffer.
+  std::string part(WEB_SOCKET_SERVER_RECIVE_SIZE - 3 * 6, 'f');
+
+  client.connection->input += testFrame(OPCODE_FRAME_TEXT, part, false)
+                              + testFrame(OPCODE_FRAME_CONTINUE, "123456", false)
+                              + testFrame(OPCODE_FRAME_CONTINUE, "abcdef");
+  testHandle(4);
+  TEST_CHECK((g_testEvents.size() == 4)
+             && (g_testEvents[3].payload == part + "123456abcdef"));
+
+  // one byte more does not
+  client.connection->output.clear();
+  client.connection->input += testFrame(OPCODE_FRAME_TEXT, part, false)
+                              + testFrame(OPCODE_FRAME_CONTINUE, "123456", false)
+                              + testFrame(OPCODE_FRAME_CONTINUE, "abcdefg");
+  testHandle(4);
+  TEST_CHECK(client.connection->output == "\x88\x02\x03\xf1");
+  TEST_CHECK((webSocket_serverGetCount() == 0)
+             && (g_testEvents.back().event == WEBSOCKET_SERVER_CLOSE));
+
+  // fragments that leave no room for the 8 byte header of the next one
+  testOpen(&server, &client);
+  client.connection->input += testFrame(OPCODE_FRAME_TEXT, part, false)
+                             + testFrame(OPCODE_FRAME_CONTINUE, "123456abcdef", false)
+                             + testFrame(OPCODE_FRAME_CONTINUE, std::string(126, 'c'));
+  testHandle(4);
+  TEST_CHECK(client.connection->output == "\x88\x02\x03\xf1");
+  TEST_CHECK(webSocket_serverGetCount() == 0);
+
+  // a continuation of nothing, a new message inside a fragmented one
+  testOpen(&server, &client);
+  client.connection->input += testFrame(OPCODE_FRAME_CONTINUE, "x");
+  webSocket_serverHandle();
+  TEST_CHECK(client.connection->output == "\x88\x02\x03\xea");
+  TEST_CHECK(g_testEvents.size() == 1);
+
+  testOpen(&server, &client);
+  client.connection->input += testFrame(OPCODE_FRAME_TEXT, "a", false)
+                              + testFrame(OPCODE_FRAME_TEXT, "b");
+  webSocket_serverHandle();
+  TEST_CHECK(client.connection->output == "\x88\x02\x03\xea");
+  TEST_CHECK((g_testEvents.size() == 1)
+             && (g_testEvents[0].event == WEBSOCKET_SERVER_CLOSE));
+
+  // a new client starts without the message of the one before
+  testOpen(&server, &client);
+  client.connection->input += testFrame(OPCODE_FRAME_CONTINUE, "x");
+  webSocket_serverHandle();
+  TEST_CHECK(client.connection->output == "\x88\x02\x03\xea");
+
+  webSocket_serverBegin(NULL, NULL);
+}
+
+static void testRefuse(void)
+{
+  WiFiServer server(81);
+  std::vector<WiFiClient> clients(WEB_SOCKET_SERVER_CLIENTS + 1);
+  WiFiClient bad;
+
+  webSocket_serverBegin(&server, testHandler);
+
+  bad.connection->input = "GET / HTTP/1.1\r\nUpgrade: websocket\r\n\r\n";
+  server.pending.push_back(bad);
+  webSocket_serverHandle();
+  TEST_CHECK(bad.connection->output.compare(0, 24, "HTTP/1.1 400 Bad Request") == 0);
+  TEST_CHECK(!bad.connected());
+
+  for (size_t i = 0; i < clients.size(); i++)
+  {
+    clients[i].connection->input = testRequest();
+    server.pending.push_back(clients[i]);
+    webSocket_serverHandle();
+  }
+
+  TEST_CHECK(webSocket_serverGetCount() == WEB_SOCKET_SERVER_CLIENTS);
+  TEST_CHECK(clients.back().connection->output.compare(0, 12, "HTTP/1.1 503") == 0);
+  TEST_CHECK(!clients.back().connected());
+
+  webSocket_serverBegin(NULL, NULL);
+  TEST_CHECK(!clients.front().connected());
+}
+
+int main(void)
+{
+  testParseLine();
+  testAccept();
+  testSession();
+  testFragments();
+  testRefuse();
+
+  return TEST_RESULT();
+}
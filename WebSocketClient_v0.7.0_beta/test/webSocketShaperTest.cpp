@@ -0,0 +1,215 @@
+/*
+ * @file    webSocketShaperTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for the send shaper of webSocketShaper.h on the stub clock:
+// the sustained rate over 10 s, held frames allowed exactly at the
+// reported delay, oversize frames, control frames, runs of queued frames,
+// a frame held in the send buffer of webSocket_handle() and control frames
+// written while it is held.
+
+#include <stdio.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketShaper.h"
+
+// 100 byte payload, masked
+#define TEST_FRAME_LENGTH	(100u + 2u + WEB_SOCKET_MASK_KEY_SIZE)
+
+static void testRate(void)
+{
+  uint32_t sent = 0;
+
+  g_testMillis = 1000;
+  webSocket_shaperSetRate(OPCODE_FRAME_BINARY, 4000, 1024, 20, 4);
+
+  // polled every msec for 10 s; the frame budget binds first: the burst
+  // of 4, then one every 50 msec
+  for (uint32_t i = 0; i < 10000; i++, g_testMillis++)
+  {
+    sent += webSocket_shaperAllow(OPCODE_FRAME_BINARY, TEST_FRAME_LENGTH);
+  }
+
+  TEST_CHECK(sent == 4 + 9999 / 50);
+
+  // the text budget is unlimited, control frames are never held
+  TEST_CHECK(webSocket_shaperAllow(OPCODE_FRAME_TEXT, 60000));
+  TEST_CHECK(webSocket_shaperAllow(OPCODE_FRAME_PING, 125));
+  TEST_CHECK(webSocket_shaperGetDelay(OPCODE_FRAME_CLOSE, 125) == 0);
+  printf("rate: %u frames in 10 s at 4000 B/s and 20 frames/s (burst 4)\n",
+         (unsigned) sent);
+
+  // bytes limit: 1000 B/s
+  g_testMillis = 100000;
+  webSocket_shaperSetRate(OPCODE_FRAME_BINARY, 1000, 1024, 0, 0);
+  sent = 0;
+
+  for (uint32_t i = 0; i < 10000; i++, g_testMillis++)
+  {
+    sent += webSocket_shaperAllow(OPCODE_FRAME_BINARY, TEST_FRAME_LENGTH);
+  }
+
+  TEST_CHECK(sent == (1024 + 9999) / TEST_FRAME_LENGTH);  // burst and 9.999 s of rate
+}
+
+// a held frame passes at the reported delay, not a msec earlier
+static void testDelay(void)
+{
+  uint32_t deferred = 0;
+
+  g_testMillis = 200000;
+  webSocket_shaperSetRate(OPCODE_FRAME_BINARY, 3000, 512, 7, 2);
+
+  for (int i = 0; i < 100; i++)
+  {
+    uint32_t length = 50 + (i * 37) % 400;
+    uint32_t delay = webSocket_shaperGetDelay(OPCODE_FRAME_BINARY, length);
+
+    if (delay > 0)
+    {
+      g_testMillis += delay - 1;
+      deferred = webSocket_shaperGetDeferred();
+      TEST_CHECK(!webSocket_shaperAllow(OPCODE_FRAME_BINARY, length));
+      TEST_CHECK(webSocket_shaperGetDeferred() == deferred + 1);
+      g_testMillis++;
+    }
+
+    TEST_CHECK(webSocket_shaperAllow(OPCODE_FRAME_BINARY, length));
+  }
+
+  // larger than the burst: only on a full bucket
+  g_testMillis += 1000;
+  TEST_CHECK(webSocket_shaperAllow(OPCODE_FRAME_BINARY, 300));
+  TEST_CHECK(webSocket_shaperGetDelay(OPCODE_FRAME_BINARY, 4000) == 300 / 3);
+  g_testMillis += 99;
+  TEST_CHECK(!webSocket_shaperAllow(OPCODE_FRAME_BINARY, 4000));
+  g_testMillis++;
+  TEST_CHECK(webSocket_shaperAllow(OPCODE_FRAME_BINARY, 4000));
+}
+
+static void testFrames(void)
+{
+  std::string frames;
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint16_t count = 0;
+
+  for (int i = 0; i < 6; i++)
+  {
+    uint8_t opcode = (i == 2) ? OPCODE_FRAME_PING : OPCODE_FRAME_BINARY;
+    uint8_t length = webSocket_frameEncodeHeader(header, true, 0, opcode, NULL, 10);
+
+    frames.append((const char *) header, length);
+    frames.append(10, (char) i);
+  }
+
+  // three binary frames and the ping between them
+  g_testMillis = 300000;
+  webSocket_shaperSetRate(OPCODE_FRAME_BINARY, 0, 0, 1, 3);
+  TEST_CHECK(webSocket_shaperAllowFrames(frames.data(), frames.size(), &count)
+             == 4 * 12);
+  TEST_CHECK(count == 4);
+
+  // a torn frame is not counted
+  g_testMillis += 10000;
+  TEST_CHECK(webSocket_shaperAllowFrames(frames.data(), 12 + 5, &count) == 12);
+  TEST_CHECK(count == 1);
+}
+
+// the frame stays in the send buffer until webSocket_getSendDelay()
+static void testSession(void)
+{
+  WiFiClient client;
+  std::string payload(100, 's');
+  uint32_t delay = 0;
+
+  g_testMillis = 400000;
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_start();
+  webSocket_shaperSetRate(OPCODE_FRAME_TEXT, 0, 0, 2, 1);
+
+  webSocket_setData(payload.data(), payload.size(), OPCODE_FRAME_TEXT);
+  webSocket_handle(client);
+  TEST_CHECK(testParse(client.connection->output).size() == 1);
+
+  webSocket_setData(payload.data(), payload.size(), OPCODE_FRAME_TEXT);
+  webSocket_handle(client);
+  TEST_CHECK(webSocket_isSendBusy());
+  delay = webSocket_getSendDelay();
+  TEST_CHECK(delay == 500);
+
+  g_testMillis += delay - 1;
+  webSocket_handle(client);
+  TEST_CHECK(webSocket_isSendBusy());
+
+  g_testMillis++;
+  webSocket_handle(client);
+  TEST_CHECK(!webSocket_isSendBusy() && (webSocket_getSendDelay() == 0));
+  TEST_CHECK(testParse(client.connection->output).size() == 2);
+
+  webSocket_abort();
+}
+
+// a ping is answered and a close written while the shaper holds a data
+// frame, the held frame does not follow the close
+static void testControl(void)
+{
+  WiFiClient client;
+  std::string payload(100, 'c');
+  std::vector<TEST_FRAME> frames;
+
+  g_testMillis = 500000;
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_setHandler(WEBSOCKET_HANDLER_PING_RECIVE, webSocket_sendPong);
+  webSocket_start();
+  webSocket_shaperSetRate(OPCODE_FRAME_TEXT, 10, 110, 0, 0);
+
+  webSocket_setData(payload.data(), payload.size(), OPCODE_FRAME_TEXT);
+  webSocket_handle(client);
+  webSocket_setData(payload.data(), payload.size(), OPCODE_FRAME_TEXT);
+  webSocket_handle(client);
+  TEST_CHECK(webSocket_isSendBusy() && (webSocket_getSendDelay() > 10000));
+
+  client.connection->input = std::string("\x89\x02p1", 4);
+  webSocket_handle(client);
+  frames = testParse(client.connection->output);
+  TEST_CHECK((frames.size() == 2) && webSocket_isSendBusy());
+  TEST_CHECK((frames.size() == 2) && frames[1].masked
+             && (frames[1].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_PONG))
+             && (frames[1].payload == "p1"));
+
+  webSocket_sendPing();
+  webSocket_handle(client);
+  frames = testParse(client.connection->output);
+  TEST_CHECK((frames.size() == 3)
+             && (frames[2].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_PING)));
+
+  webSocket_sendClose();
+  webSocket_handle(client);
+  frames = testParse(client.connection->output);
+  TEST_CHECK((frames.size() == 4) && !webSocket_isSendBusy());
+  TEST_CHECK(frames.back().head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_CLOSE));
+
+  webSocket_abort();
+  webSocket_shaperSetRate(OPCODE_FRAME_TEXT, 0, 0, 0, 0);
+}
+
+int main(void)
+{
+  testRate();
+  testDelay();
+  testFrames();
+  testSession();
+  testControl();
+
+  return TEST_RESULT();
+}
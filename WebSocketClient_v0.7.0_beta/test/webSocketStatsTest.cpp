@@ -0,0 +1,228 @@
+/*
+ * @file    webSocketStatsTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for webSocketStats.h (WEBSOCKET_STATS): frames and bytes counted
+// both ways, reconnects around webSocket_resetStats(), the varint dump read
+// back counter by counter and sent as a binary frame.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketStats.h"
+
+#define TEST_COUNTERS	(sizeof(WEB_SOCKET_STATS) / sizeof(uint32_t))
+
+static WiFiClient g_testClient;
+
+static void testBegin(void)
+{
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_setHandler(WEBSOCKET_HANDLER_PING_RECIVE, webSocket_sendPong);
+  webSocket_start();
+  g_testClient.connection->input.clear();
+  g_testClient.connection->inputOffset = 0;
+  g_testClient.connection->output.clear();
+}
+
+// a frame from the server, unmasked
+static std::string testFrame(uint8_t opcode, const std::string &payload)
+{
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t length = webSocket_frameEncodeHeader(header, true, 0, opcode, NULL,
+                                               payload.size());
+
+  return std::string((const char *) header, length) + payload;
+}
+
+static uint32_t testCounter(const WEB_SOCKET_STATS *stats, uint16_t index)
+{
+  return ((const uint32_t *) stats)[index];
+}
+
+// the counters of a dump, false when it is not one
+static bool testReadDump(const std::string &dump, std::vector<uint32_t> *counters)
+{
+  size_t index = 3;
+
+  if ((dump.size() < 3) || ((uint8_t) dump[0] != WEB_SOCKET_BINARY_TAG)
+      || (dump[1] != WEBSOCKET_BINARY_STATS) || (dump[2] != WEB_SOCKET_STATS_VERSION))
+  {
+    return false;
+  }
+
+  counters->clear();
+
+  while (index < dump.size())
+  {
+    uint32_t value = 0;
+    uint8_t shift = 0;
+    uint8_t byte = 0;
+
+    do
+    {
+      if ((index >= dump.size()) || (shift > 28))
+      {
+        return false;
+      }
+
+      byte = (uint8_t) dump[index++];
+      value |= (uint32_t)(byte & 0x7F) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+
+    counters->push_back(value);
+  }
+
+  return true;
+}
+
+// the first open after a reset is not a reconnect, the ones after it are
+static void testReconnects(void)
+{
+  WEB_SOCKET_STATS stats;
+
+  webSocket_resetStats();
+  testBegin();
+  webSocket_abort();
+  testBegin();
+  webSocket_getStats(&stats);
+  TEST_CHECK(stats.reconnects == 1);
+
+  webSocket_resetStats();
+  webSocket_getStats(&stats);
+  TEST_CHECK(stats.reconnects == 0);
+
+  webSocket_abort();
+  testBegin();
+  webSocket_getStats(&stats);
+  TEST_CHECK(stats.reconnects == 0);
+
+  webSocket_abort();
+  testBegin();
+  webSocket_getStats(&stats);
+  TEST_CHECK(stats.reconnects == 1);
+
+  webSocket_abort();
+}
+
+static void testFrames(void)
+{
+  WEB_SOCKET_STATS stats;
+  std::string large(WEB_SOCKET_SEND_PAYLOAD_SIZE + 1, 'x');
+
+  testBegin();
+  webSocket_resetStats();
+
+  g_testClient.connection->input = testFrame(OPCODE_FRAME_TEXT, "hello")
+                                   + testFrame(OPCODE_FRAME_BINARY, std::string(200, 'b'))
+                                   + testFrame(OPCODE_FRAME_PING, "p");
+  webSocket_handle(g_testClient);
+  webSocket_handle(g_testClient);
+  webSocket_handle(g_testClient);
+  webSocket_handle(g_testClient);
+
+  webSocket_setData("abc", 3, OPCODE_FRAME_TEXT);
+  TEST_CHECK(!webSocket_setData("d", 1, OPCODE_FRAME_TEXT));
+  webSocket_handle(g_testClient);
+  TEST_CHECK(!webSocket_setData(large.data(), large.size(), OPCODE_FRAME_BINARY));
+
+  webSocket_getStats(&stats);
+  TEST_CHECK((stats.frames_in[WEBSOCKET_STATS_TEXT] == 1)
+             && (stats.bytes_in[WEBSOCKET_STATS_TEXT] == 5));
+  TEST_CHECK((stats.frames_in[WEBSOCKET_STATS_BINARY] == 1)
+             && (stats.bytes_in[WEBSOCKET_STATS_BINARY] == 200));
+  TEST_CHECK((stats.frames_in[WEBSOCKET_STATS_PING] == 1)
+             && (stats.bytes_in[WEBSOCKET_STATS_PING] == 1));
+  TEST_CHECK(stats.recive_peak == 200);
+
+  // the pong answer and the text frame, masked
+  TEST_CHECK((stats.frames_out[WEBSOCKET_STATS_PONG] == 1)
+             && (stats.bytes_out[WEBSOCKET_STATS_PONG] == 1));
+  TEST_CHECK((stats.frames_out[WEBSOCKET_STATS_TEXT] == 1)
+             && (stats.bytes_out[WEBSOCKET_STATS_TEXT] == 3));
+  TEST_CHECK(stats.send_peak == 2 + 4 + 3);
+  TEST_CHECK((stats.send_dropped == 1) && (stats.payload_oversize == 1));
+
+  webSocket_abort();
+}
+
+// The dump holds every counter in member order; a buffer too small for it
+// gets nothing.
+static void testDump(void)
+{
+  WEB_SOCKET_STATS stats;
+  std::vector<uint32_t> counters;
+  std::vector<TEST_FRAME> frames;
+  char dump[WEB_SOCKET_STATS_DUMP_SIZE];
+  uint16_t length = 0;
+  int failed = 0;
+
+  testBegin();
+  webSocket_resetStats();
+
+  // counters of one to five varint bytes
+  WEB_SOCKET_STATS_ADD(timeouts, 127);
+  WEB_SOCKET_STATS_ADD(retries, 128);
+  WEB_SOCKET_STATS_ADD(queue_spooled, 16384);
+  WEB_SOCKET_STATS_ADD(queue_dropped, UINT32_MAX);
+
+  webSocket_getStats(&stats);
+  length = webSocket_dumpStats(dump, sizeof(dump));
+  TEST_CHECK(testReadDump(std::string(dump, length), &counters));
+  TEST_CHECK(counters.size() == TEST_COUNTERS);
+
+  for (uint16_t i = 0; (i < counters.size()) && (i < TEST_COUNTERS); i++)
+  {
+    failed += (counters[i] != testCounter(&stats, i));
+  }
+
+  TEST_CHECK(failed == 0);
+  TEST_CHECK((length == 3 + TEST_COUNTERS + 1 + 2 + 4) && (length <= sizeof(dump)));
+
+  for (uint16_t size = 0; size < length; size++)
+  {
+    failed += (webSocket_dumpStats(dump, size) != 0);
+  }
+
+  TEST_CHECK(failed == 0);
+
+  // all at UINT32_MAX still fits the dump size
+  for (uint16_t i = 0; i < TEST_COUNTERS; i++)
+  {
+    webSocket_statsAdd(i * sizeof(uint32_t), UINT32_MAX - testCounter(&stats, i));
+  }
+
+  TEST_CHECK(webSocket_dumpStats(dump, sizeof(dump)) == 3 + 5 * TEST_COUNTERS);
+
+  // sent as one binary frame, refused while the send buffer is taken
+  length = webSocket_dumpStats(dump, sizeof(dump));
+  TEST_CHECK(webSocket_sendStats());
+  TEST_CHECK(!webSocket_sendStats());
+  webSocket_handle(g_testClient);
+  frames = testParse(g_testClient.connection->output);
+  TEST_CHECK((frames.size() == 1)
+             && (frames[0].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_BINARY))
+             && (frames[0].payload == std::string(dump, length)));
+
+  webSocket_resetStats();
+  webSocket_abort();
+}
+
+int main(void)
+{
+  testReconnects();
+  testFrames();
+  testDump();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,198 @@
+/*
+ * @file    webSocketTemplateTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for webSocketTemplate.h: creation limits, slots and patches,
+// sends with and without a mask across key changes, and the lock on a
+// template whose frame is still queued.
+
+#include <stdio.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketTemplate.h"
+
+static WiFiClient g_testClient;
+static int8_t g_testDelete = WEB_SOCKET_TEMPLATE_INVALID;
+static bool g_is_testDeleted = false;
+
+// deletes the template from the send handler, the frame is out by then
+static void testSent(void)
+{
+  if (g_testDelete != WEB_SOCKET_TEMPLATE_INVALID)
+  {
+    g_is_testDeleted = webSocket_templateDelete(g_testDelete);
+  }
+}
+
+static void testBegin(bool mask)
+{
+  webSocket_init();
+  webSocket_setMode(mask ? WEBSOCKET_MODE_CLIENT : WEBSOCKET_MODE_SERVER);
+  webSocket_setUseMask(mask);
+  webSocket_setHandler(WEBSOCKET_HANDLER_SEND, testSent);
+  webSocket_start();
+  g_testClient.connection->output.clear();
+}
+
+// the data frames written since the last call
+static std::vector<TEST_FRAME> testWritten(void)
+{
+  std::vector<TEST_FRAME> frames;
+  std::vector<TEST_FRAME> data;
+
+  webSocket_handle(g_testClient);
+  frames = testParse(g_testClient.connection->output);
+  g_testClient.connection->output.clear();
+
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    if (!(frames[i].head & WEB_SOCKET_FRAME_CONTROL))
+    {
+      data.push_back(frames[i]);
+    }
+  }
+
+  return data;
+}
+
+static void testCreate(void)
+{
+  char body[WEB_SOCKET_TEMPLATE_SIZE + 1];
+  int8_t id[WEB_SOCKET_TEMPLATE_MAX];
+  int8_t t = WEB_SOCKET_TEMPLATE_INVALID;
+
+  memset(body, 'x', sizeof(body));
+  TEST_CHECK(webSocket_templateCreate(OPCODE_FRAME_TEXT, body, sizeof(body))
+             == WEB_SOCKET_TEMPLATE_INVALID);
+
+  for (int8_t i = 0; i < WEB_SOCKET_TEMPLATE_MAX; i++)
+  {
+    id[i] = webSocket_templateCreate(OPCODE_FRAME_TEXT, body, WEB_SOCKET_TEMPLATE_SIZE);
+    TEST_CHECK(id[i] != WEB_SOCKET_TEMPLATE_INVALID);
+  }
+
+  TEST_CHECK(webSocket_templateCreate(OPCODE_FRAME_TEXT, body, 1)
+             == WEB_SOCKET_TEMPLATE_INVALID);
+  TEST_CHECK(webSocket_templateDelete(id[1]));
+  TEST_CHECK(!webSocket_templateDelete(id[1]));
+  TEST_CHECK(webSocket_templateCreate(OPCODE_FRAME_TEXT, body, 1) == id[1]);
+
+  for (int8_t i = 0; i < WEB_SOCKET_TEMPLATE_MAX; i++)
+  {
+    TEST_CHECK(webSocket_templateDelete(id[i]));
+  }
+
+  TEST_CHECK(!webSocket_templateDelete(WEB_SOCKET_TEMPLATE_INVALID));
+  TEST_CHECK(!webSocket_templateDelete(WEB_SOCKET_TEMPLATE_MAX));
+
+  // slots must lie inside the body
+  t = webSocket_templateCreate(OPCODE_FRAME_TEXT, "{\"a\":  0,\"b\":  0}", 17);
+  TEST_CHECK(webSocket_templateAddSlot(t, "a", 5, 3) == 0);
+  TEST_CHECK(webSocket_templateAddSlot(t, "b", 13, 3) == 1);
+  TEST_CHECK(webSocket_templateAddSlot(t, "c", 15, 3) == WEB_SOCKET_TEMPLATE_INVALID);
+  TEST_CHECK(webSocket_templateAddSlot(t, "d", 0, 0) == WEB_SOCKET_TEMPLATE_INVALID);
+  TEST_CHECK(webSocket_templateFindSlot(t, "b") == 1);
+  TEST_CHECK(webSocket_templateFindSlot(t, "c") == WEB_SOCKET_TEMPLATE_INVALID);
+  TEST_CHECK(webSocket_templateDelete(t));
+}
+
+static void testPatch(bool mask)
+{
+  static const char body[] = "{\"v\":      0,\"raw\":\"....\"}";
+  int8_t t = WEB_SOCKET_TEMPLATE_INVALID;
+  int8_t v = WEB_SOCKET_TEMPLATE_INVALID;
+  int8_t raw = WEB_SOCKET_TEMPLATE_INVALID;
+  std::vector<TEST_FRAME> frames;
+
+  testBegin(mask);
+  t = webSocket_templateCreate(OPCODE_FRAME_TEXT, body, sizeof(body) - 1);
+  v = webSocket_templateAddSlot(t, "v", 5, 7);
+  raw = webSocket_templateAddSlot(t, "raw", 20, 4);
+
+  TEST_CHECK(webSocket_templatePatchInt(t, v, -123456));
+  TEST_CHECK(webSocket_templatePatch(t, raw, "abcd", 4));
+  TEST_CHECK(!webSocket_templatePatch(t, raw, "abc", 3));
+  TEST_CHECK(webSocket_templateSend(t));
+  frames = testWritten();
+  TEST_CHECK((frames.size() == 1) && (frames[0].masked == mask)
+             && (frames[0].head == (WEB_SOCKET_FRAME_FIN | OPCODE_FRAME_TEXT))
+             && (frames[0].payload == "{\"v\":-123456,\"raw\":\"abcd\"}"));
+
+  // a new key re-masks the body once, the next send is still plain JSON
+  webSocket_setRefreshMask(0x5A, 0xC3, 0x01, 0xFF);
+  TEST_CHECK(webSocket_templatePatchInt(t, v, 42));
+  TEST_CHECK(!webSocket_templatePatchInt(t, v, 12345678));
+  TEST_CHECK(!webSocket_templatePatchInt(t, v, -1234567));
+  TEST_CHECK(webSocket_templatePatchBE(t, raw, 0x41424344));
+  TEST_CHECK(webSocket_templateSend(t));
+  frames = testWritten();
+  TEST_CHECK((frames.size() == 1)
+             && (frames[0].payload == "{\"v\":     42,\"raw\":\"ABCD\"}"));
+
+  webSocket_setRefreshMask(0x00, 0x11, 0x22, 0x33);
+  TEST_CHECK(webSocket_templatePatchInt(t, v, 0));
+  TEST_CHECK(webSocket_templateSend(t));
+  frames = testWritten();
+  TEST_CHECK((frames.size() == 1)
+             && (frames[0].payload == "{\"v\":      0,\"raw\":\"ABCD\"}"));
+
+  TEST_CHECK(webSocket_templateDelete(t));
+  webSocket_abort();
+}
+
+// While the frame is queued the engine writes it from the template: patches,
+// a second send and the delete are refused until it is out.
+static void testLock(void)
+{
+  int8_t t = WEB_SOCKET_TEMPLATE_INVALID;
+  int8_t other = WEB_SOCKET_TEMPLATE_INVALID;
+  int8_t v = WEB_SOCKET_TEMPLATE_INVALID;
+  std::vector<TEST_FRAME> frames;
+
+  testBegin(true);
+  t = webSocket_templateCreate(OPCODE_FRAME_TEXT, "{\"v\":  1}", 9);
+  other = webSocket_templateCreate(OPCODE_FRAME_TEXT, "{}", 2);
+  v = webSocket_templateAddSlot(t, "v", 5, 3);
+
+  TEST_CHECK(webSocket_templateSend(t));
+  TEST_CHECK(webSocket_isSendBusy());
+  TEST_CHECK(!webSocket_templatePatchInt(t, v, 2));
+  TEST_CHECK(!webSocket_templateDelete(t));
+  TEST_CHECK(!webSocket_templateSend(other));
+
+  // another template may still go
+  TEST_CHECK(webSocket_templateDelete(other));
+
+  frames = testWritten();
+  TEST_CHECK((frames.size() == 1) && (frames[0].payload == "{\"v\":  1}"));
+  TEST_CHECK(webSocket_templatePatchInt(t, v, 2));
+
+  // deleted from the send handler once the frame is written
+  g_testDelete = t;
+  g_is_testDeleted = false;
+  TEST_CHECK(webSocket_templateSend(t));
+  TEST_CHECK(!webSocket_templateDelete(t));
+  frames = testWritten();
+  TEST_CHECK((frames.size() == 1) && (frames[0].payload == "{\"v\":  2}"));
+  TEST_CHECK(g_is_testDeleted);
+  TEST_CHECK(!webSocket_templateSend(t));
+  g_testDelete = WEB_SOCKET_TEMPLATE_INVALID;
+
+  webSocket_abort();
+}
+
+int main(void)
+{
+  testCreate();
+  testPatch(false);
+  testPatch(true);
+  testLock();
+
+  return TEST_RESULT();
+}
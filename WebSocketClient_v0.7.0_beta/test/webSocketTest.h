@@ -0,0 +1,84 @@
+/*
+ * @file    webSocketTest.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_TEST_H_
+#define WEBSOCKET_TEST_H_
+
+// Minimal checks for the host tests in this folder. A failed check prints
+// its location and the test keeps going, main() returns TEST_RESULT().
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "webSocketFrame.h"
+
+static int g_testFailed = 0;
+static int g_testPassed = 0;
+
+#define TEST_CHECK(condition) \
+  do \
+  { \
+    if (condition) \
+    { \
+      g_testPassed++; \
+    } \
+    else \
+    { \
+      g_testFailed++; \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+    } \
+  } while (0)
+
+#define TEST_RESULT() \
+  (printf("%s: %d checks, %d failed\n", __FILE__, g_testPassed + g_testFailed, \
+          g_testFailed), (g_testFailed != 0))
+
+// frames of a stream written to a stub WiFiClient, payloads unmasked
+typedef struct _TEST_FRAME
+{
+  uint8_t head;
+  bool masked;
+  std::string payload;  // unmasked
+} TEST_FRAME;
+
+inline std::vector<TEST_FRAME> testParse(const std::string &stream)
+{
+  std::vector<TEST_FRAME> frames;
+  WEB_SOCKET_FRAME_INFO info;
+  size_t offset = 0;
+  uint8_t header_length = 0;
+
+  while (offset < stream.size())
+  {
+    header_length = webSocket_frameDecodeHeader((const uint8_t *) &stream[offset],
+                                                stream.size() - offset, &info);
+
+    if ((header_length == 0)
+        || (offset + header_length + info.payload_length > stream.size()))
+    {
+      TEST_CHECK(false);  // torn frame
+      break;
+    }
+
+    TEST_FRAME frame = { (uint8_t) stream[offset], info.masked != 0,
+                         stream.substr(offset + header_length, info.payload_length) };
+
+    for (size_t i = 0; info.masked && (i < frame.payload.size()); i++)
+    {
+      frame.payload[i] ^= info.mask[i & 3];
+    }
+
+    frames.push_back(frame);
+    offset += header_length + info.payload_length;
+  }
+
+  return frames;
+}
+
+#endif /* WEBSOCKET_TEST_H_ */
@@ -0,0 +1,199 @@
+/*
+ * @file    webSocketTlsTest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for wss:// in wsHTTPClient (WEBSOCKET_TLS) against the local
+// TLS stand-in of stubs/WiFiClientSecureBearSSL.h: URL schemes and ports,
+// the server check, the MFLN fallback, an upgrade and a frame through the
+// TLS client, followed by a benchmark of full against resumed handshakes.
+
+#include <stdio.h>
+#include <chrono>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "wsBasicHttpClient.h"
+
+#define TEST_HANDSHAKES	200
+
+// the connection settings begin() derived
+class testHttpClient : public wsHTTPClient
+{
+public:
+    using wsHTTPClient::_host;
+    using wsHTTPClient::_port;
+    using wsHTTPClient::_secure;
+};
+
+static std::string g_testPayload;
+
+static void testReceive(void)
+{
+  g_testPayload.assign(webSocket_getPayload(), webSocket_available());
+}
+
+static void testBegin(void)
+{
+  testHttpClient http;
+
+  TEST_CHECK(http.begin("wss://example.local/chat"));
+  TEST_CHECK(http._secure && (http._port == 443) && (http._host == "example.local"));
+  TEST_CHECK(http.begin("wss://example.local:8443/chat"));
+  TEST_CHECK(http._secure && (http._port == 8443));
+  TEST_CHECK(http.begin("ws://example.local/chat"));
+  TEST_CHECK(!http._secure && (http._port == 80));
+  TEST_CHECK(!http.begin("example.local/chat"));
+}
+
+// without a fingerprint or trust anchors nothing is sent, a wrong
+// fingerprint fails the connect
+static void testServerCheck(void)
+{
+  static const uint8_t wrong[20] = { 0 };
+  static const BearSSL::X509List anchors;
+  uint32_t handshakes = g_testTls.handshakes;
+
+  {
+    wsHTTPClient http;
+
+    http.begin("wss://example.local/chat");
+    TEST_CHECK(!http.warm());
+    TEST_CHECK(g_testTls.handshakes == handshakes);
+  }
+
+  {
+    wsHTTPClient http;
+
+    http.begin("wss://example.local/chat");
+    http.setFingerprint(wrong);
+    TEST_CHECK(!http.warm() && !http.connected());
+  }
+
+  {
+    wsHTTPClient http;
+
+    http.begin("wss://example.local/chat");
+    http.setTrustAnchors(&anchors);
+    TEST_CHECK(http.warm() && http.connected());
+    TEST_CHECK(g_testTls.sni == "example.local");
+  }
+}
+
+// the record buffer falls back to 16k when the server does not negotiate
+// the maximum fragment length
+static void testBufferSizes(void)
+{
+  wsHTTPClient http;
+
+  http.begin("wss://example.local/chat");
+  http.setFingerprint(g_testTls.fingerprint);
+
+  g_testTls.mfln = true;
+  TEST_CHECK(http.warm());
+  TEST_CHECK((g_testTls.recv == WEB_SOCKET_TLS_RECV_SIZE)
+             && (g_testTls.xmit == WEB_SOCKET_TLS_XMIT_SIZE));
+  http.disconnect();
+
+  g_testTls.mfln = false;
+  http.setBufferSizes(2048, 512);
+  TEST_CHECK(http.warm());
+  TEST_CHECK((g_testTls.recv == 16384) && (g_testTls.xmit == 512));
+
+  g_testTls.mfln = true;
+}
+
+// the upgrade request and the frames go through the TLS client, which
+// webSocket_handle() takes by reference
+static void testUpgrade(void)
+{
+  wsHTTPClient http;
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t length = webSocket_frameEncodeHeader(header, true, 0, OPCODE_FRAME_TEXT,
+                                               NULL, 5);
+
+  g_testServer.reply = "HTTP/1.1 101 Switching Protocols\r\n\r\n"
+                       + std::string((const char *) header, length) + "hello";
+  http.begin("wss://example.local/chat");
+  http.setFingerprint(g_testTls.fingerprint);
+  http.setUpgrade(true);
+  TEST_CHECK(http.GET() == HTTP_CODE_SWITCHING_PROTOCOLS);
+  TEST_CHECK(http.getStreamPtr()->connection->output.compare(0, 24,
+                                                             "GET /chat HTTP/1.1\r\nHost")
+             == 0);
+  g_testServer.reply.clear();
+
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_setHandler(WEBSOCKET_HANDLER_RECIVE, testReceive);
+  webSocket_start();
+  g_testPayload.clear();
+  webSocket_handle(http.getStream());
+
+  TEST_CHECK(g_testPayload == "hello");
+
+  webSocket_abort();
+}
+
+// A new client does the full handshake, a reconnect of the same client
+// offers its session and skips the key exchange.
+static void benchHandshake(void)
+{
+  typedef std::chrono::steady_clock clock;
+  clock::duration full = clock::duration::zero();
+  clock::duration resumed = clock::duration::zero();
+  uint32_t resumed_count = g_testTls.resumed;
+  wsHTTPClient http;
+
+  for (int i = 0; i < TEST_HANDSHAKES; i++)
+  {
+    wsHTTPClient fresh;
+
+    fresh.begin("wss://example.local/chat");
+    fresh.setFingerprint(g_testTls.fingerprint);
+
+    clock::time_point start = clock::now();
+    TEST_CHECK(fresh.warm());
+    full += clock::now() - start;
+  }
+
+  TEST_CHECK(g_testTls.resumed == resumed_count);
+
+  http.begin("wss://example.local/chat");
+  http.setFingerprint(g_testTls.fingerprint);
+  TEST_CHECK(http.warm());
+  http.disconnect();
+
+  for (int i = 0; i < TEST_HANDSHAKES; i++)
+  {
+    clock::time_point start = clock::now();
+    TEST_CHECK(http.warm());
+    resumed += clock::now() - start;
+    http.disconnect();
+  }
+
+  TEST_CHECK(g_testTls.resumed == resumed_count + TEST_HANDSHAKES);
+  TEST_CHECK(resumed < full);
+
+  printf("handshake: full %.0f us, resumed %.0f us (%.1fx faster), %d each\n",
+         std::chrono::duration<double, std::micro>(full).count() / TEST_HANDSHAKES,
+         std::chrono::duration<double, std::micro>(resumed).count() / TEST_HANDSHAKES,
+         std::chrono::duration<double>(full).count()
+         / std::chrono::duration<double>(resumed).count(), TEST_HANDSHAKES);
+}
+
+int main(void)
+{
+  testTlsBegin();
+  testBegin();
+  testServerCheck();
+  testBufferSizes();
+  testUpgrade();
+  benchHandshake();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,383 @@
+/*
+ * @file    webSocketUtf8Test.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+// Host test for webSocketUtf8.h against a decoding reference: every one and
+// two byte sequence and the three and four byte ones around the range
+// limits (overlong forms, surrogates, above U+10FFFF), every split of a
+// message across chunks, every alignment of the SSE2 and word at a time
+// ASCII paths, and the 1007 close of webSocket_handle().
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "webSocketTest.h"
+#include "webSocket.h"
+#include "webSocketUtf8.h"
+
+// Decodes code points and checks their range (RFC 3629 section 3). A
+// message cut inside a code point is valid so far when some continuation
+// completes it; the lowest or the highest one will do, since the range
+// limits fall on block boundaries of the cut.
+static bool testReference(const std::string &text, bool *complete)
+{
+  size_t i = 0;
+
+  *complete = true;
+
+  while (i < text.size())
+  {
+    size_t start = i;
+    uint8_t b = (uint8_t) text[i++];
+    uint32_t code = 0;
+    uint32_t min = 0;
+    int count = 0;
+    bool dummy = true;
+
+    if (b < 0x80)
+    {
+      continue;
+    }
+    else if ((b & 0xE0) == 0xC0)
+    {
+      code = b & 0x1F;
+      count = 1;
+      min = 0x80;
+    }
+    else if ((b & 0xF0) == 0xE0)
+    {
+      code = b & 0x0F;
+      count = 2;
+      min = 0x800;
+    }
+    else if ((b & 0xF8) == 0xF0)
+    {
+      code = b & 0x07;
+      count = 3;
+      min = 0x10000;
+    }
+    else
+    {
+      return false;
+    }
+
+    for (int n = 0; n < count; n++)
+    {
+      if (i >= text.size())
+      {
+        std::string cut = text.substr(start);
+
+        *complete = false;
+
+        return testReference(cut + std::string(count - n, (char) 0x80), &dummy)
+               || testReference(cut + std::string(count - n, (char) 0xBF), &dummy);
+      }
+
+      if ((text[i] & 0xC0) != 0x80)
+      {
+        return false;
+      }
+
+      code = (code << 6) | (text[i++] & 0x3F);
+    }
+
+    if ((code < min) || (code > 0x10FFFF) || ((code >= 0xD800) && (code <= 0xDFFF)))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// the validator in one call, true when it agrees with the reference
+static bool testAgree(const std::string &text)
+{
+  WEB_SOCKET_UTF8_STATE state;
+  bool complete = true;
+  bool valid = testReference(text, &complete);
+
+  webSocket_utf8Reset(&state);
+
+  if (webSocket_utf8Validate(&state, (const uint8_t *) text.data(), text.size())
+      != valid)
+  {
+    return false;
+  }
+
+  return !valid || (webSocket_utf8IsComplete(&state) == complete);
+}
+
+static void testSequences(void)
+{
+  static const uint8_t edges[] = { 0x00, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0,
+                                   0xBF, 0xC0, 0xFF };
+  int failed = 0;
+
+  for (int b0 = 0; b0 < 0x100; b0++)
+  {
+    failed += !testAgree(std::string(1, (char) b0));
+
+    for (int b1 = 0; b1 < 0x100; b1++)
+    {
+      std::string two = { (char) b0, (char) b1 };
+
+      failed += !testAgree(two);
+
+      for (size_t b2 = 0; (b0 >= 0xE0) && (b2 < sizeof(edges)); b2++)
+      {
+        failed += !testAgree(two + (char) edges[b2]);
+
+        for (size_t b3 = 0; (b0 >= 0xF0) && (b3 < sizeof(edges)); b3++)
+        {
+          failed += !testAgree(two + (char) edges[b2] + (char) edges[b3]);
+        }
+      }
+    }
+  }
+
+  TEST_CHECK(failed == 0);
+}
+
+// the limits by name
+static void testLimits(void)
+{
+  static const struct
+  {
+    const char *text;
+    bool valid;
+  } cases[] = {
+    { "\xC0\xAF", false },  // overlong '/'
+    { "\xC1\xBF", false },
+    { "\xE0\x80\xAF", false },
+    { "\xE0\x9F\xBF", false },
+    { "\xF0\x80\x80\xAF", false },
+    { "\xF0\x8F\xBF\xBF", false },
+    { "\xC2\x80", true },  // U+0080
+    { "\xE0\xA0\x80", true },  // U+0800
+    { "\xF0\x90\x80\x80", true },  // U+10000
+    { "\xED\x9F\xBF", true },  // U+D7FF
+    { "\xED\xA0\x80", false },  // U+D800
+    { "\xED\xBF\xBF", false },  // U+DFFF
+    { "\xEE\x80\x80", true },  // U+E000
+    { "\xEF\xBF\xBF", true },  // U+FFFF
+    { "\xF4\x8F\xBF\xBF", true },  // U+10FFFF
+    { "\xF4\x90\x80\x80", false },  // U+110000
+    { "\xF5\x80\x80\x80", false },
+    { "\xF8\x88\x80\x80\x80", false },
+    { "\xFE", false },
+    { "\xFF", false },
+    { "\x80", false },
+    { "\xC3\xA9\xBF", false },  // stray continuation
+    { "\xC3\x28", false },
+  };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+  {
+    WEB_SOCKET_UTF8_STATE state;
+    size_t length = strlen(cases[i].text);
+
+    webSocket_utf8Reset(&state);
+    TEST_CHECK((webSocket_utf8Validate(&state, (const uint8_t *) cases[i].text, length)
+                && webSocket_utf8IsComplete(&state)) == cases[i].valid);
+  }
+}
+
+// a message in two and in byte sized chunks gives what it gives whole
+static void testChunks(void)
+{
+  static const char *const texts[] = {
+    "caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80 \xF4\x8F\xBF\xBF end",
+    "\xE0\xA0\x80\xED\x9F\xBF\xEE\x80\x80\xF0\x90\x80\x80",
+    "ascii then \xED\xA0\x80 surrogate",
+    "ascii then \xF4\x90\x80\x80 too high",
+    "overlong \xE0\x9F\xBF",
+    "cut \xF0\x9F\x98",
+  };
+
+  for (size_t t = 0; t < sizeof(texts) / sizeof(texts[0]); t++)
+  {
+    std::string text = texts[t];
+    bool complete = true;
+    bool valid = testReference(text, &complete) && complete;
+
+    for (size_t split = 0; split <= text.size(); split++)
+    {
+      WEB_SOCKET_UTF8_STATE state;
+      bool ok = true;
+
+      webSocket_utf8Reset(&state);
+      ok = webSocket_utf8Validate(&state, (const uint8_t *) text.data(), split)
+           && webSocket_utf8Validate(&state, (const uint8_t *) text.data() + split,
+                                     text.size() - split);
+      TEST_CHECK((ok && webSocket_utf8IsComplete(&state)) == valid);
+    }
+
+    WEB_SOCKET_UTF8_STATE state;
+    bool ok = true;
+
+    webSocket_utf8Reset(&state);
+
+    for (size_t i = 0; ok && (i < text.size()); i++)
+    {
+      ok = webSocket_utf8Validate(&state, (const uint8_t *) &text[i], 1);
+    }
+
+    TEST_CHECK((ok && webSocket_utf8IsComplete(&state)) == valid);
+  }
+}
+
+// a non-ASCII byte at every offset of every start alignment, in front of,
+// inside and after the 16 byte SSE2 blocks and the words
+static void testAlignment(void)
+{
+  static const char *const marks[] = { "\x80", "\xC3\xA9", "\xF0\x9F\x98\x80", "\xC3" };
+  uint8_t buffer[160 + 32];
+  int failed = 0;
+
+  for (size_t m = 0; m < sizeof(marks) / sizeof(marks[0]); m++)
+  {
+    std::string mark = marks[m];
+    bool valid = (m == 1) || (m == 2);
+    bool complete = (m != 3);
+
+    for (size_t align = 0; align < 32; align++)
+    {
+      for (size_t length = mark.size(); length <= 160; length += (length < 40) ? 1 : 7)
+      {
+        for (size_t at = 0; at + mark.size() <= length; at++)
+        {
+          WEB_SOCKET_UTF8_STATE state;
+          uint8_t *text = &buffer[align];
+          bool ok = true;
+
+          memset(text, 'a', length);
+          memcpy(&text[at], mark.data(), mark.size());
+          webSocket_utf8Reset(&state);
+          ok = webSocket_utf8Validate(&state, text, length);
+
+          // the cut mark is only incomplete when it ends the message
+          failed += (ok != (valid || ((m == 3) && (at + 1 == length))));
+          failed += ok && (webSocket_utf8IsComplete(&state)
+                           != (complete || (at + 1 != length)));
+        }
+      }
+
+      // all ASCII, at every length
+      for (size_t length = 0; length <= 160; length++)
+      {
+        WEB_SOCKET_UTF8_STATE state;
+
+        memset(&buffer[align], 'z', length);
+        webSocket_utf8Reset(&state);
+        failed += !webSocket_utf8Validate(&state, &buffer[align], length);
+      }
+    }
+  }
+
+  TEST_CHECK(failed == 0);
+}
+
+typedef struct _TEST_MESSAGE
+{
+  uint8_t opcode;
+  std::string payload;
+} TEST_MESSAGE;
+
+static std::vector<TEST_MESSAGE> g_testMessages;
+
+static void testReceive(void)
+{
+  TEST_MESSAGE message = { webSocket_getOpcode(),
+                           std::string(webSocket_getPayload(), webSocket_available()) };
+
+  g_testMessages.push_back(message);
+}
+
+static std::string testFrame(bool fin, uint8_t opcode, const std::string &payload)
+{
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t length = webSocket_frameEncodeHeader(header, fin, 0, opcode, NULL,
+                                               payload.size());
+
+  return std::string((const char *) header, length) + payload;
+}
+
+// the close frames a client session writes for a stream from the server
+static std::vector<TEST_FRAME> testSession(const std::string &stream)
+{
+  WiFiClient client;
+  std::vector<TEST_FRAME> frames;
+  std::vector<TEST_FRAME> closes;
+
+  webSocket_init();
+  webSocket_setMode(WEBSOCKET_MODE_CLIENT);
+  webSocket_setUseMask(true);
+  webSocket_setHandler(WEBSOCKET_HANDLER_RECIVE, testReceive);
+  webSocket_start();
+  g_testMessages.clear();
+
+  // a byte per read, so every code point is split across reads
+  for (size_t i = 0; i < stream.size(); i++)
+  {
+    client.connection->input += stream[i];
+    webSocket_handle(client);
+  }
+
+  webSocket_handle(client);
+  frames = testParse(client.connection->output);
+
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    if ((frames[i].head & WEB_SOCKET_FRAME_OPCODE) == OPCODE_FRAME_CLOSE)
+    {
+      closes.push_back(frames[i]);
+    }
+  }
+
+  webSocket_abort();
+
+  return closes;
+}
+
+// a text message is checked across fragments and reads, invalid UTF-8 is
+// dropped and closed with 1007, binary is not checked
+static void testClose(void)
+{
+  std::vector<TEST_FRAME> closes;
+
+  closes = testSession(testFrame(false, OPCODE_FRAME_TEXT, "caf\xC3")
+                       + testFrame(true, OPCODE_FRAME_CONTINUE, "\xA9 \xF0\x9F")
+                       + testFrame(true, OPCODE_FRAME_BINARY, "\xFF\xFE"));
+  TEST_CHECK(closes.size() == 1);  // for the code point cut at the end
+  TEST_CHECK(!closes.empty() && (closes[0].payload == "\x03\xef"));
+
+  closes = testSession(testFrame(false, OPCODE_FRAME_TEXT, "caf\xC3")
+                       + testFrame(true, OPCODE_FRAME_CONTINUE, "\xA9!")
+                       + testFrame(true, OPCODE_FRAME_BINARY, "\xFF\xFE"));
+  TEST_CHECK(closes.empty());
+  TEST_CHECK((g_testMessages.size() == 3)
+             && (g_testMessages[0].payload == "caf\xC3")
+             && (g_testMessages[1].payload == "\xA9!")
+             && (g_testMessages[2].payload == "\xFF\xFE"));
+
+  closes = testSession(testFrame(true, OPCODE_FRAME_TEXT, "ok \xED\xA0\x80 no"));
+  TEST_CHECK(!closes.empty() && (closes[0].payload == "\x03\xef"));
+  TEST_CHECK((g_testMessages.size() == 1) && g_testMessages[0].payload.empty());
+}
+
+int main(void)
+{
+  testSequences();
+  testLimits();
+  testChunks();
+  testAlignment();
+  testClose();
+
+  return TEST_RESULT();
+}
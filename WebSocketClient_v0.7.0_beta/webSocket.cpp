@@ -16,12 +16,33 @@
 #include <cstdbool>
 #include <cstdint>
 #include "webSocket.h"
+#include "webSocketBatch.h"
+#include "webSocketIngest.h"
+#include "webSocketLog.h"
+#include "webSocketMux.h"
+#include "webSocketPool.h"
+#include "webSocketQueue.h"
+#include "webSocketRecord.h"
+#include "webSocketSched.h"
+#include "webSocketShaper.h"
+#include "webSocketStats.h"
+#include "webSocketTrace.h"
+#include "webSocketUtf8.h"
 #include "Hash.h"
 
 #define WEBSOCKET_DEBUG
-#define WEB_SOCKET_HEAD_FRAME_SIZE	2
-#define WEB_SOCKET_MASK_KEY_SIZE	4
-#define WEB_SOCKET_HEADER_SIZE		(WEB_SOCKET_HEAD_FRAME_SIZE + WEB_SOCKET_MASK_KEY_SIZE)
+
+#ifdef WEBSOCKET_ROLE
+#define WEB_SOCKET_MODE()		(WEBSOCKET_ROLE)
+#else
+#define WEB_SOCKET_MODE()		(g_webSocketMode)
+#endif // WEBSOCKET_ROLE
+
+#ifdef WEBSOCKET_MASK
+#define WEB_SOCKET_IS_MASK()	(WEBSOCKET_MASK)
+#else
+#define WEB_SOCKET_IS_MASK()	(g_is_sendMaskUse)
+#endif // WEBSOCKET_MASK
 
 enum webSocetStateCode
 {
@@ -37,77 +58,106 @@ enum webSocetStateCode
   WEBSOCET_STATE_CLOSING_END = 0x17
 };
 
-enum webSocetFrameOpcode
-{
-  OPCODE_FRAME_CONTINUE = 0x00,
-  OPCODE_FRAME_TEXT = 0x01,
-  OPCODE_FRAME_BINARY = 0x02,
-  OPCODE_FRAME_RSV1 = 0x03,
-  OPCODE_FRAME_RSV2 = 0x04,
-  OPCODE_FRAME_RSV3 = 0x05,
-  OPCODE_FRAME_RSV4 = 0x06,
-  OPCODE_FRAME_RSV5 = 0x07,
-  OPCODE_FRAME_CLOSE = 0x08,
-  OPCODE_FRAME_PING = 0x09,
-  OPCODE_FRAME_PONG = 0x0A,
-  OPCODE_FRAME_RSV8 = 0x0B,
-  OPCODE_FRAME_RSV9 = 0x0C,
-  OPCODE_FRAME_RSV10 = 0x0D,
-  OPCODE_FRAME_RSV11 = 0x0E,
-  OPCODE_FRAME_RSV12 = 0x0F
-};
-
-typedef struct _WEB_SOCKET_FRAME_HEADER_INFO
-{
-  uint8_t opcode : 4;
-  uint8_t rsv3 : 1;
-  uint8_t rsv2 : 1;
-  uint8_t rsv1 : 1;
-  uint8_t fin : 1;
-  uint8_t payload_length : 7;
-  uint8_t masked : 1;
-} WEB_SOCKET_FRAME_HEADER_INFO;
-
-typedef union _WEB_SOCKET_FRAME_HEADER
-{
-  WEB_SOCKET_FRAME_HEADER_INFO data;
-  char byte[2];
-} WEB_SOCKET_FRAME_HEADER;
-
-static uint16_t webSocket_getPayloadType(uint16_t payload_length);
-static void webSocket_setPayload(const char *payload, uint16_t payload_length, uint8_t payload_option);
-static void webSocket_encodeMask(const char *payload, uint16_t payload_length, uint8_t payload_option);
+static void webSocket_setHeader(uint8_t opcode, uint16_t payload_length);
+static void webSocket_setPayload(const char *payload, uint16_t payload_length);
+static void webSocket_encodeMask(const char *payload, uint16_t payload_length);
 static void webSocket_clear(void);
 static void webSocket_timeOutRefresh(void);
 static bool webSocket_is_timeOutElapse(void);
 static bool webSocket_is_timeOutRetryOver(void);
+static void webSocket_readControlPayload(void);
+static void webSocket_updateRtt(uint32_t rtt);
+static void webSocket_updateKeepAlive(void);
 //static void webSocket_stop(void);
-static void webSocket_stateControl(WiFiClient client);
-static void webSocket_stateControlOpen(void);
-static void webSocket_stateControlClosing(void);
-static void webSocket_send(WiFiClient client);
-static void webSocket_readFrameHeader(WiFiClient client);
-static void webSocket_readFramePayload(WiFiClient client);
-
-static int webSocket_printClientRead(WiFiClient client);
+static void webSocket_stateControl(WiFiClient &client);
+static void webSocket_stateControlOpen(uint8_t opcode);
+static void webSocket_stateControlClosing(uint8_t opcode);
+static void webSocket_send(WiFiClient &client);
+static void webSocket_sendControl(WiFiClient &client);
+static void webSocket_sendData(WiFiClient &client);
+static void webSocket_releaseData(void);
+static bool webSocket_setControl(const char *payload, uint8_t payload_length,
+                                 uint8_t opcode);
+static bool webSocket_readFrameHeader(WiFiClient &client);
+static void webSocket_startFramePayload(void);
+static bool webSocket_readFramePayload(WiFiClient &client);
+static void webSocket_decodeMask(char *payload, uint16_t payload_length, uint16_t offset);
+static void webSocket_reciveInvalid(void);
+static void webSocket_reciveTooBig(WiFiClient &client);
+static void webSocket_reciveAbort(WiFiClient &client, uint16_t code);
+static bool webSocket_skipPayload(WiFiClient &client);
+#ifdef WEBSOCKET_POOL
+static bool webSocket_borrowWriteData(uint16_t payload_length);
+static void webSocket_returnWriteData(void);
+static void webSocket_returnReadPayload(void);
+#endif // WEBSOCKET_POOL
+#ifdef WEBSOCKET_INGEST
+static void webSocket_ingestDrain(WiFiClient &client);
+#endif // WEBSOCKET_INGEST
+#ifdef WEBSOCKET_QUEUE
+static void webSocket_queueSpool(void);
+static void webSocket_queueDrain(WiFiClient &client);
+static uint16_t webSocket_queueCountFrames(const char *buffer, uint16_t length);
+#endif // WEBSOCKET_QUEUE
+
+static int webSocket_printClientRead(WiFiClient &client);
 #ifndef WEBSOCKET_DEBUG
-static void webSocket_printWriteData(uint8_t payload_length);
+static void webSocket_printWriteData(void);
 static void webSocket_printFrameHeader(void);
 static void webSocket_printFramePayload(void);
 #endif // WEBSOCKET_DEBUG
 
-static WEB_SOCKET_FRAME_HEADER g_wsHeaderRecive;
-static WEB_SOCKET_FRAME_HEADER g_wsHeaderSend;
+static WEB_SOCKET_FRAME_INFO g_wsHeaderRecive;
+static uint8_t g_reciveHeader[WEB_SOCKET_FRAME_HEADER_MAX];  // kept until complete
+static uint8_t g_reciveHeaderLength = 0;
 
 static char g_webSocketFrameMask[WEB_SOCKET_MASK_KEY_SIZE];
-static char g_webSocketReadPayload[WEB_SOCKET_PAYLOAD_SIZE];
-static char g_webSocketWriteData[WEB_SOCKET_HEADER_SIZE + WEB_SOCKET_PAYLOAD_SIZE];
+static char g_webSocketPingPayload[WEB_SOCKET_PAYLOAD_TYPE1];
+// ping, pong and close have their own slot, written ahead of a data frame
+// the shaper holds
+static char g_webSocketControlData[WEB_SOCKET_CONTROL_FRAME_MAX];
+// headers of the keepalive ping and the close frames, unmasked and masked
+static constexpr uint32_t g_pingHeader[2] = {
+  webSocket_frameHeaderConst(true, OPCODE_FRAME_PING, false, WEB_SOCKET_PING_PAYLOAD_SIZE),
+  webSocket_frameHeaderConst(true, OPCODE_FRAME_PING, true, WEB_SOCKET_PING_PAYLOAD_SIZE)
+};
+static constexpr uint32_t g_closeHeader[2] = {
+  webSocket_frameHeaderConst(true, OPCODE_FRAME_CLOSE, false, 0),
+  webSocket_frameHeaderConst(true, OPCODE_FRAME_CLOSE, true, 0)
+};
+static constexpr uint32_t g_closeCodeHeader[2] = {
+  webSocket_frameHeaderConst(true, OPCODE_FRAME_CLOSE, false, 2),
+  webSocket_frameHeaderConst(true, OPCODE_FRAME_CLOSE, true, 2)
+};
+#ifdef WEBSOCKET_POOL
+static char *g_webSocketReadPayload = NULL;  // borrowed per frame
+#else
+static char g_webSocketReadPayload[WEB_SOCKET_RECIVE_PAYLOAD_SIZE];
+#endif // WEBSOCKET_POOL
+// the payload always starts at WEB_SOCKET_FRAME_HEADER16_MAX, the header is
+// written right before it once the length is known
+#ifdef WEBSOCKET_POOL
+static char *g_webSocketWriteData = NULL;  // borrowed until the frame is written
+#else
+static char g_webSocketWriteData[WEB_SOCKET_FRAME_HEADER16_MAX + WEB_SOCKET_SEND_PAYLOAD_SIZE];
+#endif // WEBSOCKET_POOL
 
 static uint8_t g_webSocketMode = WEBSOCKET_MODE_SERVER;
 static bool g_is_webSocketStart = false;
 static int g_handleLength = 0;
 static uint16_t g_sendPayloadLength = 0;
+static uint16_t g_sendFrameLength = 0;
+static uint8_t g_sendFrameOffset = 0;
+static uint8_t g_sendOpcode = 0;
+static const char *g_sendFrame = NULL;  // external frame, see webSocket_sendFrame()
+static uint8_t g_controlFrameLength = 0;
+static uint8_t g_controlPayloadLength = 0;
+static uint8_t g_controlOpcode = 0;
+static bool g_is_setControlData = false;
 static uint16_t g_recivePayloadLength = 0;
+static uint16_t g_recivePayloadCount = 0;  // bytes of the payload read so far
+static uint16_t g_reciveSkipLength = 0;  // bytes of a truncated payload still to skip
+static bool g_is_recivePayload = false;  // header decoded, payload not complete yet
 static uint8_t g_webSocketState = 0;
 static bool g_is_setSendData = false;
 static bool g_is_sendMaskUse = false;
@@ -116,6 +166,17 @@ static uint32_t g_webSocketTimeoutMax = WEB_SOCKET_TIMEOUT_DEFAULT;//msec
 static uint32_t g_webSocketTimeoutCount = 0;//msec
 static uint8_t g_webSocketRetryMax = WEB_SOCKET_TIMEOUT_RETRY;//msec
 static uint8_t g_webSocketRetryCount = 0;//msec
+static uint32_t g_webSocketKeepAlive = WEB_SOCKET_TIMEOUT_DEFAULT;//msec
+static uint32_t g_webSocketSrtt = 0;//msec << 3
+static uint32_t g_webSocketRttVar = 0;//msec << 2
+static uint8_t g_pingPayloadLength = 0;
+static uint32_t g_webSocketPingSent = 0;//msec, payload of our last ping
+static bool g_is_pingSent = false;
+#ifdef WEBSOCKET_UTF8_VALIDATE
+static WEB_SOCKET_UTF8_STATE g_webSocketUtf8;
+static bool g_is_reciveText = false;
+#endif // WEBSOCKET_UTF8_VALIDATE
+static bool g_is_reciveInvalid = false;
 static webSocketHandler g_webSocketHandleOpen = NULL;
 static webSocketHandler g_webSocketHandleSend = NULL;
 static webSocketHandler g_webSocketHandleReceive = NULL;
@@ -126,10 +187,16 @@ static webSocketHandler g_webSocketHandleReceivePing = NULL;
 static webSocketHandler g_webSocketHandleReceivePong = NULL;
 static webSocketHandler g_webSocketHandleClose = NULL;
 static webSocketHandler g_webSocketHandleRefreshMask = NULL;
+static webSocketHandler g_webSocketHandleResume = NULL;
+static bool g_is_webSocketResume = false;  // a session was open before, kept by webSocket_clear()
 
 void webSocket_init(void)
 {
+  g_is_webSocketResume = false;
   webSocket_clear();
+#ifdef WEBSOCKET_QUEUE
+  webSocket_queueBegin();
+#endif // WEBSOCKET_QUEUE
 }
 
 void webSocket_handlerWrapper(webSocketHandler handler)
@@ -171,6 +238,9 @@ void webSocket_setHandler(webSocketHandlerType type, webSocketHandler handler)
     case WEBSOCKET_HANDLER_MASK_REFRESH:
       g_webSocketHandleRefreshMask = handler;
       break;
+    case WEBSOCKET_HANDLER_RESUME:
+      g_webSocketHandleResume = handler;
+      break;
   }
 }
 
@@ -192,7 +262,19 @@ void webSocket_start(void)
 
   webSocket_timeOutRefresh();
   g_webSocketRetryCount = 0;
+  WEB_SOCKET_STATS_COUNT(reconnects);
+#ifdef WEBSOCKET_MUX
+  webSocket_muxReset();
+#endif // WEBSOCKET_MUX
   webSocket_handlerWrapper(g_webSocketHandleOpen);
+
+  if (g_is_webSocketResume)
+  {
+    // replay what the previous session did not get acknowledged
+    webSocket_handlerWrapper(g_webSocketHandleResume);
+  }
+
+  g_is_webSocketResume = true;
 }
 
 void webSocket_setMode(uint8_t mode)
@@ -209,7 +291,7 @@ void webSocket_setMode(uint8_t mode)
 
 void webSocket_setTimeoutMax(uint32_t max)
 {
-  if (WEB_SOCKET_TIMEOUT_MIN < max)
+  if (max < WEB_SOCKET_TIMEOUT_MIN)
   {
     g_webSocketTimeoutMax = WEB_SOCKET_TIMEOUT_MIN;
   }
@@ -217,6 +299,8 @@ void webSocket_setTimeoutMax(uint32_t max)
   {
     g_webSocketTimeoutMax = max;
   }
+
+  g_webSocketKeepAlive = g_webSocketTimeoutMax;
 }
 
 void webSocket_setTimeOutRetryMax(uint8_t max)
@@ -239,81 +323,185 @@ uint8_t webSocket_getTimeOutRetryCount(void)
   return g_webSocketRetryCount;
 }
 
+// smoothed round trip time measured by ping/pong, 0 until the first pong
+uint32_t webSocket_getRtt(void)
+{
+  return g_webSocketSrtt >> 3;
+}
+
+uint32_t webSocket_getRttVar(void)
+{
+  return g_webSocketRttVar >> 2;
+}
+
+// time to wait for a pong before the next retry (RFC 6298 style RTO)
+uint32_t webSocket_getRto(void)
+{
+  uint32_t rto = 0;
+
+  if (g_webSocketSrtt == 0)
+  {
+    return g_webSocketTimeoutMax;
+  }
+
+  rto = (g_webSocketSrtt >> 3) + g_webSocketRttVar;
+
+  if (rto < WEB_SOCKET_RTO_MIN)
+  {
+    rto = WEB_SOCKET_RTO_MIN;
+  }
+  else if (rto > WEB_SOCKET_RTO_MAX)
+  {
+    rto = WEB_SOCKET_RTO_MAX;
+  }
+
+  return rto;
+}
+
+// idle time before a keepalive ping is sent
+uint32_t webSocket_getKeepAliveInterval(void)
+{
+  return g_webSocketKeepAlive;
+}
+
 bool webSocket_isStart(void)
 {
   return g_is_webSocketStart;
 }
 
-void webSocket_handle(WiFiClient client)
+// Ends the session at once when the TCP link is already gone (AP roaming,
+// server reset) instead of waiting for the keepalive to time out.
+void webSocket_abort(void)
+{
+  if (g_is_webSocketStart)
+  {
+    g_webSocketState = WEBSOCET_STATE_CLOSE;
+    webSocket_handlerWrapper(g_webSocketHandleClose);
+    webSocket_clear();
+#ifndef WEBSOCKET_DEBUG
+    Serial.println("webSocket_abort()"); // DEBUG
+#endif // WEBSOCKET_DEBUG
+  }
+}
+
+void webSocket_handle(WiFiClient &client)
 {
+  bool is_frame = false;
+
   g_handleLength = client.available();
 
-  if (g_handleLength >= 2)
+  if ((g_handleLength > 0) && !g_is_recivePayload)
   {
-    //		while(client.available()){
-    //			webSocket_printClientRead(client);
-    //		}
-
-    // received
-    webSocket_readFrameHeader(client);
+    WEB_SOCKET_TRACE_BEGIN(WEBSOCKET_TRACE_HEADER);
+    g_is_recivePayload = webSocket_readFrameHeader(client);
+    WEB_SOCKET_TRACE_END(WEBSOCKET_TRACE_HEADER);
 #ifndef WEBSOCKET_DEBUG
-    webSocket_printFrameHeader(); // DEBUG
+    if (g_is_recivePayload)
+    {
+      webSocket_printFrameHeader(); // DEBUG
+    }
 #endif // WEBSOCKET_DEBUG
-    webSocket_readFramePayload(client);
+  }
+
+  if (g_is_recivePayload)
+  {
+    // a payload split across TCP segments is read over several calls, the
+    // frame is handled once it is complete
+    WEB_SOCKET_TRACE_BEGIN(WEBSOCKET_TRACE_PAYLOAD);
+    is_frame = webSocket_readFramePayload(client);
+    WEB_SOCKET_TRACE_END(WEBSOCKET_TRACE_PAYLOAD);
+  }
+
+  if (is_frame)
+  {
+    // received
 #ifndef WEBSOCKET_DEBUG
     webSocket_printFramePayload(); // DEBUG
 #endif // WEBSOCKET_DEBUG
+
+    if (g_is_reciveInvalid)
+    {
+      webSocket_reciveInvalid();
+    }
+
+    webSocket_readControlPayload();
+    WEB_SOCKET_STATS_FRAME_IN(g_wsHeaderRecive.opcode,
+                              g_recivePayloadLength);
     webSocket_timeOutRefresh();
     g_webSocketRetryCount = 0;
 
-    webSocket_handlerWrapper(g_webSocketHandleReceive);
+    WEB_SOCKET_TRACE_BEGIN(WEBSOCKET_TRACE_HANDLER);
+#ifdef WEBSOCKET_MUX
+    if (!webSocket_muxReceive(g_webSocketReadPayload, g_recivePayloadLength,
+                              (uint16_t) g_wsHeaderRecive.payload_length,
+                              g_wsHeaderRecive.opcode, g_wsHeaderRecive.fin))
+#endif // WEBSOCKET_MUX
+    {
+      webSocket_handlerWrapper(g_webSocketHandleReceive);
+    }
+    WEB_SOCKET_TRACE_END(WEBSOCKET_TRACE_HANDLER);
   }
 
-  if (g_webSocketMode == WEBSOCKET_MODE_SERVER)
+  // both roles ping an idle peer, so either side notices a dead link
+  if ((g_webSocketState == WEBSOCET_STATE_OPEN)
+      || (g_webSocketState == WEBSOCET_STATE_CLOSING))
   {
-    if ((g_webSocketState == WEBSOCET_STATE_OPEN)
-        || (g_webSocketState == WEBSOCET_STATE_CLOSING))
+    if (webSocket_is_timeOutElapse())
     {
-      if (webSocket_is_timeOutElapse())
+      if (webSocket_is_timeOutRetryOver())
       {
-        if (webSocket_is_timeOutRetryOver())
-        {
-          g_webSocketState = WEBSOCET_STATE_CLOSE;
-          webSocket_sendClose();
-          webSocket_handlerWrapper(g_webSocketHandleTimeOutClose);
+        g_webSocketState = WEBSOCET_STATE_CLOSE;
+        WEB_SOCKET_STATS_COUNT(timeouts);
+        webSocket_sendClose();
+        webSocket_handlerWrapper(g_webSocketHandleTimeOutClose);
+        WEB_SOCKET_LOG_WARN("timeout close after %u retries", g_webSocketRetryCount);
 #ifndef WEBSOCKET_DEBUG
-          Serial.println("TIMEOUT: CLOSE"); // DEBUG
+        Serial.println("TIMEOUT: CLOSE"); // DEBUG
 #endif // WEBSOCKET_DEBUG
-        }
-        else
+      }
+      else
+      {
+        g_webSocketRetryCount++;
+        WEB_SOCKET_STATS_COUNT(retries);
+
+        if (g_webSocketRetryCount > 1)
         {
-          g_webSocketRetryCount++;
-          webSocket_timeOutRefresh();
-          webSocket_sendPing();
-          webSocket_handlerWrapper(g_webSocketHandleTimeOutRetry);
+          // the first ping was lost, fall back to the configured interval
+          g_webSocketKeepAlive = g_webSocketTimeoutMax;
+        }
+
+        webSocket_timeOutRefresh();
+        webSocket_sendPing();
+        webSocket_handlerWrapper(g_webSocketHandleTimeOutRetry);
 #ifndef WEBSOCKET_DEBUG
-          Serial.print("TIMEOUT: RETRY"); // DEBUG
-          Serial.print(g_webSocketRetryCount);// DEBUG
-          Serial.print("/");// DEBUG
-          Serial.println(g_webSocketRetryMax);// DEBUG
+        Serial.print("TIMEOUT: RETRY"); // DEBUG
+        Serial.print(g_webSocketRetryCount);// DEBUG
+        Serial.print("/");// DEBUG
+        Serial.println(g_webSocketRetryMax);// DEBUG
 #endif // WEBSOCKET_DEBUG
-        }
       }
     }
   }
 
   webSocket_stateControl(client);
+#ifdef WEBSOCKET_POOL
+  if (!g_is_recivePayload)
+  {
+    webSocket_returnReadPayload();
+  }
+#endif // WEBSOCKET_POOL
 }
 
 void webSocket_setData(String sendString)
 {
-  if (sendString.length() <= WEB_SOCKET_PAYLOAD_SIZE)
+  if (sendString.length() <= WEB_SOCKET_SEND_PAYLOAD_SIZE)
   {
     webSocket_setData(sendString.c_str(), sendString.length(),
                       OPCODE_FRAME_TEXT);
   }
   else
   {
+    WEB_SOCKET_STATS_COUNT(payload_oversize);
 #ifndef WEBSOCKET_DEBUG
     Serial.println("setData(): length too long"); // DEBUG
 #endif // WEBSOCKET_DEBUG
@@ -322,12 +510,37 @@ void webSocket_setData(String sendString)
 
 void webSocket_sendPong(void)
 {
-  webSocket_setData(NULL, 0, OPCODE_FRAME_PONG);
+  // echo the payload of the last received ping
+  webSocket_setData(g_webSocketPingPayload, g_pingPayloadLength,
+                    OPCODE_FRAME_PONG);
 }
 
 void webSocket_sendPing(void)
 {
-  webSocket_setData(NULL, 0, OPCODE_FRAME_PING);
+  char timestamp[WEB_SOCKET_PING_PAYLOAD_SIZE];
+  uint32_t now = millis();
+
+  if (g_is_setControlData)
+  {
+    // a pong or close is not written yet, the retry timer pings again
+    WEB_SOCKET_STATS_COUNT(send_dropped);
+    return;
+  }
+
+  timestamp[0] = (char)(now >> 24);
+  timestamp[1] = (char)(now >> 16);
+  timestamp[2] = (char)(now >> 8);
+  timestamp[3] = (char)(now & 0x000000FF);
+
+  webSocket_setData(timestamp, WEB_SOCKET_PING_PAYLOAD_SIZE,
+                    OPCODE_FRAME_PING);
+
+  if (g_is_setControlData)
+  {
+    // only the pong echoing this timestamp is an RTT sample
+    g_webSocketPingSent = now;
+    g_is_pingSent = true;
+  }
 }
 
 void webSocket_sendClose(void)
@@ -336,6 +549,17 @@ void webSocket_sendClose(void)
   g_webSocketState |= WEBSOCET_STATE_SEND;
 }
 
+void webSocket_sendCloseCode(uint16_t code)
+{
+  char payload[2];
+
+  payload[0] = (char)(code >> 8);
+  payload[1] = (char)(code & 0x00FF);
+
+  webSocket_setData(payload, sizeof(payload), OPCODE_FRAME_CLOSE);
+  g_webSocketState |= WEBSOCET_STATE_SEND;
+}
+
 void webSocket_setUseMask(bool flag)
 {
   g_is_sendMaskUse = flag;
@@ -355,98 +579,318 @@ bool webSocket_isSendBusy(void)
   return g_is_setSendData;
 }
 
-void webSocket_setData(const char *payload, uint16_t payload_length,
-                       uint8_t opcode)
+// msec until the pending frame may be written, 0 when it can go now or
+// nothing is pending
+uint32_t webSocket_getSendDelay(void)
 {
-  uint8_t payload_option = 0;
-
-  if (!webSocket_isSendBusy())
+#ifdef WEBSOCKET_SHAPER
+  if (g_is_setSendData)
   {
-    g_wsHeaderSend.data.fin = 1;
-    g_wsHeaderSend.data.opcode = opcode;
-    g_wsHeaderSend.data.masked = g_is_sendMaskUse;
+    return webSocket_shaperGetDelay(g_sendOpcode, g_sendFrameLength);
+  }
+#endif // WEBSOCKET_SHAPER
 
-    payload_option = webSocket_getPayloadType(payload_length);
-    g_sendPayloadLength = payload_length;
+  return 0;
+}
 
-    if (payload_option)
-    {
-      g_wsHeaderSend.data.payload_length = WEB_SOCKET_PAYLOAD_TYPE2_FLAG;
-    }
-    else
+// false when the frame was dropped: too long, the slot busy or no block
+bool webSocket_setData(const char *payload, uint16_t payload_length,
+                       uint8_t opcode)
+{
+  if (opcode & WEB_SOCKET_FRAME_CONTROL)
+  {
+    if (payload_length > WEB_SOCKET_PAYLOAD_TYPE1)
     {
-      g_wsHeaderSend.data.payload_length = payload_length;
+      WEB_SOCKET_STATS_COUNT(payload_oversize);
+      return false;
     }
 
-    memcpy(&g_webSocketWriteData, g_wsHeaderSend.byte,
-           WEB_SOCKET_HEAD_FRAME_SIZE);
-
-    if (g_is_sendMaskUse)
-    {
-      memcpy(&g_webSocketWriteData[WEB_SOCKET_HEAD_FRAME_SIZE + payload_option],
-             g_webSocketFrameMask, WEB_SOCKET_MASK_KEY_SIZE);
-    }
+    return webSocket_setControl(payload, (uint8_t) payload_length, opcode);
+  }
 
-    if (payload_option)
-    {
-      g_webSocketWriteData[WEB_SOCKET_HEAD_FRAME_SIZE] = (char)(payload_length >> 8);
-      g_webSocketWriteData[WEB_SOCKET_HEAD_FRAME_SIZE + 1] = (char)(payload_length & 0x00FF);
-    }
+  if (payload_length > WEB_SOCKET_SEND_PAYLOAD_SIZE)
+  {
+    WEB_SOCKET_STATS_COUNT(payload_oversize);
+    return false;
+  }
 
-    webSocket_setPayload(payload, payload_length, payload_option);
+  if (webSocket_isSendBusy())
+  {
+    WEB_SOCKET_STATS_COUNT(send_dropped);
+    return false;
+  }
+#ifdef WEBSOCKET_POOL
+  else if (!webSocket_borrowWriteData(payload_length))
+  {
+    WEB_SOCKET_STATS_COUNT(send_dropped);
+    return false;
+  }
+#endif // WEBSOCKET_POOL
+  else
+  {
+    WEB_SOCKET_TRACE_BEGIN(WEBSOCKET_TRACE_ENCODE);
+    webSocket_setHeader(opcode, payload_length);
+    webSocket_setPayload(payload, payload_length);
+    WEB_SOCKET_TRACE_END(WEBSOCKET_TRACE_ENCODE);
 
 #ifndef WEBSOCKET_DEBUG
-    webSocket_printWriteData(payload_length); // DEBUG
+    webSocket_printWriteData(); // DEBUG
 #endif // WEBSOCKET_DEBUG
 
     g_is_setSendData = true;
+#ifdef WEBSOCKET_QUEUE
+    webSocket_queueSpool();
+#endif // WEBSOCKET_QUEUE
   }
 
+  return true;
 }
 
-static uint16_t webSocket_getPayloadType(uint16_t payload_length)
+// A ping, pong or close goes to the control slot, so it is neither dropped
+// nor delayed while a data frame is pending.
+static bool webSocket_setControl(const char *payload, uint8_t payload_length,
+                                 uint8_t opcode)
 {
-  uint16_t size = 0;
+  const char *mask = WEB_SOCKET_IS_MASK() ? g_webSocketFrameMask : NULL;
+  uint8_t header_length = 0;
 
-  if (payload_length <= WEB_SOCKET_PAYLOAD_TYPE1)
+  if (g_is_setControlData)
   {
-    size = 0;
+    WEB_SOCKET_STATS_COUNT(send_dropped);
+    return false;
+  }
+
+  if ((opcode == OPCODE_FRAME_PING)
+      && (payload_length == WEB_SOCKET_PING_PAYLOAD_SIZE))
+  {
+    header_length = webSocket_frameStoreConst((uint8_t *) g_webSocketControlData,
+                                              g_pingHeader[mask != NULL],
+                                              (const uint8_t *) mask);
   }
-  else if (payload_length <= WEB_SOCKET_PAYLOAD_TYPE2)
+  else if ((opcode == OPCODE_FRAME_CLOSE) && (payload_length == 0))
   {
-    size = 2;
+    header_length = webSocket_frameStoreConst((uint8_t *) g_webSocketControlData,
+                                              g_closeHeader[mask != NULL],
+                                              (const uint8_t *) mask);
+  }
+  else if ((opcode == OPCODE_FRAME_CLOSE) && (payload_length == 2))
+  {
+    header_length = webSocket_frameStoreConst((uint8_t *) g_webSocketControlData,
+                                              g_closeCodeHeader[mask != NULL],
+                                              (const uint8_t *) mask);
+  }
+  else
+  {
+    header_length = webSocket_frameEncodeHeader((uint8_t *) g_webSocketControlData,
+                                                true, 0, opcode,
+                                                (const uint8_t *) mask,
+                                                payload_length);
+  }
+
+  for (uint8_t i = 0; i < payload_length; i++)
+  {
+    g_webSocketControlData[header_length + i] =
+      payload[i] ^ ((mask != NULL) ? mask[i & (WEB_SOCKET_MASK_KEY_SIZE - 1)] : 0);
+  }
+
+  if (mask != NULL)
+  {
+    g_is_sendMaskRefresh = false;
   }
 
-  return size;
+  g_controlOpcode = opcode;
+  g_controlPayloadLength = payload_length;
+  g_controlFrameLength = header_length + payload_length;
+  g_is_setControlData = true;
+
+  return true;
 }
 
-static void webSocket_setPayload(const char *payload, uint16_t payload_length, uint8_t payload_option)
+// Returns the payload area of the send buffer to build a frame in place,
+// NULL while the previous frame is not sent yet. Finish with
+// webSocket_commitFrame() before the next webSocket_handle(). With
+// WEBSOCKET_POOL a nonzero *capacity asks for that many bytes only, so a
+// smaller block will do.
+char *webSocket_beginFrame(uint16_t *capacity)
 {
-  if (payload_length && payload != NULL)
+  if (webSocket_isSendBusy())
+  {
+    WEB_SOCKET_STATS_COUNT(send_dropped);
+    *capacity = 0;
+    return NULL;
+  }
+
+#ifdef WEBSOCKET_POOL
+  if (!webSocket_borrowWriteData(((*capacity > 0)
+                                  && (*capacity < WEB_SOCKET_SEND_PAYLOAD_SIZE))
+                                 ? *capacity : WEB_SOCKET_SEND_PAYLOAD_SIZE))
   {
-    uint8_t mask_index = 0;
+    WEB_SOCKET_STATS_COUNT(send_dropped);
+    *capacity = 0;
+    return NULL;
+  }
+
+  *capacity = webSocket_poolGetSize(g_webSocketWriteData)
+              - WEB_SOCKET_FRAME_HEADER16_MAX;
+
+  if (*capacity > WEB_SOCKET_SEND_PAYLOAD_SIZE)
+  {
+    *capacity = WEB_SOCKET_SEND_PAYLOAD_SIZE;
+  }
+#else
+  *capacity = WEB_SOCKET_SEND_PAYLOAD_SIZE;
+#endif // WEBSOCKET_POOL
+
+  return &g_webSocketWriteData[WEB_SOCKET_FRAME_HEADER16_MAX];
+}
+
+// Drops the frame started by webSocket_beginFrame() and, with the pool,
+// gives its block back. Does nothing while a frame is pending.
+void webSocket_cancelFrame(void)
+{
+  if (webSocket_isSendBusy())
+  {
+    return;
+  }
+
+#ifdef WEBSOCKET_POOL
+  webSocket_returnWriteData();
+#endif // WEBSOCKET_POOL
+}
+
+// Queues a complete frame (header, mask key and masked payload) that lives
+// outside the send buffer. It is written as is, so the caller must leave it
+// unchanged while webSocket_isSendBusy().
+bool webSocket_sendFrame(const char *frame, uint16_t frame_length,
+                         uint8_t opcode, uint16_t payload_length)
+{
+  if (webSocket_isSendBusy())
+  {
+    WEB_SOCKET_STATS_COUNT(send_dropped);
+    return false;
+  }
+
+  g_sendFrame = frame;
+  g_sendOpcode = opcode;
+  g_sendPayloadLength = payload_length;
+  g_sendFrameOffset = 0;
+  g_sendFrameLength = frame_length;
+
+  if (WEB_SOCKET_IS_MASK())
+  {
+    g_is_sendMaskRefresh = false;
+  }
+
+  g_is_setSendData = true;
+#ifdef WEBSOCKET_QUEUE
+  webSocket_queueSpool();
+#endif // WEBSOCKET_QUEUE
+
+  return true;
+}
+
+// key the next frame will be masked with, false when frames are not masked
+bool webSocket_getSendMask(uint8_t *mask)
+{
+  memcpy(mask, g_webSocketFrameMask, WEB_SOCKET_MASK_KEY_SIZE);
+
+  return WEB_SOCKET_IS_MASK();
+}
+
+// writes the header in front of the payload built in place and masks it
+bool webSocket_commitFrame(uint16_t payload_length, uint8_t opcode)
+{
+  if (webSocket_isSendBusy())
+  {
+    return false;
+  }
+
+  if (payload_length > WEB_SOCKET_SEND_PAYLOAD_SIZE)
+  {
+    WEB_SOCKET_STATS_COUNT(payload_oversize);
+    webSocket_cancelFrame();
+    return false;
+  }
+
+#ifdef WEBSOCKET_POOL
+  if ((g_webSocketWriteData == NULL)
+      || (payload_length + WEB_SOCKET_FRAME_HEADER16_MAX
+          > webSocket_poolGetSize(g_webSocketWriteData)))
+  {
+    WEB_SOCKET_STATS_COUNT(payload_oversize);
+    webSocket_cancelFrame();
+    return false; // no webSocket_beginFrame() or beyond its capacity
+  }
+#endif // WEBSOCKET_POOL
+
+  WEB_SOCKET_TRACE_BEGIN(WEBSOCKET_TRACE_ENCODE);
+  webSocket_setHeader(opcode, payload_length);
+
+  if (WEB_SOCKET_IS_MASK() && payload_length)
+  {
+    webSocket_encodeMask(&g_webSocketWriteData[WEB_SOCKET_FRAME_HEADER16_MAX],
+                         payload_length);
+
+    g_is_sendMaskRefresh = false;
+  }
+  WEB_SOCKET_TRACE_END(WEBSOCKET_TRACE_ENCODE);
+
+#ifndef WEBSOCKET_DEBUG
+  webSocket_printWriteData(); // DEBUG
+#endif // WEBSOCKET_DEBUG
+
+  g_is_setSendData = true;
+#ifdef WEBSOCKET_QUEUE
+  webSocket_queueSpool();
+#endif // WEBSOCKET_QUEUE
+
+  return true;
+}
+
+static void webSocket_setHeader(uint8_t opcode, uint16_t payload_length)
+{
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t header_length = 0;
+
+  header_length = webSocket_frameEncodeHeader(
+                    header, true, 0, opcode,
+                    WEB_SOCKET_IS_MASK() ? (const uint8_t *) g_webSocketFrameMask : NULL,
+                    payload_length);
+
+  g_sendOpcode = opcode;
+  g_sendPayloadLength = payload_length;
+  g_sendFrameOffset = WEB_SOCKET_FRAME_HEADER16_MAX - header_length;
+  g_sendFrameLength = header_length + payload_length;
 
-    if (g_is_sendMaskUse)
+  memcpy(&g_webSocketWriteData[g_sendFrameOffset], header, header_length);
+}
+
+static void webSocket_setPayload(const char *payload, uint16_t payload_length)
+{
+  if (payload_length && payload != NULL)
+  {
+    if (WEB_SOCKET_IS_MASK())
     {
-      webSocket_encodeMask(payload, payload_length, payload_option);
+      webSocket_encodeMask(payload, payload_length);
 
       g_is_sendMaskRefresh = false;
     }
     else
     {
-      memcpy(&g_webSocketWriteData[WEB_SOCKET_HEAD_FRAME_SIZE + payload_option],
-             payload, payload_length);
+      memcpy(&g_webSocketWriteData[WEB_SOCKET_FRAME_HEADER16_MAX], payload,
+             payload_length);
     }
   }
 }
 
-static void webSocket_encodeMask(const char *payload, uint16_t payload_length, uint8_t payload_option)
+// payload may point into the send buffer itself (in place masking)
+static void webSocket_encodeMask(const char *payload, uint16_t payload_length)
 {
   uint16_t mask_index = 0;
 
   for (uint16_t i = 0; i < payload_length; i++)
   {
-    g_webSocketWriteData[WEB_SOCKET_HEADER_SIZE + payload_option + i] =
+    g_webSocketWriteData[WEB_SOCKET_FRAME_HEADER16_MAX + i] =
       payload[i] ^ g_webSocketFrameMask[mask_index];
 
     mask_index++;
@@ -460,13 +904,34 @@ static void webSocket_encodeMask(const char *payload, uint16_t payload_length, u
 
 int webSocket_available(void)
 {
-  return g_recivePayloadLength;
+  return g_is_recivePayload ? 0 : g_recivePayloadLength;
+}
+
+// zero copy view of the received payload, valid until webSocket_handle()
+// returns; webSocket_available() bytes long
+const char *webSocket_getPayload(void)
+{
+  return g_webSocketReadPayload;
+}
+
+uint8_t webSocket_getOpcode(void)
+{
+  return g_wsHeaderRecive.opcode;
 }
 
 void webSocket_readBytes(byte *dist, uint16_t payload_length)
 {
-  memcpy(dist, g_webSocketReadPayload, payload_length);
-  g_wsHeaderRecive.data.payload_length = 0;
+  if (payload_length > g_recivePayloadLength)
+  {
+    payload_length = g_recivePayloadLength;
+  }
+
+  if (payload_length)
+  {
+    memcpy(dist, g_webSocketReadPayload, payload_length);
+  }
+
+  g_wsHeaderRecive.payload_length = 0;
   g_recivePayloadLength = 0;
 }
 
@@ -479,6 +944,7 @@ static void webSocket_clear(void)
   g_webSocketHandleTimeOutClose = NULL;
   g_webSocketHandleReceivePong = NULL;
   g_webSocketHandleClose = NULL;
+  g_webSocketHandleResume = NULL;
 
   g_webSocketMode = WEBSOCKET_MODE_SERVER;
   g_webSocketState = WEBSOCET_STATE_NONE;
@@ -488,14 +954,26 @@ static void webSocket_clear(void)
   g_is_sendMaskRefresh = false;
 
   g_handleLength = 0;
+  g_reciveHeaderLength = 0;
   g_sendPayloadLength = 0;
+  g_sendFrameLength = 0;
+  g_sendFrameOffset = 0;
+  g_sendOpcode = 0;
+  g_sendFrame = NULL;
+  g_controlFrameLength = 0;
+  g_controlPayloadLength = 0;
+  g_controlOpcode = 0;
+  g_is_setControlData = false;
   g_recivePayloadLength = 0;
+  g_recivePayloadCount = 0;
+  g_reciveSkipLength = 0;
+  g_is_recivePayload = false;
+#ifdef WEBSOCKET_POOL
+  webSocket_returnWriteData();
+  webSocket_returnReadPayload();
+#endif // WEBSOCKET_POOL
 
-  g_wsHeaderRecive.byte[0] = 0x00;
-  g_wsHeaderRecive.byte[1] = 0x00;
-
-  g_wsHeaderSend.byte[0] = 0x00;
-  g_wsHeaderSend.byte[1] = 0x00;
+  memset(&g_wsHeaderRecive, 0, sizeof(g_wsHeaderRecive));
 
   g_webSocketFrameMask[0] = 0;
   g_webSocketFrameMask[1] = 0;
@@ -505,6 +983,17 @@ static void webSocket_clear(void)
   g_webSocketTimeoutMax = WEB_SOCKET_TIMEOUT_DEFAULT;//msec
   g_webSocketRetryMax = WEB_SOCKET_TIMEOUT_RETRY;
   g_webSocketRetryCount = 0;
+
+  g_webSocketKeepAlive = WEB_SOCKET_TIMEOUT_DEFAULT;//msec
+  g_webSocketSrtt = 0;
+  g_webSocketRttVar = 0;
+  g_pingPayloadLength = 0;
+  g_webSocketPingSent = 0;
+  g_is_pingSent = false;
+#ifdef WEBSOCKET_UTF8_VALIDATE
+  g_is_reciveText = false;
+#endif // WEBSOCKET_UTF8_VALIDATE
+  g_is_reciveInvalid = false;
 }
 
 static void webSocket_timeOutRefresh(void)
@@ -514,7 +1003,15 @@ static void webSocket_timeOutRefresh(void)
 
 static bool webSocket_is_timeOutElapse(void)
 {
-  if (millis() - g_webSocketTimeoutCount >= g_webSocketTimeoutMax)
+  uint32_t timeout = g_webSocketKeepAlive;
+
+  if (g_webSocketRetryCount)
+  {
+    // a ping is outstanding, wait only as long as the link needs
+    timeout = webSocket_getRto();
+  }
+
+  if ((uint32_t)(millis() - g_webSocketTimeoutCount) >= timeout)
   {
     return true;
   }
@@ -536,6 +1033,105 @@ static bool webSocket_is_timeOutRetryOver(void)
   }
 }
 
+static void webSocket_readControlPayload(void)
+{
+  uint32_t timestamp = 0;
+
+  switch (g_wsHeaderRecive.opcode)
+  {
+    case OPCODE_FRAME_PING:
+      g_pingPayloadLength = g_recivePayloadLength;
+
+      if (g_pingPayloadLength > WEB_SOCKET_PAYLOAD_TYPE1)
+      {
+        g_pingPayloadLength = WEB_SOCKET_PAYLOAD_TYPE1;
+      }
+
+      memcpy(g_webSocketPingPayload, g_webSocketReadPayload,
+             g_pingPayloadLength);
+      break;
+    case OPCODE_FRAME_PONG:
+      if (g_recivePayloadLength == WEB_SOCKET_PING_PAYLOAD_SIZE)
+      {
+        timestamp = (((uint32_t)(uint8_t)g_webSocketReadPayload[0]) << 24)
+                    | (((uint32_t)(uint8_t)g_webSocketReadPayload[1]) << 16)
+                    | (((uint32_t)(uint8_t)g_webSocketReadPayload[2]) << 8)
+                    | ((uint32_t)(uint8_t)g_webSocketReadPayload[3]);
+      }
+
+      // an unsolicited pong, or one answering an older ping or a ping
+      // of the sketch, does not tell the link RTT
+      if (g_is_pingSent && (timestamp == g_webSocketPingSent)
+          && (g_recivePayloadLength == WEB_SOCKET_PING_PAYLOAD_SIZE))
+      {
+        g_is_pingSent = false;
+        webSocket_updateRtt(millis() - timestamp);
+        webSocket_updateKeepAlive();
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// Jacobson/Karels estimator, srtt is kept scaled by 8 and rttvar by 4
+static void webSocket_updateRtt(uint32_t rtt)
+{
+  int32_t err = 0;
+
+  if (g_webSocketSrtt == 0)
+  {
+    g_webSocketSrtt = (rtt << 3) | 1;
+    g_webSocketRttVar = rtt << 1;
+  }
+  else
+  {
+    err = (int32_t)rtt - (int32_t)(g_webSocketSrtt >> 3);
+    g_webSocketSrtt += err;
+
+    if (err < 0)
+    {
+      err = -err;
+    }
+
+    err -= (int32_t)(g_webSocketRttVar >> 2);
+    g_webSocketRttVar += err;
+  }
+}
+
+// The interval grows while the first ping is answered, but stays at least
+// WEB_SOCKET_KEEPALIVE_RTO_FACTOR RTOs so a slow link is not flooded with
+// pings, and at most what still detects a dead peer, interval plus all
+// retries, within WEB_SOCKET_KEEPALIVE_MAX.
+static void webSocket_updateKeepAlive(void)
+{
+  uint32_t rto = webSocket_getRto();
+  uint32_t retries = (uint32_t) g_webSocketRetryMax * rto;
+  uint32_t lower = WEB_SOCKET_KEEPALIVE_RTO_FACTOR * rto;
+  uint32_t upper = WEB_SOCKET_TIMEOUT_MIN;
+
+  if (retries + WEB_SOCKET_TIMEOUT_MIN < WEB_SOCKET_KEEPALIVE_MAX)
+  {
+    upper = WEB_SOCKET_KEEPALIVE_MAX - retries;
+  }
+
+  if (g_webSocketRetryCount <= 1)
+  {
+    // the link answers the first ping, ping less often
+    g_webSocketKeepAlive += g_webSocketKeepAlive / 2;
+  }
+
+  if (g_webSocketKeepAlive < lower)
+  {
+    g_webSocketKeepAlive = lower;
+  }
+
+  if (g_webSocketKeepAlive > upper)
+  {
+    g_webSocketKeepAlive = upper;
+  }
+}
+
 //static void webSocket_stop(void)
 //{
 //	if (!(g_webSocketState & WEBSOCET_STATE_CLOSE))
@@ -554,22 +1150,28 @@ static bool webSocket_is_timeOutRetryOver(void)
 //	Serial.println(g_is_webSocketStart); // DEBUG
 //}
 
-static void webSocket_stateControl(WiFiClient client)
+static void webSocket_stateControl(WiFiClient &client)
 {
+  // the header of a frame whose payload is still arriving is not acted on
+  uint8_t opcode = g_is_recivePayload ? (uint8_t) OPCODE_FRAME_CONTINUE
+                   : g_wsHeaderRecive.opcode;
+
+  WEB_SOCKET_TRACE_BEGIN(WEBSOCKET_TRACE_STATE);
+
   switch (g_webSocketState & ~(WEBSOCET_STATE_HANDSHAKE))
   {
     case WEBSOCET_STATE_NONE:
       break;
     case WEBSOCET_STATE_OPEN:
-      webSocket_stateControlOpen();
+      webSocket_stateControlOpen(opcode);
       break;
     case WEBSOCET_STATE_CLOSING:
-      webSocket_stateControlClosing();
+      webSocket_stateControlClosing(opcode);
       break;
     case WEBSOCET_STATE_CLOSE:
       webSocket_handlerWrapper(g_webSocketHandleClose);
       webSocket_clear();
-      client = WiFiClient(); // dissconnect
+      client.stop(); // dissconnect, also a TLS client passed by reference
       break;
     default:
       break;
@@ -580,15 +1182,44 @@ static void webSocket_stateControl(WiFiClient client)
     webSocket_handlerWrapper(g_webSocketHandleRefreshMask);
   }
 
-  webSocket_send(client);
+  WEB_SOCKET_TRACE_END(WEBSOCKET_TRACE_STATE);
 
-  g_wsHeaderRecive.byte[0] = 0;
-  g_wsHeaderRecive.byte[1] = 0;
+#ifdef WEBSOCKET_BATCH
+  if (g_is_webSocketStart)
+  {
+    webSocket_batchPoll();
+  }
+#endif // WEBSOCKET_BATCH
+#ifdef WEBSOCKET_MUX
+  if (g_is_webSocketStart)
+  {
+    webSocket_muxPoll();
+  }
+#endif // WEBSOCKET_MUX
+#ifdef WEBSOCKET_SCHED
+  if (g_is_webSocketStart)
+  {
+    webSocket_schedPoll();
+  }
+#endif // WEBSOCKET_SCHED
+  webSocket_send(client);
+#ifdef WEBSOCKET_QUEUE
+  webSocket_queuePoll();
+  webSocket_queueDrain(client);
+#endif // WEBSOCKET_QUEUE
+#ifdef WEBSOCKET_INGEST
+  webSocket_ingestDrain(client);
+#endif // WEBSOCKET_INGEST
+
+  if (!g_is_recivePayload)
+  {
+    memset(&g_wsHeaderRecive, 0, sizeof(g_wsHeaderRecive));
+  }
 }
 
-static void webSocket_stateControlOpen(void)
+static void webSocket_stateControlOpen(uint8_t opcode)
 {
-  switch (g_wsHeaderRecive.data.opcode)
+  switch (opcode)
   {
     case OPCODE_FRAME_CLOSE:
       g_webSocketState = WEBSOCET_STATE_CLOSING;
@@ -624,9 +1255,9 @@ static void webSocket_stateControlOpen(void)
   }
 }
 
-static void webSocket_stateControlClosing(void)
+static void webSocket_stateControlClosing(uint8_t opcode)
 {
-  switch (g_wsHeaderRecive.data.opcode)
+  switch (opcode)
   {
     case OPCODE_FRAME_CLOSE:
       g_webSocketState |= WEBSOCET_STATE_RECIVE;
@@ -668,126 +1299,580 @@ static void webSocket_stateControlClosing(void)
   }
 }
 
-static void webSocket_send(WiFiClient client)
+static void webSocket_send(WiFiClient &client)
+{
+  if (!client || !g_is_webSocketStart)
+  {
+    return;
+  }
+
+  if (g_is_setControlData)
+  {
+    if ((g_controlOpcode == OPCODE_FRAME_CLOSE) && g_is_setSendData)
+    {
+      // nothing may follow a close: the data frame goes first when the
+      // shaper lets it, otherwise it is dropped
+      webSocket_sendData(client);
+
+      if (g_is_setSendData)
+      {
+        WEB_SOCKET_STATS_COUNT(send_dropped);
+        webSocket_releaseData();
+      }
+    }
+
+    webSocket_sendControl(client);
+  }
+
+  webSocket_sendData(client);
+}
+
+// control frames are never held by the shaper
+static void webSocket_sendControl(WiFiClient &client)
+{
+  WEB_SOCKET_TRACE_BEGIN(WEBSOCKET_TRACE_WRITE);
+  client.write((const char *) g_webSocketControlData, g_controlFrameLength);
+  WEB_SOCKET_TRACE_END(WEBSOCKET_TRACE_WRITE);
+  WEB_SOCKET_RECORD(WEBSOCKET_RECORD_TX, g_webSocketControlData,
+                    g_controlFrameLength);
+  WEB_SOCKET_STATS_FRAME_OUT(g_controlOpcode, g_controlPayloadLength,
+                             g_controlFrameLength);
+  g_is_setControlData = false;
+  webSocket_handlerWrapper(g_webSocketHandleSend);
+}
+
+static void webSocket_sendData(WiFiClient &client)
+{
+  if (!g_is_setSendData)
+  {
+    return;
+  }
+
+#ifdef WEBSOCKET_SHAPER
+  if (!webSocket_shaperAllow(g_sendOpcode, g_sendFrameLength))
+  {
+    return; // stays pending, see webSocket_getSendDelay()
+  }
+#endif // WEBSOCKET_SHAPER
+
+  WEB_SOCKET_TRACE_BEGIN(WEBSOCKET_TRACE_WRITE);
+  client.write((g_sendFrame != NULL) ? g_sendFrame
+               : (const char *) &g_webSocketWriteData[g_sendFrameOffset],
+               g_sendFrameLength);
+  WEB_SOCKET_TRACE_END(WEBSOCKET_TRACE_WRITE);
+  WEB_SOCKET_RECORD(WEBSOCKET_RECORD_TX, (g_sendFrame != NULL) ? g_sendFrame
+                    : (const char *) &g_webSocketWriteData[g_sendFrameOffset],
+                    g_sendFrameLength);
+  WEB_SOCKET_STATS_FRAME_OUT(g_sendOpcode, g_sendPayloadLength,
+                             g_sendFrameLength);
+  webSocket_releaseData();
+  webSocket_handlerWrapper(g_webSocketHandleSend);
+}
+
+// the send buffer is free again
+static void webSocket_releaseData(void)
+{
+  g_is_setSendData = false;
+
+  g_sendOpcode = 0;
+  g_sendFrame = NULL;
+  g_sendFrameOffset = 0;
+  g_sendFrameLength = 0;
+  g_sendPayloadLength = 0;
+#ifdef WEBSOCKET_POOL
+  webSocket_returnWriteData();
+#endif // WEBSOCKET_POOL
+}
+
+#ifdef WEBSOCKET_INGEST
+// One frame per record pushed by an ISR or thread, up to
+// WEB_SOCKET_INGEST_BATCH per handle. Without the offline queue records wait
+// in the ring while the session is down.
+static void webSocket_ingestDrain(WiFiClient &client)
 {
-  uint16 payload_option = 0;
+  const WEB_SOCKET_INGEST_RECORD *record = NULL;
+
+#ifndef WEBSOCKET_QUEUE
+  if (!g_is_webSocketStart)
+  {
+    return;
+  }
+#endif // WEBSOCKET_QUEUE
 
-  payload_option = webSocket_getPayloadType(g_sendPayloadLength);
+  if (g_is_webSocketStart && (g_webSocketState != WEBSOCET_STATE_OPEN))
+  {
+    return;
+  }
 
-  if (client && g_is_webSocketStart && g_is_setSendData)
+  for (uint8_t i = 0; (i < WEB_SOCKET_INGEST_BATCH) && !g_is_setSendData; i++)
   {
-    if (g_is_sendMaskUse)
+    record = webSocket_ingestPeek();
+
+    if (record == NULL)
     {
-      client.write((const char *) g_webSocketWriteData,
-                   WEB_SOCKET_HEADER_SIZE + payload_option
-                   + g_sendPayloadLength);
+      break;
     }
-    else
+
+    // a record not taken (no pool block, the control slot busy) stays in
+    // the ring for the next handle
+    if (!webSocket_setData(record->data, record->length, record->opcode))
     {
-      client.write((const char *) g_webSocketWriteData,
-                   WEB_SOCKET_HEAD_FRAME_SIZE + payload_option
-                   + g_sendPayloadLength);
+      break;
     }
-    g_is_setSendData = false;
 
-    g_wsHeaderSend.byte[0] = 0;
-    g_wsHeaderSend.byte[1] = 0;
-    g_sendPayloadLength = 0;
-    webSocket_handlerWrapper(g_webSocketHandleSend);
+    webSocket_ingestPop();
+    webSocket_send(client);
   }
 }
+#endif // WEBSOCKET_INGEST
 
-static void webSocket_readFrameHeader(WiFiClient client)
+#ifdef WEBSOCKET_QUEUE
+// Moves the data frame just built to the offline queue while the session is
+// down, or while older frames are still queued so the order is kept.
+static void webSocket_queueSpool(void)
 {
-  g_wsHeaderRecive.byte[0] = webSocket_printClientRead(client);
-  g_wsHeaderRecive.byte[1] = webSocket_printClientRead(client);
+  const char *frame = (g_sendFrame != NULL) ? g_sendFrame
+                      : (const char *) &g_webSocketWriteData[g_sendFrameOffset];
+  WEB_SOCKET_FRAME_INFO info;
+  uint8_t header_length = 0;
+
+  if (((g_sendOpcode != OPCODE_FRAME_TEXT)
+       && (g_sendOpcode != OPCODE_FRAME_BINARY)
+       && (g_sendOpcode != OPCODE_FRAME_CONTINUE))
+      || (g_is_webSocketStart && webSocket_queueIsEmpty()))
+  {
+    return;
+  }
 
-  g_recivePayloadLength = g_wsHeaderRecive.data.payload_length;
+  // stored unmasked, the draining session masks it with its own key
+  header_length = webSocket_frameDecodeHeader((const uint8_t *) frame,
+                                              g_sendFrameLength, &info);
 
-  if (g_wsHeaderRecive.data.payload_length == WEB_SOCKET_PAYLOAD_TYPE2_FLAG)
+  if ((header_length != 0) && (header_length != WEB_SOCKET_FRAME_INVALID)
+      && webSocket_queueAppend((uint8_t) frame[0], &frame[info.header_length],
+                               (uint16_t) info.payload_length,
+                               info.masked ? info.mask : NULL))
   {
-    char bit16_high = 0;
-    char bit16_low = 0;
+    webSocket_releaseData();
+  }
+}
 
-    bit16_high  = webSocket_printClientRead(client);
-    bit16_low  = webSocket_printClientRead(client);
+// Sends queued frames while the session is open, whole frames batched into
+// the idle send buffer, up to WEB_SOCKET_QUEUE_BATCH writes per handle.
+static void webSocket_queueDrain(WiFiClient &client)
+{
+  uint16_t count = 0;
+  uint16_t length = 0;
+  uint16_t written = 0;
+#ifdef WEBSOCKET_POOL
+  char *buffer = NULL;
+  uint16_t size = WEB_SOCKET_POOL_FRAME_MAX;
+#else
+  char *buffer = g_webSocketWriteData;
+  uint16_t size = sizeof(g_webSocketWriteData);
+#endif // WEBSOCKET_POOL
+
+  if (!client || !g_is_webSocketStart || g_is_setSendData
+      || (g_webSocketState != WEBSOCET_STATE_OPEN)
+      || webSocket_queueIsEmpty())
+  {
+    return;
+  }
+
+#ifdef WEBSOCKET_POOL
+  buffer = webSocket_poolAlloc(size);
 
-    g_recivePayloadLength = (((uint16_t)bit16_high) << 8) | ((uint16_t)bit16_low);
+  if (buffer == NULL)
+  {
+    return;
   }
+#endif // WEBSOCKET_POOL
 
-  if (g_wsHeaderRecive.data.masked)
+  for (uint8_t i = 0; (i < WEB_SOCKET_QUEUE_BATCH) && !webSocket_queueIsEmpty();
+       i++)
   {
-    if (g_handleLength >= 6)
+    length = webSocket_queueRead(buffer, size,
+                                 WEB_SOCKET_IS_MASK() ? (const uint8_t *) g_webSocketFrameMask
+                                 : NULL, &count);
+
+#ifdef WEBSOCKET_SHAPER
+    length = webSocket_shaperAllowFrames(buffer, length, &count);
+#endif // WEBSOCKET_SHAPER
+
+    if (length == 0)
     {
-      g_webSocketFrameMask[0] = webSocket_printClientRead(client);
-      g_webSocketFrameMask[1] = webSocket_printClientRead(client);
-      g_webSocketFrameMask[2] = webSocket_printClientRead(client);
-      g_webSocketFrameMask[3] = webSocket_printClientRead(client);
+      break;
     }
-    else
+
+    WEB_SOCKET_TRACE_BEGIN(WEBSOCKET_TRACE_WRITE);
+    written = client.write((const char *) buffer, length);
+    WEB_SOCKET_TRACE_END(WEBSOCKET_TRACE_WRITE);
+
+    if (written != length)
     {
-      // error
+      // The stream ends inside a frame and cannot be resumed on this link:
+      // keep what was not written in full and drop the session, the next
+      // one starts again on a frame boundary.
+      webSocket_queueConsume(webSocket_queueCountFrames(buffer, written));
+      WEB_SOCKET_LOG_WARN("queue drain short write %u/%u", written, length);
+      client.stop();
+      webSocket_abort();
+      break;
     }
+
+    webSocket_queueConsume(count);
   }
+
+#ifdef WEBSOCKET_POOL
+  webSocket_poolFree(buffer);
+#endif // WEBSOCKET_POOL
 }
 
-static void webSocket_readFramePayload(WiFiClient client)
+// frames in the first length bytes of buffer written in full
+static uint16_t webSocket_queueCountFrames(const char *buffer, uint16_t length)
 {
-  int c = 0;
-  char b = 0;
-  int mask_index = 0;
-  int payload_count = 0;
+  WEB_SOCKET_FRAME_INFO info;
+  uint16_t offset = 0;
+  uint16_t count = 0;
+  uint8_t header_length = 0;
 
-  while (g_recivePayloadLength > payload_count)
+  while (offset < length)
   {
-    if (client.available() == 0)
+    header_length = webSocket_frameDecodeHeader((const uint8_t *) &buffer[offset],
+                                                length - offset, &info);
+
+    if ((header_length == 0) || (header_length == WEB_SOCKET_FRAME_INVALID)
+        || (offset + info.header_length + info.payload_length > length))
     {
-#ifndef WEBSOCKET_DEBUG
-      Serial.println("PAYLOAD_SIZE MISS MATCH:"); // DEBUG
-#endif // WEBSOCKET_DEBUG
       break;
     }
 
-    c = webSocket_printClientRead(client);
-    b = (char) c;
-    g_webSocketReadPayload[payload_count] = (b
-                                            ^ g_webSocketFrameMask[mask_index]);
+    offset += info.header_length + (uint16_t) info.payload_length;
+    count++;
+  }
 
-    mask_index++;
+  return count;
+}
+#endif // WEBSOCKET_QUEUE
+
+// Returns true once a whole header is decoded. A header split across TCP
+// segments is kept in g_reciveHeader until the rest has arrived.
+static bool webSocket_readFrameHeader(WiFiClient &client)
+{
+  uint8_t header_length = WEB_SOCKET_HEAD_FRAME_SIZE;
+  int read_char = 0;
 
-    if (mask_index >= 4)
+  if (g_reciveHeaderLength >= WEB_SOCKET_HEAD_FRAME_SIZE)
+  {
+    header_length = webSocket_frameHeaderSize(g_reciveHeader[1]);
+  }
+
+  while ((g_reciveHeaderLength < header_length) && (client.available() > 0))
+  {
+    read_char = webSocket_printClientRead(client);
+
+    if (read_char < 0)
     {
-      mask_index = 0;
+      break;
     }
 
-    payload_count++;
+    g_reciveHeader[g_reciveHeaderLength++] = (uint8_t) read_char;
 
-    if (payload_count >= WEB_SOCKET_PAYLOAD_SIZE)
+    if (g_reciveHeaderLength == WEB_SOCKET_HEAD_FRAME_SIZE)
     {
+      header_length = webSocket_frameHeaderSize(g_reciveHeader[1]);
+    }
+  }
+
+  if (g_reciveHeaderLength < header_length)
+  {
+    return false;
+  }
+
+  g_reciveHeaderLength = 0;
+
+  WEB_SOCKET_RECORD(WEBSOCKET_RECORD_RX_HEADER, g_reciveHeader, header_length);
+
+  if (webSocket_frameDecodeHeader(g_reciveHeader, header_length, &g_wsHeaderRecive)
+      == WEB_SOCKET_FRAME_INVALID)
+  {
+    WEB_SOCKET_LOG_WARN("invalid header %02x %02x, closing", g_reciveHeader[0],
+                        g_reciveHeader[1]);
+    webSocket_reciveAbort(client, WEB_SOCKET_CLOSE_PROTOCOL);
+    return false;
+  }
+
+  if (g_wsHeaderRecive.payload_length > WEB_SOCKET_PAYLOAD_TYPE2)
+  {
+    webSocket_reciveTooBig(client);
+    return false;
+  }
+
+  g_recivePayloadLength = (uint16_t) g_wsHeaderRecive.payload_length;
+  webSocket_startFramePayload();
+
+  return true;
+}
+
+// Sets up the payload of the header just decoded: what fits the receive
+// buffer is read, the rest of a larger payload is skipped.
+static void webSocket_startFramePayload(void)
+{
+  uint16_t payload_length = g_recivePayloadLength;
+
+#ifdef WEBSOCKET_UTF8_VALIDATE
+  if (g_wsHeaderRecive.opcode == OPCODE_FRAME_TEXT)
+  {
+    g_is_reciveText = true;
+    webSocket_utf8Reset(&g_webSocketUtf8);
+  }
+  else if (g_wsHeaderRecive.opcode == OPCODE_FRAME_BINARY)
+  {
+    g_is_reciveText = false;
+  }
+#endif // WEBSOCKET_UTF8_VALIDATE
+
+  if (payload_length > WEB_SOCKET_RECIVE_PAYLOAD_SIZE)
+  {
 #ifndef WEBSOCKET_DEBUG
-      Serial.print("PAYLOAD_SIZE OVER:"); // DEBUG
-      Serial.println(payload_count);
+    Serial.print("PAYLOAD_SIZE OVER:"); // DEBUG
+    Serial.println(payload_length);
 #endif // WEBSOCKET_DEBUG
-      break;		// not supported
+    WEB_SOCKET_STATS_COUNT(payload_truncated);
+    WEB_SOCKET_LOG_WARN("payload %u truncated to %u", payload_length,
+                        WEB_SOCKET_RECIVE_PAYLOAD_SIZE);
+    payload_length = WEB_SOCKET_RECIVE_PAYLOAD_SIZE; // not supported
+  }
+
+#ifdef WEBSOCKET_POOL
+  if (payload_length)
+  {
+    g_webSocketReadPayload = webSocket_poolAlloc(payload_length);
+
+    if (g_webSocketReadPayload == NULL)
+    {
+      WEB_SOCKET_STATS_COUNT(payload_truncated);
+      payload_length = 0; // no block free, the payload is skipped
     }
   }
+#endif // WEBSOCKET_POOL
+
+  g_reciveSkipLength = g_recivePayloadLength - payload_length;
+  g_recivePayloadLength = payload_length;
+  g_recivePayloadCount = 0;
 }
-#ifndef WEBSOCKET_DEBUG
-static void webSocket_printWriteData(uint8_t payload_length)
+
+// Reads what has arrived of the payload. Returns true once all of it is
+// read and the rest of a truncated one skipped, so the next header is read
+// in sync however the frame was split across TCP segments.
+static bool webSocket_readFramePayload(WiFiClient &client)
 {
-  Serial.println();
-  int len = 0;
+  int read_length = 0;
+#ifdef WEBSOCKET_UTF8_VALIDATE
+  bool is_validate = g_is_reciveText
+                     && ((g_wsHeaderRecive.opcode == OPCODE_FRAME_TEXT)
+                         || (g_wsHeaderRecive.opcode == OPCODE_FRAME_CONTINUE));
+#endif // WEBSOCKET_UTF8_VALIDATE
+
+  while (g_recivePayloadLength > g_recivePayloadCount)
+  {
+    read_length = client.available();
 
-  if (g_is_sendMaskUse)
+    if (read_length > g_recivePayloadLength - g_recivePayloadCount)
+    {
+      read_length = g_recivePayloadLength - g_recivePayloadCount;
+    }
+
+    if (read_length > 0)
+    {
+      read_length = client.read((uint8_t *) &g_webSocketReadPayload[g_recivePayloadCount],
+                                read_length);
+    }
+
+    if (read_length <= 0)
+    {
+      return false; // the rest comes with a later call
+    }
+
+    WEB_SOCKET_RECORD(WEBSOCKET_RECORD_RX_PAYLOAD,
+                      &g_webSocketReadPayload[g_recivePayloadCount], read_length);
+
+    // unmask and validate each chunk while it is still in cache
+    webSocket_decodeMask(&g_webSocketReadPayload[g_recivePayloadCount], read_length,
+                         g_recivePayloadCount);
+
+#ifdef WEBSOCKET_UTF8_VALIDATE
+    if (is_validate
+        && !webSocket_utf8Validate(&g_webSocketUtf8,
+                                   (const uint8_t *) &g_webSocketReadPayload[g_recivePayloadCount],
+                                   read_length))
+    {
+      g_is_reciveInvalid = true;
+    }
+#endif // WEBSOCKET_UTF8_VALIDATE
+
+    g_recivePayloadCount += read_length;
+  }
+
+  if (!webSocket_skipPayload(client))
   {
-    len = WEB_SOCKET_HEADER_SIZE + payload_length;
+    return false;
   }
-  else
+
+#ifdef WEBSOCKET_UTF8_VALIDATE
+  if (is_validate && g_wsHeaderRecive.fin)
+  {
+    // a truncated message may legitimately end inside a code point
+    if ((g_recivePayloadLength == g_wsHeaderRecive.payload_length)
+        && !webSocket_utf8IsComplete(&g_webSocketUtf8))
+    {
+      g_is_reciveInvalid = true;
+    }
+
+    g_is_reciveText = false;
+  }
+#endif // WEBSOCKET_UTF8_VALIDATE
+
+  g_is_recivePayload = false;
+  g_recivePayloadCount = 0;
+
+  return true;
+}
+
+// skips the rest of a truncated payload, true once it is all gone
+static bool webSocket_skipPayload(WiFiClient &client)
+{
+  uint8_t scratch[32];
+  int read_length = 0;
+
+  while (g_reciveSkipLength)
+  {
+    read_length = client.available();
+
+    if (read_length > (int) sizeof(scratch))
+    {
+      read_length = sizeof(scratch);
+    }
+
+    if (read_length > g_reciveSkipLength)
+    {
+      read_length = g_reciveSkipLength;
+    }
+
+    if (read_length > 0)
+    {
+      read_length = client.read(scratch, read_length);
+    }
+
+    if (read_length <= 0)
+    {
+      return false;
+    }
+
+    WEB_SOCKET_RECORD(WEBSOCKET_RECORD_RX_PAYLOAD, scratch, read_length);
+    g_reciveSkipLength -= read_length;
+  }
+
+  return true;
+}
+
+#ifdef WEBSOCKET_POOL
+// a send block of at least payload_length, the held one when it is enough
+static bool webSocket_borrowWriteData(uint16_t payload_length)
+{
+  if ((g_webSocketWriteData != NULL)
+      && (webSocket_poolGetSize(g_webSocketWriteData)
+          >= WEB_SOCKET_FRAME_HEADER16_MAX + payload_length))
   {
-    len = WEB_SOCKET_HEAD_FRAME_SIZE + payload_length;
+    return true;
   }
 
-  for (int i = 0; i < len; i++)
+  webSocket_returnWriteData();
+  g_webSocketWriteData = webSocket_poolAlloc(WEB_SOCKET_FRAME_HEADER16_MAX
+                                             + payload_length);
+
+  return g_webSocketWriteData != NULL;
+}
+
+static void webSocket_returnWriteData(void)
+{
+  if (g_webSocketWriteData != NULL)
+  {
+    webSocket_poolFree(g_webSocketWriteData);
+    g_webSocketWriteData = NULL;
+  }
+}
+
+static void webSocket_returnReadPayload(void)
+{
+  if (g_webSocketReadPayload != NULL)
+  {
+    webSocket_poolFree(g_webSocketReadPayload);
+    g_webSocketReadPayload = NULL;
+    g_recivePayloadLength = 0;
+  }
+}
+#endif // WEBSOCKET_POOL
+
+static void webSocket_decodeMask(char *payload, uint16_t payload_length, uint16_t offset)
+{
+  for (uint16_t i = 0; i < payload_length; i++)
+  {
+    payload[i] ^= g_wsHeaderRecive.mask[(offset + i) & (WEB_SOCKET_MASK_KEY_SIZE - 1)];
+  }
+}
+
+// invalid UTF-8 in a text message: drop it and close with 1007
+static void webSocket_reciveInvalid(void)
+{
+  g_is_reciveInvalid = false;
+  g_recivePayloadLength = 0;
+  WEB_SOCKET_STATS_COUNT(payload_invalid);
+#ifndef WEBSOCKET_DEBUG
+  Serial.println("RECIVE: INVALID UTF-8"); // DEBUG
+#endif // WEBSOCKET_DEBUG
+
+  if (g_webSocketState == WEBSOCET_STATE_OPEN)
+  {
+    g_webSocketState = WEBSOCET_STATE_CLOSING;
+    webSocket_sendCloseCode(WEB_SOCKET_CLOSE_INVALID_PAYLOAD);
+  }
+}
+
+// A 64-bit length cannot be skipped with the 16-bit counters, and what is
+// left of the frame would be parsed as headers. Close with 1009 and drop
+// the link instead.
+static void webSocket_reciveTooBig(WiFiClient &client)
+{
+  WEB_SOCKET_STATS_COUNT(payload_truncated);
+  WEB_SOCKET_LOG_WARN("payload %u KiB too big, closing",
+                      (uint32_t)(g_wsHeaderRecive.payload_length >> 10));
+#ifndef WEBSOCKET_DEBUG
+  Serial.println("RECIVE: PAYLOAD TOO BIG"); // DEBUG
+#endif // WEBSOCKET_DEBUG
+
+  webSocket_reciveAbort(client, WEB_SOCKET_CLOSE_TOO_BIG);
+}
+
+// the stream cannot be parsed any further, close with code and drop it
+static void webSocket_reciveAbort(WiFiClient &client, uint16_t code)
+{
+  g_recivePayloadLength = 0;
+
+  if (g_webSocketState == WEBSOCET_STATE_OPEN)
+  {
+    webSocket_sendCloseCode(code);
+    webSocket_send(client);
+  }
+
+  g_webSocketState = WEBSOCET_STATE_CLOSE;
+}
+#ifndef WEBSOCKET_DEBUG
+static void webSocket_printWriteData(void)
+{
+  Serial.println();
+
+  for (int i = g_sendFrameOffset; i < g_sendFrameOffset + g_sendFrameLength; i++)
   {
     Serial.print(g_webSocketWriteData[i], HEX);
     Serial.print(", ");
@@ -894,7 +1979,7 @@ void webSocket_Hash_Key(String h_req_key, char* h_resp_key)
 }
 
 
-static int webSocket_printClientRead(WiFiClient client)
+static int webSocket_printClientRead(WiFiClient &client)
 {
   int read_char = 0;
 
@@ -914,14 +1999,14 @@ static int webSocket_printClientRead(WiFiClient client)
 static void webSocket_printFrameHeader(void)
 {
   Serial.print("FIN: ");
-  Serial.print(g_wsHeaderRecive.data.fin, HEX);
+  Serial.print(g_wsHeaderRecive.fin, HEX);
   Serial.println(" ");
 
   Serial.print("OPCODE: ");
-  Serial.print(g_wsHeaderRecive.data.opcode, HEX);
+  Serial.print(g_wsHeaderRecive.opcode, HEX);
   Serial.print(" ");
 
-  switch (g_wsHeaderRecive.data.opcode)
+  switch (g_wsHeaderRecive.opcode)
   {
     case OPCODE_FRAME_CONTINUE:
       Serial.print("OPCODE_FRAME_CONTINUE");
@@ -947,42 +2032,36 @@ static void webSocket_printFrameHeader(void)
   }
   Serial.println();
 
-  if (g_wsHeaderRecive.data.payload_length <= WEB_SOCKET_PAYLOAD_TYPE1)
+  if (g_wsHeaderRecive.length_field <= WEB_SOCKET_PAYLOAD_TYPE1)
   {
     Serial.print("PAYLOAD_LENGTH: ");
-    Serial.println(g_wsHeaderRecive.data.payload_length, DEC);
+    Serial.println(g_wsHeaderRecive.length_field, DEC);
   }
-  else if  (g_wsHeaderRecive.data.payload_length == WEB_SOCKET_PAYLOAD_TYPE2_FLAG)
+  else
   {
     Serial.print("PAYLOAD_LENGTH: ");
-    Serial.print(g_wsHeaderRecive.data.payload_length, DEC);
+    Serial.print(g_wsHeaderRecive.length_field, DEC);
     Serial.print(": ");
     Serial.println(g_recivePayloadLength, DEC);
   }
 
   Serial.print("MASK: ");
-  Serial.println(g_wsHeaderRecive.data.masked, DEC);
+  Serial.println(g_wsHeaderRecive.masked, DEC);
 
   Serial.print("len ");
   Serial.println(g_handleLength, DEC);
 
-  Serial.print("0x");
-  Serial.print(g_wsHeaderRecive.byte[0], HEX);
-  Serial.print(", 0x");
-  Serial.print(g_wsHeaderRecive.byte[1], HEX);
-  Serial.println();
-
-  if (g_wsHeaderRecive.data.masked)
+  if (g_wsHeaderRecive.masked)
   {
     Serial.print("MASK_DATA: ");
     Serial.print("0x");
-    Serial.print(g_webSocketFrameMask[0], HEX);
+    Serial.print(g_wsHeaderRecive.mask[0], HEX);
     Serial.print(", 0x");
-    Serial.print(g_webSocketFrameMask[1], HEX);
+    Serial.print(g_wsHeaderRecive.mask[1], HEX);
     Serial.print(", 0x");
-    Serial.print(g_webSocketFrameMask[2], HEX);
+    Serial.print(g_wsHeaderRecive.mask[2], HEX);
     Serial.print(", 0x");
-    Serial.print(g_webSocketFrameMask[3], HEX);
+    Serial.print(g_wsHeaderRecive.mask[3], HEX);
     Serial.println();
   }
 }
@@ -990,7 +2069,7 @@ static void webSocket_printFrameHeader(void)
 static void webSocket_printFramePayload(void)
 {
   Serial.print("PAYLOAD: ");
-  Serial.println(g_wsHeaderRecive.data.payload_length, DEC);
+  Serial.println(g_recivePayloadLength, DEC);
 
   for (int i = 0; i < g_recivePayloadLength; i++)
   {
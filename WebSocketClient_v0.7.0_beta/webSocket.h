@@ -14,16 +14,57 @@
 #define WEBSOCKET_H_
 
 #include "WiFiClient.h"
+#include "webSocketConfig.h"
+#include "webSocketFrame.h"
 
 #define WEB_SOCKET_PAYLOAD_TYPE1		125u
 
 #define WEB_SOCKET_PAYLOAD_TYPE2_FLAG	126u
 #define WEB_SOCKET_PAYLOAD_TYPE2		65535u
 
-#define WEB_SOCKET_PAYLOAD_SIZE			(WIFICLIENT_MAX_PACKET_SIZE / 2)
+#define WEB_SOCKET_PAYLOAD_SIZE			WEB_SOCKET_RECIVE_PAYLOAD_SIZE
 #define WEB_SOCKET_TIMEOUT_RETRY		3u
 #define WEB_SOCKET_TIMEOUT_MIN			1000u//msec
 #define WEB_SOCKET_TIMEOUT_DEFAULT		2000u//msec
+#define WEB_SOCKET_KEEPALIVE_MAX		30000u//msec
+#define WEB_SOCKET_RTO_MIN				200u//msec
+#define WEB_SOCKET_RTO_MAX				10000u//msec
+#define WEB_SOCKET_KEEPALIVE_RTO_FACTOR	4u
+#define WEB_SOCKET_PING_PAYLOAD_SIZE	4u
+
+#define WEB_SOCKET_CLOSE_NORMAL			1000u
+#define WEB_SOCKET_CLOSE_PROTOCOL		1002u
+#define WEB_SOCKET_CLOSE_INVALID_PAYLOAD	1007u
+#define WEB_SOCKET_CLOSE_TOO_BIG		1009u
+
+enum webSocetFrameOpcode {
+  OPCODE_FRAME_CONTINUE = 0x00,
+  OPCODE_FRAME_TEXT = 0x01,
+  OPCODE_FRAME_BINARY = 0x02,
+  OPCODE_FRAME_RSV1 = 0x03,
+  OPCODE_FRAME_RSV2 = 0x04,
+  OPCODE_FRAME_RSV3 = 0x05,
+  OPCODE_FRAME_RSV4 = 0x06,
+  OPCODE_FRAME_RSV5 = 0x07,
+  OPCODE_FRAME_CLOSE = 0x08,
+  OPCODE_FRAME_PING = 0x09,
+  OPCODE_FRAME_PONG = 0x0A,
+  OPCODE_FRAME_RSV8 = 0x0B,
+  OPCODE_FRAME_RSV9 = 0x0C,
+  OPCODE_FRAME_RSV10 = 0x0D,
+  OPCODE_FRAME_RSV11 = 0x0E,
+  OPCODE_FRAME_RSV12 = 0x0F
+};
+
+// first payload byte of the library's own binary messages
+#define WEB_SOCKET_BINARY_TAG			0xC1u
+
+enum webSocketBinaryType {
+  WEBSOCKET_BINARY_STATS = 0x01,
+  WEBSOCKET_BINARY_BATCH,
+  WEBSOCKET_BINARY_MUX,
+  WEBSOCKET_BINARY_MUX_CREDIT
+};
 
 enum webSocketMode {
   WEBSOCKET_MODE_SERVER = 0,
@@ -39,7 +80,8 @@ enum webSocketHandlerType {
   WEBSOCKET_HANDLER_PING_RECIVE,
   WEBSOCKET_HANDLER_PONG_RECIVE,
   WEBSOCKET_HANDLER_CLOSE,
-  WEBSOCKET_HANDLER_MASK_REFRESH
+  WEBSOCKET_HANDLER_MASK_REFRESH,
+  WEBSOCKET_HANDLER_RESUME
 };
 
 typedef void (*webSocketHandler)(void);
@@ -54,19 +96,39 @@ extern void webSocket_setTimeOutRetryMax(uint8_t max);
 extern void webSocket_setTimeOutRetryCount(uint8_t count);
 extern uint8_t webSocket_getTimeOutRetryMax(void);
 extern uint8_t webSocket_getTimeOutRetryCount(void);
+extern uint32_t webSocket_getRtt(void);
+extern uint32_t webSocket_getRttVar(void);
+extern uint32_t webSocket_getRto(void);
+extern uint32_t webSocket_getKeepAliveInterval(void);
 extern bool webSocket_isStart(void);
-extern void webSocket_handle(WiFiClient client);
+extern void webSocket_abort(void);
+// Takes the client by reference since wss:// (0.7.0), so a TLS client is not
+// sliced down to its TCP socket. Callers that passed a temporary, such as
+// webSocket_handle(server.available()) or a function returning WiFiClient
+// by value, no longer compile: keep the client in a variable that outlives
+// the session and pass that.
+extern void webSocket_handle(WiFiClient &client);
 extern void webSocket_sendPong(void);
 extern void webSocket_sendPing(void);
 extern void webSocket_sendClose(void);
+extern void webSocket_sendCloseCode(uint16_t code);
 extern void webSocket_setData(String sendString);
-extern void webSocket_setData(const char *payload, uint16_t payload_length,
+extern bool webSocket_setData(const char *payload, uint16_t payload_length,
                               uint8_t opcode);
+extern char *webSocket_beginFrame(uint16_t *capacity);
+extern bool webSocket_commitFrame(uint16_t payload_length, uint8_t opcode);
+extern void webSocket_cancelFrame(void);
+extern bool webSocket_sendFrame(const char *frame, uint16_t frame_length,
+                                uint8_t opcode, uint16_t payload_length);
+extern bool webSocket_getSendMask(uint8_t *mask);
 extern void webSocket_setUseMask(bool flag);
 extern void webSocket_setRefreshMask(byte mask1, byte mask2, byte mask3,
                                      byte mask4);
 extern bool webSocket_isSendBusy(void);
+extern uint32_t webSocket_getSendDelay(void);
 extern int webSocket_available(void);
+extern const char *webSocket_getPayload(void);
+extern uint8_t webSocket_getOpcode(void);
 extern void webSocket_readBytes(byte *dist, uint16_t payload_length);
 extern void webSocket_Hash_Key(String h_req_key, char* h_resp_key);
 
@@ -0,0 +1,133 @@
+/*
+ * @file    webSocketBatch.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include "webSocketBatch.h"
+
+#ifdef WEBSOCKET_BATCH
+
+// channel, time delta and value delta as 5 byte varints at most
+#define WEB_SOCKET_BATCH_SAMPLE_MAX		(1u + 5u + 5u)
+#define WEB_SOCKET_BATCH_HEADER_MAX		(3u + 5u)
+
+static_assert(WEB_SOCKET_BATCH_SIZE <= WEB_SOCKET_SEND_PAYLOAD_SIZE,
+              "a batch must fit the send buffer");
+
+static uint16_t webSocket_batchPutVarint(uint16_t index, uint32_t value);
+
+static char g_batchBuffer[WEB_SOCKET_BATCH_SIZE];
+static uint16_t g_batchLength = 0;
+static uint16_t g_batchCount = 0;
+static uint32_t g_batchFirstTime = 0;//msec
+static uint32_t g_batchLastTime = 0;//msec
+static int32_t g_batchLastValue[WEB_SOCKET_BATCH_CHANNELS];
+
+bool webSocket_batchAdd(uint8_t channel, int32_t value)
+{
+  return webSocket_batchAddAt(channel, value, millis());
+}
+
+// Adds one sample, flushing first when it may not fit. Returns false when
+// the channel is out of range or the full batch could not be sent.
+bool webSocket_batchAddAt(uint8_t channel, int32_t value, uint32_t timestamp)
+{
+  uint32_t delta = 0;
+
+  if (channel >= WEB_SOCKET_BATCH_CHANNELS)
+  {
+    return false;
+  }
+
+  if ((g_batchLength + WEB_SOCKET_BATCH_SAMPLE_MAX > WEB_SOCKET_BATCH_SIZE)
+      && !webSocket_batchFlush())
+  {
+    return false;
+  }
+
+  if (g_batchCount == 0)
+  {
+    g_batchBuffer[0] = (char) WEB_SOCKET_BINARY_TAG;
+    g_batchBuffer[1] = (char) WEBSOCKET_BINARY_BATCH;
+    g_batchBuffer[2] = (char) WEB_SOCKET_BATCH_VERSION;
+    g_batchLength = webSocket_batchPutVarint(3, timestamp);
+    g_batchFirstTime = timestamp;
+    g_batchLastTime = timestamp;
+    memset(g_batchLastValue, 0, sizeof(g_batchLastValue));
+  }
+
+  // zigzag: small negative and positive deltas both stay short
+  delta = (uint32_t) value - (uint32_t) g_batchLastValue[channel];
+  delta = (delta << 1) ^ (uint32_t)((int32_t) delta >> 31);
+
+  g_batchLength = webSocket_batchPutVarint(g_batchLength, channel);
+  g_batchLength = webSocket_batchPutVarint(g_batchLength,
+                  timestamp - g_batchLastTime);
+  g_batchLength = webSocket_batchPutVarint(g_batchLength, delta);
+
+  g_batchLastTime = timestamp;
+  g_batchLastValue[channel] = value;
+  g_batchCount++;
+
+  return true;
+}
+
+// Sends the samples collected so far as one binary frame.
+bool webSocket_batchFlush(void)
+{
+  if (g_batchCount == 0)
+  {
+    return true;
+  }
+
+  if (webSocket_isSendBusy())
+  {
+    return false;
+  }
+
+  webSocket_setData(g_batchBuffer, g_batchLength, OPCODE_FRAME_BINARY);
+
+  g_batchLength = 0;
+  g_batchCount = 0;
+
+  return true;
+}
+
+// called by webSocket_handle(), flushes a batch older than WEB_SOCKET_BATCH_AGE
+void webSocket_batchPoll(void)
+{
+  if (g_batchCount && (millis() - g_batchFirstTime >= WEB_SOCKET_BATCH_AGE))
+  {
+    webSocket_batchFlush();
+  }
+}
+
+uint16_t webSocket_batchGetCount(void)
+{
+  return g_batchCount;
+}
+
+static uint16_t webSocket_batchPutVarint(uint16_t index, uint32_t value)
+{
+  do
+  {
+    g_batchBuffer[index] = (char)(value & 0x7F);
+    value >>= 7;
+
+    if (value)
+    {
+      g_batchBuffer[index] |= 0x80;
+    }
+
+    index++;
+  } while (value);
+
+  return index;
+}
+
+#endif // WEBSOCKET_BATCH
@@ -0,0 +1,48 @@
+/*
+ * @file    webSocketBatch.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_BATCH_H_
+#define WEBSOCKET_BATCH_H_
+
+#include "webSocket.h"
+
+// Batches timestamped samples into one binary frame:
+//
+//   [0xC1][WEBSOCKET_BINARY_BATCH][version][time of the first sample]
+//   then per sample [channel][time delta][zigzag value delta]
+//
+// every number a LEB128 varint. Time deltas are to the previous sample of
+// the frame, value deltas to the previous sample of the same channel (0 for
+// the first one), so each frame decodes on its own. A slowly changing
+// sensor costs 3 to 4 bytes per sample instead of a JSON frame.
+
+#define WEB_SOCKET_BATCH_VERSION		1u
+
+#ifndef WEB_SOCKET_BATCH_SIZE
+#define WEB_SOCKET_BATCH_SIZE			256u  // frame payload, at most WEB_SOCKET_SEND_PAYLOAD_SIZE
+#endif
+#ifndef WEB_SOCKET_BATCH_AGE
+#define WEB_SOCKET_BATCH_AGE			1000u//msec
+#endif
+#ifndef WEB_SOCKET_BATCH_CHANNELS
+#define WEB_SOCKET_BATCH_CHANNELS		8u
+#endif
+
+#ifdef WEBSOCKET_BATCH
+
+extern bool webSocket_batchAdd(uint8_t channel, int32_t value);
+extern bool webSocket_batchAddAt(uint8_t channel, int32_t value,
+                                 uint32_t timestamp);
+extern bool webSocket_batchFlush(void);
+extern void webSocket_batchPoll(void);
+extern uint16_t webSocket_batchGetCount(void);
+
+#endif // WEBSOCKET_BATCH
+
+#endif /* WEBSOCKET_BATCH_H_ */
@@ -0,0 +1,104 @@
+/*
+ * @file    webSocketConfig.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_CONFIG_H_
+#define WEBSOCKET_CONFIG_H_
+
+// Build options of the WebSocket engine.
+// Comment out a switch to remove the feature (code and RAM) from the build.
+
+#define WEBSOCKET_STATS
+//#define WEBSOCKET_TRACE
+#define WEBSOCKET_UTF8_VALIDATE
+
+// Offline queue (webSocketQueue.h): data frames built while the session is
+// down are kept and sent after the reconnect. On the device it takes
+// WEB_SOCKET_QUEUE_SECTORS flash sectors at WEB_SOCKET_QUEUE_FLASH_ADDRESS,
+// the SPIFFS area unless defined, so SPIFFS cannot be used with it.
+//#define WEBSOCKET_QUEUE
+
+// Ring for records pushed from an ISR or another thread (webSocketIngest.h),
+// drained into frames by webSocket_handle().
+//#define WEBSOCKET_INGEST
+
+// Sample batching (webSocketBatch.h): timestamped samples are delta encoded
+// into one binary frame, sent when full or WEB_SOCKET_BATCH_AGE old.
+//#define WEBSOCKET_BATCH
+
+// Logical channels with credit flow control inside binary frames
+// (webSocketMux.h), one connection and keepalive for several streams.
+//#define WEBSOCKET_MUX
+
+// Frame level traffic recorder and replay client (webSocketRecord.h,
+// webSocketReplay.h) to turn captured traffic into repeatable runs.
+//#define WEBSOCKET_RECORD
+
+// Token bucket send shaper (webSocketShaper.h), byte and frame budgets for
+// text and binary frames; control frames are exempt.
+//#define WEBSOCKET_SHAPER
+
+// Priority and expiry outbound scheduler (webSocketSched.h), expired
+// messages are dropped without being sent.
+//#define WEBSOCKET_SCHED
+
+// Fixed block pool (webSocketPool.h): receive and send buffers are borrowed
+// per frame from size classes instead of being reserved for good.
+//#define WEBSOCKET_POOL
+
+// Endpoint list with latency based failover and a warm standby
+// (webSocketEndpoint.h), used instead of webSocketReconnect.
+//#define WEBSOCKET_ENDPOINT
+
+// Leveled logging into a deferred ring (webSocketLog.h), printed by
+// webSocket_logDrain(). Calls above WEB_SOCKET_LOG_LEVEL compile out.
+//#define WEBSOCKET_LOG
+//#define WEB_SOCKET_LOG_LEVEL	WEB_SOCKET_LOG_LEVEL_INFO
+
+// Device side server for a few local clients such as a browser dashboard
+// (webSocketServer.h), next to the webSocket_handle() session.
+//#define WEBSOCKET_SERVER
+
+// wss:// in wsHTTPClient, needs the BearSSL core (2.5.0 or later). TLS
+// record buffers default to 1024 bytes each instead of 16k + 512.
+//#define WEBSOCKET_TLS
+#ifndef WEB_SOCKET_TLS_RECV_SIZE
+#define WEB_SOCKET_TLS_RECV_SIZE		1024
+#endif
+#ifndef WEB_SOCKET_TLS_XMIT_SIZE
+#define WEB_SOCKET_TLS_XMIT_SIZE		1024
+#endif
+
+// Payload buffer sizes in bytes, e.g. 256 on a sensor node, 16384 on a
+// gateway. The send size is limited to 65535 (16 bit length form).
+#ifndef WEB_SOCKET_RECIVE_PAYLOAD_SIZE
+#define WEB_SOCKET_RECIVE_PAYLOAD_SIZE	(WIFICLIENT_MAX_PACKET_SIZE / 2)
+#endif
+#ifndef WEB_SOCKET_SEND_PAYLOAD_SIZE
+#define WEB_SOCKET_SEND_PAYLOAD_SIZE	(WIFICLIENT_MAX_PACKET_SIZE / 2)
+#endif
+
+// Message templates (webSocketTemplate.h): number of templates, bytes of
+// each pre-serialized body and patchable slots per template.
+#ifndef WEB_SOCKET_TEMPLATE_MAX
+#define WEB_SOCKET_TEMPLATE_MAX			4
+#endif
+#ifndef WEB_SOCKET_TEMPLATE_SIZE
+#define WEB_SOCKET_TEMPLATE_SIZE		128
+#endif
+#ifndef WEB_SOCKET_TEMPLATE_SLOT_MAX
+#define WEB_SOCKET_TEMPLATE_SLOT_MAX	4
+#endif
+
+// Fix the role and the mask policy at compile time. webSocket_setMode() and
+// webSocket_setUseMask() are ignored and the branches of the other role or
+// policy compile out. Leave undefined to select them at runtime.
+//#define WEBSOCKET_ROLE	WEBSOCKET_MODE_CLIENT
+//#define WEBSOCKET_MASK	true
+
+#endif /* WEBSOCKET_CONFIG_H_ */
@@ -0,0 +1,749 @@
+/*
+ * @file    webSocketCoro.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include "webSocketCoro.h"
+
+#if !defined(ARDUINO) && defined(__linux__) && (__cplusplus >= 202002L)
+
+#include <errno.h>
+#include <exception>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define WEB_SOCKET_CORO_HEADER_MAX		8192u  // upgrade response
+
+static const char g_coroBase64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+void webSocketTask::promise_type::unhandled_exception() noexcept
+{
+    std::terminate();
+}
+
+webSocketLoop::webSocketLoop()
+{
+    _epoll = epoll_create1(EPOLL_CLOEXEC);
+    _random = std::random_device()() | 1u;
+}
+
+webSocketLoop::~webSocketLoop()
+{
+    if(_epoll >= 0) {
+        ::close(_epoll);
+    }
+}
+
+/**
+ * resumes coroutines until stop() or until no session is left
+ */
+void webSocketLoop::run(void)
+{
+    _stop = false;
+
+    while(!_stop && _sessions > 0 && _epoll >= 0) {
+        _eventCount = epoll_wait(_epoll, _events, WEB_SOCKET_CORO_EVENTS,
+                                 _posted.empty() ? -1 : 0);
+
+        if(_eventCount < 0) {
+            _eventCount = 0;
+            if(errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        // a resumed coroutine may destroy any session, forget() clears
+        // its pending events
+        for(_eventIndex = 0; _eventIndex < _eventCount; _eventIndex++) {
+            webSocketSession * session = (webSocketSession *) _events[_eventIndex].data.ptr;
+
+            if(session != NULL) {
+                session->onEvent(_events[_eventIndex].events);
+            }
+        }
+        _eventCount = 0;
+
+        for(size_t i = 0; i < _posted.size(); i++) {
+            webSocketSession * session = _posted[i];
+
+            if(session != NULL) {
+                _posted[i] = NULL;
+                session->_queued = false;
+                session->onEvent(0);
+            }
+        }
+        _posted.clear();
+    }
+}
+
+void webSocketLoop::stop(void)
+{
+    _stop = true;
+}
+
+bool webSocketLoop::watch(int fd, webSocketSession * session, uint32_t events, bool add)
+{
+    struct epoll_event event = {};
+
+    event.events = events;
+    event.data.ptr = session;
+
+    return epoll_ctl(_epoll, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+void webSocketLoop::unwatch(int fd, webSocketSession * session)
+{
+    epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, NULL);
+
+    for(int i = _eventIndex + 1; i < _eventCount; i++) {
+        if(_events[i].data.ptr == session) {
+            _events[i].data.ptr = NULL;
+        }
+    }
+}
+
+void webSocketLoop::post(webSocketSession * session)
+{
+    if(!session->_queued) {
+        session->_queued = true;
+        _posted.push_back(session);
+    }
+}
+
+void webSocketLoop::forget(webSocketSession * session)
+{
+    for(int i = _eventIndex + 1; i < _eventCount; i++) {
+        if(_events[i].data.ptr == session) {
+            _events[i].data.ptr = NULL;
+        }
+    }
+
+    for(size_t i = 0; i < _posted.size(); i++) {
+        if(_posted[i] == session) {
+            _posted[i] = NULL;
+        }
+    }
+}
+
+/**
+ * xorshift32 for mask keys and Sec-WebSocket-Key, both only need to be
+ * unpredictable to intermediaries
+ */
+uint32_t webSocketLoop::random(void)
+{
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+
+    return _random;
+}
+
+webSocketSession::webSocketSession(webSocketLoop & loop) :
+    _loop(loop)
+{
+    _loop._sessions++;
+}
+
+webSocketSession::~webSocketSession()
+{
+    if(_draining) {
+        flush();  // what the socket takes now, co_await close() waits for all
+    }
+
+    if(_fd >= 0) {
+        if(_registered) {
+            _loop.unwatch(_fd, this);
+        }
+        ::close(_fd);
+    }
+
+    _loop.forget(this);
+    _loop._sessions--;
+}
+
+/**
+ * starts connecting, co_await the result: true when the upgrade succeeded
+ */
+webSocketSession::ConnectAwaiter webSocketSession::connect(const char * host, uint16_t port, const char * path)
+{
+    struct addrinfo hints = {};
+    struct addrinfo * result = NULL;
+    char service[8];
+    uint8_t nonce[16];
+    char key[25];
+    int fd = -1;
+    int flag = 1;
+
+    if(_state != STATE_IDLE) {
+        return ConnectAwaiter { *this };
+    }
+
+    _state = STATE_CLOSED;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(service, sizeof(service), "%u", port);
+
+    if(getaddrinfo(host, service, &hints, &result) != 0) {
+        return ConnectAwaiter { *this };
+    }
+
+    for(struct addrinfo * address = result; address != NULL; address = address->ai_next) {
+        fd = socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    address->ai_protocol);
+
+        if(fd >= 0) {
+            if(::connect(fd, address->ai_addr, address->ai_addrlen) == 0 || errno == EINPROGRESS) {
+                break;
+            }
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(result);
+
+    if(fd < 0) {
+        return ConnectAwaiter { *this };
+    }
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    _fd = fd;
+    _state = STATE_CONNECTING;
+
+    // Sec-WebSocket-Key: 16 random bytes in base64
+    for(uint8_t i = 0; i < sizeof(nonce); i += 4) {
+        uint32_t value = _loop.random();
+        memcpy(&nonce[i], &value, 4);
+    }
+    for(uint8_t i = 0, j = 0; i < sizeof(nonce); i += 3) {
+        uint32_t bits = ((uint32_t) nonce[i] << 16)
+                        | ((i + 1u < sizeof(nonce)) ? (uint32_t) nonce[i + 1] << 8 : 0)
+                        | ((i + 2u < sizeof(nonce)) ? nonce[i + 2] : 0);
+
+        key[j++] = g_coroBase64[(bits >> 18) & 0x3F];
+        key[j++] = g_coroBase64[(bits >> 12) & 0x3F];
+        key[j++] = (i + 1u < sizeof(nonce)) ? g_coroBase64[(bits >> 6) & 0x3F] : '=';
+        key[j++] = (i + 2u < sizeof(nonce)) ? g_coroBase64[bits & 0x3F] : '=';
+    }
+    key[24] = '\0';
+
+    // sent once the socket is writable
+    _out = "GET ";
+    _out += path;
+    _out += " HTTP/1.1\r\nHost: ";
+    _out += host;
+    _out += ":";
+    _out += service;
+    _out += "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: ";
+    _out += key;
+    _out += "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    _outStart = 0;
+
+    watch();
+
+    return ConnectAwaiter { *this };
+}
+
+/**
+ * queues a masked frame, co_await suspends while the send backlog is over
+ * the high watermark; false when the session is not open
+ */
+webSocketSession::SendAwaiter webSocketSession::send(std::string_view payload, uint8_t opcode)
+{
+    if(_state == STATE_OPEN && !_closeSent) {
+        queueFrame(opcode, payload.data(), payload.size());
+        flush();
+        watch();
+    }
+
+    return SendAwaiter { *this };
+}
+
+/**
+ * starts the closing handshake, receive() returns CLOSE with the reply;
+ * after a close by the peer co_await waits until the echo is written
+ */
+webSocketSession::SendAwaiter webSocketSession::close(uint16_t code)
+{
+    if(_state == STATE_OPEN && !_closeSent) {
+        queueClose(code);
+        flush();
+        watch();
+    }
+
+    return SendAwaiter { *this };
+}
+
+bool webSocketSession::ConnectAwaiter::await_ready() const noexcept
+{
+    return session._state == STATE_OPEN || session._state == STATE_CLOSED
+           || session._state == STATE_IDLE;
+}
+
+void webSocketSession::ConnectAwaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    session._opener = handle;
+    session.watch();
+}
+
+bool webSocketSession::ConnectAwaiter::await_resume() const noexcept
+{
+    return session._state == STATE_OPEN;
+}
+
+bool webSocketSession::ReceiveAwaiter::await_ready() noexcept
+{
+    return session.tryReceive();
+}
+
+void webSocketSession::ReceiveAwaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    session._reader = handle;
+    session.watch();
+}
+
+webSocketMessage webSocketSession::ReceiveAwaiter::await_resume() const noexcept
+{
+    return session._message;
+}
+
+bool webSocketSession::SendAwaiter::await_ready() noexcept
+{
+    return !session._draining
+           && (session._state != STATE_OPEN || session.getSendPending() <= session._sendHigh);
+}
+
+void webSocketSession::SendAwaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    session._writer = handle;
+    session.watch();
+}
+
+bool webSocketSession::SendAwaiter::await_resume() const noexcept
+{
+    return session._state == STATE_OPEN;
+}
+
+/**
+ * Called by the loop, events is 0 after a failure outside an event. Every
+ * waiter that can go on is resumed last, as any of them may destroy the
+ * session.
+ */
+void webSocketSession::onEvent(uint32_t events)
+{
+    std::coroutine_handle<> ready[3];
+    int count = 0;
+
+    if(_state == STATE_CONNECTING && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+
+        if(getsockopt(_fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+            fail();
+        } else {
+            _state = STATE_HANDSHAKE;
+        }
+    }
+
+    if((_state == STATE_HANDSHAKE || _state == STATE_OPEN || _draining) && getSendPending()) {
+        flush();
+    }
+
+    if(_draining && getSendPending() == 0) {
+        fail();
+    }
+
+    if(_state == STATE_HANDSHAKE && (events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP))) {
+        handshake();
+    }
+
+    if(_opener && (_state == STATE_OPEN || _state == STATE_CLOSED)) {
+        ready[count++] = _opener;
+        _opener = nullptr;
+    }
+
+    if(_reader && tryReceive()) {
+        ready[count++] = _reader;
+        _reader = nullptr;
+    }
+
+    if(_writer && !_draining && (_state != STATE_OPEN || getSendPending() <= _sendHigh / 2)) {
+        ready[count++] = _writer;
+        _writer = nullptr;
+    }
+
+    if((events & (EPOLLERR | EPOLLHUP)) && _state == STATE_OPEN && !_reader && !_writer) {
+        // nobody reads yet: stop the level triggered hangup until receive()
+        // or send() finds it
+        _hangup = true;
+    }
+
+    watch();
+
+    for(int i = 0; i < count; i++) {
+        ready[i].resume();
+    }
+}
+
+/**
+ * epoll interest follows the waiters: reading while receive() waits,
+ * writing while bytes are queued
+ */
+void webSocketSession::watch(void)
+{
+    uint32_t events = 0;
+
+    if(_fd < 0) {
+        return;
+    }
+
+    if(_state == STATE_CONNECTING || getSendPending()) {
+        events |= EPOLLOUT;
+    }
+
+    if((_state == STATE_HANDSHAKE || _reader) && !_draining) {
+        events |= EPOLLIN | EPOLLRDHUP;
+    }
+
+    if(events == 0 && _hangup) {
+        if(_registered) {
+            _loop.unwatch(_fd, this);
+            _registered = false;
+        }
+        return;
+    }
+
+    if(!_registered) {
+        _registered = _loop.watch(_fd, this, events, true);
+        _watched = events;
+    } else if(events != _watched) {
+        _loop.watch(_fd, this, events, false);
+        _watched = events;
+    }
+}
+
+void webSocketSession::fail(void)
+{
+    if(_fd >= 0) {
+        if(_registered) {
+            _loop.unwatch(_fd, this);
+        }
+        ::close(_fd);
+        _fd = -1;
+    }
+
+    _registered = false;
+    _draining = false;
+    _state = STATE_CLOSED;
+    _out.clear();
+    _outStart = 0;
+
+    if(_opener || _reader || _writer) {
+        _loop.post(this);
+    }
+}
+
+/**
+ * Closes the session but keeps the socket until the queued bytes, the
+ * close frame last, are written. Nothing is read meanwhile.
+ */
+void webSocketSession::closeWhenFlushed(void)
+{
+    if(_fd < 0 || getSendPending() == 0) {
+        fail();
+        return;
+    }
+
+    _state = STATE_CLOSED;
+    _draining = true;
+    watch();
+
+    if(_opener || _reader || _writer) {
+        _loop.post(this);
+    }
+}
+
+/**
+ * one read: 1 when bytes were added, 0 when none are ready, -1 at the end
+ * of the stream or on an error
+ */
+int webSocketSession::fill(void)
+{
+    size_t size = _in.size();
+    ssize_t length = 0;
+
+    if(_fd < 0) {
+        return -1;
+    }
+
+    _in.resize(size + WEB_SOCKET_CORO_READ_SIZE);
+    length = ::recv(_fd, &_in[size], WEB_SOCKET_CORO_READ_SIZE, 0);
+    _in.resize(size + ((length > 0) ? length : 0));
+
+    if(length > 0) {
+        return 1;
+    }
+
+    if(length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return 0;
+    }
+
+    return -1;
+}
+
+/**
+ * writes queued bytes until the socket is full, false when the session failed
+ */
+bool webSocketSession::flush(void)
+{
+    while(_fd >= 0 && _outStart < _out.size()) {
+        ssize_t length = ::send(_fd, &_out[_outStart], _out.size() - _outStart, MSG_NOSIGNAL);
+
+        if(length > 0) {
+            _outStart += length;
+        } else if(length < 0 && errno == EINTR) {
+            continue;
+        } else if(length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            fail();
+            return false;
+        }
+    }
+
+    if(_outStart == _out.size()) {
+        _out.clear();
+        _outStart = 0;
+    } else if(_outStart > _out.size() / 2) {
+        _out.erase(0, _outStart);
+        _outStart = 0;
+    }
+
+    return _fd >= 0;
+}
+
+/**
+ * reads the upgrade response, frames that follow it stay in _in
+ */
+bool webSocketSession::handshake(void)
+{
+    size_t end = std::string::npos;
+    int result = 0;
+
+    while((result = fill()) > 0) {
+    }
+
+    end = _in.find("\r\n\r\n");
+
+    if(end == std::string::npos) {
+        if(result < 0 || _in.size() > WEB_SOCKET_CORO_HEADER_MAX) {
+            fail();
+        }
+        return false;
+    }
+
+    if(_in.compare(0, 13, "HTTP/1.1 101 ") != 0) {
+        fail();
+        return false;
+    }
+
+    _in.erase(0, end + 4);
+    _state = STATE_OPEN;
+
+    return true;
+}
+
+/**
+ * true when _message is set: the next message, or CLOSE once the session
+ * is closed and no complete message is left
+ */
+bool webSocketSession::tryReceive(void)
+{
+    int result = 0;
+
+    if(_state == STATE_IDLE) {
+        _message = { WEB_SOCKET_CORO_CLOSE, {} };
+        return true;
+    }
+
+    if(_state == STATE_CONNECTING || _state == STATE_HANDSHAKE) {
+        return false;
+    }
+
+    // the previous message is released
+    if(_inConsumed) {
+        _in.erase(0, _inConsumed);
+        _inConsumed = 0;
+    }
+
+    for(;;) {
+        result = parseFrame();
+
+        if(result > 0) {
+            return true;
+        }
+
+        if(result < 0 || _state == STATE_CLOSED) {
+            _message = { WEB_SOCKET_CORO_CLOSE, {} };
+            return true;
+        }
+
+        result = fill();
+
+        if(result == 0) {
+            return false;
+        }
+
+        if(result < 0) {
+            fail();
+        }
+    }
+}
+
+/**
+ * 1 when a message is complete, 0 when more bytes are needed, -1 when the
+ * peer broke the protocol
+ */
+int webSocketSession::parseFrame(void)
+{
+    WEB_SOCKET_FRAME_INFO info;
+
+    for(;;) {
+        const uint8_t * data = (const uint8_t *) _in.data() + _inConsumed;
+        size_t size = _in.size() - _inConsumed;
+        uint8_t header_length = webSocket_frameDecodeHeader(data, size, &info);
+        char * payload = NULL;
+        size_t length = 0;
+
+        if(header_length == 0) {
+            return 0;
+        }
+
+        if(header_length == WEB_SOCKET_FRAME_INVALID || info.rsv) {
+            return parseError(WEB_SOCKET_CORO_CLOSE_PROTOCOL);
+        }
+
+        if(info.payload_length > WEB_SOCKET_CORO_MESSAGE_MAX) {
+            return parseError(WEB_SOCKET_CORO_CLOSE_TOO_BIG);
+        }
+
+        if(size - header_length < info.payload_length) {
+            return 0;
+        }
+
+        payload = &_in[_inConsumed + header_length];
+        length = (size_t) info.payload_length;
+        _inConsumed += header_length + length;
+
+        if(info.masked) {
+            for(size_t i = 0; i < length; i++) {
+                payload[i] ^= info.mask[i % 4];
+            }
+        }
+
+        switch(info.opcode) {
+            case WEB_SOCKET_CORO_PING:
+                if(_state == STATE_OPEN && !_closeSent) {
+                    queueFrame(WEB_SOCKET_CORO_PONG, payload, length);
+                    flush();
+                }
+                break;
+
+            case WEB_SOCKET_CORO_PONG:
+                break;
+
+            case WEB_SOCKET_CORO_CLOSE:
+                if(_state == STATE_OPEN && !_closeSent) {
+                    // echo the status code
+                    queueFrame(WEB_SOCKET_CORO_CLOSE, payload, (length >= 2) ? 2 : 0);
+                    flush();
+                }
+                closeWhenFlushed();
+                _message = { WEB_SOCKET_CORO_CLOSE, std::string_view(payload, length) };
+                return 1;
+
+            case WEB_SOCKET_CORO_TEXT:
+            case WEB_SOCKET_CORO_BINARY:
+                if(_fragmentOpcode) {
+                    return parseError(WEB_SOCKET_CORO_CLOSE_PROTOCOL);
+                }
+                if(info.fin) {
+                    _message = { info.opcode, std::string_view(payload, length) };
+                    return 1;
+                }
+                _fragmentOpcode = info.opcode;
+                _fragments.assign(payload, length);
+                break;
+
+            case WEB_SOCKET_CORO_CONTINUE:
+                if(!_fragmentOpcode) {
+                    return parseError(WEB_SOCKET_CORO_CLOSE_PROTOCOL);
+                }
+                if(_fragments.size() + length > WEB_SOCKET_CORO_MESSAGE_MAX) {
+                    return parseError(WEB_SOCKET_CORO_CLOSE_TOO_BIG);
+                }
+                _fragments.append(payload, length);
+                if(info.fin) {
+                    _message = { _fragmentOpcode, _fragments };
+                    _fragmentOpcode = 0;
+                    return 1;
+                }
+                break;
+
+            default:
+                return parseError(WEB_SOCKET_CORO_CLOSE_PROTOCOL);
+        }
+    }
+}
+
+int webSocketSession::parseError(uint16_t code)
+{
+    if(_state == STATE_OPEN && !_closeSent) {
+        queueClose(code);
+        flush();
+    }
+    closeWhenFlushed();
+
+    return -1;
+}
+
+void webSocketSession::queueFrame(uint8_t opcode, const char * payload, size_t length)
+{
+    uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+    uint32_t key = _loop.random();
+    uint8_t mask[WEB_SOCKET_MASK_KEY_SIZE];
+    uint8_t header_length = 0;
+    size_t start = 0;
+
+    memcpy(mask, &key, sizeof(mask));
+    header_length = webSocket_frameEncodeHeader(header, true, 0, opcode, mask, length);
+
+    _out.append((const char *) header, header_length);
+    start = _out.size();
+    _out.append(payload, length);
+
+    for(size_t i = 0; i < length; i++) {
+        _out[start + i] ^= mask[i % 4];
+    }
+}
+
+void webSocketSession::queueClose(uint16_t code)
+{
+    char payload[2] = { (char)(code >> 8), (char)(code & 0xFF) };
+
+    queueFrame(WEB_SOCKET_CORO_CLOSE, payload, sizeof(payload));
+    _closeSent = true;
+}
+
+#endif // !ARDUINO && __linux__ && C++20
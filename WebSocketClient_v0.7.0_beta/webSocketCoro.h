@@ -0,0 +1,235 @@
+/*
+ * @file    webSocketCoro.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_CORO_H_
+#define WEBSOCKET_CORO_H_
+
+// C++20 coroutine client for Linux hosts (gateways, test tooling). Every
+// session has its own state and buffers on top of the frame codec in
+// webSocketFrame.h, and one epoll loop drives any number of them from a
+// single thread. Not built for the ESP8266.
+//
+//   webSocketTask chat(webSocketLoop &loop)
+//   {
+//     webSocketSession session(loop);
+//
+//     if (!co_await session.connect("localhost", 8080, "/WebSocketPHP/server.php"))
+//     {
+//       co_return;
+//     }
+//
+//     co_await session.send("{\"message\":\"hello\"}");
+//
+//     for (;;)
+//     {
+//       webSocketMessage message = co_await session.receive();
+//
+//       if (message.opcode == WEB_SOCKET_CORO_CLOSE)
+//       {
+//         co_await session.close();  // until the close echo is written
+//         break;  // closed by the peer or lost
+//       }
+//       ... message.payload, valid until the next receive()
+//     }
+//   }
+//
+//   webSocketLoop loop;
+//   chat(loop);
+//   loop.run();  // returns when no session is left
+//
+// connect() resolves the host name with a blocking getaddrinfo(), then
+// connects and upgrades without blocking. The 101 status is checked,
+// Sec-WebSocket-Accept is not (as in wsHTTPClient). receive() answers
+// pings and reassembles fragmented messages. send() masks and queues the
+// frame, then suspends while more than the high watermark is waiting for
+// the socket, until it drains below half of it. A close from the peer or
+// a protocol error ends the session, but the socket stays until the close
+// reply is written behind what was queued; co_await close() waits for it.
+
+#if !defined(ARDUINO) && defined(__linux__) && (__cplusplus >= 202002L)
+
+#include <coroutine>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/epoll.h>
+#include "webSocketFrame.h"
+
+// opcodes as in webSocket.h, which needs the Arduino core
+#define WEB_SOCKET_CORO_CONTINUE		0x00u
+#define WEB_SOCKET_CORO_TEXT			0x01u
+#define WEB_SOCKET_CORO_BINARY			0x02u
+#define WEB_SOCKET_CORO_CLOSE			0x08u
+#define WEB_SOCKET_CORO_PING			0x09u
+#define WEB_SOCKET_CORO_PONG			0x0Au
+
+#define WEB_SOCKET_CORO_CLOSE_NORMAL	1000u
+#define WEB_SOCKET_CORO_CLOSE_PROTOCOL	1002u
+#define WEB_SOCKET_CORO_CLOSE_TOO_BIG	1009u
+
+#ifndef WEB_SOCKET_CORO_EVENTS
+#define WEB_SOCKET_CORO_EVENTS			256  // epoll events per wait
+#endif
+#ifndef WEB_SOCKET_CORO_READ_SIZE
+#define WEB_SOCKET_CORO_READ_SIZE		16384u
+#endif
+#ifndef WEB_SOCKET_CORO_MESSAGE_MAX
+#define WEB_SOCKET_CORO_MESSAGE_MAX		(16u * 1024u * 1024u)
+#endif
+#ifndef WEB_SOCKET_CORO_SEND_HIGH
+#define WEB_SOCKET_CORO_SEND_HIGH		(256u * 1024u)
+#endif
+
+class webSocketSession;
+
+// Fire and forget coroutine, runs until its first suspension when called
+// and frees itself when it returns.
+struct webSocketTask
+{
+    struct promise_type
+    {
+        webSocketTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept;
+    };
+};
+
+struct webSocketMessage
+{
+    uint8_t opcode;  // TEXT, BINARY or CLOSE
+    std::string_view payload;  // for CLOSE the status code and reason, if any
+};
+
+class webSocketLoop
+{
+public:
+    webSocketLoop();
+    ~webSocketLoop();
+    webSocketLoop(const webSocketLoop &) = delete;
+    webSocketLoop &operator=(const webSocketLoop &) = delete;
+
+    void run(void);
+    void stop(void);
+    int getSessionCount(void) const { return _sessions; }
+
+protected:
+    friend class webSocketSession;
+
+    bool watch(int fd, webSocketSession *session, uint32_t events, bool add);
+    void unwatch(int fd, webSocketSession *session);
+    void post(webSocketSession *session);
+    void forget(webSocketSession *session);
+    uint32_t random(void);
+
+    int _epoll = -1;
+    int _sessions = 0;
+    bool _stop = false;
+    int _eventCount = 0;
+    int _eventIndex = 0;
+    struct epoll_event _events[WEB_SOCKET_CORO_EVENTS];
+    std::vector<webSocketSession *> _posted;  // closed outside onEvent(), waiters to wake
+    uint32_t _random = 0;
+};
+
+class webSocketSession
+{
+public:
+    struct ConnectAwaiter
+    {
+        webSocketSession &session;
+        bool await_ready() const noexcept;
+        void await_suspend(std::coroutine_handle<> handle) noexcept;
+        bool await_resume() const noexcept;
+    };
+
+    struct ReceiveAwaiter
+    {
+        webSocketSession &session;
+        bool await_ready() noexcept;
+        void await_suspend(std::coroutine_handle<> handle) noexcept;
+        webSocketMessage await_resume() const noexcept;
+    };
+
+    struct SendAwaiter
+    {
+        webSocketSession &session;
+        bool await_ready() noexcept;
+        void await_suspend(std::coroutine_handle<> handle) noexcept;
+        bool await_resume() const noexcept;
+    };
+
+    explicit webSocketSession(webSocketLoop &loop);
+    ~webSocketSession();
+    webSocketSession(const webSocketSession &) = delete;
+    webSocketSession &operator=(const webSocketSession &) = delete;
+
+    ConnectAwaiter connect(const char *host, uint16_t port, const char *path);
+    ReceiveAwaiter receive(void) { return ReceiveAwaiter { *this }; }
+    SendAwaiter send(std::string_view payload,
+                     uint8_t opcode = WEB_SOCKET_CORO_TEXT);
+    SendAwaiter close(uint16_t code = WEB_SOCKET_CORO_CLOSE_NORMAL);
+
+    bool isOpen(void) const { return _state == STATE_OPEN; }
+    size_t getSendPending(void) const { return _out.size() - _outStart; }
+    void setSendHighWatermark(size_t size) { _sendHigh = size; }
+
+protected:
+    friend class webSocketLoop;
+
+    enum State {
+        STATE_IDLE = 0,
+        STATE_CONNECTING,
+        STATE_HANDSHAKE,
+        STATE_OPEN,
+        STATE_CLOSED
+    };
+
+    void onEvent(uint32_t events);
+    void watch(void);
+    void fail(void);
+    void closeWhenFlushed(void);
+    int fill(void);
+    bool flush(void);
+    bool handshake(void);
+    bool tryReceive(void);
+    int parseFrame(void);
+    int parseError(uint16_t code);
+    void queueFrame(uint8_t opcode, const char *payload, size_t length);
+    void queueClose(uint16_t code);
+
+    webSocketLoop &_loop;
+    int _fd = -1;
+    State _state = STATE_IDLE;
+    uint32_t _watched = 0;
+    bool _registered = false;
+    bool _hangup = false;
+    bool _queued = false;
+    bool _closeSent = false;
+    bool _draining = false;  // closed, the socket stays until _out is written
+    size_t _sendHigh = WEB_SOCKET_CORO_SEND_HIGH;
+
+    std::string _in;  // received bytes, frames are unmasked in place
+    size_t _inConsumed = 0;  // released at the next receive()
+    std::string _out;
+    size_t _outStart = 0;
+    std::string _fragments;
+    uint8_t _fragmentOpcode = 0;
+    webSocketMessage _message = { WEB_SOCKET_CORO_CLOSE, {} };
+
+    std::coroutine_handle<> _opener;
+    std::coroutine_handle<> _reader;
+    std::coroutine_handle<> _writer;
+};
+
+#endif // !ARDUINO && __linux__ && C++20
+
+#endif /* WEBSOCKET_CORO_H_ */
@@ -0,0 +1,229 @@
+/*
+ * @file    webSocketEndpoint.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <Arduino.h>
+#include "webSocketEndpoint.h"
+#include "webSocketLog.h"
+#include "wsBasicHttpClient.h"
+
+#ifdef WEBSOCKET_ENDPOINT
+
+#define WEBSOCKET_DEBUG
+
+static void webSocket_endpointKeepStandby(uint32_t now);
+
+static wsHTTPClient *g_endpointHttp[WEB_SOCKET_ENDPOINT_MAX];
+static WEB_SOCKET_ENDPOINT g_endpoint[WEB_SOCKET_ENDPOINT_MAX];
+static webSocketHandler g_endpointSetup = NULL;
+static uint8_t g_endpointCount = 0;
+static uint8_t g_endpointActive = WEB_SOCKET_ENDPOINT_NONE;
+static uint8_t g_endpointStandby = WEB_SOCKET_ENDPOINT_NONE;
+static uint32_t g_endpointStandbyCount = 0;//msec of the last standby check
+static uint32_t g_endpointWait = 0;//msec
+static uint32_t g_endpointWaitCount = 0;//msec
+static bool g_is_endpointStandby = false;
+
+void webSocket_endpointBegin(webSocketHandler setup)
+{
+  g_endpointSetup = setup;
+  g_endpointCount = 0;
+  g_endpointActive = WEB_SOCKET_ENDPOINT_NONE;
+  g_endpointStandby = WEB_SOCKET_ENDPOINT_NONE;
+  g_endpointWait = 0;
+}
+
+bool webSocket_endpointAdd(wsHTTPClient *http)
+{
+  if ((http == NULL) || (g_endpointCount >= WEB_SOCKET_ENDPOINT_MAX))
+  {
+    return false;
+  }
+
+  g_endpointHttp[g_endpointCount] = http;
+  memset(&g_endpoint[g_endpointCount], 0, sizeof(WEB_SOCKET_ENDPOINT));
+  g_endpointCount++;
+
+  return true;
+}
+
+void webSocket_endpointSetStandby(bool standby)
+{
+  g_is_endpointStandby = standby;
+
+  if (!standby && (g_endpointStandby != WEB_SOCKET_ENDPOINT_NONE))
+  {
+    g_endpointHttp[g_endpointStandby]->disconnect();
+    g_endpointStandby = WEB_SOCKET_ENDPOINT_NONE;
+  }
+}
+
+// Returns the client of the open session, NULL while there is none. One
+// connection attempt at most per call.
+wsHTTPClient *webSocket_endpointHandle(void)
+{
+  uint32_t now = millis();
+  uint32_t handshake = 0;
+  uint8_t index = WEB_SOCKET_ENDPOINT_NONE;
+  int httpCode = 0;
+
+  if (g_endpointActive != WEB_SOCKET_ENDPOINT_NONE)
+  {
+    if (webSocket_isStart())
+    {
+      if (g_endpointHttp[g_endpointActive]->connected())
+      {
+        if (webSocket_getRtt())
+        {
+          g_endpoint[g_endpointActive].rtt = webSocket_getRtt();
+        }
+
+        webSocket_endpointKeepStandby(now);
+
+        return g_endpointHttp[g_endpointActive];
+      }
+
+      // link lost without a closing handshake
+      webSocket_abort();
+    }
+
+    WEB_SOCKET_LOG_WARN("endpoint %u lost", g_endpointActive);
+#ifndef WEBSOCKET_DEBUG
+    Serial.print("ENDPOINT: LOST "); // DEBUG
+    Serial.println(g_endpointActive); // DEBUG
+#endif // WEBSOCKET_DEBUG
+
+    g_endpointHttp[g_endpointActive]->disconnect();
+    webSocket_endpointFail(&g_endpoint[g_endpointActive], now, random(0x7FFFFFFF));
+    g_endpointActive = WEB_SOCKET_ENDPOINT_NONE;
+  }
+
+  if (now - g_endpointWaitCount < g_endpointWait)
+  {
+    return NULL;
+  }
+
+  if ((g_endpointStandby != WEB_SOCKET_ENDPOINT_NONE)
+      && g_endpointHttp[g_endpointStandby]->connected())
+  {
+    index = g_endpointStandby; // already connected, only the upgrade is left
+  }
+  else
+  {
+    index = webSocket_endpointSelect(g_endpoint, g_endpointCount, now,
+                                     WEB_SOCKET_ENDPOINT_NONE);
+  }
+
+  if (g_endpointStandby != WEB_SOCKET_ENDPOINT_NONE)
+  {
+    if (g_endpointStandby != index)
+    {
+      g_endpointHttp[g_endpointStandby]->disconnect();
+    }
+
+    g_endpointStandby = WEB_SOCKET_ENDPOINT_NONE;
+  }
+
+  if (index == WEB_SOCKET_ENDPOINT_NONE)
+  {
+    // all backed off, look again shortly
+    g_endpointWait = WEB_SOCKET_RECONNECT_MIN;
+    g_endpointWaitCount = now;
+    return NULL;
+  }
+
+  g_endpointWait = 0;
+  httpCode = g_endpointHttp[index]->GET();
+  handshake = millis() - now;
+
+  if (httpCode != HTTP_CODE_SWITCHING_PROTOCOLS)
+  {
+    WEB_SOCKET_LOG_ERROR("endpoint %u failed %d", index, httpCode);
+#ifndef WEBSOCKET_DEBUG
+    Serial.print("ENDPOINT: FAILED "); // DEBUG
+    Serial.print(index); // DEBUG
+    Serial.print(" "); // DEBUG
+    Serial.println(httpCode); // DEBUG
+#endif // WEBSOCKET_DEBUG
+
+    g_endpointHttp[index]->disconnect();
+    webSocket_endpointFail(&g_endpoint[index], now, random(0x7FFFFFFF));
+    return NULL;
+  }
+
+  webSocket_endpointSucceed(&g_endpoint[index], handshake);
+
+  if (g_endpointSetup != NULL)
+  {
+    g_endpointSetup();
+  }
+
+  webSocket_start();
+  g_endpointActive = index;
+  g_endpointStandbyCount = now - WEB_SOCKET_ENDPOINT_STANDBY_CHECK;
+
+  return g_endpointHttp[index];
+}
+
+// index of the session's endpoint, WEB_SOCKET_ENDPOINT_NONE while offline
+uint8_t webSocket_endpointGetActive(void)
+{
+  return g_endpointActive;
+}
+
+const WEB_SOCKET_ENDPOINT *webSocket_endpointGet(uint8_t index)
+{
+  return (index < g_endpointCount) ? &g_endpoint[index] : NULL;
+}
+
+// Keeps the best other endpoint connected while a session is open. The TCP
+// (and TLS) connect blocks like the one of GET(), so it is checked only
+// every WEB_SOCKET_ENDPOINT_STANDBY_CHECK.
+static void webSocket_endpointKeepStandby(uint32_t now)
+{
+  uint8_t index = WEB_SOCKET_ENDPOINT_NONE;
+
+  if (!g_is_endpointStandby || (g_endpointCount < 2)
+      || (now - g_endpointStandbyCount < WEB_SOCKET_ENDPOINT_STANDBY_CHECK))
+  {
+    return;
+  }
+
+  g_endpointStandbyCount = now;
+
+  if (g_endpointStandby != WEB_SOCKET_ENDPOINT_NONE)
+  {
+    if (g_endpointHttp[g_endpointStandby]->connected())
+    {
+      return;
+    }
+
+    g_endpointHttp[g_endpointStandby]->disconnect(); // closed by the server
+  }
+
+  index = webSocket_endpointSelect(g_endpoint, g_endpointCount, now,
+                                   g_endpointActive);
+  g_endpointStandby = WEB_SOCKET_ENDPOINT_NONE;
+
+  if (index == WEB_SOCKET_ENDPOINT_NONE)
+  {
+    return;
+  }
+
+  if (!g_endpointHttp[index]->warm())
+  {
+    g_endpointHttp[index]->disconnect();
+    webSocket_endpointFail(&g_endpoint[index], now, random(0x7FFFFFFF));
+    return;
+  }
+
+  g_endpoint[index].connect = g_endpointHttp[index]->getConnectTime();
+  g_endpointStandby = index;
+}
+
+#endif // WEBSOCKET_ENDPOINT
@@ -0,0 +1,161 @@
+/*
+ * @file    webSocketEndpoint.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_ENDPOINT_H_
+#define WEBSOCKET_ENDPOINT_H_
+
+#include <stdint.h>
+#include "webSocket.h"
+
+// Endpoint list with failover, used instead of webSocketReconnect. Every
+// endpoint is a wsHTTPClient configured like the single one (begin,
+// headers). A session goes to the healthy endpoint with the lowest score:
+// its last session RTT, else half its smoothed handshake time, else its
+// TCP connect time. Endpoints never measured score 0, so each is tried
+// once before the fastest one is settled on; ties go by list order. An
+// endpoint whose session ends or whose handshake fails is backed off with
+// jittered exponential delays (WEB_SOCKET_RECONNECT_MIN to _MAX). With a
+// standby, the next best endpoint is kept TCP (and TLS) connected, so a
+// failover only costs the upgrade request.
+//
+//   webSocket_endpointBegin(wsSetHandles);
+//   webSocket_endpointAdd(&g_http1);
+//   webSocket_endpointAdd(&g_http2);
+//   webSocket_endpointSetStandby(true);
+//   ...
+//   wsHTTPClient *http = webSocket_endpointHandle();
+//   if (http != NULL) {
+//     webSocket_handle(http->getStream());
+//   }
+//
+// The selection below is free of Arduino dependencies.
+
+#define WEB_SOCKET_ENDPOINT_NONE		0xFFu
+#define WEB_SOCKET_ENDPOINT_UNMEASURED	0u
+
+#ifndef WEB_SOCKET_ENDPOINT_MAX
+#define WEB_SOCKET_ENDPOINT_MAX			4u
+#endif
+#ifndef WEB_SOCKET_ENDPOINT_STANDBY_CHECK
+#define WEB_SOCKET_ENDPOINT_STANDBY_CHECK	5000u//msec
+#endif
+#ifndef WEB_SOCKET_RECONNECT_MIN
+#define WEB_SOCKET_RECONNECT_MIN		50//msec
+#endif
+#ifndef WEB_SOCKET_RECONNECT_MAX
+#define WEB_SOCKET_RECONNECT_MAX		10000//msec
+#endif
+
+typedef struct _WEB_SOCKET_ENDPOINT
+{
+  uint32_t handshake;  // msec, smoothed TCP connect and upgrade, 0 unmeasured
+  uint32_t connect;    // msec, last standby TCP connect, 0 unmeasured
+  uint32_t rtt;        // msec, smoothed RTT of the last session, 0 unmeasured
+  uint32_t retry_at;   // msec, backed off until, with failures
+  uint8_t failures;
+} WEB_SOCKET_ENDPOINT;
+
+static inline uint32_t webSocket_endpointScore(const WEB_SOCKET_ENDPOINT *endpoint)
+{
+  if (endpoint->rtt)
+  {
+    return endpoint->rtt;
+  }
+
+  if (endpoint->handshake)
+  {
+    return (endpoint->handshake / 2) + 1; // TCP and HTTP, two round trips
+  }
+
+  if (endpoint->connect)
+  {
+    return endpoint->connect;
+  }
+
+  return WEB_SOCKET_ENDPOINT_UNMEASURED;
+}
+
+static inline bool webSocket_endpointIsHealthy(const WEB_SOCKET_ENDPOINT *endpoint,
+                                               uint32_t now)
+{
+  return (endpoint->failures == 0)
+         || ((int32_t)(now - endpoint->retry_at) >= 0);
+}
+
+// best healthy endpoint but exclude, WEB_SOCKET_ENDPOINT_NONE if none
+static inline uint8_t webSocket_endpointSelect(const WEB_SOCKET_ENDPOINT *list,
+                                               uint8_t count, uint32_t now,
+                                               uint8_t exclude)
+{
+  uint8_t best = WEB_SOCKET_ENDPOINT_NONE;
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if ((i == exclude) || !webSocket_endpointIsHealthy(&list[i], now))
+    {
+      continue;
+    }
+
+    if ((best == WEB_SOCKET_ENDPOINT_NONE)
+        || (webSocket_endpointScore(&list[i]) < webSocket_endpointScore(&list[best])))
+    {
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+// backs the endpoint off; jitter is any random number
+static inline void webSocket_endpointFail(WEB_SOCKET_ENDPOINT *endpoint,
+                                          uint32_t now, uint32_t jitter)
+{
+  uint32_t ceiling = WEB_SOCKET_RECONNECT_MIN;
+
+  for (uint8_t i = 0; (i < endpoint->failures) && (ceiling < WEB_SOCKET_RECONNECT_MAX);
+       i++)
+  {
+    ceiling <<= 1;
+  }
+
+  if (ceiling > WEB_SOCKET_RECONNECT_MAX)
+  {
+    ceiling = WEB_SOCKET_RECONNECT_MAX;
+  }
+
+  if (endpoint->failures < UINT8_MAX)
+  {
+    endpoint->failures++;
+  }
+
+  endpoint->retry_at = now + (ceiling / 2) + (jitter % ((ceiling / 2) + 1));
+}
+
+static inline void webSocket_endpointSucceed(WEB_SOCKET_ENDPOINT *endpoint,
+                                             uint32_t handshake)
+{
+  endpoint->failures = 0;
+  endpoint->handshake = (endpoint->handshake == 0) ? handshake
+                        : (3 * endpoint->handshake + handshake) / 4;
+}
+
+#ifdef WEBSOCKET_ENDPOINT
+
+class wsHTTPClient;
+
+extern void webSocket_endpointBegin(webSocketHandler setup);
+extern bool webSocket_endpointAdd(wsHTTPClient *http);
+extern void webSocket_endpointSetStandby(bool standby);
+extern wsHTTPClient *webSocket_endpointHandle(void);
+extern uint8_t webSocket_endpointGetActive(void);
+extern const WEB_SOCKET_ENDPOINT *webSocket_endpointGet(uint8_t index);
+
+#endif // WEBSOCKET_ENDPOINT
+
+#endif /* WEBSOCKET_ENDPOINT_H_ */
@@ -0,0 +1,270 @@
+/*
+ * @file    webSocketFrame.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_FRAME_H_
+#define WEBSOCKET_FRAME_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// RFC 6455 frame header codec. Only shifts and masks on bytes in network
+// order, so the result does not depend on the compiler's bitfield layout.
+// Everything here is free of Arduino dependencies.
+
+#define WEB_SOCKET_FRAME_FIN			0x80u
+#define WEB_SOCKET_FRAME_RSV1			0x40u
+#define WEB_SOCKET_FRAME_RSV2			0x20u
+#define WEB_SOCKET_FRAME_RSV3			0x10u
+#define WEB_SOCKET_FRAME_OPCODE			0x0Fu
+#define WEB_SOCKET_FRAME_CONTROL		0x08u  // opcode bit of close, ping and pong
+#define WEB_SOCKET_FRAME_MASKED			0x80u
+#define WEB_SOCKET_FRAME_LENGTH			0x7Fu
+
+#define WEB_SOCKET_FRAME_LENGTH7_MAX	125u
+#define WEB_SOCKET_FRAME_LENGTH16_FLAG	126u
+#define WEB_SOCKET_FRAME_LENGTH16_MAX	65535u
+#define WEB_SOCKET_FRAME_LENGTH64_FLAG	127u
+
+#define WEB_SOCKET_HEAD_FRAME_SIZE		2u
+#define WEB_SOCKET_MASK_KEY_SIZE		4u
+#define WEB_SOCKET_FRAME_HEADER_MAX		(WEB_SOCKET_HEAD_FRAME_SIZE + 8u + WEB_SOCKET_MASK_KEY_SIZE)
+#define WEB_SOCKET_FRAME_HEADER16_MAX	(WEB_SOCKET_HEAD_FRAME_SIZE + 2u + WEB_SOCKET_MASK_KEY_SIZE)
+#define WEB_SOCKET_FRAME_INVALID		0xFFu  // decoded header RFC 6455 forbids
+#define WEB_SOCKET_CONTROL_FRAME_MAX	(WEB_SOCKET_HEAD_FRAME_SIZE + WEB_SOCKET_MASK_KEY_SIZE \
+  + WEB_SOCKET_FRAME_LENGTH7_MAX)
+
+typedef struct _WEB_SOCKET_FRAME_INFO
+{
+  uint8_t fin;
+  uint8_t rsv;            // RSV1..RSV3 in bits 2..0
+  uint8_t opcode;
+  uint8_t masked;
+  uint8_t length_field;   // 7 bit length field: length, 126 or 127
+  uint8_t header_length;  // bytes including extended length and mask key
+  uint64_t payload_length;
+  uint8_t mask[WEB_SOCKET_MASK_KEY_SIZE];
+} WEB_SOCKET_FRAME_INFO;
+
+constexpr uint8_t webSocket_frameByte0(bool fin, uint8_t rsv, uint8_t opcode)
+{
+  return (uint8_t)((fin ? WEB_SOCKET_FRAME_FIN : 0u)
+                   | ((rsv & 0x07u) << 4)
+                   | (opcode & WEB_SOCKET_FRAME_OPCODE));
+}
+
+constexpr uint8_t webSocket_frameLengthField(uint64_t length)
+{
+  return (length <= WEB_SOCKET_FRAME_LENGTH7_MAX) ? (uint8_t) length
+         : ((length <= WEB_SOCKET_FRAME_LENGTH16_MAX)
+            ? (uint8_t) WEB_SOCKET_FRAME_LENGTH16_FLAG
+            : (uint8_t) WEB_SOCKET_FRAME_LENGTH64_FLAG);
+}
+
+constexpr uint8_t webSocket_frameByte1(bool masked, uint64_t length)
+{
+  return (uint8_t)((masked ? WEB_SOCKET_FRAME_MASKED : 0u)
+                   | webSocket_frameLengthField(length));
+}
+
+constexpr bool webSocket_frameIsFin(uint8_t byte0)
+{
+  return (byte0 & WEB_SOCKET_FRAME_FIN) != 0;
+}
+
+constexpr uint8_t webSocket_frameRsv(uint8_t byte0)
+{
+  return (uint8_t)((byte0 >> 4) & 0x07u);
+}
+
+constexpr uint8_t webSocket_frameOpcode(uint8_t byte0)
+{
+  return (uint8_t)(byte0 & WEB_SOCKET_FRAME_OPCODE);
+}
+
+constexpr bool webSocket_frameIsMasked(uint8_t byte1)
+{
+  return (byte1 & WEB_SOCKET_FRAME_MASKED) != 0;
+}
+
+constexpr uint8_t webSocket_frameLength7(uint8_t byte1)
+{
+  return (uint8_t)(byte1 & WEB_SOCKET_FRAME_LENGTH);
+}
+
+// bytes of extended payload length that follow the 7 bit length field
+constexpr uint8_t webSocket_frameExtendedSize(uint8_t length_field)
+{
+  return (length_field == WEB_SOCKET_FRAME_LENGTH16_FLAG) ? 2u
+         : ((length_field == WEB_SOCKET_FRAME_LENGTH64_FLAG) ? 8u : 0u);
+}
+
+// full header size known from the second header byte alone
+constexpr uint8_t webSocket_frameHeaderSize(uint8_t byte1)
+{
+  return (uint8_t)(WEB_SOCKET_HEAD_FRAME_SIZE
+                   + webSocket_frameExtendedSize(webSocket_frameLength7(byte1))
+                   + (webSocket_frameIsMasked(byte1) ? WEB_SOCKET_MASK_KEY_SIZE : 0u));
+}
+
+// header size needed to send a payload of length bytes
+constexpr uint8_t webSocket_frameEncodedSize(uint64_t length, bool masked)
+{
+  return webSocket_frameHeaderSize(webSocket_frameByte1(masked, length));
+}
+
+// First four header bytes (byte0, byte1, 16 bit extended length) of a fixed
+// size message packed big-endian, e.g.
+//   static constexpr uint32_t kPing = webSocket_frameHeaderConst(
+//       true, OPCODE_FRAME_PING, true, 4);
+// The header is webSocket_frameEncodedSize(length, false) bytes long without
+// the mask key, store it with webSocket_frameStoreConst().
+constexpr uint32_t webSocket_frameHeaderConst(bool fin, uint8_t opcode,
+                                              bool masked, uint16_t length)
+{
+  return ((uint32_t) webSocket_frameByte0(fin, 0, opcode) << 24)
+         | ((uint32_t) webSocket_frameByte1(masked, length) << 16)
+         | ((length > WEB_SOCKET_FRAME_LENGTH7_MAX) ? (uint32_t) length : 0u);
+}
+
+static inline uint8_t webSocket_frameStoreConst(uint8_t *dist, uint32_t header,
+                                                const uint8_t *mask)
+{
+  uint8_t index = 0;
+
+  dist[index++] = (uint8_t)(header >> 24);
+  dist[index++] = (uint8_t)(header >> 16);
+
+  if (webSocket_frameLength7((uint8_t)(header >> 16))
+      == WEB_SOCKET_FRAME_LENGTH16_FLAG)
+  {
+    dist[index++] = (uint8_t)(header >> 8);
+    dist[index++] = (uint8_t) header;
+  }
+
+  if (mask != NULL)
+  {
+    dist[index++] = mask[0];
+    dist[index++] = mask[1];
+    dist[index++] = mask[2];
+    dist[index++] = mask[3];
+  }
+
+  return index;
+}
+
+// Writes a header to dist (at least WEB_SOCKET_FRAME_HEADER_MAX bytes).
+// mask is NULL for an unmasked frame. Returns the header size.
+static inline uint8_t webSocket_frameEncodeHeader(uint8_t *dist, bool fin,
+                                                  uint8_t rsv, uint8_t opcode,
+                                                  const uint8_t *mask,
+                                                  uint64_t length)
+{
+  uint8_t index = 0;
+  uint8_t length_field = webSocket_frameLengthField(length);
+
+  dist[index++] = webSocket_frameByte0(fin, rsv, opcode);
+  dist[index++] = webSocket_frameByte1(mask != NULL, length);
+
+  if (length_field == WEB_SOCKET_FRAME_LENGTH16_FLAG)
+  {
+    dist[index++] = (uint8_t)(length >> 8);
+    dist[index++] = (uint8_t) length;
+  }
+  else if (length_field == WEB_SOCKET_FRAME_LENGTH64_FLAG)
+  {
+    for (int8_t shift = 56; shift >= 0; shift -= 8)
+    {
+      dist[index++] = (uint8_t)(length >> shift);
+    }
+  }
+
+  if (mask != NULL)
+  {
+    dist[index++] = mask[0];
+    dist[index++] = mask[1];
+    dist[index++] = mask[2];
+    dist[index++] = mask[3];
+  }
+
+  return index;
+}
+
+// Decodes the header at src. Returns the header size, or 0 when size is too
+// short to hold the whole header (call again with more bytes). A 64 bit
+// length with the most significant bit set, or a fragmented or longer than
+// 125 bytes control frame, returns WEB_SOCKET_FRAME_INVALID with info filled
+// in, so the caller can close with 1002.
+static inline uint8_t webSocket_frameDecodeHeader(const uint8_t *src,
+                                                  size_t size,
+                                                  WEB_SOCKET_FRAME_INFO *info)
+{
+  uint8_t index = WEB_SOCKET_HEAD_FRAME_SIZE;
+  uint8_t header_length = 0;
+
+  if (size < WEB_SOCKET_HEAD_FRAME_SIZE)
+  {
+    return 0;
+  }
+
+  header_length = webSocket_frameHeaderSize(src[1]);
+
+  if (size < header_length)
+  {
+    return 0;
+  }
+
+  info->fin = webSocket_frameIsFin(src[0]);
+  info->rsv = webSocket_frameRsv(src[0]);
+  info->opcode = webSocket_frameOpcode(src[0]);
+  info->masked = webSocket_frameIsMasked(src[1]);
+  info->length_field = webSocket_frameLength7(src[1]);
+  info->header_length = header_length;
+  info->payload_length = info->length_field;
+
+  if (info->length_field == WEB_SOCKET_FRAME_LENGTH16_FLAG)
+  {
+    info->payload_length = ((uint64_t) src[2] << 8) | src[3];
+    index += 2;
+  }
+  else if (info->length_field == WEB_SOCKET_FRAME_LENGTH64_FLAG)
+  {
+    info->payload_length = 0;
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+      info->payload_length = (info->payload_length << 8) | src[index++];
+    }
+  }
+
+  if (info->masked)
+  {
+    info->mask[0] = src[index++];
+    info->mask[1] = src[index++];
+    info->mask[2] = src[index++];
+    info->mask[3] = src[index++];
+  }
+  else
+  {
+    info->mask[0] = 0;
+    info->mask[1] = 0;
+    info->mask[2] = 0;
+    info->mask[3] = 0;
+  }
+
+  if ((info->payload_length >> 63)
+      || ((info->opcode & WEB_SOCKET_FRAME_CONTROL)
+          && (!info->fin || (info->payload_length > WEB_SOCKET_FRAME_LENGTH7_MAX))))
+  {
+    return WEB_SOCKET_FRAME_INVALID;
+  }
+
+  return header_length;
+}
+
+#endif /* WEBSOCKET_FRAME_H_ */
@@ -0,0 +1,95 @@
+/*
+ * @file    webSocketIngest.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include <string.h>
+#include "webSocketIngest.h"
+#include "webSocketFrame.h"
+
+#ifdef WEBSOCKET_INGEST
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#define WEB_SOCKET_INGEST_ALIGN		4
+#else
+#define ICACHE_RAM_ATTR
+#define WEB_SOCKET_INGEST_ALIGN		64  // keep head and tail on their own cache lines
+#endif // ARDUINO
+
+static_assert((WEB_SOCKET_INGEST_SLOTS & (WEB_SOCKET_INGEST_SLOTS - 1)) == 0,
+              "WEB_SOCKET_INGEST_SLOTS must be a power of two");
+
+// free running indexes, slot = index & (WEB_SOCKET_INGEST_SLOTS - 1)
+static uint32_t g_ingestHead __attribute__((aligned(WEB_SOCKET_INGEST_ALIGN))) = 0;  // producer
+static uint32_t g_ingestTail __attribute__((aligned(WEB_SOCKET_INGEST_ALIGN))) = 0;  // consumer
+static uint32_t g_ingestOverrun = 0;  // written by the producer only
+static WEB_SOCKET_INGEST_RECORD g_ingestRecord[WEB_SOCKET_INGEST_SLOTS];
+
+// Producer side, safe from an ISR (in IRAM) or another thread. Returns false
+// when the ring is full or the record too long, for a control frame too.
+bool ICACHE_RAM_ATTR webSocket_ingestPush(const void *data, uint8_t length,
+    uint8_t opcode)
+{
+  uint32_t head = __atomic_load_n(&g_ingestHead, __ATOMIC_RELAXED);
+  uint32_t tail = __atomic_load_n(&g_ingestTail, __ATOMIC_ACQUIRE);
+  WEB_SOCKET_INGEST_RECORD *record = NULL;
+
+  if ((head - tail >= WEB_SOCKET_INGEST_SLOTS)
+      || (length > WEB_SOCKET_INGEST_RECORD_SIZE)
+      || ((opcode & WEB_SOCKET_FRAME_CONTROL) && (length > WEB_SOCKET_FRAME_LENGTH7_MAX)))
+  {
+    __atomic_store_n(&g_ingestOverrun,
+                     __atomic_load_n(&g_ingestOverrun, __ATOMIC_RELAXED) + 1,
+                     __ATOMIC_RELAXED);
+    return false;
+  }
+
+  record = &g_ingestRecord[head & (WEB_SOCKET_INGEST_SLOTS - 1)];
+  record->opcode = opcode;
+  record->length = length;
+  memcpy(record->data, data, length);
+
+  // publish the record after its contents
+  __atomic_store_n(&g_ingestHead, head + 1, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+// Consumer side: oldest record or NULL, valid until webSocket_ingestPop().
+const WEB_SOCKET_INGEST_RECORD *webSocket_ingestPeek(void)
+{
+  uint32_t tail = __atomic_load_n(&g_ingestTail, __ATOMIC_RELAXED);
+  uint32_t head = __atomic_load_n(&g_ingestHead, __ATOMIC_ACQUIRE);
+
+  if (head == tail)
+  {
+    return NULL;
+  }
+
+  return &g_ingestRecord[tail & (WEB_SOCKET_INGEST_SLOTS - 1)];
+}
+
+void webSocket_ingestPop(void)
+{
+  uint32_t tail = __atomic_load_n(&g_ingestTail, __ATOMIC_RELAXED);
+
+  if (tail != __atomic_load_n(&g_ingestHead, __ATOMIC_ACQUIRE))
+  {
+    // hand the slot back after it has been read
+    __atomic_store_n(&g_ingestTail, tail + 1, __ATOMIC_RELEASE);
+  }
+}
+
+// records dropped because the ring was full
+uint32_t webSocket_ingestGetOverrun(void)
+{
+  return __atomic_load_n(&g_ingestOverrun, __ATOMIC_RELAXED);
+}
+
+#endif // WEBSOCKET_INGEST
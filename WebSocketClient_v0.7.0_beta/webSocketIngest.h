@@ -0,0 +1,53 @@
+/*
+ * @file    webSocketIngest.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_INGEST_H_
+#define WEBSOCKET_INGEST_H_
+
+#include <stdint.h>
+#include "webSocketConfig.h"
+
+// Single producer, single consumer ring of fixed-size records. The producer
+// is one ISR or one thread, the consumer is webSocket_handle(), which turns
+// every record into a frame. webSocket_ingestPush() never waits: when the
+// ring is full the record is counted as an overrun and dropped.
+//
+//   void ICACHE_RAM_ATTR onSample(void) {
+//     uint16_t value = readAdcRegister();
+//     webSocket_ingestPush(&value, sizeof(value), OPCODE_FRAME_BINARY);
+//   }
+
+#ifndef WEB_SOCKET_INGEST_SLOTS
+#define WEB_SOCKET_INGEST_SLOTS			16u  // power of two
+#endif
+#ifndef WEB_SOCKET_INGEST_RECORD_SIZE
+#define WEB_SOCKET_INGEST_RECORD_SIZE	32u
+#endif
+#ifndef WEB_SOCKET_INGEST_BATCH
+#define WEB_SOCKET_INGEST_BATCH			8u   // records sent per handle
+#endif
+
+typedef struct _WEB_SOCKET_INGEST_RECORD
+{
+  uint8_t opcode;
+  uint8_t length;
+  char data[WEB_SOCKET_INGEST_RECORD_SIZE];
+} WEB_SOCKET_INGEST_RECORD;
+
+#ifdef WEBSOCKET_INGEST
+
+extern bool webSocket_ingestPush(const void *data, uint8_t length,
+                                 uint8_t opcode);
+extern const WEB_SOCKET_INGEST_RECORD *webSocket_ingestPeek(void);
+extern void webSocket_ingestPop(void);
+extern uint32_t webSocket_ingestGetOverrun(void);
+
+#endif // WEBSOCKET_INGEST
+
+#endif /* WEBSOCKET_INGEST_H_ */
@@ -0,0 +1,341 @@
+/*
+ * @file    webSocketJson.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include "webSocketJson.h"
+
+#define WEB_SOCKET_JSON_DECIMALS_MAX	6u
+
+static const char g_webSocketJsonHex[] = "0123456789abcdef";
+
+static void webSocket_jsonPut(WEB_SOCKET_JSON_WRITER *json, char c);
+static void webSocket_jsonPutN(WEB_SOCKET_JSON_WRITER *json, const char *data,
+                               uint16_t length);
+static void webSocket_jsonPutUInt(WEB_SOCKET_JSON_WRITER *json, uint32_t value,
+                                  uint8_t digits);
+static void webSocket_jsonPutEscaped(WEB_SOCKET_JSON_WRITER *json,
+                                     const char *value, uint16_t length);
+static void webSocket_jsonSeparator(WEB_SOCKET_JSON_WRITER *json);
+static void webSocket_jsonOpen(WEB_SOCKET_JSON_WRITER *json, char c);
+static void webSocket_jsonClose(WEB_SOCKET_JSON_WRITER *json, char c);
+
+void webSocket_jsonInit(WEB_SOCKET_JSON_WRITER *json, char *buffer,
+                        uint16_t capacity)
+{
+  json->buffer = buffer;
+  json->capacity = capacity;
+  json->length = 0;
+  json->has_item = 0;
+  json->depth = 0;
+  json->is_key = false;
+  json->is_overflow = (buffer == NULL);
+}
+
+bool webSocket_jsonBegin(WEB_SOCKET_JSON_WRITER *json)
+{
+  uint16_t capacity = 0;
+  char *buffer = webSocket_beginFrame(&capacity);
+
+  webSocket_jsonInit(json, buffer, capacity);
+
+  return buffer != NULL;
+}
+
+// Frames what was written. Nothing is sent when the payload did not fit or
+// is not a complete value, and the send block goes back to the engine.
+bool webSocket_jsonCommit(WEB_SOCKET_JSON_WRITER *json)
+{
+  if (json->is_overflow || json->depth || json->is_key)
+  {
+    webSocket_cancelFrame();
+    return false;
+  }
+
+  return webSocket_commitFrame(json->length, OPCODE_FRAME_TEXT);
+}
+
+void webSocket_jsonObjectBegin(WEB_SOCKET_JSON_WRITER *json)
+{
+  webSocket_jsonOpen(json, '{');
+}
+
+void webSocket_jsonObjectEnd(WEB_SOCKET_JSON_WRITER *json)
+{
+  webSocket_jsonClose(json, '}');
+}
+
+void webSocket_jsonArrayBegin(WEB_SOCKET_JSON_WRITER *json)
+{
+  webSocket_jsonOpen(json, '[');
+}
+
+void webSocket_jsonArrayEnd(WEB_SOCKET_JSON_WRITER *json)
+{
+  webSocket_jsonClose(json, ']');
+}
+
+void webSocket_jsonKey(WEB_SOCKET_JSON_WRITER *json, const char *key)
+{
+  if (json->is_key)
+  {
+    json->is_overflow = true;  // the previous key has no value
+  }
+
+  webSocket_jsonSeparator(json);
+  webSocket_jsonPut(json, '"');
+  webSocket_jsonPutEscaped(json, key, strlen(key));
+  webSocket_jsonPut(json, '"');
+  webSocket_jsonPut(json, ':');
+  json->is_key = true;
+}
+
+void webSocket_jsonString(WEB_SOCKET_JSON_WRITER *json, const char *value)
+{
+  webSocket_jsonStringN(json, value, strlen(value));
+}
+
+void webSocket_jsonStringN(WEB_SOCKET_JSON_WRITER *json, const char *value,
+                           uint16_t length)
+{
+  webSocket_jsonSeparator(json);
+  webSocket_jsonPut(json, '"');
+  webSocket_jsonPutEscaped(json, value, length);
+  webSocket_jsonPut(json, '"');
+}
+
+void webSocket_jsonInt(WEB_SOCKET_JSON_WRITER *json, int32_t value)
+{
+  webSocket_jsonSeparator(json);
+
+  if (value < 0)
+  {
+    webSocket_jsonPut(json, '-');
+    webSocket_jsonPutUInt(json, (uint32_t)(-(value + 1)) + 1, 1);
+  }
+  else
+  {
+    webSocket_jsonPutUInt(json, (uint32_t) value, 1);
+  }
+}
+
+void webSocket_jsonUInt(WEB_SOCKET_JSON_WRITER *json, uint32_t value)
+{
+  webSocket_jsonSeparator(json);
+  webSocket_jsonPutUInt(json, value, 1);
+}
+
+// fixed point with up to 6 decimals; NaN, infinity and values beyond the
+// 32 bit integer range are written as null
+void webSocket_jsonFloat(WEB_SOCKET_JSON_WRITER *json, float value,
+                         uint8_t decimals)
+{
+  uint32_t scale = 1;
+  uint32_t integer = 0;
+  uint32_t fraction = 0;
+
+  if (decimals > WEB_SOCKET_JSON_DECIMALS_MAX)
+  {
+    decimals = WEB_SOCKET_JSON_DECIMALS_MAX;
+  }
+
+  if ((value != value) || (value >= 4294967040.0f) || (value <= -4294967040.0f))
+  {
+    webSocket_jsonNull(json);
+    return;
+  }
+
+  webSocket_jsonSeparator(json);
+
+  if (value < 0)
+  {
+    webSocket_jsonPut(json, '-');
+    value = -value;
+  }
+
+  for (uint8_t i = 0; i < decimals; i++)
+  {
+    scale *= 10;
+  }
+
+  integer = (uint32_t) value;
+  fraction = (uint32_t)((value - (float) integer) * scale + 0.5f);
+
+  if (fraction >= scale)
+  {
+    integer++;
+    fraction -= scale;
+  }
+
+  webSocket_jsonPutUInt(json, integer, 1);
+
+  if (decimals)
+  {
+    webSocket_jsonPut(json, '.');
+    webSocket_jsonPutUInt(json, fraction, decimals);
+  }
+}
+
+void webSocket_jsonBool(WEB_SOCKET_JSON_WRITER *json, bool value)
+{
+  webSocket_jsonSeparator(json);
+
+  if (value)
+  {
+    webSocket_jsonPutN(json, "true", 4);
+  }
+  else
+  {
+    webSocket_jsonPutN(json, "false", 5);
+  }
+}
+
+void webSocket_jsonNull(WEB_SOCKET_JSON_WRITER *json)
+{
+  webSocket_jsonSeparator(json);
+  webSocket_jsonPutN(json, "null", 4);
+}
+
+static void webSocket_jsonPut(WEB_SOCKET_JSON_WRITER *json, char c)
+{
+  if (json->length < json->capacity)
+  {
+    json->buffer[json->length++] = c;
+  }
+  else
+  {
+    json->is_overflow = true;
+  }
+}
+
+static void webSocket_jsonPutN(WEB_SOCKET_JSON_WRITER *json, const char *data,
+                               uint16_t length)
+{
+  if (length <= json->capacity - json->length)
+  {
+    memcpy(&json->buffer[json->length], data, length);
+    json->length += length;
+  }
+  else
+  {
+    json->is_overflow = true;
+  }
+}
+
+// decimal, left padded with zeros to at least digits characters
+static void webSocket_jsonPutUInt(WEB_SOCKET_JSON_WRITER *json, uint32_t value,
+                                  uint8_t digits)
+{
+  char text[10];
+  uint8_t index = sizeof(text);
+
+  do
+  {
+    text[--index] = '0' + (value % 10);
+    value /= 10;
+  } while (value || (sizeof(text) - index < digits));
+
+  webSocket_jsonPutN(json, &text[index], sizeof(text) - index);
+}
+
+static void webSocket_jsonPutEscaped(WEB_SOCKET_JSON_WRITER *json,
+                                     const char *value, uint16_t length)
+{
+  uint16_t start = 0;
+  uint8_t c = 0;
+
+  for (uint16_t i = 0; i < length; i++)
+  {
+    c = (uint8_t) value[i];
+
+    if ((c >= 0x20) && (c != '"') && (c != '\\'))
+    {
+      continue;
+    }
+
+    // copy the plain run in one go, then the escape sequence
+    webSocket_jsonPutN(json, &value[start], i - start);
+    start = i + 1;
+    webSocket_jsonPut(json, '\\');
+
+    switch (c)
+    {
+      case '"':
+      case '\\':
+        webSocket_jsonPut(json, (char) c);
+        break;
+      case '\n':
+        webSocket_jsonPut(json, 'n');
+        break;
+      case '\r':
+        webSocket_jsonPut(json, 'r');
+        break;
+      case '\t':
+        webSocket_jsonPut(json, 't');
+        break;
+      case '\b':
+        webSocket_jsonPut(json, 'b');
+        break;
+      case '\f':
+        webSocket_jsonPut(json, 'f');
+        break;
+      default:
+        webSocket_jsonPutN(json, "u00", 3);
+        webSocket_jsonPut(json, g_webSocketJsonHex[c >> 4]);
+        webSocket_jsonPut(json, g_webSocketJsonHex[c & 0x0F]);
+        break;
+    }
+  }
+
+  webSocket_jsonPutN(json, &value[start], length - start);
+}
+
+// comma before every value or key but the first one of a container
+static void webSocket_jsonSeparator(WEB_SOCKET_JSON_WRITER *json)
+{
+  if (json->is_key)
+  {
+    json->is_key = false;
+    return;
+  }
+
+  if (json->has_item & (1u << json->depth))
+  {
+    webSocket_jsonPut(json, ',');
+  }
+
+  json->has_item |= (1u << json->depth);
+}
+
+static void webSocket_jsonOpen(WEB_SOCKET_JSON_WRITER *json, char c)
+{
+  webSocket_jsonSeparator(json);
+  webSocket_jsonPut(json, c);
+
+  if (json->depth + 1u >= WEB_SOCKET_JSON_DEPTH_MAX)
+  {
+    json->is_overflow = true;
+    return;
+  }
+
+  json->depth++;
+  json->has_item &= ~(1u << json->depth);
+}
+
+static void webSocket_jsonClose(WEB_SOCKET_JSON_WRITER *json, char c)
+{
+  webSocket_jsonPut(json, c);
+
+  if ((json->depth == 0) || json->is_key)
+  {
+    json->is_overflow = true;
+    return;
+  }
+
+  json->depth--;
+}
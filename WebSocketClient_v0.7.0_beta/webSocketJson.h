@@ -0,0 +1,61 @@
+/*
+ * @file    webSocketJson.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_JSON_H_
+#define WEBSOCKET_JSON_H_
+
+#include "webSocket.h"
+
+#define WEB_SOCKET_JSON_DEPTH_MAX		16u
+
+// Streaming JSON writer. webSocket_jsonBegin() serializes straight into the
+// payload area of the outgoing frame and webSocket_jsonCommit() frames it,
+// no String and no heap. Commas and nesting are tracked by the writer:
+//
+//   WEB_SOCKET_JSON_WRITER json;
+//   if (webSocket_jsonBegin(&json)) {
+//     webSocket_jsonObjectBegin(&json);
+//     webSocket_jsonKey(&json, "message");
+//     webSocket_jsonString(&json, "Hello");
+//     webSocket_jsonObjectEnd(&json);
+//     webSocket_jsonCommit(&json);
+//   }
+typedef struct _WEB_SOCKET_JSON_WRITER
+{
+  char *buffer;
+  uint16_t capacity;
+  uint16_t length;
+  uint16_t has_item;   // bit n: depth n already holds a value
+  uint8_t depth;
+  bool is_key;         // a key was written, its value follows
+  bool is_overflow;
+} WEB_SOCKET_JSON_WRITER;
+
+extern void webSocket_jsonInit(WEB_SOCKET_JSON_WRITER *json, char *buffer,
+                               uint16_t capacity);
+extern bool webSocket_jsonBegin(WEB_SOCKET_JSON_WRITER *json);
+extern bool webSocket_jsonCommit(WEB_SOCKET_JSON_WRITER *json);
+
+extern void webSocket_jsonObjectBegin(WEB_SOCKET_JSON_WRITER *json);
+extern void webSocket_jsonObjectEnd(WEB_SOCKET_JSON_WRITER *json);
+extern void webSocket_jsonArrayBegin(WEB_SOCKET_JSON_WRITER *json);
+extern void webSocket_jsonArrayEnd(WEB_SOCKET_JSON_WRITER *json);
+extern void webSocket_jsonKey(WEB_SOCKET_JSON_WRITER *json, const char *key);
+extern void webSocket_jsonString(WEB_SOCKET_JSON_WRITER *json,
+                                 const char *value);
+extern void webSocket_jsonStringN(WEB_SOCKET_JSON_WRITER *json,
+                                  const char *value, uint16_t length);
+extern void webSocket_jsonInt(WEB_SOCKET_JSON_WRITER *json, int32_t value);
+extern void webSocket_jsonUInt(WEB_SOCKET_JSON_WRITER *json, uint32_t value);
+extern void webSocket_jsonFloat(WEB_SOCKET_JSON_WRITER *json, float value,
+                                uint8_t decimals);
+extern void webSocket_jsonBool(WEB_SOCKET_JSON_WRITER *json, bool value);
+extern void webSocket_jsonNull(WEB_SOCKET_JSON_WRITER *json);
+
+#endif /* WEBSOCKET_JSON_H_ */
@@ -0,0 +1,109 @@
+/*
+ * @file    webSocketLog.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include <stdio.h>
+#include <Arduino.h>
+#include <Print.h>
+#include "webSocketLog.h"
+
+#ifdef WEBSOCKET_LOG
+
+static const char g_logLevelName[] = "-EWID";
+
+static WEB_SOCKET_LOG_RECORD g_logRecord[WEB_SOCKET_LOG_SLOTS];
+static uint16_t g_logHead = 0;
+static uint16_t g_logCount = 0;
+static uint32_t g_logLost = 0;
+
+void webSocket_logWrite(uint8_t level, const char *format, uint8_t argc,
+                        const uint32_t *args)
+{
+  WEB_SOCKET_LOG_RECORD *record = NULL;
+
+  if (g_logCount >= WEB_SOCKET_LOG_SLOTS)
+  {
+    g_logLost++;
+    return;
+  }
+
+  record = &g_logRecord[(g_logHead + g_logCount) % WEB_SOCKET_LOG_SLOTS];
+  record->time = millis();
+  record->format = format;
+  record->level = level;
+  record->argc = argc;
+  memcpy(record->args, args, argc * sizeof(uint32_t));
+  g_logCount++;
+}
+
+// Formats and removes the oldest record as "time L message". Returns the
+// line length, 0 when the ring is empty.
+uint16_t webSocket_logFormat(char *line, uint16_t size)
+{
+  const WEB_SOCKET_LOG_RECORD *record = &g_logRecord[g_logHead];
+  int length = 0;
+  int message = 0;
+
+  if ((g_logCount == 0) || (size == 0))
+  {
+    return 0;
+  }
+
+  length = snprintf(line, size, "%lu %c ", (unsigned long) record->time,
+                    g_logLevelName[(record->level < 5) ? record->level : 0]);
+
+  if ((length >= 0) && (length < size))
+  {
+    // unused arguments are passed too, printf ignores them
+    message = snprintf_P(&line[length], size - length, record->format,
+                         record->args[0], record->args[1], record->args[2],
+                         record->args[3]);
+    length += (message > 0) ? message : 0;
+  }
+
+  if (length >= size)
+  {
+    length = size - 1; // truncated
+  }
+
+  g_logHead = (g_logHead + 1) % WEB_SOCKET_LOG_SLOTS;
+  g_logCount--;
+
+  return (length > 0) ? length : 0;
+}
+
+// prints up to max records, with a note when records were lost
+uint16_t webSocket_logDrain(Print &out, uint16_t max)
+{
+  char line[WEB_SOCKET_LOG_LINE_SIZE];
+  uint16_t count = 0;
+
+  if (g_logLost)
+  {
+    snprintf(line, sizeof(line), "(%lu log records lost)",
+             (unsigned long) g_logLost);
+    out.println(line);
+    g_logLost = 0;
+  }
+
+  while ((count < max) && webSocket_logFormat(line, sizeof(line)))
+  {
+    out.println(line);
+    count++;
+  }
+
+  return count;
+}
+
+uint32_t webSocket_logGetLost(void)
+{
+  return g_logLost;
+}
+
+#endif // WEBSOCKET_LOG
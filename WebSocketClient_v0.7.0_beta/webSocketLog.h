@@ -0,0 +1,106 @@
+/*
+ * @file    webSocketLog.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_LOG_H_
+#define WEBSOCKET_LOG_H_
+
+#include <stdint.h>
+#include "webSocketConfig.h"
+
+// Leveled, deferred logging. A log call below WEB_SOCKET_LOG_LEVEL is
+// compiled out, arguments included. Otherwise it stores a timestamp, the
+// address of its format string (kept in flash by PSTR) and up to
+// WEB_SOCKET_LOG_ARGS integer arguments in a RAM ring; nothing is
+// formatted or printed until webSocket_logDrain() or webSocket_logFormat()
+// runs outside the time critical path:
+//
+//   WEB_SOCKET_LOG_WARN("payload %u over %u", length, WEB_SOCKET_RECIVE_PAYLOAD_SIZE);
+//   ...
+//   webSocket_logDrain(Serial, 4);  // in loop(), when there is time
+//
+// Arguments are stored as 32 bit integers: %d, %u, %x and %c only, no
+// strings or pointers. When the ring is full new records are counted as
+// lost.
+
+#define WEB_SOCKET_LOG_LEVEL_NONE		0
+#define WEB_SOCKET_LOG_LEVEL_ERROR		1
+#define WEB_SOCKET_LOG_LEVEL_WARN		2
+#define WEB_SOCKET_LOG_LEVEL_INFO		3
+#define WEB_SOCKET_LOG_LEVEL_DEBUG		4
+
+#ifndef WEB_SOCKET_LOG_LEVEL
+#define WEB_SOCKET_LOG_LEVEL			WEB_SOCKET_LOG_LEVEL_INFO
+#endif
+#ifndef WEB_SOCKET_LOG_SLOTS
+#define WEB_SOCKET_LOG_SLOTS			16u
+#endif
+#define WEB_SOCKET_LOG_ARGS				4u
+#define WEB_SOCKET_LOG_LINE_SIZE		96u
+
+#ifndef PSTR
+#define PSTR(s)							(s)
+#endif
+
+typedef struct _WEB_SOCKET_LOG_RECORD
+{
+  uint32_t time;//msec
+  const char *format;  // in flash on the ESP8266
+  uint8_t level;
+  uint8_t argc;
+  uint32_t args[WEB_SOCKET_LOG_ARGS];
+} WEB_SOCKET_LOG_RECORD;
+
+#ifdef WEBSOCKET_LOG
+
+class Print;
+
+extern void webSocket_logWrite(uint8_t level, const char *format, uint8_t argc,
+                               const uint32_t *args);
+extern uint16_t webSocket_logFormat(char *line, uint16_t size);
+extern uint16_t webSocket_logDrain(Print &out, uint16_t max);
+extern uint32_t webSocket_logGetLost(void);
+
+template<typename... T>
+static inline void webSocket_logPut(uint8_t level, const char *format,
+                                    T... args)
+{
+  const uint32_t values[] = { 0, (uint32_t) args... };
+
+  static_assert(sizeof...(T) <= WEB_SOCKET_LOG_ARGS, "too many log arguments");
+
+  webSocket_logWrite(level, format, sizeof...(T), &values[1]);
+}
+
+#define WEB_SOCKET_LOG(level, format, ...) \
+  webSocket_logPut(level, PSTR(format), ##__VA_ARGS__)
+
+#endif // WEBSOCKET_LOG
+
+#if defined(WEBSOCKET_LOG) && (WEB_SOCKET_LOG_LEVEL >= WEB_SOCKET_LOG_LEVEL_ERROR)
+#define WEB_SOCKET_LOG_ERROR(format, ...)	WEB_SOCKET_LOG(WEB_SOCKET_LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#else
+#define WEB_SOCKET_LOG_ERROR(format, ...)
+#endif
+#if defined(WEBSOCKET_LOG) && (WEB_SOCKET_LOG_LEVEL >= WEB_SOCKET_LOG_LEVEL_WARN)
+#define WEB_SOCKET_LOG_WARN(format, ...)	WEB_SOCKET_LOG(WEB_SOCKET_LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#else
+#define WEB_SOCKET_LOG_WARN(format, ...)
+#endif
+#if defined(WEBSOCKET_LOG) && (WEB_SOCKET_LOG_LEVEL >= WEB_SOCKET_LOG_LEVEL_INFO)
+#define WEB_SOCKET_LOG_INFO(format, ...)	WEB_SOCKET_LOG(WEB_SOCKET_LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#else
+#define WEB_SOCKET_LOG_INFO(format, ...)
+#endif
+#if defined(WEBSOCKET_LOG) && (WEB_SOCKET_LOG_LEVEL >= WEB_SOCKET_LOG_LEVEL_DEBUG)
+#define WEB_SOCKET_LOG_DEBUG(format, ...)	WEB_SOCKET_LOG(WEB_SOCKET_LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#else
+#define WEB_SOCKET_LOG_DEBUG(format, ...)
+#endif
+
+#endif /* WEBSOCKET_LOG_H_ */
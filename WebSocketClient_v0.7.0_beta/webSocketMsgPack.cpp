@@ -0,0 +1,670 @@
+/*
+ * @file    webSocketMsgPack.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include "webSocketMsgPack.h"
+
+// decoded head of the next value
+typedef struct _WEB_SOCKET_MSGPACK_HEAD
+{
+  uint8_t type;
+  uint8_t size;         // bytes of the head itself
+  bool is_negative;     // integer is a negative signed value
+  uint32_t length;      // str/bin/ext bytes after the head, array/map count
+  uint64_t integer;     // INT value (two's complement when negative), BOOL
+  double real;
+} WEB_SOCKET_MSGPACK_HEAD;
+
+static void webSocket_msgpackPut(WEB_SOCKET_MSGPACK_WRITER *pack,
+                                 uint8_t marker, uint32_t value,
+                                 uint8_t size);
+static void webSocket_msgpackPutN(WEB_SOCKET_MSGPACK_WRITER *pack,
+                                  const void *data, uint16_t length);
+static uint64_t webSocket_msgpackGet(const uint8_t *data, uint8_t size);
+static bool webSocket_msgpackHead(WEB_SOCKET_MSGPACK_READER *unpack,
+                                  WEB_SOCKET_MSGPACK_HEAD *head);
+static bool webSocket_msgpackNext(WEB_SOCKET_MSGPACK_READER *unpack,
+                                  WEB_SOCKET_MSGPACK_HEAD *head,
+                                  uint8_t type);
+
+void webSocket_msgpackInit(WEB_SOCKET_MSGPACK_WRITER *pack, char *buffer,
+                           uint16_t capacity)
+{
+  pack->buffer = buffer;
+  pack->capacity = capacity;
+  pack->length = 0;
+  pack->is_overflow = (buffer == NULL);
+}
+
+bool webSocket_msgpackBegin(WEB_SOCKET_MSGPACK_WRITER *pack)
+{
+  uint16_t capacity = 0;
+  char *buffer = webSocket_beginFrame(&capacity);
+
+  webSocket_msgpackInit(pack, buffer, capacity);
+
+  return buffer != NULL;
+}
+
+bool webSocket_msgpackCommit(WEB_SOCKET_MSGPACK_WRITER *pack)
+{
+  if (pack->is_overflow)
+  {
+    webSocket_cancelFrame();
+    return false;
+  }
+
+  return webSocket_commitFrame(pack->length, OPCODE_FRAME_BINARY);
+}
+
+void webSocket_msgpackNil(WEB_SOCKET_MSGPACK_WRITER *pack)
+{
+  webSocket_msgpackPut(pack, 0xC0, 0, 0);
+}
+
+void webSocket_msgpackBool(WEB_SOCKET_MSGPACK_WRITER *pack, bool value)
+{
+  webSocket_msgpackPut(pack, value ? 0xC3 : 0xC2, 0, 0);
+}
+
+// smallest encoding that holds the value
+void webSocket_msgpackInt(WEB_SOCKET_MSGPACK_WRITER *pack, int32_t value)
+{
+  if (value >= 0)
+  {
+    webSocket_msgpackUInt(pack, (uint32_t) value);
+  }
+  else if (value >= -32)
+  {
+    webSocket_msgpackPut(pack, (uint8_t) value, 0, 0);
+  }
+  else if (value >= INT8_MIN)
+  {
+    webSocket_msgpackPut(pack, 0xD0, (uint32_t) value, 1);
+  }
+  else if (value >= INT16_MIN)
+  {
+    webSocket_msgpackPut(pack, 0xD1, (uint32_t) value, 2);
+  }
+  else
+  {
+    webSocket_msgpackPut(pack, 0xD2, (uint32_t) value, 4);
+  }
+}
+
+void webSocket_msgpackUInt(WEB_SOCKET_MSGPACK_WRITER *pack, uint32_t value)
+{
+  if (value <= 0x7F)
+  {
+    webSocket_msgpackPut(pack, (uint8_t) value, 0, 0);
+  }
+  else if (value <= UINT8_MAX)
+  {
+    webSocket_msgpackPut(pack, 0xCC, value, 1);
+  }
+  else if (value <= UINT16_MAX)
+  {
+    webSocket_msgpackPut(pack, 0xCD, value, 2);
+  }
+  else
+  {
+    webSocket_msgpackPut(pack, 0xCE, value, 4);
+  }
+}
+
+void webSocket_msgpackFloat(WEB_SOCKET_MSGPACK_WRITER *pack, float value)
+{
+  uint32_t bits = 0;
+
+  memcpy(&bits, &value, sizeof(bits));
+  webSocket_msgpackPut(pack, 0xCA, bits, 4);
+}
+
+void webSocket_msgpackStr(WEB_SOCKET_MSGPACK_WRITER *pack, const char *value,
+                          uint16_t length)
+{
+  if (length <= 31)
+  {
+    webSocket_msgpackPut(pack, 0xA0 | length, 0, 0);
+  }
+  else if (length <= UINT8_MAX)
+  {
+    webSocket_msgpackPut(pack, 0xD9, length, 1);
+  }
+  else
+  {
+    webSocket_msgpackPut(pack, 0xDA, length, 2);
+  }
+
+  webSocket_msgpackPutN(pack, value, length);
+}
+
+void webSocket_msgpackBin(WEB_SOCKET_MSGPACK_WRITER *pack, const void *value,
+                          uint16_t length)
+{
+  if (length <= UINT8_MAX)
+  {
+    webSocket_msgpackPut(pack, 0xC4, length, 1);
+  }
+  else
+  {
+    webSocket_msgpackPut(pack, 0xC5, length, 2);
+  }
+
+  webSocket_msgpackPutN(pack, value, length);
+}
+
+// followed by count values
+void webSocket_msgpackArray(WEB_SOCKET_MSGPACK_WRITER *pack, uint16_t count)
+{
+  if (count <= 15)
+  {
+    webSocket_msgpackPut(pack, 0x90 | count, 0, 0);
+  }
+  else
+  {
+    webSocket_msgpackPut(pack, 0xDC, count, 2);
+  }
+}
+
+// followed by count key/value pairs
+void webSocket_msgpackMap(WEB_SOCKET_MSGPACK_WRITER *pack, uint16_t count)
+{
+  if (count <= 15)
+  {
+    webSocket_msgpackPut(pack, 0x80 | count, 0, 0);
+  }
+  else
+  {
+    webSocket_msgpackPut(pack, 0xDE, count, 2);
+  }
+}
+
+void webSocket_msgpackReaderInit(WEB_SOCKET_MSGPACK_READER *unpack,
+                                 const char *data, uint16_t length)
+{
+  unpack->data = (const uint8_t *) data;
+  unpack->length = length;
+  unpack->index = 0;
+  unpack->is_error = false;
+}
+
+// reader over the payload received in the current webSocket_handle()
+void webSocket_msgpackReaderBegin(WEB_SOCKET_MSGPACK_READER *unpack)
+{
+  webSocket_msgpackReaderInit(unpack, webSocket_getPayload(),
+                              webSocket_available());
+}
+
+// type of the next value, WEBSOCKET_MSGPACK_INVALID at the end or on error
+uint8_t webSocket_msgpackPeekType(WEB_SOCKET_MSGPACK_READER *unpack)
+{
+  WEB_SOCKET_MSGPACK_HEAD head;
+
+  if (!webSocket_msgpackHead(unpack, &head))
+  {
+    return WEBSOCKET_MSGPACK_INVALID;
+  }
+
+  return head.type;
+}
+
+bool webSocket_msgpackReadNil(WEB_SOCKET_MSGPACK_READER *unpack)
+{
+  WEB_SOCKET_MSGPACK_HEAD head;
+
+  return webSocket_msgpackNext(unpack, &head, WEBSOCKET_MSGPACK_NIL);
+}
+
+bool webSocket_msgpackReadBool(WEB_SOCKET_MSGPACK_READER *unpack, bool *value)
+{
+  WEB_SOCKET_MSGPACK_HEAD head;
+
+  if (!webSocket_msgpackNext(unpack, &head, WEBSOCKET_MSGPACK_BOOL))
+  {
+    return false;
+  }
+
+  *value = (head.integer != 0);
+
+  return true;
+}
+
+// any integer encoding whose value fits
+bool webSocket_msgpackReadInt(WEB_SOCKET_MSGPACK_READER *unpack,
+                              int32_t *value)
+{
+  WEB_SOCKET_MSGPACK_HEAD head;
+
+  if (!webSocket_msgpackHead(unpack, &head)
+      || (head.type != WEBSOCKET_MSGPACK_INT)
+      || (head.is_negative && ((int64_t) head.integer < INT32_MIN))
+      || (!head.is_negative && (head.integer > INT32_MAX)))
+  {
+    return false;
+  }
+
+  unpack->index += head.size;
+  *value = (int32_t) head.integer;
+
+  return true;
+}
+
+bool webSocket_msgpackReadUInt(WEB_SOCKET_MSGPACK_READER *unpack,
+                               uint32_t *value)
+{
+  WEB_SOCKET_MSGPACK_HEAD head;
+
+  if (!webSocket_msgpackHead(unpack, &head)
+      || (head.type != WEBSOCKET_MSGPACK_INT)
+      || head.is_negative
+      || (head.integer > UINT32_MAX))
+  {
+    return false;
+  }
+
+  unpack->index += head.size;
+  *value = (uint32_t) head.integer;
+
+  return true;
+}
+
+// float32, float64 and integers
+bool webSocket_msgpackReadFloat(WEB_SOCKET_MSGPACK_READER *unpack,
+                                float *value)
+{
+  WEB_SOCKET_MSGPACK_HEAD head;
+
+  if (!webSocket_msgpackHead(unpack, &head))
+  {
+    return false;
+  }
+
+  if (head.type == WEBSOCKET_MSGPACK_FLOAT)
+  {
+    *value = (float) head.real;
+  }
+  else if (head.type == WEBSOCKET_MSGPACK_INT)
+  {
+    *value = head.is_negative ? (float)(int64_t) head.integer
+             : (float) head.integer;
+  }
+  else
+  {
+    return false;
+  }
+
+  unpack->index += head.size;
+
+  return true;
+}
+
+// value points into the buffer and is not NUL terminated
+bool webSocket_msgpackReadStr(WEB_SOCKET_MSGPACK_READER *unpack,
+                              const char **value, uint16_t *length)
+{
+  WEB_SOCKET_MSGPACK_HEAD head;
+  uint16_t index = unpack->index;
+
+  if (!webSocket_msgpackNext(unpack, &head, WEBSOCKET_MSGPACK_STR))
+  {
+    return false;
+  }
+
+  *value = (const char *) &unpack->data[index + head.size];
+  *length = (uint16_t) head.length;
+  unpack->index += head.length;
+
+  return true;
+}
+
+bool webSocket_msgpackReadBin(WEB_SOCKET_MSGPACK_READER *unpack,
+                              const uint8_t **value, uint16_t *length)
+{
+  WEB_SOCKET_MSGPACK_HEAD head;
+  uint16_t index = unpack->index;
+
+  if (!webSocket_msgpackNext(unpack, &head, WEBSOCKET_MSGPACK_BIN))
+  {
+    return false;
+  }
+
+  *value = &unpack->data[index + head.size];
+  *length = (uint16_t) head.length;
+  unpack->index += head.length;
+
+  return true;
+}
+
+bool webSocket_msgpackReadArray(WEB_SOCKET_MSGPACK_READER *unpack,
+                                uint16_t *count)
+{
+  WEB_SOCKET_MSGPACK_HEAD head;
+
+  if (!webSocket_msgpackNext(unpack, &head, WEBSOCKET_MSGPACK_ARRAY))
+  {
+    return false;
+  }
+
+  *count = (uint16_t) head.length;
+
+  return true;
+}
+
+bool webSocket_msgpackReadMap(WEB_SOCKET_MSGPACK_READER *unpack,
+                              uint16_t *count)
+{
+  WEB_SOCKET_MSGPACK_HEAD head;
+
+  if (!webSocket_msgpackNext(unpack, &head, WEBSOCKET_MSGPACK_MAP))
+  {
+    return false;
+  }
+
+  *count = (uint16_t) head.length;
+
+  return true;
+}
+
+// skips the next value including everything nested in it, no recursion
+bool webSocket_msgpackSkip(WEB_SOCKET_MSGPACK_READER *unpack)
+{
+  WEB_SOCKET_MSGPACK_HEAD head;
+  uint32_t pending = 1;
+
+  while (pending)
+  {
+    if (!webSocket_msgpackHead(unpack, &head))
+    {
+      return false;
+    }
+
+    unpack->index += head.size;
+    pending--;
+
+    switch (head.type)
+    {
+      case WEBSOCKET_MSGPACK_STR:
+      case WEBSOCKET_MSGPACK_BIN:
+      case WEBSOCKET_MSGPACK_EXT:
+        unpack->index += head.length;
+        break;
+      case WEBSOCKET_MSGPACK_ARRAY:
+        pending += head.length;
+        break;
+      case WEBSOCKET_MSGPACK_MAP:
+        pending += head.length * 2;
+        break;
+      default:
+        break;
+    }
+  }
+
+  return true;
+}
+
+static void webSocket_msgpackPut(WEB_SOCKET_MSGPACK_WRITER *pack,
+                                 uint8_t marker, uint32_t value,
+                                 uint8_t size)
+{
+  if (pack->length + 1u + size > pack->capacity)
+  {
+    pack->is_overflow = true;
+    return;
+  }
+
+  pack->buffer[pack->length++] = (char) marker;
+
+  while (size)
+  {
+    size--;
+    pack->buffer[pack->length++] = (char)(value >> (size * 8));
+  }
+}
+
+static void webSocket_msgpackPutN(WEB_SOCKET_MSGPACK_WRITER *pack,
+                                  const void *data, uint16_t length)
+{
+  if (pack->length + (uint32_t) length > pack->capacity)
+  {
+    pack->is_overflow = true;
+    return;
+  }
+
+  memcpy(&pack->buffer[pack->length], data, length);
+  pack->length += length;
+}
+
+static uint64_t webSocket_msgpackGet(const uint8_t *data, uint8_t size)
+{
+  uint64_t value = 0;
+
+  for (uint8_t i = 0; i < size; i++)
+  {
+    value = (value << 8) | data[i];
+  }
+
+  return value;
+}
+
+// decodes the head of the next value without consuming it
+static bool webSocket_msgpackHead(WEB_SOCKET_MSGPACK_READER *unpack,
+                                  WEB_SOCKET_MSGPACK_HEAD *head)
+{
+  const uint8_t *data = &unpack->data[unpack->index];
+  uint16_t remaining = unpack->length - unpack->index;
+  uint8_t marker = 0;
+  uint8_t field = 0;  // bytes of the length/value field after the marker
+  uint32_t bits = 0;
+  float real = 0;
+
+  if (unpack->is_error || (remaining == 0))
+  {
+    return false;
+  }
+
+  marker = data[0];
+  head->size = 1;
+  head->is_negative = false;
+  head->length = 0;
+  head->integer = 0;
+  head->real = 0;
+
+  if (marker <= 0x7F)
+  {
+    head->type = WEBSOCKET_MSGPACK_INT;
+    head->integer = marker;
+    return true;
+  }
+  else if (marker >= 0xE0)
+  {
+    head->type = WEBSOCKET_MSGPACK_INT;
+    head->is_negative = true;
+    head->integer = (uint64_t)(int64_t)(int8_t) marker;
+    return true;
+  }
+  else if (marker <= 0x8F)
+  {
+    head->type = WEBSOCKET_MSGPACK_MAP;
+    head->length = marker & 0x0F;
+  }
+  else if (marker <= 0x9F)
+  {
+    head->type = WEBSOCKET_MSGPACK_ARRAY;
+    head->length = marker & 0x0F;
+  }
+  else if (marker <= 0xBF)
+  {
+    head->type = WEBSOCKET_MSGPACK_STR;
+    head->length = marker & 0x1F;
+  }
+  else
+  {
+    switch (marker)
+    {
+      case 0xC0:
+        head->type = WEBSOCKET_MSGPACK_NIL;
+        return true;
+      case 0xC2:
+      case 0xC3:
+        head->type = WEBSOCKET_MSGPACK_BOOL;
+        head->integer = marker & 0x01;
+        return true;
+      case 0xC4:
+      case 0xC5:
+      case 0xC6:
+        head->type = WEBSOCKET_MSGPACK_BIN;
+        field = 1 << (marker - 0xC4);
+        break;
+      case 0xC7:
+      case 0xC8:
+      case 0xC9:
+        head->type = WEBSOCKET_MSGPACK_EXT;
+        field = 1 << (marker - 0xC7);
+        break;
+      case 0xCA:
+      case 0xCB:
+        head->type = WEBSOCKET_MSGPACK_FLOAT;
+        field = (marker == 0xCA) ? 4 : 8;
+        break;
+      case 0xCC:
+      case 0xCD:
+      case 0xCE:
+      case 0xCF:
+        head->type = WEBSOCKET_MSGPACK_INT;
+        field = 1 << (marker - 0xCC);
+        break;
+      case 0xD0:
+      case 0xD1:
+      case 0xD2:
+      case 0xD3:
+        head->type = WEBSOCKET_MSGPACK_INT;
+        field = 1 << (marker - 0xD0);
+        break;
+      case 0xD4:
+      case 0xD5:
+      case 0xD6:
+      case 0xD7:
+      case 0xD8:
+        head->type = WEBSOCKET_MSGPACK_EXT;
+        head->length = 1 + (1 << (marker - 0xD4));
+        break;
+      case 0xD9:
+      case 0xDA:
+      case 0xDB:
+        head->type = WEBSOCKET_MSGPACK_STR;
+        field = 1 << (marker - 0xD9);
+        break;
+      case 0xDC:
+      case 0xDD:
+        head->type = WEBSOCKET_MSGPACK_ARRAY;
+        field = (marker == 0xDC) ? 2 : 4;
+        break;
+      case 0xDE:
+      case 0xDF:
+        head->type = WEBSOCKET_MSGPACK_MAP;
+        field = (marker == 0xDE) ? 2 : 4;
+        break;
+      default:
+        unpack->is_error = true;  // 0xC1 is never used
+        return false;
+    }
+  }
+
+  if (remaining < 1u + field)
+  {
+    unpack->is_error = true;
+    return false;
+  }
+
+  head->size += field;
+
+  switch (head->type)
+  {
+    case WEBSOCKET_MSGPACK_INT:
+      head->integer = webSocket_msgpackGet(&data[1], field);
+
+      if ((marker >= 0xD0) && (head->integer >> (field * 8 - 1)))
+      {
+        // sign extend
+        head->is_negative = true;
+
+        if (field < 8)
+        {
+          head->integer |= ~(uint64_t) 0 << (field * 8);
+        }
+      }
+      return true;
+    case WEBSOCKET_MSGPACK_FLOAT:
+      if (field == 4)
+      {
+        bits = (uint32_t) webSocket_msgpackGet(&data[1], 4);
+        memcpy(&real, &bits, sizeof(real));
+        head->real = real;
+      }
+      else
+      {
+        head->integer = webSocket_msgpackGet(&data[1], 8);
+        memcpy(&head->real, &head->integer, sizeof(head->real));
+        head->integer = 0;
+      }
+      return true;
+    case WEBSOCKET_MSGPACK_ARRAY:
+    case WEBSOCKET_MSGPACK_MAP:
+      if (field)
+      {
+        head->length = (uint32_t) webSocket_msgpackGet(&data[1], field);
+      }
+
+      // every element takes a byte at least, which also keeps the count
+      // below 65536 and the pending count of a skip from wrapping
+      if (head->length > (uint32_t)(remaining - head->size)
+                         / ((head->type == WEBSOCKET_MSGPACK_MAP) ? 2u : 1u))
+      {
+        unpack->is_error = true;
+        return false;
+      }
+      return true;
+    default:
+      break;
+  }
+
+  // str, bin and ext: the data must be inside the buffer
+  if (field)
+  {
+    head->length = (uint32_t) webSocket_msgpackGet(&data[1], field);
+  }
+
+  if (head->type == WEBSOCKET_MSGPACK_EXT)
+  {
+    head->length += (marker <= 0xC9) ? 1 : 0;  // ext type byte
+  }
+
+  if (head->length > (uint32_t)(remaining - head->size))
+  {
+    unpack->is_error = true;
+    return false;
+  }
+
+  return true;
+}
+
+static bool webSocket_msgpackNext(WEB_SOCKET_MSGPACK_READER *unpack,
+                                  WEB_SOCKET_MSGPACK_HEAD *head,
+                                  uint8_t type)
+{
+  if (!webSocket_msgpackHead(unpack, head) || (head->type != type))
+  {
+    return false;
+  }
+
+  unpack->index += head->size;
+
+  return true;
+}
@@ -0,0 +1,94 @@
+/*
+ * @file    webSocketMsgPack.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_MSGPACK_H_
+#define WEBSOCKET_MSGPACK_H_
+
+#include "webSocket.h"
+
+// MessagePack encoder writing into the payload area of the send frame and
+// decoder reading the receive buffer in place. Strings and binaries are
+// returned as pointers into the buffer, nothing is copied or allocated.
+// 0xC1 (WEB_SOCKET_BINARY_TAG) is never used by MessagePack, so library
+// binary messages cannot be mistaken for it.
+
+enum webSocketMsgPackType {
+  WEBSOCKET_MSGPACK_INVALID = 0,
+  WEBSOCKET_MSGPACK_NIL,
+  WEBSOCKET_MSGPACK_BOOL,
+  WEBSOCKET_MSGPACK_INT,
+  WEBSOCKET_MSGPACK_FLOAT,
+  WEBSOCKET_MSGPACK_STR,
+  WEBSOCKET_MSGPACK_BIN,
+  WEBSOCKET_MSGPACK_ARRAY,
+  WEBSOCKET_MSGPACK_MAP,
+  WEBSOCKET_MSGPACK_EXT
+};
+
+typedef struct _WEB_SOCKET_MSGPACK_WRITER
+{
+  char *buffer;
+  uint16_t capacity;
+  uint16_t length;
+  bool is_overflow;
+} WEB_SOCKET_MSGPACK_WRITER;
+
+typedef struct _WEB_SOCKET_MSGPACK_READER
+{
+  const uint8_t *data;
+  uint16_t length;
+  uint16_t index;
+  bool is_error;
+} WEB_SOCKET_MSGPACK_READER;
+
+extern void webSocket_msgpackInit(WEB_SOCKET_MSGPACK_WRITER *pack,
+                                  char *buffer, uint16_t capacity);
+extern bool webSocket_msgpackBegin(WEB_SOCKET_MSGPACK_WRITER *pack);
+extern bool webSocket_msgpackCommit(WEB_SOCKET_MSGPACK_WRITER *pack);
+extern void webSocket_msgpackNil(WEB_SOCKET_MSGPACK_WRITER *pack);
+extern void webSocket_msgpackBool(WEB_SOCKET_MSGPACK_WRITER *pack, bool value);
+extern void webSocket_msgpackInt(WEB_SOCKET_MSGPACK_WRITER *pack,
+                                 int32_t value);
+extern void webSocket_msgpackUInt(WEB_SOCKET_MSGPACK_WRITER *pack,
+                                  uint32_t value);
+extern void webSocket_msgpackFloat(WEB_SOCKET_MSGPACK_WRITER *pack,
+                                   float value);
+extern void webSocket_msgpackStr(WEB_SOCKET_MSGPACK_WRITER *pack,
+                                 const char *value, uint16_t length);
+extern void webSocket_msgpackBin(WEB_SOCKET_MSGPACK_WRITER *pack,
+                                 const void *value, uint16_t length);
+extern void webSocket_msgpackArray(WEB_SOCKET_MSGPACK_WRITER *pack,
+                                   uint16_t count);
+extern void webSocket_msgpackMap(WEB_SOCKET_MSGPACK_WRITER *pack,
+                                 uint16_t count);
+
+extern void webSocket_msgpackReaderInit(WEB_SOCKET_MSGPACK_READER *unpack,
+                                        const char *data, uint16_t length);
+extern void webSocket_msgpackReaderBegin(WEB_SOCKET_MSGPACK_READER *unpack);
+extern uint8_t webSocket_msgpackPeekType(WEB_SOCKET_MSGPACK_READER *unpack);
+extern bool webSocket_msgpackReadNil(WEB_SOCKET_MSGPACK_READER *unpack);
+extern bool webSocket_msgpackReadBool(WEB_SOCKET_MSGPACK_READER *unpack,
+                                      bool *value);
+extern bool webSocket_msgpackReadInt(WEB_SOCKET_MSGPACK_READER *unpack,
+                                     int32_t *value);
+extern bool webSocket_msgpackReadUInt(WEB_SOCKET_MSGPACK_READER *unpack,
+                                      uint32_t *value);
+extern bool webSocket_msgpackReadFloat(WEB_SOCKET_MSGPACK_READER *unpack,
+                                       float *value);
+extern bool webSocket_msgpackReadStr(WEB_SOCKET_MSGPACK_READER *unpack,
+                                     const char **value, uint16_t *length);
+extern bool webSocket_msgpackReadBin(WEB_SOCKET_MSGPACK_READER *unpack,
+                                     const uint8_t **value, uint16_t *length);
+extern bool webSocket_msgpackReadArray(WEB_SOCKET_MSGPACK_READER *unpack,
+                                       uint16_t *count);
+extern bool webSocket_msgpackReadMap(WEB_SOCKET_MSGPACK_READER *unpack,
+                                     uint16_t *count);
+extern bool webSocket_msgpackSkip(WEB_SOCKET_MSGPACK_READER *unpack);
+
+#endif /* WEBSOCKET_MSGPACK_H_ */
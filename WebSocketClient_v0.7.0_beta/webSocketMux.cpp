@@ -0,0 +1,301 @@
+/*
+ * @file    webSocketMux.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include "webSocketMux.h"
+
+#ifdef WEBSOCKET_MUX
+
+static_assert(WEB_SOCKET_MUX_CHANNELS <= 32,
+              "credit grants are tracked in a 32 bit mask");
+static_assert(WEB_SOCKET_MUX_CHANNELS * 3u + 2u <= WEB_SOCKET_SEND_PAYLOAD_SIZE,
+              "all credit grants must fit one frame");
+
+// send queue of one channel: [length lo][length hi][message]..., oldest first
+typedef struct _WEB_SOCKET_MUX_CHANNEL
+{
+  webSocketMuxHandler handler;
+  uint32_t credit;    // bytes the peer still accepts
+  uint32_t consumed;  // bytes received and handled, not granted back yet
+  uint16_t length;
+  char queue[WEB_SOCKET_MUX_QUEUE_SIZE];
+} WEB_SOCKET_MUX_CHANNEL;
+
+#define WEB_SOCKET_MUX_NONE		0xFFu
+
+static bool webSocket_muxSendCredit(void);
+static bool webSocket_muxSendData(uint8_t channel);
+static void webSocket_muxConsume(uint8_t channel, uint32_t length);
+
+static WEB_SOCKET_MUX_CHANNEL g_muxChannel[WEB_SOCKET_MUX_CHANNELS];
+static uint32_t g_muxGrantMask = 0;
+static uint8_t g_muxNext = 0;
+static uint8_t g_muxFragment = WEB_SOCKET_MUX_NONE;  // channel of a fragmented message
+
+// new session: a full window each way, queued messages are kept
+void webSocket_muxReset(void)
+{
+  for (uint8_t i = 0; i < WEB_SOCKET_MUX_CHANNELS; i++)
+  {
+    g_muxChannel[i].credit = WEB_SOCKET_MUX_WINDOW;
+    g_muxChannel[i].consumed = 0;
+  }
+
+  g_muxGrantMask = 0;
+  g_muxFragment = WEB_SOCKET_MUX_NONE;
+}
+
+void webSocket_muxSetHandler(uint8_t channel, webSocketMuxHandler handler)
+{
+  if (channel < WEB_SOCKET_MUX_CHANNELS)
+  {
+    g_muxChannel[channel].handler = handler;
+  }
+}
+
+// Queues a message; false when the channel queue is full or the message
+// could never be sent (larger than a frame or the window).
+bool webSocket_muxSend(uint8_t channel, const char *payload,
+                       uint16_t payload_length)
+{
+  WEB_SOCKET_MUX_CHANNEL *mux = NULL;
+
+  if ((channel >= WEB_SOCKET_MUX_CHANNELS)
+      || (payload_length + WEB_SOCKET_MUX_HEADER_SIZE > WEB_SOCKET_SEND_PAYLOAD_SIZE)
+      || (payload_length > WEB_SOCKET_MUX_WINDOW))
+  {
+    return false;
+  }
+
+  mux = &g_muxChannel[channel];
+
+  if (mux->length + 2u + payload_length > WEB_SOCKET_MUX_QUEUE_SIZE)
+  {
+    return false;
+  }
+
+  mux->queue[mux->length++] = (char)(payload_length & 0xFF);
+  mux->queue[mux->length++] = (char)(payload_length >> 8);
+  memcpy(&mux->queue[mux->length], payload, payload_length);
+  mux->length += payload_length;
+
+  return true;
+}
+
+// Called by webSocket_handle() for every data frame: payload_length bytes
+// were read of the frame_length sent, the rest was truncated. Returns false
+// when it is not a mux frame, so the receive handler gets it.
+//
+// Credit is granted for every byte the peer sent, so a truncated or a
+// fragmented message does not shrink the window. A truncated message is
+// handled with what was read, like any other; a fragmented one is dropped,
+// since messages are not reassembled.
+bool webSocket_muxReceive(const char *payload, uint16_t payload_length,
+                          uint16_t frame_length, uint8_t opcode, bool fin)
+{
+  const uint8_t *data = (const uint8_t *) payload;
+  WEB_SOCKET_MUX_CHANNEL *mux = NULL;
+  uint16_t length = 0;
+
+  if (opcode == OPCODE_FRAME_CONTINUE)
+  {
+    if (g_muxFragment == WEB_SOCKET_MUX_NONE)
+    {
+      return false;
+    }
+
+    webSocket_muxConsume(g_muxFragment, frame_length);
+
+    if (fin)
+    {
+      g_muxFragment = WEB_SOCKET_MUX_NONE;
+    }
+
+    return true;
+  }
+
+  if ((opcode != OPCODE_FRAME_BINARY)
+      || (payload_length < WEB_SOCKET_MUX_HEADER_SIZE - 1)
+      || (data[0] != WEB_SOCKET_BINARY_TAG))
+  {
+    return false;
+  }
+
+  if (data[1] == WEBSOCKET_BINARY_MUX_CREDIT)
+  {
+    for (uint16_t i = 2; i + 3 <= payload_length; i += 3)
+    {
+      if (data[i] < WEB_SOCKET_MUX_CHANNELS)
+      {
+        g_muxChannel[data[i]].credit += ((uint16_t) data[i + 1] << 8) | data[i + 2];
+      }
+    }
+
+    return true;
+  }
+
+  if ((data[1] != WEBSOCKET_BINARY_MUX)
+      || (payload_length < WEB_SOCKET_MUX_HEADER_SIZE))
+  {
+    return false;
+  }
+
+  if (data[2] >= WEB_SOCKET_MUX_CHANNELS)
+  {
+    return true; // unknown channel, dropped
+  }
+
+  if (!fin)
+  {
+    g_muxFragment = data[2];
+  }
+  else
+  {
+    mux = &g_muxChannel[data[2]];
+    length = payload_length - WEB_SOCKET_MUX_HEADER_SIZE;
+
+    if (mux->handler != NULL)
+    {
+      mux->handler(data[2], &payload[WEB_SOCKET_MUX_HEADER_SIZE], length);
+    }
+  }
+
+  webSocket_muxConsume(data[2], frame_length - WEB_SOCKET_MUX_HEADER_SIZE);
+
+  return true;
+}
+
+// called by webSocket_handle(), sends at most one frame
+void webSocket_muxPoll(void)
+{
+  if (webSocket_isSendBusy())
+  {
+    return;
+  }
+
+  if (g_muxGrantMask)
+  {
+    webSocket_muxSendCredit();
+    return;
+  }
+
+  for (uint8_t i = 0; i < WEB_SOCKET_MUX_CHANNELS; i++)
+  {
+    uint8_t channel = (g_muxNext + i) % WEB_SOCKET_MUX_CHANNELS;
+
+    if (webSocket_muxSendData(channel))
+    {
+      g_muxNext = (channel + 1) % WEB_SOCKET_MUX_CHANNELS;
+      return;
+    }
+  }
+}
+
+uint32_t webSocket_muxGetCredit(uint8_t channel)
+{
+  return (channel < WEB_SOCKET_MUX_CHANNELS) ? g_muxChannel[channel].credit : 0;
+}
+
+uint16_t webSocket_muxGetQueued(uint8_t channel)
+{
+  return (channel < WEB_SOCKET_MUX_CHANNELS) ? g_muxChannel[channel].length : 0;
+}
+
+static bool webSocket_muxSendCredit(void)
+{
+  uint16_t capacity = 2u + 3u * WEB_SOCKET_MUX_CHANNELS;
+  uint16_t index = 0;
+  uint8_t *frame = (uint8_t *) webSocket_beginFrame(&capacity);
+
+  if (frame == NULL)
+  {
+    return false;
+  }
+
+  frame[index++] = WEB_SOCKET_BINARY_TAG;
+  frame[index++] = WEBSOCKET_BINARY_MUX_CREDIT;
+
+  g_muxGrantMask = 0;
+
+  for (uint8_t i = 0; i < WEB_SOCKET_MUX_CHANNELS; i++)
+  {
+    if (g_muxChannel[i].consumed >= WEB_SOCKET_MUX_WINDOW / 2)
+    {
+      // 16 bits per grant, a larger backlog goes with the next frame
+      uint16_t grant = (g_muxChannel[i].consumed > UINT16_MAX)
+                       ? UINT16_MAX : (uint16_t) g_muxChannel[i].consumed;
+
+      frame[index++] = i;
+      frame[index++] = (uint8_t)(grant >> 8);
+      frame[index++] = (uint8_t) grant;
+      g_muxChannel[i].consumed -= grant;
+      webSocket_muxConsume(i, 0);
+    }
+  }
+
+  return webSocket_commitFrame(index, OPCODE_FRAME_BINARY);
+}
+
+// counts bytes to grant back, in chunks rather than a frame per message
+static void webSocket_muxConsume(uint8_t channel, uint32_t length)
+{
+  g_muxChannel[channel].consumed += length;
+
+  if (g_muxChannel[channel].consumed >= WEB_SOCKET_MUX_WINDOW / 2)
+  {
+    g_muxGrantMask |= (1ul << channel);
+  }
+}
+
+static bool webSocket_muxSendData(uint8_t channel)
+{
+  WEB_SOCKET_MUX_CHANNEL *mux = &g_muxChannel[channel];
+  uint16_t length = 0;
+  uint16_t capacity = 0;
+  char *frame = NULL;
+
+  if (mux->length == 0)
+  {
+    return false;
+  }
+
+  length = (uint8_t) mux->queue[0] | ((uint16_t)(uint8_t) mux->queue[1] << 8);
+
+  if (length > mux->credit)
+  {
+    return false; // blocked until the peer grants credit
+  }
+
+  capacity = length + WEB_SOCKET_MUX_HEADER_SIZE;
+  frame = webSocket_beginFrame(&capacity);
+
+  if (frame == NULL)
+  {
+    return false;
+  }
+
+  frame[0] = (char) WEB_SOCKET_BINARY_TAG;
+  frame[1] = (char) WEBSOCKET_BINARY_MUX;
+  frame[2] = (char) channel;
+  memcpy(&frame[WEB_SOCKET_MUX_HEADER_SIZE], &mux->queue[2], length);
+
+  if (!webSocket_commitFrame(length + WEB_SOCKET_MUX_HEADER_SIZE,
+                             OPCODE_FRAME_BINARY))
+  {
+    return false;
+  }
+
+  mux->credit -= length;
+  mux->length -= 2u + length;
+  memmove(mux->queue, &mux->queue[2u + length], mux->length);
+
+  return true;
+}
+
+#endif // WEBSOCKET_MUX
@@ -0,0 +1,60 @@
+/*
+ * @file    webSocketMux.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_MUX_H_
+#define WEBSOCKET_MUX_H_
+
+#include "webSocket.h"
+
+// Logical channels inside binary frames of one connection:
+//
+//   data    [0xC1][WEBSOCKET_BINARY_MUX][channel][message]
+//   credit  [0xC1][WEBSOCKET_BINARY_MUX_CREDIT]([channel][bytes, 16 bit BE])...
+//
+// Each side may send WEB_SOCKET_MUX_WINDOW message bytes per channel and
+// then waits for credit, which the receiver grants back after its channel
+// handler returned. webSocket_muxSend() only queues; webSocket_handle()
+// sends one message per call, taking the channels in turn, so a channel
+// that ran out of credit or has a long queue does not hold up the others.
+// Credit grants go out before data. Both sides start with a full window
+// on every (re)connect. A message must fit one frame: a fragmented one is
+// dropped, its bytes are still granted back.
+
+#ifndef WEB_SOCKET_MUX_CHANNELS
+#define WEB_SOCKET_MUX_CHANNELS			4u
+#endif
+#ifndef WEB_SOCKET_MUX_WINDOW
+#define WEB_SOCKET_MUX_WINDOW			512u  // bytes in flight per channel
+#endif
+#ifndef WEB_SOCKET_MUX_QUEUE_SIZE
+#define WEB_SOCKET_MUX_QUEUE_SIZE		256u  // send queue bytes per channel
+#endif
+
+#define WEB_SOCKET_MUX_HEADER_SIZE		3u
+
+typedef void (*webSocketMuxHandler)(uint8_t channel, const char *payload,
+                                    uint16_t payload_length);
+
+#ifdef WEBSOCKET_MUX
+
+extern void webSocket_muxReset(void);
+extern void webSocket_muxSetHandler(uint8_t channel,
+                                    webSocketMuxHandler handler);
+extern bool webSocket_muxSend(uint8_t channel, const char *payload,
+                              uint16_t payload_length);
+extern bool webSocket_muxReceive(const char *payload, uint16_t payload_length,
+                                 uint16_t frame_length, uint8_t opcode,
+                                 bool fin);
+extern void webSocket_muxPoll(void);
+extern uint32_t webSocket_muxGetCredit(uint8_t channel);
+extern uint16_t webSocket_muxGetQueued(uint8_t channel);
+
+#endif // WEBSOCKET_MUX
+
+#endif /* WEBSOCKET_MUX_H_ */
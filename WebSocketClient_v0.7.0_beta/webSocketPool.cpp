@@ -0,0 +1,163 @@
+/*
+ * @file    webSocketPool.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include "webSocketPool.h"
+
+#ifdef WEBSOCKET_POOL
+
+// rounded up so every block stays 4 byte aligned
+#define WEB_SOCKET_POOL_ALIGN(size)		(((size) + 3u) & ~3u)
+
+static_assert(WEB_SOCKET_POOL_SMALL_SIZE < WEB_SOCKET_POOL_MEDIUM_SIZE
+              && WEB_SOCKET_POOL_MEDIUM_SIZE < WEB_SOCKET_POOL_LARGE_SIZE,
+              "size classes must grow");
+static_assert(WEB_SOCKET_POOL_SMALL_COUNT <= 32
+              && WEB_SOCKET_POOL_MEDIUM_COUNT <= 32
+              && WEB_SOCKET_POOL_LARGE_COUNT <= 32,
+              "free blocks are tracked in a 32 bit mask");
+static_assert(WEB_SOCKET_POOL_LARGE_SIZE >= WEB_SOCKET_POOL_FRAME_MAX,
+              "the large class must hold a whole frame");
+
+typedef struct _WEB_SOCKET_POOL_CLASS
+{
+  char *base;
+  uint16_t size;
+  uint8_t count;
+  uint8_t used;
+  uint8_t high_water;
+  uint32_t free_mask;  // bit n set: block n is free
+} WEB_SOCKET_POOL_CLASS;
+
+static bool webSocket_poolFind(const char *block, uint8_t *index,
+                               uint8_t *number);
+
+static uint32_t g_poolSmall[WEB_SOCKET_POOL_ALIGN(WEB_SOCKET_POOL_SMALL_SIZE)
+                            * WEB_SOCKET_POOL_SMALL_COUNT / 4];
+static uint32_t g_poolMedium[WEB_SOCKET_POOL_ALIGN(WEB_SOCKET_POOL_MEDIUM_SIZE)
+                             * WEB_SOCKET_POOL_MEDIUM_COUNT / 4];
+static uint32_t g_poolLarge[WEB_SOCKET_POOL_ALIGN(WEB_SOCKET_POOL_LARGE_SIZE)
+                            * WEB_SOCKET_POOL_LARGE_COUNT / 4];
+
+#define WEB_SOCKET_POOL_MASK(count)		((count) >= 32 ? 0xFFFFFFFFu : ((1ul << (count)) - 1))
+
+static WEB_SOCKET_POOL_CLASS g_poolClass[WEBSOCKET_POOL_CLASSES] =
+{
+  { (char *) g_poolSmall, WEB_SOCKET_POOL_ALIGN(WEB_SOCKET_POOL_SMALL_SIZE),
+    WEB_SOCKET_POOL_SMALL_COUNT, 0, 0,
+    WEB_SOCKET_POOL_MASK(WEB_SOCKET_POOL_SMALL_COUNT) },
+  { (char *) g_poolMedium, WEB_SOCKET_POOL_ALIGN(WEB_SOCKET_POOL_MEDIUM_SIZE),
+    WEB_SOCKET_POOL_MEDIUM_COUNT, 0, 0,
+    WEB_SOCKET_POOL_MASK(WEB_SOCKET_POOL_MEDIUM_COUNT) },
+  { (char *) g_poolLarge, WEB_SOCKET_POOL_ALIGN(WEB_SOCKET_POOL_LARGE_SIZE),
+    WEB_SOCKET_POOL_LARGE_COUNT, 0, 0,
+    WEB_SOCKET_POOL_MASK(WEB_SOCKET_POOL_LARGE_COUNT) }
+};
+static uint32_t g_poolFailed = 0;
+
+// smallest free block of at least size bytes, NULL when there is none
+char *webSocket_poolAlloc(uint16_t size)
+{
+  WEB_SOCKET_POOL_CLASS *pool = NULL;
+  uint8_t number = 0;
+
+  for (uint8_t i = 0; i < WEBSOCKET_POOL_CLASSES; i++)
+  {
+    pool = &g_poolClass[i];
+
+    if ((size > pool->size) || (pool->free_mask == 0))
+    {
+      continue;
+    }
+
+    number = __builtin_ctz(pool->free_mask);
+    pool->free_mask &= ~(1ul << number);
+    pool->used++;
+
+    if (pool->used > pool->high_water)
+    {
+      pool->high_water = pool->used;
+    }
+
+    return &pool->base[(uint32_t) number * pool->size];
+  }
+
+  g_poolFailed++;
+
+  return NULL;
+}
+
+void webSocket_poolFree(char *block)
+{
+  uint8_t index = 0;
+  uint8_t number = 0;
+
+  if (!webSocket_poolFind(block, &index, &number)
+      || (g_poolClass[index].free_mask & (1ul << number)))
+  {
+    return; // not a pool block or already free
+  }
+
+  g_poolClass[index].free_mask |= (1ul << number);
+  g_poolClass[index].used--;
+}
+
+// usable size of a block, 0 when it is not from the pool
+uint16_t webSocket_poolGetSize(const char *block)
+{
+  uint8_t index = 0;
+  uint8_t number = 0;
+
+  return webSocket_poolFind(block, &index, &number) ? g_poolClass[index].size : 0;
+}
+
+uint16_t webSocket_poolGetClassSize(uint8_t index)
+{
+  return (index < WEBSOCKET_POOL_CLASSES) ? g_poolClass[index].size : 0;
+}
+
+uint8_t webSocket_poolGetUsed(uint8_t index)
+{
+  return (index < WEBSOCKET_POOL_CLASSES) ? g_poolClass[index].used : 0;
+}
+
+uint8_t webSocket_poolGetHighWater(uint8_t index)
+{
+  return (index < WEBSOCKET_POOL_CLASSES) ? g_poolClass[index].high_water : 0;
+}
+
+uint32_t webSocket_poolGetFailed(void)
+{
+  return g_poolFailed;
+}
+
+static bool webSocket_poolFind(const char *block, uint8_t *index,
+                               uint8_t *number)
+{
+  const WEB_SOCKET_POOL_CLASS *pool = NULL;
+  uintptr_t offset = 0;
+
+  for (uint8_t i = 0; i < WEBSOCKET_POOL_CLASSES; i++)
+  {
+    pool = &g_poolClass[i];
+    offset = (uintptr_t) block - (uintptr_t) pool->base; // wraps when below
+
+    if ((offset < (uintptr_t) pool->size * pool->count)
+        && ((offset % pool->size) == 0))
+    {
+      *index = i;
+      *number = (uint8_t)(offset / pool->size);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+#endif // WEBSOCKET_POOL
@@ -0,0 +1,67 @@
+/*
+ * @file    webSocketPool.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_POOL_H_
+#define WEBSOCKET_POOL_H_
+
+#include <stdint.h>
+#include "WiFiClient.h"
+#include "webSocketConfig.h"
+#include "webSocketFrame.h"
+
+// Fixed block pool in three size classes, static memory only. The receive
+// and send buffers of webSocket.cpp are borrowed from it per frame instead
+// of being reserved for good, so a small message takes a small block and
+// the sketch may borrow what is free. A request gets the smallest free
+// block that fits it; each class counts the blocks in use and its high
+// water mark.
+
+#define WEB_SOCKET_POOL_FRAME_MAX		(WEB_SOCKET_FRAME_HEADER16_MAX \
+  + ((WEB_SOCKET_RECIVE_PAYLOAD_SIZE > WEB_SOCKET_SEND_PAYLOAD_SIZE) \
+     ? WEB_SOCKET_RECIVE_PAYLOAD_SIZE : WEB_SOCKET_SEND_PAYLOAD_SIZE))
+
+#ifndef WEB_SOCKET_POOL_SMALL_SIZE
+#define WEB_SOCKET_POOL_SMALL_SIZE		64u
+#endif
+#ifndef WEB_SOCKET_POOL_SMALL_COUNT
+#define WEB_SOCKET_POOL_SMALL_COUNT		4u
+#endif
+#ifndef WEB_SOCKET_POOL_MEDIUM_SIZE
+#define WEB_SOCKET_POOL_MEDIUM_SIZE		256u
+#endif
+#ifndef WEB_SOCKET_POOL_MEDIUM_COUNT
+#define WEB_SOCKET_POOL_MEDIUM_COUNT	2u
+#endif
+#ifndef WEB_SOCKET_POOL_LARGE_SIZE
+#define WEB_SOCKET_POOL_LARGE_SIZE		WEB_SOCKET_POOL_FRAME_MAX
+#endif
+#ifndef WEB_SOCKET_POOL_LARGE_COUNT
+#define WEB_SOCKET_POOL_LARGE_COUNT		2u  // a received frame and the reply built in its handler
+#endif
+
+enum webSocketPoolClass {
+  WEBSOCKET_POOL_SMALL = 0,
+  WEBSOCKET_POOL_MEDIUM,
+  WEBSOCKET_POOL_LARGE,
+  WEBSOCKET_POOL_CLASSES
+};
+
+#ifdef WEBSOCKET_POOL
+
+extern char *webSocket_poolAlloc(uint16_t size);
+extern void webSocket_poolFree(char *block);
+extern uint16_t webSocket_poolGetSize(const char *block);
+extern uint16_t webSocket_poolGetClassSize(uint8_t index);
+extern uint8_t webSocket_poolGetUsed(uint8_t index);
+extern uint8_t webSocket_poolGetHighWater(uint8_t index);
+extern uint32_t webSocket_poolGetFailed(void);
+
+#endif // WEBSOCKET_POOL
+
+#endif /* WEBSOCKET_POOL_H_ */
@@ -0,0 +1,797 @@
+/*
+ * @file    webSocketQueue.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string.h>
+#include "webSocketQueue.h"
+#include "webSocketFrame.h"
+#include "webSocketStats.h"
+
+#ifdef WEBSOCKET_QUEUE
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+// the SPIFFS area by default, do not mount SPIFFS when the queue is used
+extern "C" uint32_t _SPIFFS_start;
+#ifndef WEB_SOCKET_QUEUE_FLASH_ADDRESS
+#define WEB_SOCKET_QUEUE_FLASH_ADDRESS	((uint32_t)(uintptr_t) &_SPIFFS_start - 0x40200000u)
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif // ARDUINO
+
+#define WEB_SOCKET_QUEUE_SECTOR_MAGIC	0x32534357u
+#define WEB_SOCKET_QUEUE_RECORD_MAGIC	0x5752u
+#define WEB_SOCKET_QUEUE_BLANK			0xFFFFFFFFu
+#define WEB_SOCKET_QUEUE_RECORD_SIZE(length)	\
+  ((uint16_t)(sizeof(WEB_SOCKET_QUEUE_RECORD) + (((length) + 3u) & ~3u)))
+
+typedef struct _WEB_SOCKET_QUEUE_SECTOR
+{
+  uint32_t magic;
+  uint32_t sequence;  // grows by one per opened sector
+} WEB_SOCKET_QUEUE_SECTOR;
+
+typedef struct _WEB_SOCKET_QUEUE_RECORD
+{
+  uint16_t magic;
+  uint16_t length;    // head byte and payload, the record is padded to 4
+  uint32_t crc;       // CRC32 of head byte and payload
+  uint32_t state;     // WEB_SOCKET_QUEUE_BLANK until drained, then 0
+} WEB_SOCKET_QUEUE_RECORD;
+
+static bool webSocket_queueMap(void);
+static bool webSocket_queueLoad(uint32_t address, void *dist,
+                                uint16_t length);
+static bool webSocket_queueStore(uint32_t address, const void *src,
+                                 uint16_t length);
+static bool webSocket_queueErase(uint16_t sector);
+static bool webSocket_queueRecord(uint16_t sector, uint16_t offset,
+                                  WEB_SOCKET_QUEUE_RECORD *record);
+static bool webSocket_queueNext(uint16_t *sector, uint16_t *offset,
+                                WEB_SOCKET_QUEUE_RECORD *record);
+static bool webSocket_queueOpenSector(void);
+static bool webSocket_queueStage(const void *data, uint16_t length,
+                                 const uint8_t *mask);
+static bool webSocket_queueFlush(void);
+static void webSocket_queueRecount(void);
+static void webSocket_queueSeekTail(void);
+static void webSocket_queueMarkDrained(uint16_t sector, uint16_t offset);
+static bool webSocket_queueVerify(uint16_t sector, uint16_t offset,
+                                  const WEB_SOCKET_QUEUE_RECORD *record);
+static uint32_t webSocket_queueCrc(uint32_t crc, const char *data,
+                                   uint16_t length, const uint8_t *mask);
+
+static uint16_t g_queueHeadSector = 0;  // next append
+static uint16_t g_queueHeadOffset = 0;
+static uint16_t g_queueTailSector = 0;  // oldest record not drained
+static uint16_t g_queueTailOffset = 0;
+static uint32_t g_queueSequence = 0;
+static uint32_t g_queueCount = 0;
+static bool g_is_queueOpen = false;
+static bool g_is_queueNextErased = false;  // the sector after the head
+static uint32_t g_queueStage[WEB_SOCKET_QUEUE_STAGE_SIZE / 4];
+static uint16_t g_queueStageLength = 0;
+static uint16_t g_queueStageOffset = 0;  // in the head sector, flash holds all before it
+
+static_assert((WEB_SOCKET_QUEUE_STAGE_SIZE % 4) == 0,
+              "WEB_SOCKET_QUEUE_STAGE_SIZE must be a multiple of 4");
+
+// Maps the storage and recovers head and tail from it.
+bool webSocket_queueBegin(void)
+{
+  WEB_SOCKET_QUEUE_SECTOR header;
+  WEB_SOCKET_QUEUE_RECORD record;
+  uint32_t oldest_sequence = WEB_SOCKET_QUEUE_BLANK;
+  uint16_t oldest = WEB_SOCKET_QUEUE_SECTORS;
+  uint16_t last = 0;
+  uint32_t blank[3];
+
+  g_is_queueOpen = false;
+  g_is_queueNextErased = false;
+  g_queueSequence = 0;
+  g_queueCount = 0;
+  g_queueStageLength = 0;
+
+  if ((WEB_SOCKET_QUEUE_SECTORS < 2) || !webSocket_queueMap())
+  {
+    return false;
+  }
+
+  for (uint16_t i = 0; i < WEB_SOCKET_QUEUE_SECTORS; i++)
+  {
+    webSocket_queueLoad(i * WEB_SOCKET_QUEUE_SECTOR_SIZE, &header,
+                        sizeof(header));
+
+    if (header.magic != WEB_SOCKET_QUEUE_SECTOR_MAGIC)
+    {
+      continue;
+    }
+
+    if (header.sequence >= g_queueSequence)
+    {
+      g_queueSequence = header.sequence;
+      g_queueHeadSector = i;
+    }
+
+    if (header.sequence < oldest_sequence)
+    {
+      oldest_sequence = header.sequence;
+      oldest = i;
+    }
+  }
+
+  g_is_queueOpen = true;
+
+  if (oldest == WEB_SOCKET_QUEUE_SECTORS)
+  {
+    // empty storage
+    g_queueHeadSector = WEB_SOCKET_QUEUE_SECTORS - 1;
+    g_queueHeadOffset = WEB_SOCKET_QUEUE_SECTOR_SIZE;
+    g_is_queueOpen = webSocket_queueOpenSector();
+    return g_is_queueOpen;
+  }
+
+  // end of the newest sector; a torn header leaves dirty bytes behind, the
+  // next append then starts a new sector
+  g_queueHeadOffset = sizeof(WEB_SOCKET_QUEUE_SECTOR);
+
+  while (webSocket_queueRecord(g_queueHeadSector, g_queueHeadOffset, &record))
+  {
+    last = g_queueHeadOffset;
+    g_queueHeadOffset += WEB_SOCKET_QUEUE_RECORD_SIZE(record.length);
+  }
+
+  if (last
+      && webSocket_queueRecord(g_queueHeadSector, last, &record)
+      && (record.state == WEB_SOCKET_QUEUE_BLANK)
+      && !webSocket_queueVerify(g_queueHeadSector, last, &record))
+  {
+    webSocket_queueMarkDrained(g_queueHeadSector, last);
+    WEB_SOCKET_STATS_COUNT(queue_dropped);
+  }
+
+  if (g_queueHeadOffset + sizeof(blank) <= WEB_SOCKET_QUEUE_SECTOR_SIZE)
+  {
+    webSocket_queueLoad(g_queueHeadSector * WEB_SOCKET_QUEUE_SECTOR_SIZE
+                        + g_queueHeadOffset, blank, sizeof(blank));
+
+    if ((blank[0] & blank[1] & blank[2]) != WEB_SOCKET_QUEUE_BLANK)
+    {
+      g_queueHeadOffset = WEB_SOCKET_QUEUE_SECTOR_SIZE;
+    }
+  }
+
+  g_queueStageOffset = g_queueHeadOffset;
+
+  // count what is left from the oldest sector on
+  g_queueTailSector = oldest;
+  g_queueTailOffset = sizeof(WEB_SOCKET_QUEUE_SECTOR);
+  webSocket_queueRecount();
+
+  return true;
+}
+
+// Stages the first header byte and payload of a frame, dropping the oldest
+// sector when the ring is full. mask is the key the payload is masked with,
+// NULL if it is not; the payload is stored unmasked.
+bool webSocket_queueAppend(uint8_t head, const char *payload,
+                           uint16_t length, const uint8_t *mask)
+{
+  static const uint8_t padding[3] = { 0xFF, 0xFF, 0xFF };
+  WEB_SOCKET_QUEUE_RECORD record;
+  uint16_t size = WEB_SOCKET_QUEUE_RECORD_SIZE(length + 1u);
+
+  if (!g_is_queueOpen
+      || (size > WEB_SOCKET_QUEUE_SECTOR_SIZE - sizeof(WEB_SOCKET_QUEUE_SECTOR)))
+  {
+    return false;
+  }
+
+  if ((g_queueHeadOffset + size > WEB_SOCKET_QUEUE_SECTOR_SIZE)
+      && (!webSocket_queueFlush() || !webSocket_queueOpenSector()))
+  {
+    return false;
+  }
+
+  record.magic = WEB_SOCKET_QUEUE_RECORD_MAGIC;
+  record.length = length + 1u;
+  record.crc = webSocket_queueCrc(webSocket_queueCrc(0, (const char *) &head, 1, NULL),
+                                  payload, length, mask);
+  record.state = WEB_SOCKET_QUEUE_BLANK;
+
+  // header first: a reset while a long record is half in flash leaves one
+  // failing its CRC
+  if (!webSocket_queueStage(&record, sizeof(record), NULL)
+      || !webSocket_queueStage(&head, 1, NULL)
+      || !webSocket_queueStage(payload, length, mask)
+      || !webSocket_queueStage(padding, size - sizeof(record) - length - 1u, NULL))
+  {
+    return false;
+  }
+
+  if (g_queueCount == 0)
+  {
+    g_queueTailSector = g_queueHeadSector;
+    g_queueTailOffset = g_queueHeadOffset;
+  }
+
+  g_queueHeadOffset += size;
+  g_queueCount++;
+  WEB_SOCKET_STATS_COUNT(queue_spooled);
+
+  return true;
+}
+
+// Encodes as many whole frames as fit into dist, oldest first, without
+// consuming them. mask is the key of the draining session, NULL to send
+// unmasked. Returns the bytes written, count the frames.
+uint16_t webSocket_queueRead(char *dist, uint16_t size, const uint8_t *mask,
+                             uint16_t *count)
+{
+  WEB_SOCKET_QUEUE_RECORD record;
+  uint16_t sector = g_queueTailSector;
+  uint16_t offset = g_queueTailOffset;
+  uint16_t length = 0;
+  uint16_t payload_length = 0;
+  uint8_t header_length = 0;
+  char *payload = NULL;
+  uint8_t head = 0;
+
+  *count = 0;
+
+  if (!g_is_queueOpen || !webSocket_queueFlush())
+  {
+    return 0;
+  }
+
+  while (webSocket_queueNext(&sector, &offset, &record))
+  {
+    if (record.state == WEB_SOCKET_QUEUE_BLANK)
+    {
+      payload_length = record.length - 1u;
+      header_length = webSocket_frameEncodedSize(payload_length, mask != NULL);
+
+      if (record.length && (length + header_length + payload_length > size))
+      {
+        break;
+      }
+
+      // the head byte lands on the last header byte, the payload after it
+      payload = &dist[length + header_length];
+
+      if (record.length)
+      {
+        webSocket_queueLoad(sector * WEB_SOCKET_QUEUE_SECTOR_SIZE + offset
+                            + sizeof(record), payload - 1, record.length);
+      }
+
+      if (record.length
+          && (webSocket_queueCrc(0, payload - 1, record.length, NULL) == record.crc))
+      {
+        head = (uint8_t) payload[-1];
+        webSocket_frameEncodeHeader((uint8_t *) &dist[length],
+                                    webSocket_frameIsFin(head),
+                                    webSocket_frameRsv(head),
+                                    webSocket_frameOpcode(head), mask,
+                                    payload_length);
+
+        for (uint16_t i = 0; (mask != NULL) && (i < payload_length); i++)
+        {
+          payload[i] ^= mask[i & 3];
+        }
+
+        length += header_length + payload_length;
+        (*count)++;
+      }
+      else
+      {
+        // torn by a reset, never send it
+        webSocket_queueMarkDrained(sector, offset);
+        g_queueCount--;
+        WEB_SOCKET_STATS_COUNT(queue_dropped);
+      }
+    }
+
+    offset += WEB_SOCKET_QUEUE_RECORD_SIZE(record.length);
+  }
+
+  return length;
+}
+
+// marks the first count frames returned by webSocket_queueRead() as sent
+void webSocket_queueConsume(uint16_t count)
+{
+  WEB_SOCKET_QUEUE_RECORD record;
+
+  while (count
+         && webSocket_queueNext(&g_queueTailSector, &g_queueTailOffset,
+                                &record))
+  {
+    if (record.state == WEB_SOCKET_QUEUE_BLANK)
+    {
+      webSocket_queueMarkDrained(g_queueTailSector, g_queueTailOffset);
+      g_queueCount--;
+      count--;
+      WEB_SOCKET_STATS_COUNT(queue_drained);
+    }
+
+    g_queueTailOffset += WEB_SOCKET_QUEUE_RECORD_SIZE(record.length);
+  }
+
+  webSocket_queueSeekTail();
+}
+
+// Flash work kept out of webSocket_queueAppend(): writes the stage and
+// erases the sector after the head, unless it still holds pending records.
+void webSocket_queuePoll(void)
+{
+  uint16_t next = (g_queueHeadSector + 1) % WEB_SOCKET_QUEUE_SECTORS;
+
+  if (!g_is_queueOpen)
+  {
+    return;
+  }
+
+  webSocket_queueFlush();
+
+  if (!g_is_queueNextErased && !(g_queueCount && (g_queueTailSector == next)))
+  {
+    g_is_queueNextErased = webSocket_queueErase(next);
+  }
+}
+
+bool webSocket_queueIsEmpty(void)
+{
+  return g_queueCount == 0;
+}
+
+uint32_t webSocket_queueGetCount(void)
+{
+  return g_queueCount;
+}
+
+// drops every stored frame
+void webSocket_queueClear(void)
+{
+  if (!g_is_queueOpen)
+  {
+    return;
+  }
+
+  WEB_SOCKET_STATS_ADD(queue_dropped, g_queueCount);
+  g_queueCount = 0;
+  g_queueStageLength = 0;
+  g_queueHeadOffset = WEB_SOCKET_QUEUE_SECTOR_SIZE;
+  webSocket_queueOpenSector();
+}
+
+// record header at sector/offset, false past the last record of the sector
+static bool webSocket_queueRecord(uint16_t sector, uint16_t offset,
+                                  WEB_SOCKET_QUEUE_RECORD *record)
+{
+  if (offset + sizeof(WEB_SOCKET_QUEUE_RECORD) > WEB_SOCKET_QUEUE_SECTOR_SIZE)
+  {
+    return false;
+  }
+
+  webSocket_queueLoad(sector * WEB_SOCKET_QUEUE_SECTOR_SIZE + offset, record,
+                      sizeof(WEB_SOCKET_QUEUE_RECORD));
+
+  return (record->magic == WEB_SOCKET_QUEUE_RECORD_MAGIC)
+         && (WEB_SOCKET_QUEUE_RECORD_SIZE(record->length)
+             <= WEB_SOCKET_QUEUE_SECTOR_SIZE - offset);
+}
+
+// Record at sector/offset or the first one after it in ring order, false at
+// the head. Sectors without a valid header are skipped.
+static bool webSocket_queueNext(uint16_t *sector, uint16_t *offset,
+                                WEB_SOCKET_QUEUE_RECORD *record)
+{
+  WEB_SOCKET_QUEUE_SECTOR header;
+
+  for (uint16_t i = 0; i <= WEB_SOCKET_QUEUE_SECTORS; i++)
+  {
+    if ((*sector == g_queueHeadSector) && (*offset >= g_queueHeadOffset))
+    {
+      return false;
+    }
+
+    if (webSocket_queueRecord(*sector, *offset, record))
+    {
+      return true;
+    }
+
+    if (*sector == g_queueHeadSector)
+    {
+      return false;
+    }
+
+    do
+    {
+      *sector = (*sector + 1) % WEB_SOCKET_QUEUE_SECTORS;
+      webSocket_queueLoad(*sector * WEB_SOCKET_QUEUE_SECTOR_SIZE, &header,
+                          sizeof(header));
+    }
+    while ((header.magic != WEB_SOCKET_QUEUE_SECTOR_MAGIC)
+           && (*sector != g_queueHeadSector));
+
+    *offset = sizeof(WEB_SOCKET_QUEUE_SECTOR);
+  }
+
+  return false;
+}
+
+// moves the head into a freshly erased sector, the stage must be empty
+static bool webSocket_queueOpenSector(void)
+{
+  WEB_SOCKET_QUEUE_SECTOR header;
+  WEB_SOCKET_QUEUE_RECORD record;
+  uint16_t next = (g_queueHeadSector + 1) % WEB_SOCKET_QUEUE_SECTORS;
+  uint16_t sector = g_queueTailSector;
+  uint16_t offset = g_queueTailOffset;
+  uint32_t dropped = 0;
+
+  if (g_queueCount && (g_queueTailSector == next))
+  {
+    // ring is full, retention drops the oldest sector
+    while (webSocket_queueNext(&sector, &offset, &record) && (sector == next))
+    {
+      if (record.state == WEB_SOCKET_QUEUE_BLANK)
+      {
+        dropped++;
+      }
+
+      offset += WEB_SOCKET_QUEUE_RECORD_SIZE(record.length);
+    }
+
+    g_queueCount -= dropped;
+    WEB_SOCKET_STATS_ADD(queue_dropped, dropped);
+
+    g_queueTailSector = (next + 1) % WEB_SOCKET_QUEUE_SECTORS;
+    g_queueTailOffset = sizeof(WEB_SOCKET_QUEUE_SECTOR);
+    webSocket_queueSeekTail();
+  }
+
+  header.magic = WEB_SOCKET_QUEUE_SECTOR_MAGIC;
+  header.sequence = ++g_queueSequence;
+
+  // erased ahead by webSocket_queuePoll() unless the ring was full
+  if ((!g_is_queueNextErased && !webSocket_queueErase(next))
+      || !webSocket_queueStore(next * WEB_SOCKET_QUEUE_SECTOR_SIZE, &header,
+                               sizeof(header)))
+  {
+    g_is_queueNextErased = false;
+    return false;
+  }
+
+  g_is_queueNextErased = false;
+  g_queueHeadSector = next;
+  g_queueHeadOffset = sizeof(WEB_SOCKET_QUEUE_SECTOR);
+  g_queueStageOffset = g_queueHeadOffset;
+
+  if (g_queueCount == 0)
+  {
+    g_queueTailSector = g_queueHeadSector;
+    g_queueTailOffset = g_queueHeadOffset;
+  }
+
+  return true;
+}
+
+// skips drained records so the tail is on the oldest pending one
+static void webSocket_queueSeekTail(void)
+{
+  WEB_SOCKET_QUEUE_RECORD record;
+
+  while (webSocket_queueNext(&g_queueTailSector, &g_queueTailOffset, &record)
+         && (record.state != WEB_SOCKET_QUEUE_BLANK))
+  {
+    g_queueTailOffset += WEB_SOCKET_QUEUE_RECORD_SIZE(record.length);
+  }
+}
+
+// Copies data into the stage, unmasked with mask unless NULL. A full stage
+// is written out before it takes more.
+static bool webSocket_queueStage(const void *data, uint16_t length,
+                                 const uint8_t *mask)
+{
+  uint8_t *stage = (uint8_t *) g_queueStage;
+  const uint8_t *src = (const uint8_t *) data;
+  uint16_t chunk = 0;
+
+  for (uint16_t i = 0; i < length; i += chunk)
+  {
+    if ((g_queueStageLength == sizeof(g_queueStage)) && !webSocket_queueFlush())
+    {
+      return false;
+    }
+
+    chunk = sizeof(g_queueStage) - g_queueStageLength;
+
+    if (chunk > length - i)
+    {
+      chunk = length - i;
+    }
+
+    if (mask == NULL)
+    {
+      memcpy(&stage[g_queueStageLength], &src[i], chunk);
+    }
+    else
+    {
+      for (uint16_t j = 0; j < chunk; j++)
+      {
+        stage[g_queueStageLength + j] = src[i + j] ^ mask[(i + j) & 3];
+      }
+    }
+
+    g_queueStageLength += chunk;
+  }
+
+  return true;
+}
+
+// Writes the stage to the head sector with one store. On a flash error the
+// staged records are lost and the sector takes no more.
+static bool webSocket_queueFlush(void)
+{
+  uint16_t length = g_queueStageLength;
+
+  if (length == 0)
+  {
+    return true;
+  }
+
+  g_queueStageLength = 0;
+
+  if (!webSocket_queueStore(g_queueHeadSector * WEB_SOCKET_QUEUE_SECTOR_SIZE
+                            + g_queueStageOffset, g_queueStage, length))
+  {
+    g_queueHeadOffset = g_queueStageOffset;
+    webSocket_queueRecount();
+    g_queueHeadOffset = WEB_SOCKET_QUEUE_SECTOR_SIZE;
+    g_queueStageOffset = WEB_SOCKET_QUEUE_SECTOR_SIZE;
+    return false;
+  }
+
+  g_queueStageOffset += length;
+
+  return true;
+}
+
+// counts the pending records from the tail on
+static void webSocket_queueRecount(void)
+{
+  WEB_SOCKET_QUEUE_RECORD record;
+  uint16_t sector = g_queueTailSector;
+  uint16_t offset = g_queueTailOffset;
+
+  g_queueCount = 0;
+
+  while (webSocket_queueNext(&sector, &offset, &record))
+  {
+    if (record.state == WEB_SOCKET_QUEUE_BLANK)
+    {
+      g_queueCount++;
+    }
+
+    offset += WEB_SOCKET_QUEUE_RECORD_SIZE(record.length);
+  }
+
+  webSocket_queueSeekTail();
+}
+
+// clears the state word, a 1 to 0 write that needs no erase
+static void webSocket_queueMarkDrained(uint16_t sector, uint16_t offset)
+{
+  uint32_t state = 0;
+
+  webSocket_queueStore(sector * WEB_SOCKET_QUEUE_SECTOR_SIZE + offset
+                       + offsetof(WEB_SOCKET_QUEUE_RECORD, state), &state,
+                       sizeof(state));
+}
+
+// only the newest record can be torn by a reset, check it from storage
+static bool webSocket_queueVerify(uint16_t sector, uint16_t offset,
+                                  const WEB_SOCKET_QUEUE_RECORD *record)
+{
+  char buffer[64];
+  uint32_t address = sector * WEB_SOCKET_QUEUE_SECTOR_SIZE + offset
+                     + sizeof(WEB_SOCKET_QUEUE_RECORD);
+  uint32_t crc = 0;
+  uint16_t chunk = 0;
+
+  for (uint16_t i = 0; i < record->length; i += chunk)
+  {
+    chunk = record->length - i;
+
+    if (chunk > sizeof(buffer))
+    {
+      chunk = sizeof(buffer);
+    }
+
+    webSocket_queueLoad(address + i, buffer, chunk);
+    crc = webSocket_queueCrc(crc, buffer, chunk, NULL);
+  }
+
+  return crc == record->crc;
+}
+
+// CRC32 (zlib), start with 0 and chain over chunks. data masked with mask
+// is checked as if unmasked.
+static uint32_t webSocket_queueCrc(uint32_t crc, const char *data,
+                                   uint16_t length, const uint8_t *mask)
+{
+  crc = ~crc;
+
+  for (uint16_t i = 0; i < length; i++)
+  {
+    crc ^= (uint8_t) data[i] ^ ((mask != NULL) ? mask[i & 3] : 0u);
+
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+  }
+
+  return ~crc;
+}
+
+#ifdef ARDUINO
+
+static bool webSocket_queueMap(void)
+{
+  return true;
+}
+
+// flash is accessed in aligned words, data goes through a word buffer
+static bool webSocket_queueLoad(uint32_t address, void *dist,
+                                uint16_t length)
+{
+  uint32_t buffer[16];
+  uint16_t chunk = 0;
+
+  while (length)
+  {
+    chunk = (length < sizeof(buffer)) ? length : sizeof(buffer);
+
+    if (!ESP.flashRead(WEB_SOCKET_QUEUE_FLASH_ADDRESS + address, buffer,
+                       (chunk + 3u) & ~3u))
+    {
+      return false;
+    }
+
+    memcpy(dist, buffer, chunk);
+    dist = (char *) dist + chunk;
+    address += chunk;
+    length -= chunk;
+  }
+
+  return true;
+}
+
+static bool webSocket_queueStore(uint32_t address, const void *src,
+                                 uint16_t length)
+{
+  uint32_t buffer[16];
+  uint16_t chunk = 0;
+
+  // the stage is word aligned and padded, one write for all of it
+  if (((((uintptr_t) src) & 3u) == 0) && ((length & 3u) == 0))
+  {
+    return ESP.flashWrite(WEB_SOCKET_QUEUE_FLASH_ADDRESS + address,
+                          (uint32_t *) src, length);
+  }
+
+  while (length)
+  {
+    chunk = (length < sizeof(buffer)) ? length : sizeof(buffer);
+
+    // padding stays erased
+    memset(buffer, 0xFF, sizeof(buffer));
+    memcpy(buffer, src, chunk);
+
+    if (!ESP.flashWrite(WEB_SOCKET_QUEUE_FLASH_ADDRESS + address, buffer,
+                        (chunk + 3u) & ~3u))
+    {
+      return false;
+    }
+
+    src = (const char *) src + chunk;
+    address += chunk;
+    length -= chunk;
+  }
+
+  return true;
+}
+
+static bool webSocket_queueErase(uint16_t sector)
+{
+  return ESP.flashEraseSector(WEB_SOCKET_QUEUE_FLASH_ADDRESS
+                              / WEB_SOCKET_QUEUE_SECTOR_SIZE + sector);
+}
+
+#else
+
+static uint8_t *g_queueMap = NULL;
+
+// MAP_SHARED: what is stored survives a crash of the process
+static bool webSocket_queueMap(void)
+{
+  int fd = 0;
+  size_t size = (size_t) WEB_SOCKET_QUEUE_SECTORS
+                * WEB_SOCKET_QUEUE_SECTOR_SIZE;
+  void *map = MAP_FAILED;
+
+  if (g_queueMap != NULL)
+  {
+    return true;
+  }
+
+  fd = open(WEB_SOCKET_QUEUE_FILE, O_RDWR | O_CREAT, 0600);
+
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  if (ftruncate(fd, size) == 0)
+  {
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+
+  close(fd);
+
+  if (map == MAP_FAILED)
+  {
+    return false;
+  }
+
+  g_queueMap = (uint8_t *) map;
+
+  return true;
+}
+
+static bool webSocket_queueLoad(uint32_t address, void *dist,
+                                uint16_t length)
+{
+  memcpy(dist, &g_queueMap[address], length);
+
+  return true;
+}
+
+static bool webSocket_queueStore(uint32_t address, const void *src,
+                                 uint16_t length)
+{
+  memcpy(&g_queueMap[address], src, length);
+
+  return true;
+}
+
+static bool webSocket_queueErase(uint16_t sector)
+{
+  uint8_t *start = &g_queueMap[sector * WEB_SOCKET_QUEUE_SECTOR_SIZE];
+
+  memset(start, 0xFF, WEB_SOCKET_QUEUE_SECTOR_SIZE);
+
+  // let the kernel start writing back the previous sector
+  msync(g_queueMap, (size_t) WEB_SOCKET_QUEUE_SECTORS
+        * WEB_SOCKET_QUEUE_SECTOR_SIZE, MS_ASYNC);
+
+  return true;
+}
+
+#endif // ARDUINO
+
+#endif // WEBSOCKET_QUEUE
@@ -0,0 +1,66 @@
+/*
+ * @file    webSocketQueue.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_QUEUE_H_
+#define WEBSOCKET_QUEUE_H_
+
+#include <stdint.h>
+#include "webSocketConfig.h"
+
+// Store-and-forward log of data frames built while the session is down. A
+// record keeps the first header byte (FIN, RSV, opcode) and the unmasked
+// payload; webSocket_queueRead() encodes the frames again with the mask key
+// of the session that drains them, so nothing stored depends on the session
+// state that webSocket_clear() resets.
+//
+// The log is a ring of erase sectors, in flash on the device and in an
+// mmap'd file elsewhere. Each sector starts with a sequence number, each
+// record with its length and CRC32; a drained record is marked by clearing
+// its state word, which flash allows without an erase. After a reset the
+// sectors are scanned, a record torn by the reset fails its CRC and is
+// skipped. When the ring is full the oldest sector is dropped.
+//
+// Appends only copy into a RAM stage; webSocket_queuePoll(), run by
+// webSocket_handle(), writes it to flash in one go and erases the next
+// sector ahead of time, so a send call does no flash work until the stage
+// is full or a sector ends without an erased successor. Records still in
+// the stage are lost on a reset. Call webSocket_queuePoll() from loop()
+// as well when webSocket_handle() is not called while offline.
+
+#define WEB_SOCKET_QUEUE_SECTOR_SIZE	4096u
+
+#ifndef WEB_SOCKET_QUEUE_SECTORS
+#define WEB_SOCKET_QUEUE_SECTORS		16u
+#endif
+#ifndef WEB_SOCKET_QUEUE_FILE
+#define WEB_SOCKET_QUEUE_FILE			"websocket.queue"
+#endif
+#ifndef WEB_SOCKET_QUEUE_STAGE_SIZE
+#define WEB_SOCKET_QUEUE_STAGE_SIZE		256u  // RAM for records not yet in flash, multiple of 4
+#endif
+#ifndef WEB_SOCKET_QUEUE_BATCH
+#define WEB_SOCKET_QUEUE_BATCH			4u  // send buffers drained per handle
+#endif
+
+#ifdef WEBSOCKET_QUEUE
+
+extern bool webSocket_queueBegin(void);
+extern bool webSocket_queueAppend(uint8_t head, const char *payload,
+                                  uint16_t length, const uint8_t *mask);
+extern uint16_t webSocket_queueRead(char *dist, uint16_t size,
+                                    const uint8_t *mask, uint16_t *count);
+extern void webSocket_queueConsume(uint16_t count);
+extern void webSocket_queuePoll(void);
+extern bool webSocket_queueIsEmpty(void);
+extern uint32_t webSocket_queueGetCount(void);
+extern void webSocket_queueClear(void);
+
+#endif // WEBSOCKET_QUEUE
+
+#endif /* WEBSOCKET_QUEUE_H_ */
@@ -0,0 +1,135 @@
+/*
+ * @file    webSocketReconnect.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <Arduino.h>
+#include "webSocketLog.h"
+#include "webSocketReconnect.h"
+#include "wsBasicHttpClient.h"
+
+#define WEBSOCKET_DEBUG
+
+static void webSocket_reconnectSchedule(void);
+
+static wsHTTPClient *g_reconnectHttp = NULL;
+static webSocketHandler g_reconnectSetup = NULL;
+static uint32_t g_reconnectMin = WEB_SOCKET_RECONNECT_MIN;//msec
+static uint32_t g_reconnectMax = WEB_SOCKET_RECONNECT_MAX;//msec
+static uint32_t g_reconnectDelay = 0;//msec
+static uint32_t g_reconnectCount = 0;//msec
+static uint8_t g_reconnectAttempt = 0;
+static bool g_is_reconnectOnline = false;
+
+void webSocket_reconnectBegin(wsHTTPClient *http, webSocketHandler setup)
+{
+  g_reconnectHttp = http;
+  g_reconnectSetup = setup;
+  g_reconnectDelay = 0;
+  g_reconnectAttempt = 0;
+  g_is_reconnectOnline = false;
+}
+
+void webSocket_reconnectSetBackoff(uint32_t min, uint32_t max)
+{
+  g_reconnectMin = (min > 0) ? min : 1;
+  g_reconnectMax = (max > g_reconnectMin) ? max : g_reconnectMin;
+}
+
+// failed attempts since the last session
+uint8_t webSocket_reconnectGetAttempt(void)
+{
+  return g_reconnectAttempt;
+}
+
+// wait before the next attempt
+uint32_t webSocket_reconnectGetDelay(void)
+{
+  return g_reconnectDelay;
+}
+
+// Returns true while the session is open, call webSocket_handle() then.
+bool webSocket_reconnectHandle(void)
+{
+  int httpCode = 0;
+
+  if (g_reconnectHttp == NULL)
+  {
+    return false;
+  }
+
+  if (webSocket_isStart())
+  {
+    if (g_reconnectHttp->connected())
+    {
+      return true;
+    }
+
+    // link lost without a closing handshake
+    webSocket_abort();
+  }
+
+  if (g_is_reconnectOnline)
+  {
+    // the session just ended, first retry after a short jittered delay
+    g_is_reconnectOnline = false;
+    g_reconnectHttp->disconnect();
+    g_reconnectAttempt = 0;
+    webSocket_reconnectSchedule();
+    return false;
+  }
+
+  if (millis() - g_reconnectCount < g_reconnectDelay)
+  {
+    return false;
+  }
+
+  httpCode = g_reconnectHttp->GET();
+
+  if (httpCode == HTTP_CODE_SWITCHING_PROTOCOLS)
+  {
+    if (g_reconnectSetup != NULL)
+    {
+      g_reconnectSetup();
+    }
+
+    webSocket_start();
+    g_reconnectAttempt = 0;
+    g_reconnectDelay = 0;
+    g_is_reconnectOnline = true;
+    return true;
+  }
+
+  WEB_SOCKET_LOG_ERROR("reconnect failed %d", httpCode);
+
+#ifndef WEBSOCKET_DEBUG
+  Serial.print("RECONNECT: FAILED "); // DEBUG
+  Serial.println(httpCode); // DEBUG
+#endif // WEBSOCKET_DEBUG
+
+  g_reconnectHttp->disconnect();
+  webSocket_reconnectSchedule();
+
+  return false;
+}
+
+static void webSocket_reconnectSchedule(void)
+{
+  g_reconnectDelay = webSocket_reconnectBackoff(g_reconnectMin, g_reconnectMax,
+                                                g_reconnectAttempt, random(0x7FFFFFFF));
+  g_reconnectCount = millis();
+
+  if (g_reconnectAttempt < UINT8_MAX)
+  {
+    g_reconnectAttempt++;
+  }
+
+#ifndef WEBSOCKET_DEBUG
+  Serial.print("RECONNECT: WAIT "); // DEBUG
+  Serial.println(g_reconnectDelay); // DEBUG
+#endif // WEBSOCKET_DEBUG
+}
@@ -0,0 +1,61 @@
+/*
+ * @file    webSocketReconnect.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_RECONNECT_H_
+#define WEBSOCKET_RECONNECT_H_
+
+#include <stdint.h>
+#include "webSocket.h"
+
+#ifndef WEB_SOCKET_RECONNECT_MIN
+#define WEB_SOCKET_RECONNECT_MIN	50//msec
+#endif
+#ifndef WEB_SOCKET_RECONNECT_MAX
+#define WEB_SOCKET_RECONNECT_MAX	10000//msec
+#endif
+
+// Reconnect manager. Configure the wsHTTPClient (begin, headers) once and
+// call webSocket_reconnectHandle() from loop() while WiFi is up; it opens
+// the session, notices when it ends or the TCP link drops, and retries with
+// jittered exponential backoff. setup registers the handlers before every
+// webSocket_start() (webSocket_clear() drops them on close);
+// WEBSOCKET_HANDLER_RESUME runs after OPEN on every session but the first.
+//
+//   if (webSocket_reconnectHandle()) {
+//     webSocket_handle(g_http.getStream());
+//   }
+//
+// The backoff below is free of Arduino dependencies.
+
+// Wait before the attempt after attempt failed ones: an exponential ceiling
+// from min to max with equal jitter, so devices dropped by the same AP do
+// not retry in lockstep. jitter is any random number.
+static inline uint32_t webSocket_reconnectBackoff(uint32_t min, uint32_t max,
+                                                  uint8_t attempt, uint32_t jitter)
+{
+  uint32_t ceiling = min;
+
+  for (uint8_t i = 0; (i < attempt) && (ceiling < max); i++)
+  {
+    ceiling = (ceiling > max / 2) ? max : (ceiling << 1);
+  }
+
+  return (ceiling / 2) + (jitter % ((ceiling / 2) + 1));
+}
+
+class wsHTTPClient;
+
+extern void webSocket_reconnectBegin(wsHTTPClient *http,
+                                     webSocketHandler setup);
+extern void webSocket_reconnectSetBackoff(uint32_t min, uint32_t max);
+extern bool webSocket_reconnectHandle(void);
+extern uint8_t webSocket_reconnectGetAttempt(void);
+extern uint32_t webSocket_reconnectGetDelay(void);
+
+#endif /* WEBSOCKET_RECONNECT_H_ */
@@ -0,0 +1,238 @@
+/*
+ * @file    webSocketRecord.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include <string.h>
+#include <Arduino.h>
+#include "webSocketRecord.h"
+
+#ifdef WEBSOCKET_RECORD
+
+#ifndef ARDUINO
+#include <stdio.h>
+#endif // ARDUINO
+
+static uint8_t webSocket_recordPutVarint(uint8_t *dist, uint32_t value);
+static void webSocket_recordCopyIn(const uint8_t *src, uint16_t length);
+static void webSocket_recordCopyOut(uint8_t *dist, uint16_t offset,
+                                    uint16_t length);
+static void webSocket_recordSkip(void);
+
+static uint8_t g_recordBuffer[WEB_SOCKET_RECORD_SIZE];
+static uint16_t g_recordHead = 0;
+static uint16_t g_recordTail = 0;
+static uint16_t g_recordUsed = 0;
+static uint32_t g_recordDropped = 0;
+static uint32_t g_recordTime = 0;//msec of the last record
+static bool g_is_record = false;
+#ifndef ARDUINO
+static FILE *g_recordFile = NULL;
+#endif // ARDUINO
+
+void webSocket_recordStart(void)
+{
+  g_recordTime = millis();
+  g_is_record = true;
+}
+
+void webSocket_recordStop(void)
+{
+  g_is_record = false;
+}
+
+void webSocket_recordPut(uint8_t kind, const void *data, uint16_t length)
+{
+  uint8_t header[WEB_SOCKET_RECORD_HEADER_MAX];
+  uint8_t header_length = 0;
+  uint32_t now = 0;
+
+  if (!g_is_record)
+  {
+    return;
+  }
+
+  now = millis();
+  header[header_length++] = kind;
+  header_length += webSocket_recordPutVarint(&header[header_length],
+                   now - g_recordTime);
+  header_length += webSocket_recordPutVarint(&header[header_length], length);
+  g_recordTime = now;
+
+#ifndef ARDUINO
+  if (g_recordFile != NULL)
+  {
+    fwrite(header, 1, header_length, g_recordFile);
+    fwrite(data, 1, length, g_recordFile);
+    return;
+  }
+#endif // ARDUINO
+
+  if (header_length + length > WEB_SOCKET_RECORD_SIZE)
+  {
+    g_recordDropped++;
+    return;
+  }
+
+  while (WEB_SOCKET_RECORD_SIZE - g_recordUsed < header_length + length)
+  {
+    webSocket_recordSkip();
+    g_recordDropped++;
+  }
+
+  webSocket_recordCopyIn(header, header_length);
+  webSocket_recordCopyIn((const uint8_t *) data, length);
+}
+
+// Moves whole records, oldest first, out of the ring. Returns the bytes
+// copied; a record larger than size stays in the ring.
+uint16_t webSocket_recordRead(uint8_t *dist, uint16_t size)
+{
+  uint8_t header[WEB_SOCKET_RECORD_HEADER_MAX];
+  WEB_SOCKET_RECORD_INFO info;
+  uint8_t header_length = 0;
+  uint16_t count = 0;
+  uint16_t record_length = 0;
+
+  while (g_recordUsed)
+  {
+    header_length = (g_recordUsed < sizeof(header)) ? g_recordUsed
+                    : sizeof(header);
+    webSocket_recordCopyOut(header, 0, header_length);
+
+    if (!webSocket_recordParse(header, header_length, &info))
+    {
+      break;
+    }
+
+    record_length = info.header_length + info.length;
+
+    if (count + record_length > size)
+    {
+      break;
+    }
+
+    webSocket_recordCopyOut(&dist[count], 0, record_length);
+    webSocket_recordSkip();
+    count += record_length;
+  }
+
+  return count;
+}
+
+uint32_t webSocket_recordGetDropped(void)
+{
+  return g_recordDropped;
+}
+
+#ifndef ARDUINO
+bool webSocket_recordOpen(const char *path)
+{
+  webSocket_recordClose();
+
+  g_recordFile = fopen(path, "wb");
+
+  if (g_recordFile == NULL)
+  {
+    return false;
+  }
+
+  fwrite(WEB_SOCKET_RECORD_MAGIC, 1, WEB_SOCKET_RECORD_MAGIC_SIZE,
+         g_recordFile);
+
+  return true;
+}
+
+void webSocket_recordClose(void)
+{
+  if (g_recordFile != NULL)
+  {
+    fclose(g_recordFile);
+    g_recordFile = NULL;
+  }
+}
+#endif // ARDUINO
+
+static uint8_t webSocket_recordPutVarint(uint8_t *dist, uint32_t value)
+{
+  uint8_t index = 0;
+
+  do
+  {
+    dist[index] = (uint8_t)(value & 0x7F);
+    value >>= 7;
+
+    if (value)
+    {
+      dist[index] |= 0x80;
+    }
+
+    index++;
+  } while (value);
+
+  return index;
+}
+
+static void webSocket_recordCopyIn(const uint8_t *src, uint16_t length)
+{
+  uint16_t first = WEB_SOCKET_RECORD_SIZE - g_recordHead;
+
+  if (first > length)
+  {
+    first = length;
+  }
+
+  memcpy(&g_recordBuffer[g_recordHead], src, first);
+  memcpy(g_recordBuffer, &src[first], length - first);
+
+  g_recordHead = (g_recordHead + length) % WEB_SOCKET_RECORD_SIZE;
+  g_recordUsed += length;
+}
+
+static void webSocket_recordCopyOut(uint8_t *dist, uint16_t offset,
+                                    uint16_t length)
+{
+  uint16_t start = (g_recordTail + offset) % WEB_SOCKET_RECORD_SIZE;
+  uint16_t first = WEB_SOCKET_RECORD_SIZE - start;
+
+  if (first > length)
+  {
+    first = length;
+  }
+
+  memcpy(dist, &g_recordBuffer[start], first);
+  memcpy(&dist[first], g_recordBuffer, length - first);
+}
+
+// drops the oldest record
+static void webSocket_recordSkip(void)
+{
+  uint8_t header[WEB_SOCKET_RECORD_HEADER_MAX];
+  WEB_SOCKET_RECORD_INFO info;
+  uint8_t header_length = 0;
+  uint16_t record_length = 0;
+
+  header_length = (g_recordUsed < sizeof(header)) ? g_recordUsed
+                  : sizeof(header);
+  webSocket_recordCopyOut(header, 0, header_length);
+
+  if (!webSocket_recordParse(header, header_length, &info))
+  {
+    // not a record header, the ring is lost
+    g_recordTail = g_recordHead;
+    g_recordUsed = 0;
+    return;
+  }
+
+  record_length = info.header_length + info.length;
+
+  g_recordTail = (g_recordTail + record_length) % WEB_SOCKET_RECORD_SIZE;
+  g_recordUsed -= record_length;
+}
+
+#endif // WEBSOCKET_RECORD
@@ -0,0 +1,121 @@
+/*
+ * @file    webSocketRecord.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_RECORD_H_
+#define WEBSOCKET_RECORD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "webSocketConfig.h"
+
+// Frame level traffic recorder. Received bytes are recorded as they come
+// off the client (header, then the payload still masked), sent frames as
+// they are written, so a trace replays byte for byte through
+// webSocketReplayClient (webSocketReplay.h). A trace is a sequence of
+//
+//   [kind][time delta, msec][length][bytes]
+//
+// with the delta and length as LEB128 varints, 3 bytes of overhead for
+// most records. On the device records go to a RAM ring that drops the
+// oldest records, drained with webSocket_recordRead(); on a host they can
+// go to a file instead, which starts with WEB_SOCKET_RECORD_MAGIC.
+
+#define WEB_SOCKET_RECORD_MAGIC			"WSR\x01"
+#define WEB_SOCKET_RECORD_MAGIC_SIZE	4u
+#define WEB_SOCKET_RECORD_HEADER_MAX	(1u + 5u + 3u)
+
+#ifndef WEB_SOCKET_RECORD_SIZE
+#define WEB_SOCKET_RECORD_SIZE			2048u  // RAM ring bytes
+#endif
+
+enum webSocketRecordKind {
+  WEBSOCKET_RECORD_RX_HEADER = 1,
+  WEBSOCKET_RECORD_RX_PAYLOAD,
+  WEBSOCKET_RECORD_TX
+};
+
+typedef struct _WEB_SOCKET_RECORD_INFO
+{
+  uint8_t kind;
+  uint8_t header_length;
+  uint32_t delta;//msec
+  uint16_t length;
+} WEB_SOCKET_RECORD_INFO;
+
+// Decodes the record header at src. Returns its size, or 0 when size is
+// too short to hold it or it is malformed.
+static inline uint8_t webSocket_recordParse(const uint8_t *src, size_t size,
+                                            WEB_SOCKET_RECORD_INFO *info)
+{
+  uint8_t index = 1;
+  uint32_t value = 0;
+
+  if (size < 3)
+  {
+    return 0;
+  }
+
+  info->kind = src[0];
+
+  for (uint8_t field = 0; field < 2; field++)
+  {
+    value = 0;
+
+    for (uint8_t shift = 0; ; shift += 7)
+    {
+      if ((index >= size) || (shift > 28))
+      {
+        return 0;
+      }
+
+      value |= (uint32_t)(src[index] & 0x7F) << shift;
+
+      if (!(src[index++] & 0x80))
+      {
+        break;
+      }
+    }
+
+    if (field == 0)
+    {
+      info->delta = value;
+    }
+    else
+    {
+      info->length = (uint16_t) value;
+    }
+  }
+
+  info->header_length = index;
+
+  return index;
+}
+
+#ifdef WEBSOCKET_RECORD
+
+#define WEB_SOCKET_RECORD(kind, data, length)	webSocket_recordPut(kind, data, length)
+
+extern void webSocket_recordStart(void);
+extern void webSocket_recordStop(void);
+extern void webSocket_recordPut(uint8_t kind, const void *data,
+                                uint16_t length);
+extern uint16_t webSocket_recordRead(uint8_t *dist, uint16_t size);
+extern uint32_t webSocket_recordGetDropped(void);
+#ifndef ARDUINO
+extern bool webSocket_recordOpen(const char *path);
+extern void webSocket_recordClose(void);
+#endif // ARDUINO
+
+#else
+
+#define WEB_SOCKET_RECORD(kind, data, length)
+
+#endif // WEBSOCKET_RECORD
+
+#endif /* WEBSOCKET_RECORD_H_ */
@@ -0,0 +1,208 @@
+/*
+ * @file    webSocketReplay.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <string.h>
+#include "webSocketReplay.h"
+
+#ifdef WEBSOCKET_RECORD
+
+webSocketReplayClient::webSocketReplayClient()
+{
+}
+
+/**
+ * the trace must stay valid until isDone(), a file magic is skipped
+ */
+void webSocketReplayClient::begin(const uint8_t * trace, size_t length, bool paced)
+{
+    _trace = trace;
+    _length = length;
+    _position = 0;
+    _remain = 0;
+    _time = 0;
+    _written = 0;
+    _paced = paced;
+    _started = false;
+
+    if(length >= WEB_SOCKET_RECORD_MAGIC_SIZE
+       && memcmp(trace, WEB_SOCKET_RECORD_MAGIC, WEB_SOCKET_RECORD_MAGIC_SIZE) == 0) {
+        _position = WEB_SOCKET_RECORD_MAGIC_SIZE;
+    }
+}
+
+/**
+ * true when no received bytes are left, recorded sends may follow
+ */
+bool webSocketReplayClient::isDone(void)
+{
+    WEB_SOCKET_RECORD_INFO info;
+    size_t position = _position;
+
+    if(_remain) {
+        return false;
+    }
+
+    while(position < _length
+          && webSocket_recordParse(&_trace[position], _length - position, &info)) {
+        if(info.kind != WEBSOCKET_RECORD_TX && info.length) {
+            return false;
+        }
+        position += info.header_length + info.length;
+    }
+
+    return true;
+}
+
+uint32_t webSocketReplayClient::getWritten(void)
+{
+    return _written;
+}
+
+/**
+ * bytes of the received records that are due, the pacing clock starts
+ * with the first call
+ */
+int webSocketReplayClient::available()
+{
+    WEB_SOCKET_RECORD_INFO info;
+    size_t position = _position;
+    uint32_t time = _time;
+    int count = _remain;
+
+    if(!_started) {
+        _start = millis();
+        _started = true;
+    }
+
+    while(position < _length
+          && webSocket_recordParse(&_trace[position], _length - position, &info)) {
+        time += info.delta;
+
+        if((_paced && (time > millis() - _start))
+           || (position + info.header_length + info.length > _length)) {
+            break;
+        }
+        if(info.kind != WEBSOCKET_RECORD_TX) {
+            count += info.length;
+        }
+        position += info.header_length + info.length;
+    }
+
+    return count;
+}
+
+int webSocketReplayClient::read()
+{
+    uint8_t data = 0;
+
+    if(read(&data, 1) != 1) {
+        return -1;
+    }
+
+    return data;
+}
+
+int webSocketReplayClient::read(uint8_t * buf, size_t size)
+{
+    size_t count = 0;
+    size_t length = 0;
+
+    while(count < size) {
+        if(_remain == 0 && !nextRecord()) {
+            break;
+        }
+
+        length = (_remain < size - count) ? _remain : size - count;
+        memcpy(&buf[count], &_trace[_data], length);
+        _data += length;
+        _remain -= length;
+        count += length;
+    }
+
+    return count;
+}
+
+int webSocketReplayClient::peek()
+{
+    if(_remain == 0 && !nextRecord()) {
+        return -1;
+    }
+
+    return _trace[_data];
+}
+
+size_t webSocketReplayClient::write(uint8_t data)
+{
+    (void) data;
+    _written++;
+    return 1;
+}
+
+size_t webSocketReplayClient::write(const uint8_t * buf, size_t size)
+{
+    (void) buf;
+    _written += size;
+    return size;
+}
+
+void webSocketReplayClient::flush()
+{
+}
+
+void webSocketReplayClient::stop()
+{
+    _position = _length;
+    _remain = 0;
+}
+
+uint8_t webSocketReplayClient::connected()
+{
+    return !isDone();
+}
+
+webSocketReplayClient::operator bool()
+{
+    return connected();
+}
+
+/**
+ * steps to the next received record that is due, false when there is none
+ */
+bool webSocketReplayClient::nextRecord(void)
+{
+    WEB_SOCKET_RECORD_INFO info;
+
+    while(_position < _length
+          && webSocket_recordParse(&_trace[_position], _length - _position, &info)) {
+        if(_paced && (_time + info.delta > millis() - _start)) {
+            return false;
+        }
+
+        _time += info.delta;
+        _data = _position + info.header_length;
+        _position = _data + info.length;
+
+        if(_position > _length) {
+            _position = _length; // truncated trace
+            return false;
+        }
+        if(info.kind != WEBSOCKET_RECORD_TX && info.length) {
+            _remain = info.length;
+            return true;
+        }
+    }
+
+    if(_position < _length) {
+        _position = _length; // malformed record, end the replay
+    }
+
+    return false;
+}
+
+#endif // WEBSOCKET_RECORD
@@ -0,0 +1,67 @@
+/*
+ * @file    webSocketReplay.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_REPLAY_H_
+#define WEBSOCKET_REPLAY_H_
+
+#include <WiFiClient.h>
+#include "webSocketRecord.h"
+
+// In-memory client that plays the received bytes of a trace recorded by
+// webSocketRecord back into webSocket_handle(). Sent bytes are counted and
+// dropped. With paced, bytes become available at their recorded times,
+// otherwise all at once:
+//
+//   webSocketReplayClient replay;
+//   replay.begin(trace, trace_length, false);
+//   webSocket_start();
+//   while (!replay.isDone()) {
+//     webSocket_handle(replay);
+//   }
+
+#ifdef WEBSOCKET_RECORD
+
+class webSocketReplayClient: public WiFiClient {
+
+public:
+    webSocketReplayClient();
+
+    void begin(const uint8_t * trace, size_t length, bool paced);
+    bool isDone(void);
+    uint32_t getWritten(void);///bytes the library sent
+
+    virtual int available();
+    virtual int read();
+    virtual int read(uint8_t * buf, size_t size);
+    virtual int peek();
+    virtual size_t write(uint8_t data);
+    virtual size_t write(const uint8_t * buf, size_t size);
+    virtual void flush();
+    virtual void stop();
+    virtual uint8_t connected();
+    virtual operator bool();
+
+protected:
+    bool nextRecord(void);
+
+    const uint8_t * _trace = NULL;
+    size_t _length = 0;
+    size_t _position = 0;///next record header
+    size_t _data = 0;///next byte of the current record
+    uint16_t _remain = 0;///bytes left in the current record
+    uint32_t _time = 0;///msec of the current record from the first
+    uint32_t _start = 0;
+    uint32_t _written = 0;
+    bool _paced = false;
+    bool _started = false;
+};
+
+#endif // WEBSOCKET_RECORD
+
+#endif /* WEBSOCKET_REPLAY_H_ */
@@ -0,0 +1,161 @@
+/*
+ * @file    webSocketSched.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include <string.h>
+#include <Arduino.h>
+#include "webSocketSched.h"
+
+#ifdef WEBSOCKET_SCHED
+
+static bool webSocket_schedIsBefore(const WEB_SOCKET_SCHED_RECORD *a,
+                                    const WEB_SOCKET_SCHED_RECORD *b);
+static bool webSocket_schedIsExpired(const WEB_SOCKET_SCHED_RECORD *record,
+                                     uint32_t now);
+
+static WEB_SOCKET_SCHED_RECORD g_schedRecord[WEB_SOCKET_SCHED_SLOTS];
+static uint8_t g_schedCount = 0;
+static uint32_t g_schedDropped = 0;
+
+// Queues a message. When all slots are taken it replaces the oldest message
+// of the lowest priority unless that one ranks higher, then the new message
+// is dropped and false returned.
+bool webSocket_schedSend(const char *payload, uint16_t payload_length,
+                         uint8_t opcode, uint8_t priority, uint32_t ttl)
+{
+  WEB_SOCKET_SCHED_RECORD *slot = NULL;
+  uint32_t now = millis();
+
+  if ((payload_length > WEB_SOCKET_SCHED_RECORD_SIZE) || (opcode == 0))
+  {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < WEB_SOCKET_SCHED_SLOTS; i++)
+  {
+    WEB_SOCKET_SCHED_RECORD *record = &g_schedRecord[i];
+
+    if ((record->opcode == 0) || webSocket_schedIsExpired(record, now))
+    {
+      if (record->opcode != 0)
+      {
+        g_schedDropped++;
+        g_schedCount--;
+      }
+
+      slot = record;
+      break;
+    }
+
+    // lowest priority, oldest within it
+    if ((slot == NULL) || (record->priority < slot->priority)
+        || ((record->priority == slot->priority)
+            && ((int32_t)(record->time - slot->time) < 0)))
+    {
+      slot = record;
+    }
+  }
+
+  if (slot->opcode != 0)
+  {
+    g_schedDropped++;
+
+    if (slot->priority > priority)
+    {
+      return false;
+    }
+
+    g_schedCount--;
+  }
+
+  slot->opcode = opcode;
+  slot->priority = priority;
+  slot->length = payload_length;
+  slot->time = now;
+  slot->ttl = ttl;
+  memcpy(slot->data, payload, payload_length);
+  g_schedCount++;
+
+  return true;
+}
+
+// called by webSocket_handle(), sends at most one message
+void webSocket_schedPoll(void)
+{
+  WEB_SOCKET_SCHED_RECORD *best = NULL;
+  uint32_t now = millis();
+
+  if (g_schedCount == 0)
+  {
+    return;
+  }
+
+  for (uint8_t i = 0; i < WEB_SOCKET_SCHED_SLOTS; i++)
+  {
+    WEB_SOCKET_SCHED_RECORD *record = &g_schedRecord[i];
+
+    if (record->opcode == 0)
+    {
+      continue;
+    }
+
+    if (webSocket_schedIsExpired(record, now))
+    {
+      record->opcode = 0;
+      g_schedCount--;
+      g_schedDropped++;
+      continue;
+    }
+
+    if ((best == NULL) || webSocket_schedIsBefore(record, best))
+    {
+      best = record;
+    }
+  }
+
+  if ((best == NULL) || webSocket_isSendBusy())
+  {
+    return;
+  }
+
+  webSocket_setData(best->data, best->length, best->opcode);
+  best->opcode = 0;
+  g_schedCount--;
+}
+
+uint8_t webSocket_schedGetCount(void)
+{
+  return g_schedCount;
+}
+
+// expired, and replaced or refused because all slots were taken
+uint32_t webSocket_schedGetDropped(void)
+{
+  return g_schedDropped;
+}
+
+static bool webSocket_schedIsBefore(const WEB_SOCKET_SCHED_RECORD *a,
+                                    const WEB_SOCKET_SCHED_RECORD *b)
+{
+  if (a->priority != b->priority)
+  {
+    return a->priority > b->priority;
+  }
+
+  return (int32_t)(a->time - b->time) < 0;
+}
+
+static bool webSocket_schedIsExpired(const WEB_SOCKET_SCHED_RECORD *record,
+                                     uint32_t now)
+{
+  return (record->ttl != WEB_SOCKET_SCHED_NO_EXPIRY)
+         && (now - record->time >= record->ttl);
+}
+
+#endif // WEBSOCKET_SCHED
@@ -0,0 +1,53 @@
+/*
+ * @file    webSocketSched.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_SCHED_H_
+#define WEBSOCKET_SCHED_H_
+
+#include "webSocket.h"
+
+// Outbound scheduler. Messages wait in WEB_SOCKET_SCHED_SLOTS slots with a
+// priority (higher first, oldest first within one priority) and an
+// optional time to live. webSocket_handle() sends the best unexpired
+// message whenever the send buffer is free and drops expired ones without
+// writing them, so a backlog costs freshness at most the time to live:
+//
+//   webSocket_schedSend(json, length, OPCODE_FRAME_TEXT, 1, 500);
+
+#ifndef WEB_SOCKET_SCHED_SLOTS
+#define WEB_SOCKET_SCHED_SLOTS			8u
+#endif
+#ifndef WEB_SOCKET_SCHED_RECORD_SIZE
+#define WEB_SOCKET_SCHED_RECORD_SIZE	128u
+#endif
+
+#define WEB_SOCKET_SCHED_NO_EXPIRY		0u
+
+typedef struct _WEB_SOCKET_SCHED_RECORD
+{
+  uint8_t opcode;   // 0 for a free slot
+  uint8_t priority;
+  uint16_t length;
+  uint32_t time;    // msec queued
+  uint32_t ttl;     // msec, WEB_SOCKET_SCHED_NO_EXPIRY
+  char data[WEB_SOCKET_SCHED_RECORD_SIZE];
+} WEB_SOCKET_SCHED_RECORD;
+
+#ifdef WEBSOCKET_SCHED
+
+extern bool webSocket_schedSend(const char *payload, uint16_t payload_length,
+                                uint8_t opcode, uint8_t priority,
+                                uint32_t ttl);
+extern void webSocket_schedPoll(void);
+extern uint8_t webSocket_schedGetCount(void);
+extern uint32_t webSocket_schedGetDropped(void);
+
+#endif // WEBSOCKET_SCHED
+
+#endif /* WEBSOCKET_SCHED_H_ */
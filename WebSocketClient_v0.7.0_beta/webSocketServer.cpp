@@ -0,0 +1,681 @@
+/*
+ * @file    webSocketServer.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <WiFiServer.h>
+#include "webSocketLog.h"
+#include "webSocketServer.h"
+#include "Hash.h"
+
+#ifdef WEBSOCKET_SERVER
+
+// largest header of a frame to a client: unmasked, 16 bit length
+#define WEB_SOCKET_SERVER_HEADER_SIZE	(WEB_SOCKET_HEAD_FRAME_SIZE + 2u)
+#define WEB_SOCKET_SHA1_SIZE			20u
+
+static_assert(WEB_SOCKET_SERVER_CLIENTS < WEB_SOCKET_SERVER_ALL,
+              "client index WEB_SOCKET_SERVER_ALL is the broadcast");
+static_assert(WEB_SOCKET_SERVER_SEND_SIZE <= WEB_SOCKET_FRAME_LENGTH16_MAX,
+              "frames to clients use the 16 bit length form");
+static_assert(WEB_SOCKET_SERVER_RECIVE_SIZE >= 160u,
+              "the receive buffer also holds the 101 response");
+
+enum webSocketServerState {
+  WEBSOCKET_SERVER_STATE_FREE = 0,
+  WEBSOCKET_SERVER_STATE_HANDSHAKE,
+  WEBSOCKET_SERVER_STATE_OPEN
+};
+
+typedef struct _WEB_SOCKET_SERVER_CLIENT
+{
+  WiFiClient client;
+  WEB_SOCKET_SERVER_REQUEST request;
+  uint32_t time;//msec, accepted at
+  uint16_t length;  // bytes in buffer, request line or frames
+  uint16_t message;  // bytes of a fragmented message in front of the frames
+  uint8_t opcode;  // of that message, OPCODE_FRAME_CONTINUE when none
+  uint8_t state;
+  char buffer[WEB_SOCKET_SERVER_RECIVE_SIZE];
+} WEB_SOCKET_SERVER_CLIENT;
+
+static void webSocket_serverAcceptClient(void);
+static void webSocket_serverHandshake(uint8_t index);
+static void webSocket_serverReceive(uint8_t index);
+static bool webSocket_serverFrame(uint8_t index,
+                                  const WEB_SOCKET_FRAME_INFO *info,
+                                  uint16_t payload_length);
+static bool webSocket_serverWrite(uint8_t index, const uint8_t *data,
+                                  uint16_t length);
+static void webSocket_serverSendControl(uint8_t index, uint8_t opcode,
+                                        const char *payload,
+                                        uint16_t payload_length);
+static void webSocket_serverDrop(uint8_t index);
+
+static const char g_serverBase64[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char g_serverGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+static const char g_serverSwitching[] =
+  "HTTP/1.1 101 Switching Protocols\r\n"
+  "Upgrade: websocket\r\n"
+  "Connection: Upgrade\r\n"
+  "Sec-WebSocket-Accept: ";
+static const char g_serverBadRequest[] =
+  "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n";
+static const char g_serverUnavailable[] =
+  "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\n\r\n";
+
+static WiFiServer *g_server = NULL;
+static webSocketServerHandler g_serverHandler = NULL;
+static WEB_SOCKET_SERVER_CLIENT g_serverClient[WEB_SOCKET_SERVER_CLIENTS];
+
+// The header is encoded right aligned in front of the payload, so a frame
+// is one contiguous write whatever its length form.
+static uint8_t g_serverFrame[WEB_SOCKET_SERVER_HEADER_SIZE
+                             + WEB_SOCKET_SERVER_SEND_SIZE];
+
+// lower case token, compared without regard to case
+static bool webSocket_serverIsToken(const char *text, uint16_t length,
+                                    const char *token)
+{
+  uint16_t i = 0;
+
+  for (i = 0; (i < length) && (token[i] != '\0'); i++)
+  {
+    char c = text[i];
+
+    if ((c >= 'A') && (c <= 'Z'))
+    {
+      c += 'a' - 'A';
+    }
+
+    if (c != token[i])
+    {
+      return false;
+    }
+  }
+
+  return (i == length) && (token[i] == '\0');
+}
+
+// "Name: value" with the name in lower case, the value is trimmed
+static bool webSocket_serverHeader(const char *line, uint16_t length,
+                                   const char *name, const char **value,
+                                   uint16_t *value_length)
+{
+  uint16_t name_length = strlen(name);
+  uint16_t start = name_length + 1;
+
+  if ((length <= name_length) || (line[name_length] != ':')
+      || !webSocket_serverIsToken(line, name_length, name))
+  {
+    return false;
+  }
+
+  while ((start < length) && ((line[start] == ' ') || (line[start] == '\t')))
+  {
+    start++;
+  }
+
+  while ((length > start)
+         && ((line[length - 1] == ' ') || (line[length - 1] == '\t')))
+  {
+    length--;
+  }
+
+  *value = &line[start];
+  *value_length = length - start;
+
+  return true;
+}
+
+int8_t webSocket_serverParseLine(WEB_SOCKET_SERVER_REQUEST *request,
+                                 const char *line, uint16_t length)
+{
+  const char *value = NULL;
+  uint16_t value_length = 0;
+
+  if (!request->is_get)
+  {
+    // request line: GET /path HTTP/1.1
+    request->is_get = (length > 4) && (memcmp(line, "GET ", 4) == 0);
+    return request->is_get ? 0 : -1;
+  }
+
+  if (length == 0)
+  {
+    return (request->is_upgrade && request->is_version
+            && (request->key[0] != '\0')) ? 1 : -1;
+  }
+
+  if (webSocket_serverHeader(line, length, "upgrade", &value, &value_length))
+  {
+    request->is_upgrade = webSocket_serverIsToken(value, value_length,
+                                                  "websocket");
+  }
+  else if (webSocket_serverHeader(line, length, "sec-websocket-version",
+                                  &value, &value_length))
+  {
+    request->is_version = (value_length == 2) && (memcmp(value, "13", 2) == 0);
+  }
+  else if (webSocket_serverHeader(line, length, "sec-websocket-key", &value,
+                                  &value_length)
+           && (value_length == WEB_SOCKET_SERVER_KEY_SIZE))
+  {
+    memcpy(request->key, value, WEB_SOCKET_SERVER_KEY_SIZE);
+    request->key[WEB_SOCKET_SERVER_KEY_SIZE] = '\0';
+  }
+
+  return 0;
+}
+
+// writes 4 characters per 3 bytes, padded with '=', not terminated
+void webSocket_serverBase64(const uint8_t *src, uint16_t length, char *dist)
+{
+  for (uint16_t i = 0; i < length; i += 3)
+  {
+    uint32_t bits = (uint32_t) src[i] << 16;
+
+    if (i + 1 < length)
+    {
+      bits |= (uint32_t) src[i + 1] << 8;
+    }
+
+    if (i + 2 < length)
+    {
+      bits |= src[i + 2];
+    }
+
+    *dist++ = g_serverBase64[(bits >> 18) & 0x3F];
+    *dist++ = g_serverBase64[(bits >> 12) & 0x3F];
+    *dist++ = (i + 1 < length) ? g_serverBase64[(bits >> 6) & 0x3F] : '=';
+    *dist++ = (i + 2 < length) ? g_serverBase64[bits & 0x3F] : '=';
+  }
+}
+
+// Sec-WebSocket-Accept of a 24 character key, like webSocket_Hash_Key()
+// but without String; accept holds WEB_SOCKET_SERVER_ACCEPT_SIZE + 1.
+void webSocket_serverAccept(const char *key, char *accept)
+{
+  uint8_t merge[WEB_SOCKET_SERVER_KEY_SIZE + sizeof(g_serverGuid) - 1];
+  uint8_t hash[WEB_SOCKET_SHA1_SIZE];
+
+  memcpy(merge, key, WEB_SOCKET_SERVER_KEY_SIZE);
+  memcpy(&merge[WEB_SOCKET_SERVER_KEY_SIZE], g_serverGuid,
+         sizeof(g_serverGuid) - 1);
+  sha1(merge, sizeof(merge), hash);
+
+  webSocket_serverBase64(hash, WEB_SOCKET_SHA1_SIZE, accept);
+  accept[WEB_SOCKET_SERVER_ACCEPT_SIZE] = '\0';
+}
+
+void webSocket_serverBegin(WiFiServer *server, webSocketServerHandler handler)
+{
+  for (uint8_t i = 0; i < WEB_SOCKET_SERVER_CLIENTS; i++)
+  {
+    if (g_serverClient[i].state != WEBSOCKET_SERVER_STATE_FREE)
+    {
+      g_serverClient[i].client.stop();
+      g_serverClient[i].state = WEBSOCKET_SERVER_STATE_FREE;
+    }
+  }
+
+  g_server = server;
+  g_serverHandler = handler;
+}
+
+// call from loop(), accepts, upgrades and reads the clients
+void webSocket_serverHandle(void)
+{
+  if (g_server == NULL)
+  {
+    return;
+  }
+
+  webSocket_serverAcceptClient();
+
+  for (uint8_t i = 0; i < WEB_SOCKET_SERVER_CLIENTS; i++)
+  {
+    if (g_serverClient[i].state == WEBSOCKET_SERVER_STATE_HANDSHAKE)
+    {
+      webSocket_serverHandshake(i);
+    }
+    else if (g_serverClient[i].state == WEBSOCKET_SERVER_STATE_OPEN)
+    {
+      webSocket_serverReceive(i);
+    }
+  }
+}
+
+// Payload area of the shared send frame, *capacity is set to its size.
+// Fill it, then send with webSocket_serverCommitFrame().
+char *webSocket_serverBeginFrame(uint16_t *capacity)
+{
+  *capacity = WEB_SOCKET_SERVER_SEND_SIZE;
+
+  return (char *) &g_serverFrame[WEB_SOCKET_SERVER_HEADER_SIZE];
+}
+
+// Sends the frame to one client or to WEB_SOCKET_SERVER_ALL. The header is
+// encoded once, every client gets the same bytes. Returns the number of
+// clients written to.
+uint8_t webSocket_serverCommitFrame(uint8_t client, uint16_t payload_length,
+                                   uint8_t opcode)
+{
+  uint8_t header_length = 0;
+  uint8_t *frame = NULL;
+  uint8_t count = 0;
+
+  if (payload_length > WEB_SOCKET_SERVER_SEND_SIZE)
+  {
+    return 0;
+  }
+
+  header_length = webSocket_frameEncodedSize(payload_length, false);
+  frame = &g_serverFrame[WEB_SOCKET_SERVER_HEADER_SIZE - header_length];
+  webSocket_frameEncodeHeader(frame, true, 0, opcode, NULL, payload_length);
+
+  for (uint8_t i = 0; i < WEB_SOCKET_SERVER_CLIENTS; i++)
+  {
+    if (((client == WEB_SOCKET_SERVER_ALL) || (client == i))
+        && (g_serverClient[i].state == WEBSOCKET_SERVER_STATE_OPEN)
+        && webSocket_serverWrite(i, frame, header_length + payload_length))
+    {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+bool webSocket_serverSend(uint8_t client, const char *payload,
+                          uint16_t payload_length, uint8_t opcode)
+{
+  uint16_t capacity = 0;
+  char *frame = webSocket_serverBeginFrame(&capacity);
+
+  if ((client >= WEB_SOCKET_SERVER_CLIENTS) || (payload_length > capacity))
+  {
+    return false;
+  }
+
+  memcpy(frame, payload, payload_length);
+
+  return webSocket_serverCommitFrame(client, payload_length, opcode) == 1;
+}
+
+uint8_t webSocket_serverBroadcast(const char *payload, uint16_t payload_length,
+                                  uint8_t opcode)
+{
+  uint16_t capacity = 0;
+  char *frame = webSocket_serverBeginFrame(&capacity);
+
+  if (payload_length > capacity)
+  {
+    return 0;
+  }
+
+  memcpy(frame, payload, payload_length);
+
+  return webSocket_serverCommitFrame(WEB_SOCKET_SERVER_ALL, payload_length,
+                                     opcode);
+}
+
+void webSocket_serverClose(uint8_t client, uint16_t code)
+{
+  char payload[2] = { (char)(code >> 8), (char)(code & 0xFF) };
+
+  if (client >= WEB_SOCKET_SERVER_CLIENTS)
+  {
+    return;
+  }
+
+  if (g_serverClient[client].state == WEBSOCKET_SERVER_STATE_OPEN)
+  {
+    webSocket_serverSendControl(client, OPCODE_FRAME_CLOSE, payload,
+                                sizeof(payload));
+  }
+
+  if (g_serverClient[client].state != WEBSOCKET_SERVER_STATE_FREE)
+  {
+    webSocket_serverDrop(client);
+  }
+}
+
+uint8_t webSocket_serverGetCount(void)
+{
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < WEB_SOCKET_SERVER_CLIENTS; i++)
+  {
+    if (g_serverClient[i].state == WEBSOCKET_SERVER_STATE_OPEN)
+    {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+static void webSocket_serverAcceptClient(void)
+{
+  WiFiClient client = g_server->available();
+
+  if (!client)
+  {
+    return;
+  }
+
+  for (uint8_t i = 0; i < WEB_SOCKET_SERVER_CLIENTS; i++)
+  {
+    WEB_SOCKET_SERVER_CLIENT *server = &g_serverClient[i];
+
+    if (server->state == WEBSOCKET_SERVER_STATE_FREE)
+    {
+      server->client = client;
+      server->client.setNoDelay(true);
+      memset(&server->request, 0, sizeof(server->request));
+      server->time = millis();
+      server->length = 0;
+      server->message = 0;
+      server->opcode = OPCODE_FRAME_CONTINUE;
+      server->state = WEBSOCKET_SERVER_STATE_HANDSHAKE;
+      return;
+    }
+  }
+
+  WEB_SOCKET_LOG_WARN("server full, client refused");
+  client.write((const uint8_t *) g_serverUnavailable,
+               sizeof(g_serverUnavailable) - 1);
+  client.stop();
+}
+
+// reads the request a byte at a time, so no frame data is consumed
+static void webSocket_serverHandshake(uint8_t index)
+{
+  WEB_SOCKET_SERVER_CLIENT *server = &g_serverClient[index];
+  int8_t result = 0;
+  int data = 0;
+
+  while ((result == 0) && (server->client.available() > 0))
+  {
+    data = server->client.read();
+
+    if (data < 0)
+    {
+      break;
+    }
+
+    if (data != '\n')
+    {
+      if (server->length < WEB_SOCKET_SERVER_RECIVE_SIZE)
+      {
+        server->buffer[server->length++] = (char) data; // long lines are cut
+      }
+
+      continue;
+    }
+
+    if ((server->length > 0) && (server->buffer[server->length - 1] == '\r'))
+    {
+      server->length--;
+    }
+
+    result = webSocket_serverParseLine(&server->request, server->buffer,
+                                       server->length);
+    server->length = 0;
+  }
+
+  if (result > 0)
+  {
+    uint16_t length = sizeof(g_serverSwitching) - 1;
+
+    memcpy(server->buffer, g_serverSwitching, length);
+    webSocket_serverAccept(server->request.key, &server->buffer[length]);
+    length += WEB_SOCKET_SERVER_ACCEPT_SIZE;
+    memcpy(&server->buffer[length], "\r\n\r\n", 4);
+    length += 4;
+
+    if (webSocket_serverWrite(index, (const uint8_t *) server->buffer, length))
+    {
+      server->state = WEBSOCKET_SERVER_STATE_OPEN;
+      WEB_SOCKET_LOG_INFO("server client %u open", index);
+
+      if (g_serverHandler != NULL)
+      {
+        g_serverHandler(index, WEBSOCKET_SERVER_OPEN, NULL, 0);
+      }
+    }
+  }
+  else if (result < 0)
+  {
+    WEB_SOCKET_LOG_WARN("server client %u bad upgrade", index);
+    webSocket_serverWrite(index, (const uint8_t *) g_serverBadRequest,
+                          sizeof(g_serverBadRequest) - 1);
+    webSocket_serverDrop(index);
+  }
+  else if (!server->client.connected()
+           || (millis() - server->time > WEB_SOCKET_SERVER_HANDSHAKE_TIMEOUT))
+  {
+    webSocket_serverDrop(index);
+  }
+}
+
+// The frames follow the fragments of a message collected so far; each
+// payload is unmasked and moved to the front of its frame, where a fragment
+// joins the message.
+static void webSocket_serverReceive(uint8_t index)
+{
+  WEB_SOCKET_SERVER_CLIENT *server = &g_serverClient[index];
+  WEB_SOCKET_FRAME_INFO info;
+  uint8_t header_length = 0;
+  uint16_t frame_length = 0;
+  uint16_t start = 0;
+  uint16_t rest = 0;
+  char *frame = NULL;
+  int length = 0;
+
+  if (server->client.available() > 0)
+  {
+    length = server->client.read((uint8_t *) &server->buffer[server->length],
+                                 WEB_SOCKET_SERVER_RECIVE_SIZE - server->length);
+    server->length += (length > 0) ? length : 0;
+  }
+  else if (!server->client.connected())
+  {
+    webSocket_serverDrop(index);
+    return;
+  }
+
+  while (server->state == WEBSOCKET_SERVER_STATE_OPEN)
+  {
+    start = server->message;
+    frame = &server->buffer[start];
+    header_length = webSocket_frameDecodeHeader((const uint8_t *) frame,
+                                                server->length - start, &info);
+
+    if (header_length == 0)
+    {
+      if (server->length == WEB_SOCKET_SERVER_RECIVE_SIZE)
+      {
+        // the message leaves no room for the next header
+        webSocket_serverClose(index, WEB_SOCKET_CLOSE_TOO_BIG);
+      }
+
+      return; // header incomplete
+    }
+
+    if ((header_length == WEB_SOCKET_FRAME_INVALID) || !info.masked || info.rsv)
+    {
+      webSocket_serverClose(index, WEB_SOCKET_CLOSE_PROTOCOL);
+      return;
+    }
+
+    if (info.payload_length > WEB_SOCKET_SERVER_RECIVE_SIZE - start - header_length)
+    {
+      webSocket_serverClose(index, WEB_SOCKET_CLOSE_TOO_BIG);
+      return;
+    }
+
+    frame_length = header_length + (uint16_t) info.payload_length;
+
+    if (server->length - start < frame_length)
+    {
+      return; // payload incomplete
+    }
+
+    for (uint16_t i = 0; i < info.payload_length; i++)
+    {
+      frame[i] = frame[header_length + i] ^ info.mask[i % 4];
+    }
+
+    if (!webSocket_serverFrame(index, &info, (uint16_t) info.payload_length))
+    {
+      return; // the client is gone
+    }
+
+    // the frames after this one follow the message, which may have grown
+    // by the payload or been handled
+    rest = server->length - start - frame_length;
+    memmove(&server->buffer[server->message], &frame[frame_length], rest);
+    server->length = server->message + rest;
+  }
+}
+
+// The payload is at server->message; a fragment is kept there by moving
+// server->message behind it. false when the client was closed.
+static bool webSocket_serverFrame(uint8_t index,
+                                  const WEB_SOCKET_FRAME_INFO *info,
+                                  uint16_t payload_length)
+{
+  WEB_SOCKET_SERVER_CLIENT *server = &g_serverClient[index];
+  char *payload = &server->buffer[server->message];
+  uint8_t opcode = info->opcode;
+
+  switch (info->opcode)
+  {
+    case OPCODE_FRAME_TEXT:
+    case OPCODE_FRAME_BINARY:
+    case OPCODE_FRAME_CONTINUE:
+      // a new message before the last one ended, a continuation of none
+      if ((info->opcode == OPCODE_FRAME_CONTINUE)
+          == (server->opcode == OPCODE_FRAME_CONTINUE))
+      {
+        webSocket_serverClose(index, WEB_SOCKET_CLOSE_PROTOCOL);
+        return false;
+      }
+
+      if (!info->fin)
+      {
+        if (server->opcode == OPCODE_FRAME_CONTINUE)
+        {
+          server->opcode = info->opcode;
+        }
+
+        server->message += payload_length;
+        break;
+      }
+
+      if (server->opcode != OPCODE_FRAME_CONTINUE)
+      {
+        // the last fragment, the message starts at the buffer
+        opcode = server->opcode;
+        payload = server->buffer;
+        payload_length += server->message;
+        server->message = 0;
+        server->opcode = OPCODE_FRAME_CONTINUE;
+      }
+
+      if (g_serverHandler != NULL)
+      {
+        g_serverHandler(index, (opcode == OPCODE_FRAME_TEXT)
+                        ? WEBSOCKET_SERVER_TEXT : WEBSOCKET_SERVER_BINARY,
+                        payload, payload_length);
+      }
+      break;
+
+    case OPCODE_FRAME_PING:
+      webSocket_serverSendControl(index, OPCODE_FRAME_PONG, payload,
+                                  payload_length);
+      break;
+
+    case OPCODE_FRAME_PONG:
+      break;
+
+    case OPCODE_FRAME_CLOSE:
+      // echo the status code, then close the connection
+      webSocket_serverSendControl(index, OPCODE_FRAME_CLOSE, payload,
+                                  (payload_length >= 2) ? 2 : 0);
+      webSocket_serverDrop(index);
+      return false;
+
+    default:
+      // reserved opcodes
+      webSocket_serverClose(index, WEB_SOCKET_CLOSE_PROTOCOL);
+      return false;
+  }
+
+  // the handler may have closed the client
+  return server->state == WEBSOCKET_SERVER_STATE_OPEN;
+}
+
+// a client that does not take the whole write is dropped
+static bool webSocket_serverWrite(uint8_t index, const uint8_t *data,
+                                  uint16_t length)
+{
+  if (g_serverClient[index].client.write(data, length) != length)
+  {
+    webSocket_serverDrop(index);
+    return false;
+  }
+
+  return true;
+}
+
+static void webSocket_serverSendControl(uint8_t index, uint8_t opcode,
+                                        const char *payload,
+                                        uint16_t payload_length)
+{
+  uint8_t frame[WEB_SOCKET_HEAD_FRAME_SIZE + WEB_SOCKET_FRAME_LENGTH7_MAX];
+  uint8_t header_length = webSocket_frameEncodeHeader(frame, true, 0, opcode,
+                                                      NULL, payload_length);
+
+  memcpy(&frame[header_length], payload, payload_length);
+  webSocket_serverWrite(index, frame, header_length + payload_length);
+}
+
+static void webSocket_serverDrop(uint8_t index)
+{
+  WEB_SOCKET_SERVER_CLIENT *server = &g_serverClient[index];
+  bool is_open = (server->state == WEBSOCKET_SERVER_STATE_OPEN);
+
+  if (server->state == WEBSOCKET_SERVER_STATE_FREE)
+  {
+    return; // already dropped by a failed write
+  }
+
+  server->state = WEBSOCKET_SERVER_STATE_FREE;
+  server->length = 0;
+  server->message = 0;
+  server->opcode = OPCODE_FRAME_CONTINUE;
+  server->client.stop();
+
+  if (is_open)
+  {
+    WEB_SOCKET_LOG_INFO("server client %u closed", index);
+
+    if (g_serverHandler != NULL)
+    {
+      g_serverHandler(index, WEBSOCKET_SERVER_CLOSE, NULL, 0);
+    }
+  }
+}
+
+#endif // WEBSOCKET_SERVER
@@ -0,0 +1,106 @@
+/*
+ * @file    webSocketServer.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_SERVER_H_
+#define WEBSOCKET_SERVER_H_
+
+#include <stdint.h>
+#include "webSocket.h"
+
+class WiFiServer;
+
+// Device side server for a few local clients, e.g. a dashboard page in a
+// browser, without a relay such as server.php. It is independent of the
+// webSocket_handle() session, both can run at once.
+//
+// The upgrade request is parsed line by line in the client's receive
+// buffer, nothing is allocated. Frames to clients are unmasked. A
+// broadcast encodes the frame once and writes the same bytes to every open
+// client. Fragmented messages are put together in the receive buffer, and
+// control frames may come between the fragments. A message that does not
+// fit, with the header of the next frame, closes the client with 1009; a
+// continuation without a first fragment or a new message before the last
+// one ends closes it with 1002.
+//
+//   WiFiServer g_server(81);
+//   ...
+//   g_server.begin();
+//   webSocket_serverBegin(&g_server, handleServerEvent);
+//   ...
+//   webSocket_serverHandle();  // in loop()
+//   webSocket_serverBroadcast(json, length, OPCODE_FRAME_TEXT);
+//
+// The handler gets OPEN and CLOSE with a NULL payload, TEXT and BINARY
+// with the unmasked message, valid until the handler returns.
+
+#define WEB_SOCKET_SERVER_ALL			0xFFu
+#define WEB_SOCKET_SERVER_KEY_SIZE		24u  // base64 of 16 bytes
+#define WEB_SOCKET_SERVER_ACCEPT_SIZE	28u  // base64 of a SHA-1 hash
+
+#ifndef WEB_SOCKET_SERVER_CLIENTS
+#define WEB_SOCKET_SERVER_CLIENTS		4u
+#endif
+#ifndef WEB_SOCKET_SERVER_RECIVE_SIZE
+#define WEB_SOCKET_SERVER_RECIVE_SIZE	256u  // frame header and payload, at least one request line
+#endif
+#ifndef WEB_SOCKET_SERVER_SEND_SIZE
+#define WEB_SOCKET_SERVER_SEND_SIZE		512u  // payload
+#endif
+#ifndef WEB_SOCKET_SERVER_HANDSHAKE_TIMEOUT
+#define WEB_SOCKET_SERVER_HANDSHAKE_TIMEOUT	2000u//msec
+#endif
+
+enum webSocketServerEvent {
+  WEBSOCKET_SERVER_OPEN = 1,
+  WEBSOCKET_SERVER_TEXT,
+  WEBSOCKET_SERVER_BINARY,
+  WEBSOCKET_SERVER_CLOSE
+};
+
+// upgrade request seen so far
+typedef struct _WEB_SOCKET_SERVER_REQUEST
+{
+  bool is_get;
+  bool is_upgrade;
+  bool is_version;
+  char key[WEB_SOCKET_SERVER_KEY_SIZE + 1];
+} WEB_SOCKET_SERVER_REQUEST;
+
+typedef void (*webSocketServerHandler)(uint8_t client, uint8_t event,
+                                       const char *payload, uint16_t length);
+
+#ifdef WEBSOCKET_SERVER
+
+// Free of Arduino dependencies. webSocket_serverParseLine() takes one
+// request line without CR LF; it returns 1 at the empty line when the
+// request is a valid upgrade, -1 when it is not, 0 for more lines.
+extern int8_t webSocket_serverParseLine(WEB_SOCKET_SERVER_REQUEST *request,
+                                        const char *line, uint16_t length);
+extern void webSocket_serverBase64(const uint8_t *src, uint16_t length,
+                                   char *dist);
+
+extern void webSocket_serverBegin(WiFiServer *server,
+                                  webSocketServerHandler handler);
+extern void webSocket_serverHandle(void);
+extern char *webSocket_serverBeginFrame(uint16_t *capacity);
+extern uint8_t webSocket_serverCommitFrame(uint8_t client,
+                                           uint16_t payload_length,
+                                           uint8_t opcode);
+extern bool webSocket_serverSend(uint8_t client, const char *payload,
+                                 uint16_t payload_length, uint8_t opcode);
+extern uint8_t webSocket_serverBroadcast(const char *payload,
+                                         uint16_t payload_length,
+                                         uint8_t opcode);
+extern void webSocket_serverClose(uint8_t client, uint16_t code);
+extern uint8_t webSocket_serverGetCount(void);
+extern void webSocket_serverAccept(const char *key, char *accept);
+
+#endif // WEBSOCKET_SERVER
+
+#endif /* WEBSOCKET_SERVER_H_ */
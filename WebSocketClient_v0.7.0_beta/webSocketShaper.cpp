@@ -0,0 +1,202 @@
+/*
+ * @file    webSocketShaper.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include <Arduino.h>
+#include "webSocket.h"
+#include "webSocketShaper.h"
+
+#ifdef WEBSOCKET_SHAPER
+
+static bool webSocket_shaperIsExempt(uint8_t opcode);
+static void webSocket_shaperRefill(void);
+static uint64_t webSocket_shaperNeed(const WEB_SOCKET_SHAPER_BUCKET *bucket,
+                                     uint32_t count);
+static uint32_t webSocket_shaperWait(const WEB_SOCKET_SHAPER_BUCKET *bucket,
+                                     uint32_t count);
+
+static WEB_SOCKET_SHAPER_BUCKET g_shaperBytes[WEBSOCKET_SHAPER_BUDGETS];
+static WEB_SOCKET_SHAPER_BUCKET g_shaperFrames[WEBSOCKET_SHAPER_BUDGETS];
+static uint32_t g_shaperTime = 0;//msec of the last refill
+static uint32_t g_shaperDeferred = 0;
+
+// the buckets start full
+void webSocket_shaperSetRate(uint8_t opcode, uint32_t bytes_per_sec,
+                             uint32_t byte_burst, uint32_t frames_per_sec,
+                             uint32_t frame_burst)
+{
+  uint8_t budget = (opcode == OPCODE_FRAME_TEXT) ? WEBSOCKET_SHAPER_TEXT
+                   : WEBSOCKET_SHAPER_BINARY;
+
+  webSocket_shaperRefill();
+
+  g_shaperBytes[budget].rate = bytes_per_sec;
+  g_shaperBytes[budget].burst = (byte_burst > 0) ? byte_burst : 1;
+  g_shaperBytes[budget].tokens = (uint64_t) g_shaperBytes[budget].burst * 1000u;
+  g_shaperFrames[budget].rate = frames_per_sec;
+  g_shaperFrames[budget].burst = (frame_burst > 0) ? frame_burst : 1;
+  g_shaperFrames[budget].tokens = (uint64_t) g_shaperFrames[budget].burst * 1000u;
+}
+
+// takes the tokens for one frame; false when it has to wait
+bool webSocket_shaperAllow(uint8_t opcode, uint32_t frame_length)
+{
+  uint8_t budget = (opcode == OPCODE_FRAME_TEXT) ? WEBSOCKET_SHAPER_TEXT
+                   : WEBSOCKET_SHAPER_BINARY;
+  WEB_SOCKET_SHAPER_BUCKET *bytes = &g_shaperBytes[budget];
+  WEB_SOCKET_SHAPER_BUCKET *frames = &g_shaperFrames[budget];
+
+  if (webSocket_shaperIsExempt(opcode))
+  {
+    return true;
+  }
+
+  webSocket_shaperRefill();
+
+  if ((bytes->tokens < webSocket_shaperNeed(bytes, frame_length))
+      || (frames->tokens < webSocket_shaperNeed(frames, 1)))
+  {
+    g_shaperDeferred++;
+    return false;
+  }
+
+  if (bytes->rate)
+  {
+    bytes->tokens -= webSocket_shaperNeed(bytes, frame_length);
+  }
+
+  if (frames->rate)
+  {
+    frames->tokens -= webSocket_shaperNeed(frames, 1);
+  }
+
+  return true;
+}
+
+// msec until webSocket_shaperAllow() passes the frame
+uint32_t webSocket_shaperGetDelay(uint8_t opcode, uint32_t frame_length)
+{
+  uint8_t budget = (opcode == OPCODE_FRAME_TEXT) ? WEBSOCKET_SHAPER_TEXT
+                   : WEBSOCKET_SHAPER_BINARY;
+  uint32_t bytes_wait = 0;
+  uint32_t frames_wait = 0;
+
+  if (webSocket_shaperIsExempt(opcode))
+  {
+    return 0;
+  }
+
+  webSocket_shaperRefill();
+
+  bytes_wait = webSocket_shaperWait(&g_shaperBytes[budget], frame_length);
+  frames_wait = webSocket_shaperWait(&g_shaperFrames[budget], 1);
+
+  return (bytes_wait > frames_wait) ? bytes_wait : frames_wait;
+}
+
+// For a run of complete frames (the store-and-forward queue): takes the
+// tokens of the leading frames that may go now and returns their length,
+// count is set to their number.
+uint16_t webSocket_shaperAllowFrames(const char *frames, uint16_t length,
+                                     uint16_t *count)
+{
+  WEB_SOCKET_FRAME_INFO info;
+  uint16_t offset = 0;
+  uint16_t allowed = 0;
+  uint32_t frame_length = 0;
+  uint8_t header_length = 0;
+
+  while (offset < length)
+  {
+    header_length = webSocket_frameDecodeHeader((const uint8_t *) &frames[offset],
+                    length - offset, &info);
+    frame_length = header_length + info.payload_length;
+
+    if ((header_length == 0) || (header_length == WEB_SOCKET_FRAME_INVALID)
+        || (offset + frame_length > length)
+        || !webSocket_shaperAllow(info.opcode, frame_length))
+    {
+      break;
+    }
+
+    offset += frame_length;
+    allowed++;
+  }
+
+  *count = allowed;
+
+  return offset;
+}
+
+uint32_t webSocket_shaperGetDeferred(void)
+{
+  return g_shaperDeferred;
+}
+
+static bool webSocket_shaperIsExempt(uint8_t opcode)
+{
+  return (opcode & 0x08) != 0; // control frames
+}
+
+static void webSocket_shaperRefill(void)
+{
+  uint32_t now = millis();
+  uint32_t elapsed = now - g_shaperTime;
+  WEB_SOCKET_SHAPER_BUCKET *bucket = NULL;
+
+  if (elapsed == 0)
+  {
+    return;
+  }
+
+  g_shaperTime = now;
+
+  for (uint8_t i = 0; i < 2 * WEBSOCKET_SHAPER_BUDGETS; i++)
+  {
+    bucket = (i < WEBSOCKET_SHAPER_BUDGETS) ? &g_shaperBytes[i]
+             : &g_shaperFrames[i - WEBSOCKET_SHAPER_BUDGETS];
+
+    if (bucket->rate)
+    {
+      bucket->tokens += (uint64_t) bucket->rate * elapsed;
+
+      if (bucket->tokens > (uint64_t) bucket->burst * 1000u)
+      {
+        bucket->tokens = (uint64_t) bucket->burst * 1000u;
+      }
+    }
+  }
+}
+
+// tokens to take for count, a count above the burst takes a full bucket
+static uint64_t webSocket_shaperNeed(const WEB_SOCKET_SHAPER_BUCKET *bucket,
+                                     uint32_t count)
+{
+  if (bucket->rate == 0)
+  {
+    return 0;
+  }
+
+  return (uint64_t)((count < bucket->burst) ? count : bucket->burst) * 1000u;
+}
+
+static uint32_t webSocket_shaperWait(const WEB_SOCKET_SHAPER_BUCKET *bucket,
+                                     uint32_t count)
+{
+  uint64_t need = webSocket_shaperNeed(bucket, count);
+
+  if (bucket->tokens >= need)
+  {
+    return 0;
+  }
+
+  return (uint32_t)((need - bucket->tokens + bucket->rate - 1) / bucket->rate);
+}
+
+#endif // WEBSOCKET_SHAPER
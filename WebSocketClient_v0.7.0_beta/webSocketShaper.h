@@ -0,0 +1,55 @@
+/*
+ * @file    webSocketShaper.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_SHAPER_H_
+#define WEBSOCKET_SHAPER_H_
+
+#include <stdint.h>
+#include "webSocketConfig.h"
+
+// Token bucket send shaper. Text and binary frames each have a byte budget
+// and a frame budget: a sustained rate per second and a burst. A data frame
+// stays pending in the send buffer until both buckets of its opcode hold
+// enough tokens; control frames are never held. A frame larger than the
+// burst goes out once the bucket is full. A rate of 0 leaves that budget
+// unlimited, the default.
+//
+//   webSocket_shaperSetRate(OPCODE_FRAME_BINARY, 4096, 1024, 20, 4);
+//   ...
+//   delay(webSocket_getSendDelay());
+
+enum webSocketShaperBudget {
+  WEBSOCKET_SHAPER_TEXT = 0,
+  WEBSOCKET_SHAPER_BINARY,
+  WEBSOCKET_SHAPER_BUDGETS
+};
+
+typedef struct _WEB_SOCKET_SHAPER_BUCKET
+{
+  uint32_t rate;    // tokens per second, 0 unlimited
+  uint32_t burst;
+  uint64_t tokens;  // 1/1000 token, one thousandth is gained per rate and msec
+} WEB_SOCKET_SHAPER_BUCKET;
+
+#ifdef WEBSOCKET_SHAPER
+
+extern void webSocket_shaperSetRate(uint8_t opcode, uint32_t bytes_per_sec,
+                                    uint32_t byte_burst,
+                                    uint32_t frames_per_sec,
+                                    uint32_t frame_burst);
+extern bool webSocket_shaperAllow(uint8_t opcode, uint32_t frame_length);
+extern uint32_t webSocket_shaperGetDelay(uint8_t opcode,
+                                         uint32_t frame_length);
+extern uint16_t webSocket_shaperAllowFrames(const char *frames,
+                                            uint16_t length, uint16_t *count);
+extern uint32_t webSocket_shaperGetDeferred(void);
+
+#endif // WEBSOCKET_SHAPER
+
+#endif /* WEBSOCKET_SHAPER_H_ */
@@ -0,0 +1,176 @@
+/*
+ * @file    webSocketStats.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include "webSocketStats.h"
+
+#ifdef WEBSOCKET_STATS
+
+static uint8_t webSocket_statsOpcodeIndex(uint8_t opcode);
+static uint16_t webSocket_statsPutVarint(char *dist, uint16_t size,
+                                         uint16_t index, uint32_t value);
+
+static WEB_SOCKET_STATS g_webSocketStats;
+static bool g_is_statsOpened = false;
+
+void webSocket_getStats(WEB_SOCKET_STATS *dist)
+{
+  memcpy(dist, &g_webSocketStats, sizeof(WEB_SOCKET_STATS));
+}
+
+// the next open counts as the first of the session again, not as a reconnect
+void webSocket_resetStats(void)
+{
+  memset(&g_webSocketStats, 0, sizeof(WEB_SOCKET_STATS));
+  g_is_statsOpened = false;
+}
+
+// [tag][type][version] followed by every counter as LEB128 varint in
+// WEB_SOCKET_STATS member order. Returns 0 when dist is too small.
+uint16_t webSocket_dumpStats(char *dist, uint16_t size)
+{
+  const uint32_t *counter = (const uint32_t *) &g_webSocketStats;
+  uint16_t index = 0;
+
+  if (size < 3)
+  {
+    return 0;
+  }
+
+  dist[index++] = (char) WEB_SOCKET_BINARY_TAG;
+  dist[index++] = (char) WEBSOCKET_BINARY_STATS;
+  dist[index++] = (char) WEB_SOCKET_STATS_VERSION;
+
+  for (uint16_t i = 0; i < sizeof(WEB_SOCKET_STATS) / sizeof(uint32_t); i++)
+  {
+    index = webSocket_statsPutVarint(dist, size, index, counter[i]);
+
+    if (index == 0)
+    {
+      return 0;
+    }
+  }
+
+  return index;
+}
+
+bool webSocket_sendStats(void)
+{
+  char dump[WEB_SOCKET_STATS_DUMP_SIZE];
+  uint16_t length = 0;
+
+  if (webSocket_isSendBusy())
+  {
+    return false;
+  }
+
+  length = webSocket_dumpStats(dump, sizeof(dump));
+
+  if (length == 0)
+  {
+    return false;
+  }
+
+  return webSocket_setData(dump, length, OPCODE_FRAME_BINARY);
+}
+
+void webSocket_statsFrameIn(uint8_t opcode, uint16_t length)
+{
+  uint8_t index = webSocket_statsOpcodeIndex(opcode);
+
+  g_webSocketStats.frames_in[index]++;
+  g_webSocketStats.bytes_in[index] += length;
+
+  if (g_webSocketStats.recive_peak < length)
+  {
+    g_webSocketStats.recive_peak = length;
+  }
+}
+
+void webSocket_statsFrameOut(uint8_t opcode, uint16_t length,
+                             uint16_t frame_length)
+{
+  uint8_t index = webSocket_statsOpcodeIndex(opcode);
+
+  g_webSocketStats.frames_out[index]++;
+  g_webSocketStats.bytes_out[index] += length;
+
+  if (g_webSocketStats.send_peak < frame_length)
+  {
+    g_webSocketStats.send_peak = frame_length;
+  }
+}
+
+void webSocket_statsCount(size_t offset)
+{
+  if (offset == offsetof(WEB_SOCKET_STATS, reconnects))
+  {
+    // the first open of the session is not a reconnect
+    if (!g_is_statsOpened)
+    {
+      g_is_statsOpened = true;
+      return;
+    }
+  }
+
+  (*(uint32_t *)((char *) &g_webSocketStats + offset))++;
+}
+
+void webSocket_statsAdd(size_t offset, uint32_t value)
+{
+  *(uint32_t *)((char *) &g_webSocketStats + offset) += value;
+}
+
+static uint8_t webSocket_statsOpcodeIndex(uint8_t opcode)
+{
+  switch (opcode)
+  {
+    case OPCODE_FRAME_CONTINUE:
+      return WEBSOCKET_STATS_CONTINUE;
+    case OPCODE_FRAME_TEXT:
+      return WEBSOCKET_STATS_TEXT;
+    case OPCODE_FRAME_BINARY:
+      return WEBSOCKET_STATS_BINARY;
+    case OPCODE_FRAME_CLOSE:
+      return WEBSOCKET_STATS_CLOSE;
+    case OPCODE_FRAME_PING:
+      return WEBSOCKET_STATS_PING;
+    case OPCODE_FRAME_PONG:
+      return WEBSOCKET_STATS_PONG;
+    default:
+      return WEBSOCKET_STATS_RESERVED;
+  }
+}
+
+static uint16_t webSocket_statsPutVarint(char *dist, uint16_t size,
+                                         uint16_t index, uint32_t value)
+{
+  do
+  {
+    if (index >= size)
+    {
+      return 0;
+    }
+
+    dist[index] = (char)(value & 0x7F);
+    value >>= 7;
+
+    if (value)
+    {
+      dist[index] |= 0x80;
+    }
+
+    index++;
+  } while (value);
+
+  return index;
+}
+
+#endif // WEBSOCKET_STATS
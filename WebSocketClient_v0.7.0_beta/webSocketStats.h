@@ -0,0 +1,76 @@
+/*
+ * @file    webSocketStats.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_STATS_H_
+#define WEBSOCKET_STATS_H_
+
+#include "webSocket.h"
+
+#define WEB_SOCKET_STATS_VERSION		3u
+#define WEB_SOCKET_STATS_DUMP_SIZE		208u
+
+enum webSocketStatsOpcode {
+  WEBSOCKET_STATS_CONTINUE = 0,
+  WEBSOCKET_STATS_TEXT,
+  WEBSOCKET_STATS_BINARY,
+  WEBSOCKET_STATS_CLOSE,
+  WEBSOCKET_STATS_PING,
+  WEBSOCKET_STATS_PONG,
+  WEBSOCKET_STATS_RESERVED,
+  WEBSOCKET_STATS_OPCODE_MAX
+};
+
+typedef struct _WEB_SOCKET_STATS
+{
+  uint32_t frames_in[WEBSOCKET_STATS_OPCODE_MAX];
+  uint32_t bytes_in[WEBSOCKET_STATS_OPCODE_MAX];
+  uint32_t frames_out[WEBSOCKET_STATS_OPCODE_MAX];
+  uint32_t bytes_out[WEBSOCKET_STATS_OPCODE_MAX];
+  uint32_t send_dropped;      // webSocket_setData() while busy
+  uint32_t payload_oversize;  // send payload larger than the buffer
+  uint32_t payload_truncated; // receive payload cut short
+  uint32_t timeouts;
+  uint32_t retries;
+  uint32_t reconnects;
+  uint32_t send_peak;         // bytes of the largest frame built
+  uint32_t recive_peak;       // bytes of the largest payload read
+  uint32_t payload_invalid;   // text messages that are not UTF-8
+  uint32_t queue_spooled;     // frames stored while offline
+  uint32_t queue_drained;     // stored frames sent after reconnect
+  uint32_t queue_dropped;     // stored frames lost to retention
+} WEB_SOCKET_STATS;
+
+#ifdef WEBSOCKET_STATS
+
+#define WEB_SOCKET_STATS_FRAME_IN(opcode, length)	webSocket_statsFrameIn(opcode, length)
+#define WEB_SOCKET_STATS_FRAME_OUT(opcode, length, frame_length)	webSocket_statsFrameOut(opcode, length, frame_length)
+#define WEB_SOCKET_STATS_COUNT(field)	webSocket_statsCount(offsetof(WEB_SOCKET_STATS, field))
+#define WEB_SOCKET_STATS_ADD(field, value)	webSocket_statsAdd(offsetof(WEB_SOCKET_STATS, field), value)
+
+extern void webSocket_getStats(WEB_SOCKET_STATS *dist);
+extern void webSocket_resetStats(void);
+extern uint16_t webSocket_dumpStats(char *dist, uint16_t size);
+extern bool webSocket_sendStats(void);
+
+extern void webSocket_statsFrameIn(uint8_t opcode, uint16_t length);
+extern void webSocket_statsFrameOut(uint8_t opcode, uint16_t length,
+                                    uint16_t frame_length);
+extern void webSocket_statsCount(size_t offset);
+extern void webSocket_statsAdd(size_t offset, uint32_t value);
+
+#else
+
+#define WEB_SOCKET_STATS_FRAME_IN(opcode, length)
+#define WEB_SOCKET_STATS_FRAME_OUT(opcode, length, frame_length)
+#define WEB_SOCKET_STATS_COUNT(field)
+#define WEB_SOCKET_STATS_ADD(field, value)
+
+#endif // WEBSOCKET_STATS
+
+#endif /* WEBSOCKET_STATS_H_ */
@@ -0,0 +1,338 @@
+/*
+ * @file    webSocketTemplate.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include <string.h>
+#include "webSocketTemplate.h"
+#include "webSocketStats.h"
+#include "webSocketTrace.h"
+
+typedef struct _WEB_SOCKET_TEMPLATE_SLOT
+{
+  const char *name;   // not copied, use a literal
+  uint16_t offset;    // in the body
+  uint8_t width;
+} WEB_SOCKET_TEMPLATE_SLOT;
+
+typedef struct _WEB_SOCKET_TEMPLATE
+{
+  bool is_use;
+  uint8_t opcode;
+  uint8_t slot_count;
+  uint8_t frame_offset;  // header is right aligned in front of the body
+  uint16_t length;
+  uint8_t mask[WEB_SOCKET_MASK_KEY_SIZE];  // key the body is masked with
+  WEB_SOCKET_TEMPLATE_SLOT slot[WEB_SOCKET_TEMPLATE_SLOT_MAX];
+  char frame[WEB_SOCKET_FRAME_HEADER16_MAX + WEB_SOCKET_TEMPLATE_SIZE];
+} WEB_SOCKET_TEMPLATE;
+
+static WEB_SOCKET_TEMPLATE g_webSocketTemplate[WEB_SOCKET_TEMPLATE_MAX];
+static int8_t g_templateSending = WEB_SOCKET_TEMPLATE_INVALID;
+
+static WEB_SOCKET_TEMPLATE *webSocket_templateGet(int8_t id);
+static WEB_SOCKET_TEMPLATE_SLOT *webSocket_templateGetSlot(int8_t id,
+    int8_t slot);
+static void webSocket_templateWrite(WEB_SOCKET_TEMPLATE *tmpl,
+                                    uint16_t offset, const uint8_t *data,
+                                    uint8_t length);
+static void webSocket_templateRekey(WEB_SOCKET_TEMPLATE *tmpl);
+
+// Copies body into a free template, returns its id or
+// WEB_SOCKET_TEMPLATE_INVALID when none is free or body is too long.
+int8_t webSocket_templateCreate(uint8_t opcode, const char *body,
+                                uint16_t length)
+{
+  WEB_SOCKET_TEMPLATE *tmpl = NULL;
+
+  if (length > WEB_SOCKET_TEMPLATE_SIZE)
+  {
+    WEB_SOCKET_STATS_COUNT(payload_oversize);
+    return WEB_SOCKET_TEMPLATE_INVALID;
+  }
+
+  for (int8_t id = 0; id < WEB_SOCKET_TEMPLATE_MAX; id++)
+  {
+    tmpl = &g_webSocketTemplate[id];
+
+    if (!tmpl->is_use)
+    {
+      memset(tmpl, 0, sizeof(*tmpl));
+      tmpl->is_use = true;
+      tmpl->opcode = opcode;
+      tmpl->length = length;
+      memcpy(&tmpl->frame[WEB_SOCKET_FRAME_HEADER16_MAX], body, length);
+
+      // plain body with a zero key, header written by the first rekey
+      webSocket_templateRekey(tmpl);
+
+      return id;
+    }
+  }
+
+  return WEB_SOCKET_TEMPLATE_INVALID;
+}
+
+// Frees the template, false while it is queued: the engine still writes
+// the frame from it. The send handler may delete it.
+bool webSocket_templateDelete(int8_t id)
+{
+  WEB_SOCKET_TEMPLATE *tmpl = webSocket_templateGet(id);
+
+  if ((tmpl == NULL) || ((g_templateSending == id) && webSocket_isSendBusy()))
+  {
+    return false;
+  }
+
+  tmpl->is_use = false;
+
+  if (g_templateSending == id)
+  {
+    g_templateSending = WEB_SOCKET_TEMPLATE_INVALID;
+  }
+
+  return true;
+}
+
+// Marks width bytes at offset of the body as a slot, returns the slot index.
+int8_t webSocket_templateAddSlot(int8_t id, const char *name,
+                                 uint16_t offset, uint8_t width)
+{
+  WEB_SOCKET_TEMPLATE *tmpl = webSocket_templateGet(id);
+  WEB_SOCKET_TEMPLATE_SLOT *slot = NULL;
+
+  if ((tmpl == NULL)
+      || (tmpl->slot_count >= WEB_SOCKET_TEMPLATE_SLOT_MAX)
+      || (width == 0)
+      || ((uint32_t) offset + width > tmpl->length))
+  {
+    return WEB_SOCKET_TEMPLATE_INVALID;
+  }
+
+  slot = &tmpl->slot[tmpl->slot_count];
+  slot->name = name;
+  slot->offset = offset;
+  slot->width = width;
+
+  return tmpl->slot_count++;
+}
+
+// slot index by name, resolve once and keep the index for the sends
+int8_t webSocket_templateFindSlot(int8_t id, const char *name)
+{
+  WEB_SOCKET_TEMPLATE *tmpl = webSocket_templateGet(id);
+
+  if (tmpl == NULL)
+  {
+    return WEB_SOCKET_TEMPLATE_INVALID;
+  }
+
+  for (uint8_t i = 0; i < tmpl->slot_count; i++)
+  {
+    if (strcmp(tmpl->slot[i].name, name) == 0)
+    {
+      return i;
+    }
+  }
+
+  return WEB_SOCKET_TEMPLATE_INVALID;
+}
+
+// Raw bytes, length must be the slot width.
+bool webSocket_templatePatch(int8_t id, int8_t slot, const void *data,
+                             uint8_t length)
+{
+  WEB_SOCKET_TEMPLATE_SLOT *info = webSocket_templateGetSlot(id, slot);
+
+  if ((info == NULL) || (length != info->width))
+  {
+    return false;
+  }
+
+  webSocket_templateWrite(&g_webSocketTemplate[id], info->offset,
+                          (const uint8_t *) data, length);
+
+  return true;
+}
+
+// Right aligned decimal padded with spaces, false when it does not fit.
+bool webSocket_templatePatchInt(int8_t id, int8_t slot, int32_t value)
+{
+  WEB_SOCKET_TEMPLATE_SLOT *info = webSocket_templateGetSlot(id, slot);
+  uint8_t digit[WEB_SOCKET_TEMPLATE_SIZE];
+  uint32_t number = (value < 0) ? 0u - (uint32_t) value : (uint32_t) value;
+  uint8_t index = 0;
+
+  if (info == NULL)
+  {
+    return false;
+  }
+
+  index = info->width;
+
+  do
+  {
+    if (index == 0)
+    {
+      return false;
+    }
+
+    digit[--index] = '0' + (number % 10);
+    number /= 10;
+  }
+  while (number);
+
+  if (value < 0)
+  {
+    if (index == 0)
+    {
+      return false;
+    }
+
+    digit[--index] = '-';
+  }
+
+  memset(digit, ' ', index);
+
+  webSocket_templateWrite(&g_webSocketTemplate[id], info->offset, digit,
+                          info->width);
+
+  return true;
+}
+
+// Big-endian integer of the slot width (1 to 4 bytes), for binary bodies.
+bool webSocket_templatePatchBE(int8_t id, int8_t slot, uint32_t value)
+{
+  WEB_SOCKET_TEMPLATE_SLOT *info = webSocket_templateGetSlot(id, slot);
+  uint8_t data[4];
+
+  if ((info == NULL) || (info->width > sizeof(data)))
+  {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < info->width; i++)
+  {
+    data[i] = (uint8_t)(value >> ((info->width - 1 - i) * 8));
+  }
+
+  webSocket_templateWrite(&g_webSocketTemplate[id], info->offset, data,
+                          info->width);
+
+  return true;
+}
+
+bool webSocket_templateSend(int8_t id)
+{
+  WEB_SOCKET_TEMPLATE *tmpl = webSocket_templateGet(id);
+
+  if ((tmpl == NULL) || webSocket_isSendBusy())
+  {
+    if (tmpl != NULL)
+    {
+      WEB_SOCKET_STATS_COUNT(send_dropped);
+    }
+
+    return false;
+  }
+
+  WEB_SOCKET_TRACE_BEGIN(WEBSOCKET_TRACE_ENCODE);
+  webSocket_templateRekey(tmpl);
+  WEB_SOCKET_TRACE_END(WEBSOCKET_TRACE_ENCODE);
+
+  if (!webSocket_sendFrame(&tmpl->frame[tmpl->frame_offset],
+                           WEB_SOCKET_FRAME_HEADER16_MAX - tmpl->frame_offset
+                           + tmpl->length, tmpl->opcode, tmpl->length))
+  {
+    return false;
+  }
+
+  g_templateSending = id;
+
+  return true;
+}
+
+static WEB_SOCKET_TEMPLATE *webSocket_templateGet(int8_t id)
+{
+  if ((id < 0) || (id >= WEB_SOCKET_TEMPLATE_MAX)
+      || !g_webSocketTemplate[id].is_use)
+  {
+    return NULL;
+  }
+
+  return &g_webSocketTemplate[id];
+}
+
+// NULL also while the template is queued, the engine writes it in place
+static WEB_SOCKET_TEMPLATE_SLOT *webSocket_templateGetSlot(int8_t id,
+    int8_t slot)
+{
+  WEB_SOCKET_TEMPLATE *tmpl = webSocket_templateGet(id);
+
+  if ((tmpl == NULL) || (slot < 0) || (slot >= tmpl->slot_count)
+      || ((g_templateSending == id) && webSocket_isSendBusy()))
+  {
+    return NULL;
+  }
+
+  return &tmpl->slot[slot];
+}
+
+// writes plain bytes into the body, masking only them
+static void webSocket_templateWrite(WEB_SOCKET_TEMPLATE *tmpl,
+                                    uint16_t offset, const uint8_t *data,
+                                    uint8_t length)
+{
+  char *body = &tmpl->frame[WEB_SOCKET_FRAME_HEADER16_MAX];
+
+  for (uint8_t i = 0; i < length; i++)
+  {
+    body[offset + i] = data[i]
+                       ^ tmpl->mask[(offset + i) % WEB_SOCKET_MASK_KEY_SIZE];
+  }
+}
+
+// Re-masks the body when the engine's key or mask policy changed since the
+// last send (one pass with old ^ new key) and rewrites the header.
+static void webSocket_templateRekey(WEB_SOCKET_TEMPLATE *tmpl)
+{
+  uint8_t mask[WEB_SOCKET_MASK_KEY_SIZE];
+  uint8_t delta[WEB_SOCKET_MASK_KEY_SIZE];
+  uint8_t header[WEB_SOCKET_FRAME_HEADER_MAX];
+  uint8_t header_length = 0;
+  bool is_mask = webSocket_getSendMask(mask);
+  bool is_change = false;
+  char *body = &tmpl->frame[WEB_SOCKET_FRAME_HEADER16_MAX];
+
+  if (!is_mask)
+  {
+    memset(mask, 0, sizeof(mask));
+  }
+
+  for (uint8_t i = 0; i < WEB_SOCKET_MASK_KEY_SIZE; i++)
+  {
+    delta[i] = tmpl->mask[i] ^ mask[i];
+    is_change |= (delta[i] != 0);
+  }
+
+  if (is_change)
+  {
+    for (uint16_t i = 0; i < tmpl->length; i++)
+    {
+      body[i] ^= delta[i % WEB_SOCKET_MASK_KEY_SIZE];
+    }
+
+    memcpy(tmpl->mask, mask, sizeof(mask));
+  }
+
+  header_length = webSocket_frameEncodeHeader(header, true, 0, tmpl->opcode,
+                  is_mask ? mask : NULL, tmpl->length);
+
+  tmpl->frame_offset = WEB_SOCKET_FRAME_HEADER16_MAX - header_length;
+  memcpy(&tmpl->frame[tmpl->frame_offset], header, header_length);
+}
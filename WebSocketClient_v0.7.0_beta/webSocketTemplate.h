@@ -0,0 +1,50 @@
+/*
+ * @file    webSocketTemplate.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_TEMPLATE_H_
+#define WEBSOCKET_TEMPLATE_H_
+
+#include "webSocket.h"
+
+// Pre-encoded messages. A template keeps a complete frame (header, mask key
+// and masked body); a send patches only the fixed-width slots, masking the
+// changed bytes as they are written, and hands the frame to the engine
+// without copying:
+//
+//   static int8_t t, v;
+//   t = webSocket_templateCreate(OPCODE_FRAME_TEXT, "{\"v\":     0}", 12);
+//   v = webSocket_templateAddSlot(t, "v", 5, 6);
+//   ...
+//   webSocket_templatePatchInt(t, v, analogRead(A0));
+//   webSocket_templateSend(t);
+//
+// While the frame is queued the slots and the template itself are locked:
+// patches and webSocket_templateDelete() return false until it is written.
+//
+// Decimal slots are right aligned and padded with spaces, which JSON allows
+// in front of a number. When the mask key or the mask policy changes the
+// body is re-keyed once at the next send.
+
+#define WEB_SOCKET_TEMPLATE_INVALID		(-1)
+
+extern int8_t webSocket_templateCreate(uint8_t opcode, const char *body,
+                                       uint16_t length);
+extern bool webSocket_templateDelete(int8_t id);
+extern int8_t webSocket_templateAddSlot(int8_t id, const char *name,
+                                        uint16_t offset, uint8_t width);
+extern int8_t webSocket_templateFindSlot(int8_t id, const char *name);
+extern bool webSocket_templatePatch(int8_t id, int8_t slot,
+                                    const void *data, uint8_t length);
+extern bool webSocket_templatePatchInt(int8_t id, int8_t slot,
+                                       int32_t value);
+extern bool webSocket_templatePatchBE(int8_t id, int8_t slot,
+                                      uint32_t value);
+extern bool webSocket_templateSend(int8_t id);
+
+#endif /* WEBSOCKET_TEMPLATE_H_ */
@@ -0,0 +1,112 @@
+/*
+ * @file    webSocketTrace.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include "webSocketTrace.h"
+
+#ifdef WEBSOCKET_TRACE
+
+static const char *const g_webSocketTraceName[WEBSOCKET_TRACE_STAGE_MAX] =
+{
+  "HEADER", "PAYLOAD", "HANDLER", "STATE", "ENCODE", "WRITE"
+};
+
+static WEB_SOCKET_TRACE_HISTOGRAM g_webSocketTrace[WEBSOCKET_TRACE_STAGE_MAX];
+
+void webSocket_traceRecord(uint8_t stage, uint32_t ticks)
+{
+  WEB_SOCKET_TRACE_HISTOGRAM *histogram = &g_webSocketTrace[stage];
+  uint8_t bucket = 0;
+
+  if (ticks)
+  {
+    bucket = 31 - __builtin_clz(ticks);
+
+    if (bucket >= WEB_SOCKET_TRACE_BUCKETS)
+    {
+      bucket = WEB_SOCKET_TRACE_BUCKETS - 1;
+    }
+  }
+
+  if ((histogram->count == 0) || (ticks < histogram->min))
+  {
+    histogram->min = ticks;
+  }
+
+  if (ticks > histogram->max)
+  {
+    histogram->max = ticks;
+  }
+
+  histogram->count++;
+  histogram->total += ticks;
+  histogram->bucket[bucket]++;
+}
+
+void webSocket_traceReset(void)
+{
+  memset(g_webSocketTrace, 0, sizeof(g_webSocketTrace));
+}
+
+bool webSocket_traceGetHistogram(uint8_t stage,
+                                 WEB_SOCKET_TRACE_HISTOGRAM *dist)
+{
+  if (stage >= WEBSOCKET_TRACE_STAGE_MAX)
+  {
+    return false;
+  }
+
+  memcpy(dist, &g_webSocketTrace[stage], sizeof(WEB_SOCKET_TRACE_HISTOGRAM));
+
+  return true;
+}
+
+// one line per stage: name count min avg max, then "<2^i>:<count>" for every
+// non empty bucket
+void webSocket_tracePrint(Print &out)
+{
+  for (uint8_t i = 0; i < WEBSOCKET_TRACE_STAGE_MAX; i++)
+  {
+    WEB_SOCKET_TRACE_HISTOGRAM *histogram = &g_webSocketTrace[i];
+
+    out.print(g_webSocketTraceName[i]);
+    out.print(" n=");
+    out.print((unsigned long) histogram->count);
+    out.print(" min=");
+    out.print((unsigned long) histogram->min);
+    out.print(" avg=");
+
+    if (histogram->count)
+    {
+      out.print((unsigned long)(histogram->total / histogram->count));
+    }
+    else
+    {
+      out.print(0);
+    }
+
+    out.print(" max=");
+    out.print((unsigned long) histogram->max);
+
+    for (uint8_t j = 0; j < WEB_SOCKET_TRACE_BUCKETS; j++)
+    {
+      if (histogram->bucket[j])
+      {
+        out.print(" ");
+        out.print(1UL << j);
+        out.print(":");
+        out.print((unsigned long) histogram->bucket[j]);
+      }
+    }
+
+    out.println();
+  }
+}
+
+#endif // WEBSOCKET_TRACE
@@ -0,0 +1,77 @@
+/*
+ * @file    webSocketTrace.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_TRACE_H_
+#define WEBSOCKET_TRACE_H_
+
+#include <Print.h>
+#include "webSocket.h"
+
+#if !defined(ARDUINO) && !defined(__x86_64__) && !defined(__i386__)
+#include <time.h>
+#endif
+
+// bucket i counts spans of [2^i, 2^(i+1)) clock ticks, the last one
+// collects everything longer
+#define WEB_SOCKET_TRACE_BUCKETS		24u
+
+enum webSocketTraceStage {
+  WEBSOCKET_TRACE_HEADER = 0,  // webSocket_readFrameHeader
+  WEBSOCKET_TRACE_PAYLOAD,     // webSocket_readFramePayload (read + unmask)
+  WEBSOCKET_TRACE_HANDLER,     // receive handler dispatch
+  WEBSOCKET_TRACE_STATE,       // webSocket_stateControl
+  WEBSOCKET_TRACE_ENCODE,      // webSocket_setData (header + mask)
+  WEBSOCKET_TRACE_WRITE,       // client.write
+  WEBSOCKET_TRACE_STAGE_MAX
+};
+
+typedef struct _WEB_SOCKET_TRACE_HISTOGRAM
+{
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+  uint32_t bucket[WEB_SOCKET_TRACE_BUCKETS];
+} WEB_SOCKET_TRACE_HISTOGRAM;
+
+#ifdef WEBSOCKET_TRACE
+
+// CPU cycles on the device, TSC or nanoseconds on a host
+static inline uint32_t webSocket_traceClock(void)
+{
+#if defined(ARDUINO)
+  return ESP.getCycleCount();
+#elif defined(__x86_64__) || defined(__i386__)
+  return (uint32_t) __builtin_ia32_rdtsc();
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint32_t)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+#endif
+}
+
+#define WEB_SOCKET_TRACE_BEGIN(stage)	uint32_t trace_##stage = webSocket_traceClock()
+#define WEB_SOCKET_TRACE_END(stage)	webSocket_traceRecord(stage, webSocket_traceClock() - trace_##stage)
+
+extern void webSocket_traceRecord(uint8_t stage, uint32_t ticks);
+extern void webSocket_traceReset(void);
+extern bool webSocket_traceGetHistogram(uint8_t stage,
+                                        WEB_SOCKET_TRACE_HISTOGRAM *dist);
+extern void webSocket_tracePrint(Print &out);
+
+#else
+
+#define WEB_SOCKET_TRACE_BEGIN(stage)
+#define WEB_SOCKET_TRACE_END(stage)
+
+#endif // WEBSOCKET_TRACE
+
+#endif /* WEBSOCKET_TRACE_H_ */
@@ -0,0 +1,153 @@
+/*
+ * @file    webSocketUtf8.cpp
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#include <cstdint>
+#include "webSocketUtf8.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// native word for the ASCII fast path: 4 bytes on the device, 8 on a 64 bit
+// host. may_alias allows reading the byte buffer through it.
+typedef size_t __attribute__((__may_alias__)) webSocketUtf8Word;
+
+#define WEB_SOCKET_UTF8_ASCII_MASK	((size_t) -1 / 0xFF * 0x80)
+
+static size_t webSocket_utf8AsciiSpan(const uint8_t *data, size_t length);
+
+void webSocket_utf8Reset(WEB_SOCKET_UTF8_STATE *state)
+{
+  state->remaining = 0;
+  state->lower = 0x80;
+  state->upper = 0xBF;
+}
+
+bool webSocket_utf8IsComplete(const WEB_SOCKET_UTF8_STATE *state)
+{
+  return state->remaining == 0;
+}
+
+bool webSocket_utf8Validate(WEB_SOCKET_UTF8_STATE *state,
+                            const uint8_t *data, size_t length)
+{
+  size_t i = 0;
+  uint8_t b = 0;
+
+  while (i < length)
+  {
+    if (state->remaining == 0)
+    {
+      i += webSocket_utf8AsciiSpan(&data[i], length - i);
+
+      if (i >= length)
+      {
+        break;
+      }
+
+      b = data[i++];
+
+      if ((b >= 0xC2) && (b <= 0xDF))
+      {
+        state->remaining = 1;
+      }
+      else if (b == 0xE0)
+      {
+        state->remaining = 2;
+        state->lower = 0xA0;  // overlong
+      }
+      else if (b == 0xED)
+      {
+        state->remaining = 2;
+        state->upper = 0x9F;  // surrogates
+      }
+      else if ((b >= 0xE1) && (b <= 0xEF))
+      {
+        state->remaining = 2;
+      }
+      else if (b == 0xF0)
+      {
+        state->remaining = 3;
+        state->lower = 0x90;  // overlong
+      }
+      else if (b == 0xF4)
+      {
+        state->remaining = 3;
+        state->upper = 0x8F;  // above U+10FFFF
+      }
+      else if ((b >= 0xF1) && (b <= 0xF3))
+      {
+        state->remaining = 3;
+      }
+      else
+      {
+        return false;
+      }
+    }
+    else
+    {
+      b = data[i++];
+
+      if ((b < state->lower) || (b > state->upper))
+      {
+        return false;
+      }
+
+      state->remaining--;
+      state->lower = 0x80;
+      state->upper = 0xBF;
+    }
+  }
+
+  return true;
+}
+
+// number of leading ASCII bytes: 16 at a time with SSE2, then a native word
+// at a time, then byte by byte
+static size_t webSocket_utf8AsciiSpan(const uint8_t *data, size_t length)
+{
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  for (; i + 16 <= length; i += 16)
+  {
+    if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *) &data[i])))
+    {
+      break;
+    }
+  }
+#endif // __SSE2__
+
+  while ((i < length)
+         && ((uintptr_t) &data[i] & (sizeof(webSocketUtf8Word) - 1)))
+  {
+    if (data[i] & 0x80)
+    {
+      return i;
+    }
+
+    i++;
+  }
+
+  for (; i + sizeof(webSocketUtf8Word) <= length;
+       i += sizeof(webSocketUtf8Word))
+  {
+    if (*(const webSocketUtf8Word *) &data[i] & WEB_SOCKET_UTF8_ASCII_MASK)
+    {
+      break;
+    }
+  }
+
+  while ((i < length) && !(data[i] & 0x80))
+  {
+    i++;
+  }
+
+  return i;
+}
@@ -0,0 +1,31 @@
+/*
+ * @file    webSocketUtf8.h
+ * @version 0.7.0 (beta)
+ * 
+ * Dual licensed under the MIT or GPL Version 2 (2.1) licenses.
+ * Copyright (c) 2016 visyeii
+ * 
+ */
+
+#ifndef WEBSOCKET_UTF8_H_
+#define WEBSOCKET_UTF8_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Incremental UTF-8 validator (RFC 3629). The state carries a code point
+// that is split across calls, so a text message can be checked chunk by
+// chunk and frame by frame.
+typedef struct _WEB_SOCKET_UTF8_STATE
+{
+  uint8_t remaining;  // continuation bytes still expected
+  uint8_t lower;      // allowed range of the next continuation byte
+  uint8_t upper;
+} WEB_SOCKET_UTF8_STATE;
+
+extern void webSocket_utf8Reset(WEB_SOCKET_UTF8_STATE *state);
+extern bool webSocket_utf8Validate(WEB_SOCKET_UTF8_STATE *state,
+                                   const uint8_t *data, size_t length);
+extern bool webSocket_utf8IsComplete(const WEB_SOCKET_UTF8_STATE *state);
+
+#endif /* WEBSOCKET_UTF8_H_ */
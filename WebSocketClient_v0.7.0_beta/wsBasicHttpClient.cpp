@@ -7,7 +7,9 @@
  * 
  */
 
+#include <ESP8266WiFi.h>
 #include "wsBasicHttpClient.h"
+#include "webSocketLog.h"
 /**
  * constructor
  */
@@ -28,11 +30,116 @@ wsHTTPClient::~wsHTTPClient()
         delete[] _currentHeaders;
     }
 }
+/**
+ * ws:// and wss:// are mapped to http:// and https://, the port defaults to
+ * 80 and 443
+ */
+bool wsHTTPClient::begin(String url)
+{
+    int index = url.indexOf("://");
+    String scheme;
+    String rest;
+    String authority;
+
+    if(index < 0) {
+        return false;
+    }
+
+    scheme = url.substring(0, index);
+    rest = url.substring(index + 3);
+    authority = rest;
+
+    if(authority.indexOf('/') >= 0) {
+        authority = authority.substring(0, authority.indexOf('/'));
+    }
+    if(authority.indexOf('@') >= 0) {
+        authority = authority.substring(authority.indexOf('@') + 1);
+    }
+
+    resetCache();
+    _secure = (scheme == "wss") || (scheme == "https");
+
+#ifndef WEBSOCKET_TLS
+    if(_secure) {
+        return false;
+    }
+#endif // WEBSOCKET_TLS
+
+    if(!HTTPClient::begin(String("http://") + rest)) {
+        return false;
+    }
+
+    if(_secure) {
+        _protocol = "https";
+        if(authority.indexOf(':') < 0) {
+            _port = 443;
+        }
+    }
+
+    return true;
+}
+
+uint32_t wsHTTPClient::getConnectTime(void)
+{
+    return _connectTime;
+}
+
+#ifdef WEBSOCKET_TLS
+void wsHTTPClient::setFingerprint(const uint8_t * fingerprint)
+{
+    _fingerprint = fingerprint;
+}
+
+void wsHTTPClient::setTrustAnchors(const BearSSL::X509List * trustAnchors)
+{
+    _trustAnchors = trustAnchors;
+}
+
+/**
+ * BearSSL accepts 512 to 16384; a receive buffer below 16384 needs a server
+ * supporting max fragment length negotiation, checked once on connect
+ */
+void wsHTTPClient::setBufferSizes(int recv, int xmit)
+{
+    _tlsRecv = recv;
+    _tlsXmit = xmit;
+    _tlsProbed = false;
+}
+#endif // WEBSOCKET_TLS
+
 void wsHTTPClient::setUpgrade(bool upgrade)
 {
     _upgrade = upgrade;
 }
 
+/**
+ * TCP (and TLS) connect without sending the request, a later GET() uses
+ * the open connection
+ */
+bool wsHTTPClient::warm(void)
+{
+    return connect();
+}
+
+/**
+ * close the connection, the cached address and request are kept
+ */
+void wsHTTPClient::disconnect(void)
+{
+    if(_tcp) {
+        _tcp->stop();
+    }
+}
+
+/**
+ * drop the cached address and request header
+ */
+void wsHTTPClient::resetCache(void)
+{
+    _hasAddress = false;
+    _request = "";
+}
+
 int wsHTTPClient::GET()
 {
     return sendRequest("GET");
@@ -65,12 +172,121 @@ int wsHTTPClient::sendRequest(const char * type, uint8_t * payload, size_t size)
     return returnError(handleHeaderResponse());
 }
 
+/**
+ * HTTPClient::connect() resolving _host only once
+ */
+bool wsHTTPClient::connect(void)
+{
+    if(connected()) {
+        while(_tcp->available() > 0) {
+            _tcp->read();
+        }
+        return true;
+    }
+
+#ifdef WEBSOCKET_TLS
+    if(_secure) {
+        return connectSecure();
+    }
+#endif // WEBSOCKET_TLS
+
+    if(!_transportTraits) {
+        return false;
+    }
+
+    _connectTime = millis();
+
+    if(!_hasAddress) {
+        if(!WiFi.hostByName(_host.c_str(), _address)) {
+            return false;
+        }
+        _hasAddress = true;
+    }
+
+    _tcp = _transportTraits->create();
+
+    if(!_tcp->connect(_address, _port)) {
+        _hasAddress = false; // the server may have moved, resolve again
+        return false;
+    }
+
+    if(!_transportTraits->verify(*_tcp, _host.c_str())) {
+        _tcp->stop();
+        return false;
+    }
+
+    _tcp->setTimeout(_tcpTimeout);
+    _tcp->setNoDelay(true);
+
+    _connectTime = millis() - _connectTime;
+
+    return connected();
+}
+
+#ifdef WEBSOCKET_TLS
+/**
+ * TLS connect with BearSSL. The session of the last handshake is offered
+ * again, so a reconnect to the same server resumes it (session ID) and
+ * skips the key exchange. The host name is used, not the cached address,
+ * for SNI and certificate name checks.
+ */
+bool wsHTTPClient::connectSecure(void)
+{
+    BearSSL::WiFiClientSecure * tls = NULL;
+
+    if(!_fingerprint && !_trustAnchors) {
+        return false; // no way to check the server
+    }
+
+    _connectTime = millis();
+
+    if(!_tlsProbed) {
+        // without MFLN the server may send records of 16k
+        if(!BearSSL::WiFiClientSecure::probeMFLN(_host.c_str(), _port, _tlsRecv)) {
+            _tlsRecv = 16384;
+        }
+        _tlsProbed = true;
+    }
+
+    tls = new BearSSL::WiFiClientSecure();
+    _tcp.reset(tls);
+
+    tls->setBufferSizes(_tlsRecv, _tlsXmit);
+    tls->setSession(&_session);
+
+    if(_fingerprint) {
+        tls->setFingerprint(_fingerprint);
+    } else {
+        tls->setTrustAnchors(_trustAnchors);
+    }
+
+    if(!tls->connect(_host.c_str(), _port)) {
+        return false;
+    }
+
+    _tcp->setTimeout(_tcpTimeout);
+    _tcp->setNoDelay(true);
+
+    _connectTime = millis() - _connectTime;
+
+    return connected();
+}
+#endif // WEBSOCKET_TLS
+
 bool wsHTTPClient::sendHeader(const char * type)
 {
+    bool isGet = (strcmp(type, "GET") == 0);
+
     if(!connected()) {
         return false;
     }
 
+    // only the upgrade GET repeats on every reconnect, other methods are
+    // built each time
+    if(isGet && _request.length()) {
+        return (_tcp->write((const uint8_t *) _request.c_str(), _request.length()) == _request.length());
+    }
+
     String header = String(type) + " " + _uri + F(" HTTP/1.");
 
     if(_useHTTP10) {
@@ -106,7 +322,11 @@ bool wsHTTPClient::sendHeader(const char * type)
 
     header += _headers + "\r\n";
 
-    Serial.print(header);//debug
+    WEB_SOCKET_LOG_DEBUG("HTTP request %u bytes", header.length());
+
+    if(isGet) {
+        _request = header;
+    }
 
     return (_tcp->write((const uint8_t *) header.c_str(), header.length()) == header.length());
 }
@@ -11,6 +11,11 @@
 #define WSBASICHTTPCLIENT_H_
 
 #include <ESP8266HTTPClient.h>
+#include <IPAddress.h>
+#include "webSocketConfig.h"
+#ifdef WEBSOCKET_TLS
+#include <WiFiClientSecureBearSSL.h>
+#endif // WEBSOCKET_TLS
 
 class wsHTTPClient: public HTTPClient {
 
@@ -18,14 +23,41 @@ public:
 	wsHTTPClient();
     ~wsHTTPClient();
 
+    bool begin(String url);///ws://, wss:// (WEBSOCKET_TLS), http:// or https://
     void setUpgrade(bool upgrade);///upgrade
     int GET();
     int sendRequest(const char * type, uint8_t * payload = NULL, size_t size = 0);
+    bool warm(void);///connect ahead of GET(), for a standby
+    void disconnect(void);
+    void resetCache(void);///call after changing the url or headers
+    uint32_t getConnectTime(void);///msec of the last TCP and TLS connect
+#ifdef WEBSOCKET_TLS
+    void setFingerprint(const uint8_t * fingerprint);///SHA1 of the server certificate
+    void setTrustAnchors(const BearSSL::X509List * trustAnchors);
+    void setBufferSizes(int recv, int xmit);///TLS record buffers
+#endif // WEBSOCKET_TLS
 
 protected:
+    bool connect(void);
+#ifdef WEBSOCKET_TLS
+    bool connectSecure(void);
+#endif // WEBSOCKET_TLS
     bool sendHeader(const char * type);
 
     bool _upgrade = false;
+    bool _hasAddress = false;
+    IPAddress _address;///resolved _host, kept across reconnects
+    String _request;///GET request header, built by the first sendHeader("GET")
+    uint32_t _connectTime = 0;
+    bool _secure = false;
+#ifdef WEBSOCKET_TLS
+    BearSSL::Session _session;///kept across reconnects for resumption
+    const uint8_t * _fingerprint = NULL;
+    const BearSSL::X509List * _trustAnchors = NULL;
+    int _tlsRecv = WEB_SOCKET_TLS_RECV_SIZE;
+    int _tlsXmit = WEB_SOCKET_TLS_XMIT_SIZE;
+    bool _tlsProbed = false;///server answered the MFLN probe once
+#endif // WEBSOCKET_TLS
 };
 
 #endif /* WSBASICHTTPCLIENT_H_ */
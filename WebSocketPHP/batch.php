@@ -0,0 +1,48 @@
+<?php
+// Decoder for the sample batches of webSocketBatch.cpp:
+// 0xc1 0x02 version varint(time) then varint(channel) varint(dt) zigzag(dv)
+// per sample. Returns array(array(time, channel, value), ...) or NULL.
+
+function batch_decode($data)
+{
+	$offset = 3;
+	$samples = array();
+	$last = array();
+
+	if(strlen($data) < 4 || ord($data[0]) != 0xc1 || ord($data[1]) != 0x02 || ord($data[2]) != 1)
+		return NULL;
+
+	try {
+		$time = batch_read_varint($data, $offset);
+		while($offset < strlen($data)) {
+			$channel = batch_read_varint($data, $offset);
+			$time = ($time + batch_read_varint($data, $offset)) & 0xffffffff;
+			$delta = batch_read_varint($data, $offset);
+			$delta = ($delta >> 1) ^ -($delta & 1); //zigzag
+			$value = (isset($last[$channel]) ? $last[$channel] : 0) + $delta;
+			$value = ($value & 0xffffffff);
+			if($value >= 0x80000000)
+				$value -= 0x100000000; //int32 wrap, like the client
+			$last[$channel] = $value;
+			$samples[] = array($time, $channel, $value);
+		}
+	} catch (Exception $e) {
+		return NULL;
+	}
+	return $samples;
+}
+
+//LEB128, at most 5 bytes for 32 bits
+function batch_read_varint($data, &$offset)
+{
+	$value = 0;
+	for ($shift = 0; $shift < 35; $shift += 7) {
+		if($offset >= strlen($data))
+			throw new Exception('batch: truncated');
+		$byte = ord($data[$offset++]);
+		$value |= ($byte & 0x7f) << $shift;
+		if(($byte & 0x80) == 0)
+			return $value & 0xffffffff;
+	}
+	throw new Exception('batch: varint too long');
+}
@@ -0,0 +1,114 @@
+<?php
+// MessagePack decoder for binary frames sent by the ESP8266 client.
+// Maps are returned as associative arrays, str and bin as PHP strings.
+
+function msgpack_decode($data)
+{
+	$offset = 0;
+	try {
+		$value = msgpack_decode_value($data, $offset);
+	} catch (Exception $e) {
+		return NULL;
+	}
+	if($offset != strlen($data))
+		return NULL; //trailing bytes
+	return $value;
+}
+
+//read an unsigned big-endian integer of $size bytes
+function msgpack_read_uint($data, &$offset, $size)
+{
+	if($offset + $size > strlen($data))
+		throw new Exception('msgpack: truncated');
+	$value = 0;
+	for ($i = 0; $i < $size; ++$i) {
+		$value = ($value << 8) | ord($data[$offset++]);
+	}
+	return $value;
+}
+
+function msgpack_read_int($data, &$offset, $size)
+{
+	$value = msgpack_read_uint($data, $offset, $size);
+	$bits = $size * 8;
+	if($bits < 64 && $value >= (1 << ($bits - 1)))
+		$value -= (1 << $bits);
+	return $value;
+}
+
+function msgpack_read_bytes($data, &$offset, $length)
+{
+	if($offset + $length > strlen($data))
+		throw new Exception('msgpack: truncated');
+	$bytes = substr($data, $offset, $length);
+	$offset += $length;
+	return $bytes;
+}
+
+function msgpack_decode_array($data, &$offset, $count)
+{
+	$items = array();
+	for ($i = 0; $i < $count; ++$i) {
+		$items[] = msgpack_decode_value($data, $offset);
+	}
+	return $items;
+}
+
+function msgpack_decode_map($data, &$offset, $count)
+{
+	$items = array();
+	for ($i = 0; $i < $count; ++$i) {
+		$key = msgpack_decode_value($data, $offset);
+		$items[$key] = msgpack_decode_value($data, $offset);
+	}
+	return $items;
+}
+
+function msgpack_decode_value($data, &$offset)
+{
+	$marker = msgpack_read_uint($data, $offset, 1);
+
+	if($marker <= 0x7f) //positive fixint
+		return $marker;
+	if($marker >= 0xe0) //negative fixint
+		return $marker - 0x100;
+	if($marker <= 0x8f) //fixmap
+		return msgpack_decode_map($data, $offset, $marker & 0x0f);
+	if($marker <= 0x9f) //fixarray
+		return msgpack_decode_array($data, $offset, $marker & 0x0f);
+	if($marker <= 0xbf) //fixstr
+		return msgpack_read_bytes($data, $offset, $marker & 0x1f);
+
+	switch($marker) {
+		case 0xc0: return NULL;
+		case 0xc2: return false;
+		case 0xc3: return true;
+		case 0xc4: case 0xc5: case 0xc6: //bin 8/16/32
+		case 0xd9: case 0xda: case 0xdb: //str 8/16/32
+			$size = 1 << (($marker >= 0xd9 ? $marker - 0xd9 : $marker - 0xc4));
+			$length = msgpack_read_uint($data, $offset, $size);
+			return msgpack_read_bytes($data, $offset, $length);
+		case 0xc7: case 0xc8: case 0xc9: //ext 8/16/32, returned as raw bytes
+			$length = msgpack_read_uint($data, $offset, 1 << ($marker - 0xc7));
+			return msgpack_read_bytes($data, $offset, $length + 1);
+		case 0xca:
+			$bytes = msgpack_read_bytes($data, $offset, 4);
+			return unpack('G', $bytes)[1];
+		case 0xcb:
+			$bytes = msgpack_read_bytes($data, $offset, 8);
+			return unpack('E', $bytes)[1];
+		case 0xcc: case 0xcd: case 0xce: case 0xcf:
+			return msgpack_read_uint($data, $offset, 1 << ($marker - 0xcc));
+		case 0xd0: case 0xd1: case 0xd2: case 0xd3:
+			return msgpack_read_int($data, $offset, 1 << ($marker - 0xd0));
+		case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8: //fixext
+			return msgpack_read_bytes($data, $offset, 1 + (1 << ($marker - 0xd4)));
+		case 0xdc: case 0xdd:
+			$count = msgpack_read_uint($data, $offset, $marker == 0xdc ? 2 : 4);
+			return msgpack_decode_array($data, $offset, $count);
+		case 0xde: case 0xdf:
+			$count = msgpack_read_uint($data, $offset, $marker == 0xde ? 2 : 4);
+			return msgpack_decode_map($data, $offset, $count);
+	}
+	throw new Exception('msgpack: invalid marker');
+}
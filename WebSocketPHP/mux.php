@@ -0,0 +1,16 @@
+<?php
+// Logical channels of webSocketMux.cpp: 0xc1 0x03 channel message.
+// The server handles each message at once, so credit is granted back right
+// away with 0xc1 0x04 channel length(16 bit BE) in a binary frame.
+
+function mux_decode($data)
+{
+	if(strlen($data) < 3 || ord($data[0]) != 0xc1 || ord($data[1]) != 0x03)
+		return NULL;
+	return array(ord($data[2]), (string) substr($data, 3));
+}
+
+function mux_credit($channel, $length)
+{
+	return pack('CCCCCn', 0x80 | 0x2, 5, 0xc1, 0x04, $channel, $length);
+}
@@ -1,9 +1,13 @@
 <?php
 // https://github.com/sanwebe/Chat-Using-WebSocket-and-PHP-Socket
 $host = 'localhost'; //host
-$port = '8080'; //port
+$port = isset($argv[1]) ? $argv[1] : '8080'; //port, php server.php 8081 for another instance
 $null = NULL; //null var
 
+require_once __DIR__ . '/msgpack.php';
+require_once __DIR__ . '/batch.php';
+require_once __DIR__ . '/mux.php';
+
 //Create TCP/IP sream socket
 $socket = socket_create(AF_INET, SOCK_STREAM, SOL_TCP);
 //reuseable port
@@ -50,9 +54,36 @@ while (true) {
 		while(socket_recv($changed_socket, $buf, 1024, 0) >= 1)
 		{
 			//var_dump($buf);
+			$opcode = ord($buf[0]) & 0x0f;
 			$received_text = unmask($buf); //unmask data
 			//var_dump($received_text);
-			$tst_msg = json_decode($received_text); //json decode
+			if($opcode == 0x2 && ord($received_text[0]) == 0xc1 && ord($received_text[1]) == 0x02) {
+				//sensor samples batched by the client
+				$samples = batch_decode($received_text);
+				if($samples !== NULL) {
+					send_message(mask(json_encode(array('type'=>'samples', 'samples'=>$samples))));
+				}
+				break 2; //exist this loop
+			}
+			if($opcode == 0x2 && ord($received_text[0]) == 0xc1 && ord($received_text[1]) == 0x03) {
+				//logical channel message, the payload may be binary
+				list($channel, $message) = mux_decode($received_text);
+				send_message(mask(json_encode(array('type'=>'mux', 'channel'=>$channel, 'message'=>base64_encode($message)))));
+				$credit = mux_credit($channel, strlen($message));
+				@socket_write($changed_socket, $credit, strlen($credit));
+				break 2; //exist this loop
+			}
+			if($opcode == 0x2 && ord($received_text[0]) != 0xc1) {
+				//MessagePack from the client, 0xc1 tags library messages
+				$tst_msg = msgpack_decode($received_text); //NULL when malformed
+				$tst_msg = is_array($tst_msg) ? (object) $tst_msg : NULL;
+			}
+			else {
+				$tst_msg = json_decode($received_text); //json decode
+			}
+			if(!is_object($tst_msg)) {
+				break 2; //not a chat message, drop it
+			}
 			//var_dump($tst_msg);
 			$user_name = $tst_msg->name; //sender name
 			$user_message = $tst_msg->message; //message text